@@ -0,0 +1,1004 @@
+/*
+* Benchmarks for lm2
+*
+*   latency     one call feeding the next, time per dependent call
+*   throughput  every operation family over arrays sized for L1, L2, last level cache and DRAM,
+*               ns per operation and GB/s of loaded and stored data. Rows marked soa run the
+*               8 lane stream / matrix array kernels of lm2_soa.hpp
+*   compare     pairs of ways of computing the same result, checked against unchecked division,
+*               operator chains against fma / lerp and the soa streams, std::mt19937 against
+*               lm2::random, scalar spline calls against the soa bulk path, single rays against
+*               8 ray packets on a lm2_bvh tree, SAH against linear BVH builds, single noise
+*               samples against soa streams and a 4096 x 4096 heightfield fill, AABB against OBB
+*               fits of 64 point meshlets, normals and tangents of a 1M triangle mesh on one thread
+*               and on the pool, per normal SH evaluation against the packed 8 lane irradiance and
+*               a cubemap projection, per channel pow against the sRGB tables and polynomial and
+*               pixel format conversions of a 3840 x 2160 image in GB/s
+*
+* Pass section names to run only those, e.g. commonLMBench latency throughput.
+* commonLMBench is the scalar build and commonLMBenchSIMD the LM2_SIMD build, running both
+* compares the scalar and vectorized versions of every row.
+* Build with optimizations, e.g. -DCMAKE_BUILD_TYPE=Release, the numbers are meaningless otherwise
+*/
+#include "lm2.hpp"
+#include "lm2_bvh.hpp"
+#include "lm2_color.hpp"
+#include "lm2_mesh.hpp"
+#include "lm2_morton.hpp"
+#include "lm2_noise.hpp"
+#include "lm2_obb.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_random.hpp"
+#include "lm2_sh.hpp"
+#include "lm2_soa.hpp"
+#include "lm2_spline.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace lm2;
+
+namespace {
+
+constexpr size_t elementCount = 1 << 16;
+constexpr int repeats = 200;
+
+float sink = 0;
+
+// Best of repeats, in nanoseconds per element
+template<typename Func>
+double measure(Func func) {
+	double best = 1e30;
+	for (int i = 0; i < repeats; i++) {
+		auto start = std::chrono::steady_clock::now();
+		func();
+		auto end = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - start).count() / elementCount;
+		best = ns < best ? ns : best;
+	}
+	return best;
+}
+
+template<typename V>
+void fill(std::vector<V>& values, float offset) {
+	float* data = reinterpret_cast<float*>(values.data());
+	size_t count = values.size() * sizeof(V) / sizeof(float);
+	for (size_t i = 0; i < count; i++) {
+		data[i] = offset + static_cast<float>(i % 97);
+	}
+}
+
+void report(const char* name, const char* baselineName, double baseline, const char* candidateName, double candidate) {
+	std::printf("%-28s %-9s %7.3f ns  %-9s %7.3f ns  x%.2f\n", name, baselineName, baseline, candidateName, candidate, baseline / candidate);
+}
+
+template<typename V>
+void benchDivision(const char* name) {
+	std::vector<V> a(elementCount), b(elementCount), out(elementCount);
+	fill(a, 0.0f);
+	fill(b, 1.0f);
+
+	double checked = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = a[i] / b[i];
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double unchecked = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = unchecked::divide(a[i], b[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report(name, "checked", checked, "unchecked", unchecked);
+}
+
+template<typename V>
+void benchScalarDivision(const char* name) {
+	std::vector<V> a(elementCount), out(elementCount);
+	std::vector<float> s(elementCount);
+	fill(a, 0.0f);
+	fill(s, 1.0f);
+
+	double checked = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = a[i] / s[i];
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double unchecked = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = unchecked::divide(a[i], s[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report(name, "checked", checked, "unchecked", unchecked);
+}
+
+template<typename V>
+void benchModulo(const char* name) {
+	std::vector<V> a(elementCount), b(elementCount), out(elementCount);
+	fill(a, 0.0f);
+	fill(b, 1.0f);
+
+	double checked = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = a[i] % b[i];
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double unchecked = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = unchecked::modulo(a[i], b[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report(name, "checked", checked, "unchecked", unchecked);
+}
+
+// out = a * s + c, the integration step of a particle update
+template<typename V>
+void benchFma(const char* name) {
+	std::vector<V> a(elementCount), c(elementCount), out(elementCount);
+	fill(a, 0.0f);
+	fill(c, 1.0f);
+	const float s = 0.016f;
+
+	double chained = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = a[i] * s + c[i];
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double fused = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = fma(a[i], s, c[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report(name, "operators", chained, "fma", fused);
+}
+
+template<typename V>
+void benchLerp(const char* name) {
+	std::vector<V> a(elementCount), b(elementCount), out(elementCount);
+	std::vector<float> t(elementCount);
+	fill(a, 0.0f);
+	fill(b, 1.0f);
+	for (size_t i = 0; i < elementCount; i++) {
+		t[i] = static_cast<float>(i % 100) / 100.0f;
+	}
+
+	double chained = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = a[i] + (b[i] - a[i]) * t[i];
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double fused = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = lerp(a[i], b[i], t[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report(name, "operators", chained, "lerp", fused);
+}
+
+void benchStreams() {
+	std::vector<vec3> a(elementCount), b(elementCount), out(elementCount);
+	std::vector<float> t(elementCount);
+	fill(a, 0.0f);
+	fill(b, 1.0f);
+	fill(t, 0.0f);
+	soa::vec3Stream sa, sb, sout;
+	soa::floatStream st;
+	soa::fromAoS(a.data(), elementCount, sa);
+	soa::fromAoS(b.data(), elementCount, sb);
+	st.resize(elementCount);
+	for (size_t i = 0; i < elementCount; i++) {
+		st.set(i, t[i]);
+	}
+
+	double fused = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = fma(a[i], 0.016f, b[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double stream = measure([&] {
+		soa::fma(sa, 0.016f, sb, sout);
+		sink += sout.get(elementCount / 2).x;
+	});
+	report("vec3 fma, soa stream", "fma", fused, "stream", stream);
+
+	fused = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = lerp(a[i], b[i], t[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	stream = measure([&] {
+		soa::lerp(sa, sb, st, sout);
+		sink += sout.get(elementCount / 2).x;
+	});
+	report("vec3 lerp, soa stream", "lerp", fused, "stream", stream);
+}
+
+// Latency
+
+constexpr size_t latencyCalls = 1 << 16;
+constexpr int latencyRepeats = 50;
+
+// Copy through volatile memory, the compiler can't fold a chain starting from the result
+template<typename V>
+V opaque(const V& value) {
+	volatile unsigned char bytes[sizeof(V)];
+	const unsigned char* src = reinterpret_cast<const unsigned char*>(&value);
+	for (size_t i = 0; i < sizeof(V); i++) {
+		bytes[i] = src[i];
+	}
+	V result;
+	unsigned char* dst = reinterpret_cast<unsigned char*>(&result);
+	for (size_t i = 0; i < sizeof(V); i++) {
+		dst[i] = bytes[i];
+	}
+	return result;
+}
+
+// Best of latencyRepeats, in nanoseconds per call, step's result is the next call's argument
+template<typename V, typename Step>
+void latencyRow(const char* name, V start, Step step) {
+	double best = 1e30;
+	for (int r = 0; r < latencyRepeats; r++) {
+		V value = opaque(start);
+		auto begin = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < latencyCalls; i++) {
+			value = step(value);
+		}
+		auto end = std::chrono::steady_clock::now();
+		// Every lane, or the compiler drops the parts of a matrix chain that don't reach the first
+		const float* lanes = reinterpret_cast<const float*>(&value);
+		for (size_t k = 0; k < sizeof(V) / sizeof(float); k++) {
+			sink += lanes[k];
+		}
+		double ns = std::chrono::duration<double, std::nano>(end - begin).count() / latencyCalls;
+		best = ns < best ? ns : best;
+	}
+	std::printf("%-28s %8.3f ns\n", name, best);
+}
+
+void benchLatency() {
+	std::printf("\nlatency, best of %d chains of %zu dependent calls\n", latencyRepeats, latencyCalls);
+
+	// Weights summing to 1 keep the dot chains away from denormals and infinity
+	const vec3 axis = normalize(vec3{ 1, 2, 3 });
+	const vec3 weights3{ 0.5f, 0.3f, 0.2f };
+	const vec4 weights4{ 0.4f, 0.3f, 0.2f, 0.1f };
+	const vec4 offset{ 0.5f, 0.25f, 0.125f, 0.0625f };
+	const mat3 rotation3 = rotation3D(vec3{ 10, 20, 30 });
+	// Matrices go through opaque so the compiler can't fold their zero entries into the scalar code
+	const mat4 rotation = opaque(mat4(rotation3));
+
+	latencyRow("vec3 + vec3", vec3{ 1, 2, 3 }, [&](vec3 v) { return v + axis; });
+	latencyRow("vec4 + vec4", vec4{ 1, 2, 3, 4 }, [&](vec4 v) { return v + offset; });
+	latencyRow("vec4 * float", vec4{ 1, 2, 3, 4 }, [](vec4 v) { return v * 0.999f; });
+	latencyRow("dot vec3", vec3{ 1, 2, 3 }, [&](vec3 v) { return vec3{ dot(v, weights3), v.z, v.x }; });
+	latencyRow("dot vec4", vec4{ 1, 2, 3, 4 }, [&](vec4 v) { return vec4{ dot(v, weights4), v.x, v.y, v.z }; });
+	latencyRow("cross vec3", vec3{ 1, 0, 0 }, [&](vec3 v) { return cross(v, axis); });
+	latencyRow("normalize vec3", vec3{ 1, 2, 3 }, [](vec3 v) { return normalize(v); });
+	latencyRow("normalize vec4", vec4{ 1, 2, 3, 4 }, [](vec4 v) { return normalize(v); });
+	latencyRow("mat4 * vec4", vec4{ 1, 2, 3, 1 }, [&](vec4 v) { return rotation * v; });
+	latencyRow("mat3 * mat3", mat3(rotation3D(vec3{ 1, 2, 3 })), [&](mat3 m) { return rotation3 * m; });
+	latencyRow("mat4 * mat4", rotation, [&](mat4 m) { return rotation * m; });
+	latencyRow("rotation3D", vec3{ 10, 20, 30 }, [](vec3 v) {
+		return rotation3D(v).x * 90.0f;
+	});
+	latencyRow("perspective", 60.0f, [](float fov) {
+		return 60.0f + perspective(fov, 0.1f, 100.0f, 0.5625f).x.x * 0.001f;
+	});
+	latencyRow("lookAt", vec3{ 1, 2, 10 }, [](vec3 eye) {
+		mat4 view = lookAt(eye, vec3{ 0, 0, 0 }, vec3{ 0, 1, 0 });
+		return vec3{ 1.0f + view.x.x * 0.001f, 2, 10 };
+	});
+}
+
+// Throughput
+
+struct workingSet {
+	const char* name;
+	size_t bytes;
+};
+
+constexpr workingSet workingSets[] = {
+	{ "L1 16K", size_t(16) << 10 },
+	{ "L2 256K", size_t(256) << 10 },
+	{ "LLC 4M", size_t(4) << 20 },
+	{ "DRAM 64M", size_t(64) << 20 },
+};
+
+// Elements processed per sample, small working sets are swept several times
+constexpr size_t minSampleElements = 1 << 22;
+constexpr int throughputSamples = 7;
+
+// Best of throughputSamples, in nanoseconds per element
+template<typename Func>
+double measureArray(size_t count, Func func) {
+	size_t passes = std::max<size_t>(minSampleElements / count, 1);
+	func();
+	double best = 1e30;
+	for (int s = 0; s < throughputSamples; s++) {
+		auto begin = std::chrono::steady_clock::now();
+		for (size_t p = 0; p < passes; p++) {
+			func();
+		}
+		auto end = std::chrono::steady_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - begin).count() / double(passes * count);
+		best = ns < best ? ns : best;
+	}
+	return best;
+}
+
+// kernel(count) prepares count elements of bytesPerOp loaded and stored bytes and returns ns per element
+template<typename Kernel>
+void throughputRow(const char* name, const char* path, size_t bytesPerOp, Kernel kernel) {
+	std::printf("%-28s %-4s", name, path);
+	for (const workingSet& set : workingSets) {
+		double ns = kernel(std::max<size_t>(set.bytes / bytesPerOp, soa::blockSize));
+		std::printf("  %7.3f ns %6.1f GB/s", ns, double(bytesPerOp) / ns);
+	}
+	std::printf("\n");
+}
+
+template<typename V>
+float firstComponent(const V& value) {
+	float result;
+	std::memcpy(&result, &value, sizeof(float));
+	return result;
+}
+
+template<typename A, typename Out, typename Op>
+void unaryRow(const char* name, Op op) {
+	throughputRow(name, "aos", sizeof(A) + sizeof(Out), [&](size_t count) {
+		std::vector<A> a(count);
+		std::vector<Out> out(count);
+		fill(a, 1.0f);
+		return measureArray(count, [&] {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = op(a[i]);
+			}
+			sink += firstComponent(out[count / 2]);
+		});
+	});
+}
+
+template<typename A, typename B, typename Out, typename Op>
+void binaryRow(const char* name, Op op) {
+	throughputRow(name, "aos", sizeof(A) + sizeof(B) + sizeof(Out), [&](size_t count) {
+		std::vector<A> a(count);
+		std::vector<B> b(count);
+		std::vector<Out> out(count);
+		fill(a, 1.0f);
+		fill(b, 2.0f);
+		return measureArray(count, [&] {
+			for (size_t i = 0; i < count; i++) {
+				out[i] = op(a[i], b[i]);
+			}
+			sink += firstComponent(out[count / 2]);
+		});
+	});
+}
+
+// kernel(a, b, out) on vec3 streams, bytesPerOp counts the streams the kernel touches
+template<typename OutStream, typename Kernel>
+void streamRow(const char* name, size_t bytesPerOp, Kernel kernel) {
+	throughputRow(name, "soa", bytesPerOp, [&](size_t count) {
+		std::vector<vec3> values(count);
+		fill(values, 1.0f);
+		soa::vec3Stream a, b;
+		OutStream out;
+		soa::fromAoS(values.data(), count, a);
+		fill(values, 2.0f);
+		soa::fromAoS(values.data(), count, b);
+		return measureArray(count, [&] {
+			kernel(a, b, out);
+			sink += firstComponent(out.blocks[0]);
+		});
+	});
+}
+
+// kernel(a, b, count, out) on AoS matrix arrays
+template<typename Matrix, typename Kernel>
+void matrixArrayRow(const char* name, Kernel kernel) {
+	throughputRow(name, "soa", 3 * sizeof(Matrix), [&](size_t count) {
+		std::vector<Matrix> a(count), b(count), out(count);
+		fill(a, 1.0f);
+		fill(b, 2.0f);
+		return measureArray(count, [&] {
+			kernel(a.data(), b.data(), count, out.data());
+			sink += firstComponent(out[count / 2]);
+		});
+	});
+}
+
+void benchThroughput() {
+	std::printf("\nthroughput, best of %d samples, per operation and loaded + stored bytes\n", throughputSamples);
+	std::printf("%-28s %-4s", "", "");
+	for (const workingSet& set : workingSets) {
+		std::printf("  %-22s", set.name);
+	}
+	std::printf("\n");
+
+	const mat4 shared = opaque(perspective(60.0f, 0.1f, 100.0f, 0.5625f) * lookAt(vec3{ 1, 2, 10 }, vec3{ 0, 0, 0 }, vec3{ 0, 1, 0 }));
+
+	// Vector operations
+	binaryRow<vec3, vec3, vec3>("vec3 + vec3", [](vec3 a, vec3 b) { return a + b; });
+	binaryRow<vec4, vec4, vec4>("vec4 + vec4", [](vec4 a, vec4 b) { return a + b; });
+	binaryRow<vec4, vec4, vec4>("vec4 * vec4", [](vec4 a, vec4 b) { return a * b; });
+	binaryRow<vec4, float, vec4>("vec4 * float", [](vec4 a, float b) { return a * b; });
+
+	// Dot / cross
+	binaryRow<vec3, vec3, float>("dot vec3", [](vec3 a, vec3 b) { return dot(a, b); });
+	streamRow<soa::floatStream>("dot vec3", 7 * sizeof(float), [](const soa::vec3Stream& a, const soa::vec3Stream& b, soa::floatStream& out) {
+		soa::dot(a, b, out);
+	});
+	binaryRow<vec4, vec4, float>("dot vec4", [](vec4 a, vec4 b) { return dot(a, b); });
+	binaryRow<vec3, vec3, vec3>("cross vec3", [](vec3 a, vec3 b) { return cross(a, b); });
+	streamRow<soa::vec3Stream>("cross vec3", 9 * sizeof(float), [](const soa::vec3Stream& a, const soa::vec3Stream& b, soa::vec3Stream& out) {
+		soa::cross(a, b, out);
+	});
+
+	// Normalize
+	unaryRow<vec3, vec3>("normalize vec3", [](vec3 a) { return normalize(a); });
+	streamRow<soa::vec3Stream>("normalize vec3", 6 * sizeof(float), [](const soa::vec3Stream& a, const soa::vec3Stream&, soa::vec3Stream& out) {
+		soa::normalize(a, out);
+	});
+	unaryRow<vec4, vec4>("normalize vec4", [](vec4 a) { return normalize(a); });
+
+	// Matrix * vector, one shared matrix
+	unaryRow<vec4, vec4>("mat4 * vec4", [&](vec4 a) { return shared * a; });
+	unaryRow<vec3, vec3>("mat4 * point", [&](vec3 a) {
+		vec4 r = shared * vec4{ a.x, a.y, a.z, 1 };
+		return vec3{ r.x, r.y, r.z };
+	});
+	streamRow<soa::vec3Stream>("mat4 * point", 6 * sizeof(float), [&](const soa::vec3Stream& a, const soa::vec3Stream&, soa::vec3Stream& out) {
+		soa::transformPoints(shared, a, out);
+	});
+
+	// Matrix * matrix, one pair per element
+	binaryRow<mat3, mat3, mat3>("mat3 * mat3", [](const mat3& a, const mat3& b) { return a * b; });
+	binaryRow<mat4, mat4, mat4>("mat4 * mat4", [](const mat4& a, const mat4& b) { return a * b; });
+	matrixArrayRow<mat4>("mat4 * mat4", [](const mat4* a, const mat4* b, size_t count, mat4* out) {
+		soa::multiply(a, b, count, out);
+	});
+	binaryRow<mat3x4, mat3x4, mat3x4>("mat3x4 * mat3x4", [](const mat3x4& a, const mat3x4& b) { return a * b; });
+	matrixArrayRow<mat3x4>("mat3x4 * mat3x4", [](const mat3x4* a, const mat3x4* b, size_t count, mat3x4* out) {
+		soa::multiply(a, b, count, out);
+	});
+
+	// Matrix construction
+	unaryRow<vec3, mat3>("rotation3D", [](vec3 degrees) { return rotation3D(degrees); });
+	unaryRow<float, mat4>("perspective", [](float fov) { return perspective(fov, 0.1f, 100.0f, 0.5625f); });
+	binaryRow<vec3, vec3, mat4>("lookAt", [](vec3 eye, vec3 at) { return lookAt(eye, at, vec3{ 0, 1, 0 }); });
+}
+
+// Particle initialization, per element std::mt19937 calls against the 8 lane generator
+void benchRandom() {
+	std::vector<vec3> out(elementCount);
+	std::mt19937 engine(1);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+	random::generator g(1);
+	random::generator8 g8(1);
+
+	double standard = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = { distribution(engine), distribution(engine), distribution(engine) };
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double scalar = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 });
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double lanes = measure([&] {
+		random::uniform(g8, out.data(), elementCount, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 });
+		sink += out[elementCount / 2].x;
+	});
+	report("vec3 uniform", "mt19937", standard, "xoshiro", scalar);
+	report("vec3 uniform, 8 lanes", "mt19937", standard, "8 lanes", lanes);
+
+	double sphere = measure([&] {
+		random::onUnitSphere(g8, out.data(), elementCount);
+		sink += out[elementCount / 2].x;
+	});
+	double scalarSphere = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = random::onUnitSphere(g);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report("onUnitSphere", "scalar", scalarSphere, "8 lanes", sphere);
+}
+
+// Camera path sampling, scalar spline calls against the soa bulk path
+void benchSpline() {
+	random::generator g(3);
+	std::vector<vec3> points(16);
+	for (vec3& p : points) {
+		p = random::uniform(g, vec3{ -10, -10, -10 }, vec3{ 10, 10, 10 });
+	}
+	spline<vec3> path = catmullRomSpline(points.data(), points.size());
+	std::vector<vec3> out(elementCount);
+	soa::vec3Stream stream;
+	float step = 15.0f / (elementCount - 1);
+
+	double scalar = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = path.evaluate(static_cast<float>(i) * step);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double bulk = measure([&] {
+		sample(path, elementCount, stream);
+		sink += stream.blocks[0].x[1];
+	});
+	report("catmull-rom vec3 samples", "scalar", scalar, "soa", bulk);
+
+	soa::floatStream u;
+	u.resize(elementCount);
+	for (size_t i = 0; i < elementCount; i++) {
+		u.set(i, random::uniform(g, 0.0f, 15.0f));
+	}
+	double scattered = measure([&] {
+		evaluate(path, u, stream);
+		sink += stream.blocks[0].x[1];
+	});
+	double scalarScattered = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = path.evaluate(u.get(i));
+		}
+		sink += out[elementCount / 2].x;
+	});
+	report("catmull-rom random u", "scalar", scalarScattered, "soa", scattered);
+}
+
+// Single noise samples against 8 lane streams, then a heightfield filled on one thread and on the pool
+template<typename V, typename Stream>
+void benchNoise(const char* name, noise::settings settings) {
+	random::generator g(4);
+	std::vector<V> points(elementCount);
+	Stream stream;
+	stream.resize(elementCount);
+	for (size_t i = 0; i < elementCount; i++) {
+		points[i] = random::uniform(g, V{} - 100.0f, V{} + 100.0f);
+		stream.set(i, points[i]);
+	}
+	std::vector<float> out(elementCount);
+	soa::floatStream bulk;
+
+	double scalar = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = noise::sample(settings, points[i]);
+		}
+		sink += out[elementCount / 2];
+	});
+	double soa = measure([&] {
+		noise::sample(settings, stream, bulk);
+		sink += bulk.blocks[0].v[1];
+	});
+	report(name, "scalar", scalar, "soa", soa);
+}
+
+void benchNoiseGrid() {
+	constexpr size_t size = 4096;
+	noise::settings settings;
+	settings.octaves = 5;
+	std::vector<float> heights(size * size);
+	threadPool pool;
+
+	auto seconds = [&](threadPool* target) {
+		double result = 1e30;
+		for (int i = 0; i < 3; i++) {
+			auto start = std::chrono::steady_clock::now();
+			noise::fillGrid(settings, vec2{ 0, 0 }, vec2{ 1.0f / 256, 1.0f / 256 }, size, size, heights.data(), target);
+			auto end = std::chrono::steady_clock::now();
+			result = std::min(result, std::chrono::duration<double>(end - start).count());
+			sink += heights[size * size / 2];
+		}
+		return result;
+	};
+	double serial = seconds(nullptr);
+	double pooled = seconds(&pool);
+	std::printf("simplex fbm 5 octaves, %zux%zu  serial %7.1f ms  %zu threads %7.1f ms  x%.2f\n", size, size, serial * 1e3, pool.getThreadCount(), pooled * 1e3, serial / pooled);
+}
+
+// Bounds for 64 point meshlets of rotated boxes, AABB against OBB fits and how much tighter the OBB is
+void benchOBB() {
+	constexpr size_t meshletSize = 64;
+	constexpr size_t meshletCount = elementCount / meshletSize;
+	random::generator g(6);
+	std::vector<vec3> points(elementCount);
+	std::vector<uint32_t> offsets(meshletCount + 1);
+	for (size_t m = 0; m < meshletCount; m++) {
+		vec3 axis = normalize(random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 }) + vec3{ 0, 0, 0.01f });
+		mat3 rotation = quaternion2matrix3x3(quaternionAxisAngle(axis, random::uniform(g, 0.0f, 360.0f)));
+		vec3 center = random::uniform(g, vec3{ -100, -100, -100 }, vec3{ 100, 100, 100 });
+		for (size_t i = 0; i < meshletSize; i++) {
+			points[m * meshletSize + i] = center + rotation * random::uniform(g, vec3{ -4, -1, -0.2f }, vec3{ 4, 1, 0.2f });
+		}
+		offsets[m] = static_cast<uint32_t>(m * meshletSize);
+	}
+	offsets[meshletCount] = static_cast<uint32_t>(elementCount);
+	std::vector<aabb> boxes(meshletCount);
+	std::vector<obb> oriented(meshletCount);
+
+	double aligned = measure([&] {
+		for (size_t m = 0; m < meshletCount; m++) {
+			boxes[m] = computeAABB(points.data() + offsets[m], meshletSize);
+		}
+		sink += boxes[meshletCount / 2].min.x;
+	}) * meshletSize;
+	double fitted = measure([&] {
+		computeOBBs(points.data(), offsets.data(), meshletCount, oriented.data());
+		sink += oriented[meshletCount / 2].center.x;
+	}) * meshletSize;
+	report("64 point meshlet bounds", "aabb", aligned, "obb", fitted);
+	double ratio = 0;
+	for (size_t m = 0; m < meshletCount; m++) {
+		ratio += volume(oriented[m]) / volume(aabb2obb(boxes[m]));
+	}
+	std::printf("%-28s obb / aabb volume %.3f\n", "", ratio / meshletCount);
+}
+
+// Vertex normals, tangents and a position weld of a bumpy 1M triangle grid, on one thread and on the pool
+void benchMesh() {
+	constexpr size_t size = 724;
+	constexpr size_t vertexCount = (size + 1) * (size + 1);
+	constexpr size_t triangleCount = size * size * 2;
+	random::generator g(7);
+	std::vector<vec3> positions(vertexCount);
+	std::vector<vec2> uvs(vertexCount);
+	for (size_t z = 0; z <= size; z++) {
+		for (size_t x = 0; x <= size; x++) {
+			positions[z * (size + 1) + x] = { float(x), random::uniform(g, 0.0f, 0.5f), float(z) };
+			uvs[z * (size + 1) + x] = { x / float(size), z / float(size) };
+		}
+	}
+	std::vector<uint32_t> indices;
+	indices.reserve(triangleCount * 3);
+	for (size_t z = 0; z < size; z++) {
+		for (size_t x = 0; x < size; x++) {
+			uint32_t a = static_cast<uint32_t>(z * (size + 1) + x);
+			uint32_t b = a + static_cast<uint32_t>(size + 1);
+			indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+	std::vector<vec3> normals(vertexCount);
+	std::vector<vec4> tangents(vertexCount);
+	std::vector<uint32_t> remap(vertexCount);
+	threadPool pool;
+
+	auto seconds = [&](auto&& f) {
+		double result = 1e30;
+		for (int i = 0; i < 3; i++) {
+			auto start = std::chrono::steady_clock::now();
+			f();
+			auto end = std::chrono::steady_clock::now();
+			result = std::min(result, std::chrono::duration<double>(end - start).count());
+		}
+		return result;
+	};
+	auto row = [&](const char* name, auto&& f) {
+		double serial = seconds([&] { f(nullptr); });
+		double pooled = seconds([&] { f(&pool); });
+		std::printf("%-28s serial %7.1f ms  %zu threads %7.1f ms  x%.2f\n", name, serial * 1e3, pool.getThreadCount(), pooled * 1e3, serial / pooled);
+	};
+	row("1M triangle normals", [&](threadPool* target) {
+		mesh::computeNormals(positions.data(), vertexCount, indices.data(), triangleCount, normals.data(), mesh::normalWeight::angle, 0, target);
+		sink += normals[vertexCount / 2].y;
+	});
+	row("1M triangle tangents", [&](threadPool* target) {
+		mesh::computeTangents(positions.data(), uvs.data(), normals.data(), vertexCount, indices.data(), triangleCount, tangents.data(), 0, target);
+		sink += tangents[vertexCount / 2].x;
+	});
+	row("500k vertex weld", [&](threadPool* target) {
+		sink += float(mesh::weld(&positions[0].x, vertexCount, 3, 0, remap.data(), target));
+	});
+}
+
+// L2 irradiance for many normals, evaluating the coefficients per normal against the packed 8 lane
+// polynomial, then a 6 x 256 x 256 cubemap projected on one thread and on the pool
+void benchSH() {
+	random::generator g(8);
+	sh::l2 radiance;
+	for (vec3& c : radiance.coefficients) {
+		c = random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 });
+	}
+	std::vector<vec3> normals(elementCount), out(elementCount);
+	soa::vec3Stream stream, bulk;
+	stream.resize(elementCount);
+	for (size_t i = 0; i < elementCount; i++) {
+		normals[i] = random::onUnitSphere(g);
+		stream.set(i, normals[i]);
+	}
+	sh::packedIrradiance packed = sh::packIrradiance(radiance);
+	double scalar = measure([&] {
+		sh::l2 irradiance = sh::convolveCosine(radiance);
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = sh::evaluate(irradiance, normals[i]);
+		}
+		sink += out[elementCount / 2].x;
+	});
+	double soa = measure([&] {
+		sh::irradiance(packed, stream, bulk);
+		sink += bulk.blocks[0].x[1];
+	});
+	report("sh l2 irradiance", "evaluate", scalar, "packed", soa);
+
+	constexpr size_t size = 256;
+	std::vector<vec3> texels(size * size * 6);
+	for (vec3& t : texels) {
+		t = random::uniform(g, vec3{ 0, 0, 0 }, vec3{ 1, 1, 1 });
+	}
+	threadPool pool;
+	auto seconds = [&](threadPool* target) {
+		double result = 1e30;
+		for (int i = 0; i < 3; i++) {
+			auto start = std::chrono::steady_clock::now();
+			sh::l2 projected = sh::projectCubemap(texels.data(), size, target);
+			auto end = std::chrono::steady_clock::now();
+			result = std::min(result, std::chrono::duration<double>(end - start).count());
+			sink += projected.coefficients[0].x;
+		}
+		return result;
+	};
+	double serial = seconds(nullptr);
+	double pooled = seconds(&pool);
+	std::printf("sh l2 cubemap 6x%zux%zu       serial %7.2f ms  %zu threads %7.2f ms  x%.2f\n", size, size, serial * 1e3, pool.getThreadCount(), pooled * 1e3, serial / pooled);
+}
+
+// sRGB channels through std::pow against the tables and lane polynomial, then whole 4K images
+// between pixel formats on one thread and on the pool, GB/s of loaded and stored bytes
+void benchColor() {
+	random::generator g(9);
+	std::vector<uint8_t> codes(elementCount), encoded(elementCount);
+	std::vector<float> values(elementCount), out(elementCount);
+	for (size_t i = 0; i < elementCount; i++) {
+		codes[i] = static_cast<uint8_t>(random::uniform(g) * 256);
+		values[i] = random::uniform(g);
+	}
+	double powDecode = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = color::srgbToLinear(codes[i] / 255.0f);
+		}
+		sink += out[elementCount / 2];
+	});
+	double lutDecode = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = color::srgb8ToLinear(codes[i]);
+		}
+		sink += out[elementCount / 2];
+	});
+	report("srgb8 -> linear", "pow", powDecode, "lut", lutDecode);
+	double powEncode = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			encoded[i] = static_cast<uint8_t>(color::linearToSrgb(values[i]) * 255 + 0.5f);
+		}
+		sink += encoded[elementCount / 2];
+	});
+	double lutEncode = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			encoded[i] = color::linearToSrgb8(values[i]);
+		}
+		sink += encoded[elementCount / 2];
+	});
+	report("linear -> srgb8", "pow", powEncode, "lut", lutEncode);
+	double powFloat = measure([&] {
+		for (size_t i = 0; i < elementCount; i++) {
+			out[i] = color::linearToSrgb(values[i]);
+		}
+		sink += out[elementCount / 2];
+	});
+	double polyFloat = measure([&] {
+		color::linearToSrgb(values.data(), out.data(), elementCount);
+		sink += out[elementCount / 2];
+	});
+	report("linear -> srgb float", "pow", powFloat, "poly", polyFloat);
+
+	constexpr size_t width = 3840, height = 2160;
+	std::vector<unsigned char> source(width * height * 16), target(width * height * 16);
+	for (size_t i = 0; i < width * height * 4; i++) {
+		source[i] = static_cast<unsigned char>(random::uniform(g) * 256);
+	}
+	threadPool pool;
+	auto row = [&](const char* name, color::format from, color::format to) {
+		// Valid pixels of the source format from the random bytes
+		color::convert(source.data(), color::format::rgba8Unorm, 0, target.data(), from, 0, width, height);
+		std::memcpy(source.data(), target.data(), width * height * color::bytesPerPixel(from));
+		auto seconds = [&](threadPool* p) {
+			double result = 1e30;
+			for (int i = 0; i < 3; i++) {
+				auto start = std::chrono::steady_clock::now();
+				color::convert(source.data(), from, 0, target.data(), to, 0, width, height, p);
+				auto end = std::chrono::steady_clock::now();
+				result = std::min(result, std::chrono::duration<double>(end - start).count());
+				sink += target[width * height / 2];
+			}
+			return result;
+		};
+		double bytes = double(width * height * (color::bytesPerPixel(from) + color::bytesPerPixel(to)));
+		double serial = seconds(nullptr);
+		double pooled = seconds(&pool);
+		std::printf("%-28s serial %6.2f GB/s  %zu threads %6.2f GB/s  x%.2f\n", name, bytes / serial * 1e-9, pool.getThreadCount(), bytes / pooled * 1e-9, serial / pooled);
+	};
+	row("4k rgba8 -> bgra8", color::format::rgba8Unorm, color::format::bgra8Unorm);
+	row("4k rgba8 -> bgra8 srgb", color::format::rgba8Unorm, color::format::bgra8Srgb);
+	row("4k bgra8 srgb -> rgba32f", color::format::bgra8Srgb, color::format::rgba32Float);
+	row("4k rgba32f -> rgba8 srgb", color::format::rgba32Float, color::format::rgba8Srgb);
+	row("4k rgba16f -> bgra8 srgb", color::format::rgba16Float, color::format::bgra8Srgb);
+}
+
+// Picking rays from one eye point into a random triangle soup, rays per second and build time
+void benchBVH() {
+	constexpr size_t triangleCount = 100000;
+	constexpr size_t rayCount = 1 << 14;
+	constexpr int bvhRepeats = 5;
+
+	random::generator g(2);
+	std::vector<vec3> positions(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount; i++) {
+		vec3 center = random::uniform(g, vec3{ -50, -50, -50 }, vec3{ 50, 50, 50 });
+		for (size_t k = 0; k < 3; k++) {
+			positions[i * 3 + k] = center + random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 });
+		}
+	}
+	std::vector<ray> rays(rayCount);
+	for (size_t i = 0; i < rayCount; i++) {
+		vec2 screen = random::uniform(g, vec2{ -0.5f, -0.5f }, vec2{ 0.5f, 0.5f });
+		rays[i] = { { 0, 0, -100 }, normalize(vec3{ screen.x, screen.y, 1 }) };
+	}
+	// Neighbouring rays are neighbouring pixels, as for a picking or visibility grid
+	std::sort(rays.begin(), rays.end(), [](const ray& a, const ray& b) {
+		return int(a.direction.y * 64) != int(b.direction.y * 64) ? a.direction.y < b.direction.y : a.direction.x < b.direction.x;
+	});
+
+	auto best = [](auto func) {
+		double result = 1e30;
+		for (int i = 0; i < bvhRepeats; i++) {
+			auto start = std::chrono::steady_clock::now();
+			func();
+			auto end = std::chrono::steady_clock::now();
+			result = std::min(result, std::chrono::duration<double>(end - start).count());
+		}
+		return result;
+	};
+
+	bvh tree;
+	double build = best([&] { tree = buildBVH(positions.data(), triangleCount); });
+	std::vector<rayHit> hits(rayCount);
+	double single = best([&] {
+		for (size_t i = 0; i < rayCount; i++) {
+			hits[i] = intersect(tree, rays[i]);
+		}
+		sink += hits[rayCount / 2].t;
+	});
+	double packets = best([&] {
+		intersect(tree, rays.data(), rayCount, hits.data());
+		sink += hits[rayCount / 2].t;
+	});
+	std::vector<uint8_t> mask(soa::maskBytes(rayCount));
+	double shadow = best([&] {
+		occluded(tree, rays.data(), rayCount, mask.data());
+		sink += mask[0];
+	});
+	std::printf("bvh build, %zu triangles      %7.2f ms, %zu nodes\n", triangleCount, build * 1e3, tree.nodes.size());
+	std::printf("%-28s %-9s %7.2f Mrays/s  %-9s %7.2f Mrays/s  x%.2f\n", "bvh closest hit", "single", rayCount / single * 1e-6, "packets", rayCount / packets * 1e-6, single / packets);
+	std::printf("%-28s %-9s %7.2f Mrays/s\n", "bvh occluded", "packets", rayCount / shadow * 1e-6);
+
+	// Linear BVH, the per frame rebuild path
+	std::vector<uint32_t> codes(triangleCount);
+	std::vector<uint32_t> order(triangleCount);
+	aabb bounds = computeAABB(positions.data(), positions.size());
+	double encode = best([&] {
+		morton::codes(positions.data(), triangleCount, bounds, codes.data(), 3 * sizeof(vec3));
+		sink += static_cast<float>(codes[triangleCount / 2]);
+	});
+	double sort = best([&] {
+		morton::codes(positions.data(), triangleCount, bounds, codes.data(), 3 * sizeof(vec3));
+		for (size_t i = 0; i < triangleCount; i++) {
+			order[i] = static_cast<uint32_t>(i);
+		}
+		radixSort(codes.data(), order.data(), triangleCount);
+		sink += static_cast<float>(order[triangleCount / 2]);
+	}) - encode;
+	bvh linear;
+	double linearBuild = best([&] { linear = buildLBVH(positions.data(), triangleCount); });
+	double linearPackets = best([&] {
+		intersect(linear, rays.data(), rayCount, hits.data());
+		sink += hits[rayCount / 2].t;
+	});
+	std::printf("morton codes, %zu points       %7.3f ms\n", triangleCount, encode * 1e3);
+	std::printf("radix sort, %zu keys           %7.3f ms\n", triangleCount, sort * 1e3);
+	std::printf("lbvh build, %zu triangles      %7.2f ms, %zu nodes\n", triangleCount, linearBuild * 1e3, linear.nodes.size());
+	std::printf("%-28s %-9s %7.2f Mrays/s  %-9s %7.2f Mrays/s  x%.2f\n", "closest hit packets", "sah", rayCount / packets * 1e-6, "lbvh", rayCount / linearPackets * 1e-6, packets / linearPackets);
+}
+
+// Comparisons
+
+void benchCompare() {
+	std::printf("\ncompare, %zu elements, best of %d runs, per element\n", elementCount, repeats);
+
+	benchDivision<vec2>("vec2 / vec2");
+	benchDivision<vec3>("vec3 / vec3");
+	benchDivision<vec4>("vec4 / vec4");
+	benchScalarDivision<vec2>("vec2 / float");
+	benchScalarDivision<vec3>("vec3 / float");
+	benchScalarDivision<vec4>("vec4 / float");
+	benchModulo<vec3>("vec3 % vec3");
+	benchModulo<vec4>("vec4 % vec4");
+
+	benchFma<vec3>("vec3 * float + vec3");
+	benchFma<vec4>("vec4 * float + vec4");
+	benchLerp<vec3>("vec3 lerp");
+	benchLerp<vec4>("vec4 lerp");
+	benchStreams();
+	benchRandom();
+	benchSpline();
+
+	noise::settings single;
+	single.mode = noise::fractal::none;
+	single.type = noise::basis::perlin;
+	benchNoise<vec3, soa::vec3Stream>("perlin vec3", single);
+	single.type = noise::basis::simplex;
+	benchNoise<vec2, soa::vec2Stream>("simplex vec2", single);
+	benchNoise<vec3, soa::vec3Stream>("simplex vec3", single);
+	benchNoise<vec4, soa::vec4Stream>("simplex vec4", single);
+	single.type = noise::basis::value;
+	benchNoise<vec3, soa::vec3Stream>("value vec3", single);
+	benchNoiseGrid();
+	benchOBB();
+	benchMesh();
+	benchSH();
+	benchColor();
+	benchBVH();
+}
+
+bool selected(int argc, char** argv, const char* section) {
+	if (argc < 2) {
+		return true;
+	}
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], section) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+#ifdef LM2_SIMD
+	std::printf("lm2 SIMD build, %s backend\n", simd::backendName);
+#else
+	std::printf("lm2 scalar build, soa kernels on the %s backend\n", simd::backendName);
+#endif
+
+	if (selected(argc, argv, "latency")) {
+		benchLatency();
+	}
+	if (selected(argc, argv, "throughput")) {
+		benchThroughput();
+	}
+	if (selected(argc, argv, "compare")) {
+		benchCompare();
+	}
+
+	std::printf("(%g)\n", sink);
+	return 0;
+}
@@ -1,8 +1,13 @@
 /*
 * A single header library for basic linear math
+* Define LM2_SIMD to enable the SIMD backend for float vector4D / matrix4x4 (see lm2_simd.hpp)
 */
 #pragma once
 
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
 #ifndef LM2_NO_OUTPUT_FUNCTIONS
 #include <iostream>
 #endif
@@ -21,10 +26,10 @@ template<typename T>
 struct vector2D {
 	T x, y;
 
-	operator vector3D<T>() {
+	constexpr operator vector3D<T>() const noexcept {
 		return { x, y, 0 };
 	}
-	operator vector4D<T>() {
+	constexpr operator vector4D<T>() const noexcept {
 		return { x, y, 0, 0 };
 	}
 };
@@ -33,7 +38,7 @@ template<typename T>
 struct vector3D {
 	T x, y, z;
 
-	operator vector4D<T>() {
+	constexpr operator vector4D<T>() const noexcept {
 		return { x, y, z, 0 };
 	}
 };
@@ -49,20 +54,21 @@ using vec4 = vector4D<float>;
 
 // Matrix types
 template<typename T> struct matrix3x3;
+template<typename T> struct matrix3x4;
 template<typename T> struct matrix4x4;
 
 template<typename T>
 struct matrix2x2 {
 	vector2D<T> x, y;
 
-	operator matrix3x3<T>() {
+	constexpr operator matrix3x3<T>() const noexcept {
 		return {
 			{ x.x, x.y, 0 },
 			{ y.x, y.y, 0 },
 			{ 0,   0,   1 },
 		};
 	}
-	operator matrix4x4<T>() {
+	constexpr operator matrix4x4<T>() const noexcept {
 		return {
 			{ x.x, x.y, 0, 0 },
 			{ y.x, y.y, 0, 0 },
@@ -76,23 +82,40 @@ template<typename T>
 struct matrix3x3 {
 	vector3D<T> x, y, z;
 
-	operator matrix4x4<T>() {
+	constexpr operator matrix4x4<T>() const noexcept {
 		return {
 			{ x.x, x.y, x.z, 0 },
 			{ y.x, y.y, y.z, 0 },
-			{ z.x, z.y, y.z, 0 },
+			{ z.x, z.y, z.z, 0 },
 			{ 0,   0,   0,   1 },
 		};
 	}
 };
 
+// Affine matrix, the last row (0, 0, 0, 1) of a matrix4x4 is implied
+// Same memory layout as the first three rows of a matrix4x4
+template<typename T>
+struct matrix3x4 {
+	vector4D<T> x, y, z;
+
+	constexpr operator matrix4x4<T>() const noexcept {
+		return { x, y, z, { 0, 0, 0, 1 } };
+	}
+};
+
 template<typename T>
 struct matrix4x4 {
 	vector4D<T> x, y, z, w;
+
+	// Drops the last row, which must be (0, 0, 0, 1)
+	constexpr explicit operator matrix3x4<T>() const noexcept {
+		return { x, y, z };
+	}
 };
 
 using mat2 = matrix2x2<float>;
 using mat3 = matrix3x3<float>;
+using mat3x4 = matrix3x4<float>;
 using mat4 = matrix4x4<float>;
 
 // Quaternion types
@@ -103,13 +126,198 @@ struct quaternionT {
 
 using quaternion = quaternionT<float>;
 
+// Scalar math
+// constexpr capable versions of the <cmath> functions used by lm2. In constant evaluation they
+// use the implementations in detail (accurate to a few ULP of long double), at runtime they
+// call <cmath> directly, so runtime results are unchanged.
+namespace detail {
+constexpr long double pi = 3.141592653589793238462643383279502884L;
+
+constexpr long double truncate(long double x) noexcept {
+	if (x >= 9.2e18L || x <= -9.2e18L) {
+		return x;
+	}
+	return static_cast<long double>(static_cast<long long>(x));
+}
+
+constexpr long double sqrt(long double x) noexcept {
+	if (x != x || x < 0) {
+		return std::numeric_limits<long double>::quiet_NaN();
+	}
+	if (x == 0 || x == std::numeric_limits<long double>::infinity()) {
+		return x;
+	}
+	// Scale into [0.25, 4] by powers of 4, exact in binary floating point
+	long double scale = 1;
+	while (x > 4) {
+		x /= 4;
+		scale *= 2;
+	}
+	while (x < 0.25L) {
+		x *= 4;
+		scale /= 2;
+	}
+	long double curr = 1;
+	long double prev = 0;
+	for (int i = 0; i < 32 && curr != prev; i++) {
+		prev = curr;
+		curr = 0.5L * (curr + x / curr);
+	}
+	return curr * scale;
+}
+
+// Reduce to [-pi, pi]
+constexpr long double reduceAngle(long double x) noexcept {
+	long double k = truncate(x / (2 * pi) + (x < 0 ? -0.5L : 0.5L));
+	return x - k * 2 * pi;
+}
+constexpr long double sin(long double x) noexcept {
+	x = reduceAngle(x);
+	long double term = x;
+	long double sum = x;
+	for (int n = 1; n < 40; n++) {
+		term *= -x * x / ((2 * n) * (2 * n + 1));
+		sum += term;
+	}
+	return sum;
+}
+constexpr long double cos(long double x) noexcept {
+	x = reduceAngle(x);
+	long double term = 1;
+	long double sum = 1;
+	for (int n = 1; n < 40; n++) {
+		term *= -x * x / ((2 * n - 1) * (2 * n));
+		sum += term;
+	}
+	return sum;
+}
+constexpr long double atan(long double x) noexcept {
+	bool negate = x < 0;
+	x = negate ? -x : x;
+	bool invert = x > 1;
+	x = invert ? 1 / x : x;
+	// Two argument halvings, atan(x) = 2 * atan(x / (1 + sqrt(1 + x * x))), give |x| < 0.2
+	x = x / (1 + sqrt(1 + x * x));
+	x = x / (1 + sqrt(1 + x * x));
+	long double term = x;
+	long double sum = x;
+	for (int n = 1; n < 30; n++) {
+		term *= -x * x;
+		sum += term / (2 * n + 1);
+	}
+	long double result = 4 * sum;
+	result = invert ? pi / 2 - result : result;
+	return negate ? -result : result;
+}
+constexpr long double atan2(long double y, long double x) noexcept {
+	if (x > 0) {
+		return atan(y / x);
+	}
+	if (x < 0) {
+		return y < 0 ? atan(y / x) - pi : atan(y / x) + pi;
+	}
+	return y > 0 ? pi / 2 : (y < 0 ? -pi / 2 : 0);
+}
+
+// True where std::fma compiles to a single instruction instead of a library call
+#ifdef FP_FAST_FMAF
+constexpr bool fastFmaFloat = true;
+#else
+constexpr bool fastFmaFloat = false;
+#endif
+#ifdef FP_FAST_FMA
+constexpr bool fastFmaDouble = true;
+#else
+constexpr bool fastFmaDouble = false;
+#endif
+template<typename T>
+constexpr bool fastFma = std::is_same_v<T, float> ? fastFmaFloat : (std::is_same_v<T, double> ? fastFmaDouble : false);
+} // namespace detail
+
+template<typename T>
+constexpr T abs(T x) noexcept {
+	return x < 0 ? -x : x;
+}
+template<typename T>
+constexpr T sqrt(T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		return static_cast<T>(detail::sqrt(static_cast<long double>(x)));
+	}
+	return std::sqrt(x);
+}
+template<typename T>
+constexpr T sin(T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		return static_cast<T>(detail::sin(static_cast<long double>(x)));
+	}
+	return std::sin(x);
+}
+template<typename T>
+constexpr T cos(T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		return static_cast<T>(detail::cos(static_cast<long double>(x)));
+	}
+	return std::cos(x);
+}
+template<typename T>
+constexpr T tan(T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		return static_cast<T>(detail::sin(static_cast<long double>(x)) / detail::cos(static_cast<long double>(x)));
+	}
+	return std::tan(x);
+}
+template<typename T>
+constexpr T atan2(T y, T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		return static_cast<T>(detail::atan2(static_cast<long double>(y), static_cast<long double>(x)));
+	}
+	return std::atan2(y, x);
+}
+template<typename T>
+constexpr T asin(T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		long double v = static_cast<long double>(x);
+		return static_cast<T>(detail::atan2(v, detail::sqrt(1 - v * v)));
+	}
+	return std::asin(x);
+}
+template<typename T>
+constexpr T acos(T x) noexcept {
+	if (std::is_constant_evaluated()) {
+		long double v = static_cast<long double>(x);
+		return static_cast<T>(detail::atan2(detail::sqrt(1 - v * v), v));
+	}
+	return std::acos(x);
+}
+// Constant evaluation is exact only while x / y fits in a long long
+template<typename T>
+constexpr T fmod(T x, T y) noexcept {
+	if (std::is_constant_evaluated()) {
+		long double a = static_cast<long double>(x);
+		long double b = static_cast<long double>(y);
+		return static_cast<T>(a - detail::truncate(a / b) * b);
+	}
+	return std::fmod(x, y);
+}
+// a * b + c with a single rounding where the target has hardware FMA (FP_FAST_FMA), else a * b + c.
+// Constant evaluation always takes a * b + c
+template<typename T>
+constexpr T fma(T a, T b, T c) noexcept {
+	if constexpr (detail::fastFma<T>) {
+		if (!std::is_constant_evaluated()) {
+			return std::fma(a, b, c);
+		}
+	}
+	return a * b + c;
+}
+
 // Scalar functions
 template<typename T>
-T degrees2radians(T degrees) {
+constexpr T degrees2radians(T degrees) noexcept {
 	return degrees * static_cast<T>(PIrad);
 }
 template<typename T>
-T radians2degrees(T radians) {
+constexpr T radians2degrees(T radians) noexcept {
 	return radians / static_cast<T>(PIrad);
 }
 
@@ -118,24 +326,24 @@ T radians2degrees(T radians) {
 // Vector
 // Dot
 template<typename T>
-T dot(vector2D<T> a, vector2D<T> b) {
+constexpr T dot(vector2D<T> a, vector2D<T> b) noexcept {
 	return a.x * b.x + a.y * b.y;
 }
 template<typename T>
-T dot(vector3D<T> a, vector3D<T> b) {
+constexpr T dot(vector3D<T> a, vector3D<T> b) noexcept {
 	return a.x * b.x + a.y * b.y + a.z * b.z;
 }
 template<typename T>
-T dot(vector4D<T> a, vector4D<T> b) {
+constexpr T dot(vector4D<T> a, vector4D<T> b) noexcept {
 	return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
 }
 // Cross
 template<typename T>
-T cross(vector2D<T> a, vector2D<T> b) {
+constexpr T cross(vector2D<T> a, vector2D<T> b) noexcept {
 	return a.x * b.y - a.y * b.x;
 }
 template<typename T>
-vector3D<T> cross(vector3D<T> a, vector3D<T> b) {
+constexpr vector3D<T> cross(vector3D<T> a, vector3D<T> b) noexcept {
 	return {
 		a.y * b.z - a.z * b.y,
 		a.z * b.x - a.x * b.z,
@@ -145,54 +353,98 @@ vector3D<T> cross(vector3D<T> a, vector3D<T> b) {
 // Magnitude
 // Squared
 template<typename T>
-T magnitudeSquared(vector2D<T> vec) {
+constexpr T magnitudeSquared(vector2D<T> vec) noexcept {
 	return vec.x * vec.x + vec.y * vec.y;
 }
 template<typename T>
-T magnitudeSquared(vector3D<T> vec) {
+constexpr T magnitudeSquared(vector3D<T> vec) noexcept {
 	return vec.x * vec.x + vec.y * vec.y + vec.z * vec.z;
 }
 template<typename T>
-T magnitudeSquared(vector4D<T> vec) {
+constexpr T magnitudeSquared(vector4D<T> vec) noexcept {
 	return vec.x * vec.x + vec.y * vec.y + vec.z * vec.z + vec.w * vec.w;
 }
 // Normal
 template<typename T>
-T magnitude(vector2D<T> vec) {
-	return std::sqrt(magnitudeSquared(vec));
+constexpr T magnitude(vector2D<T> vec) noexcept {
+	return sqrt(magnitudeSquared(vec));
 }
 template<typename T>
-T magnitude(vector3D<T> vec) {
-	return std::sqrt(magnitudeSquared(vec));
+constexpr T magnitude(vector3D<T> vec) noexcept {
+	return sqrt(magnitudeSquared(vec));
 }
 template<typename T>
-T magnitude(vector4D<T> vec) {
-	return std::sqrt(magnitudeSquared(vec));
+constexpr T magnitude(vector4D<T> vec) noexcept {
+	return sqrt(magnitudeSquared(vec));
 }
 // Normalize
 template<typename T>
-vector2D<T> normalize(vector2D<T> vec) {
+constexpr vector2D<T> normalize(vector2D<T> vec) noexcept {
 	return vec / magnitude(vec);
 }
 template<typename T>
-vector3D<T> normalize(vector3D<T> vec) {
+constexpr vector3D<T> normalize(vector3D<T> vec) noexcept {
 	return vec / magnitude(vec);
-}template<typename T>
-vector4D<T> normalize(vector4D<T> vec) {
+}
+template<typename T>
+constexpr vector4D<T> normalize(vector4D<T> vec) noexcept {
 	return vec / magnitude(vec);
 }
+// Fused multiply add, a * b + c in one pass without temporaries, using lm2::fma per component
+template<typename T>
+constexpr vector2D<T> fma(vector2D<T> a, vector2D<T> b, vector2D<T> c) noexcept {
+	return { fma(a.x, b.x, c.x), fma(a.y, b.y, c.y) };
+}
+template<typename T>
+constexpr vector3D<T> fma(vector3D<T> a, vector3D<T> b, vector3D<T> c) noexcept {
+	return { fma(a.x, b.x, c.x), fma(a.y, b.y, c.y), fma(a.z, b.z, c.z) };
+}
+template<typename T>
+constexpr vector4D<T> fma(vector4D<T> a, vector4D<T> b, vector4D<T> c) noexcept {
+	return { fma(a.x, b.x, c.x), fma(a.y, b.y, c.y), fma(a.z, b.z, c.z), fma(a.w, b.w, c.w) };
+}
+// a * s + c
+template<typename T>
+constexpr vector2D<T> fma(vector2D<T> a, T s, vector2D<T> c) noexcept {
+	return { fma(a.x, s, c.x), fma(a.y, s, c.y) };
+}
+template<typename T>
+constexpr vector3D<T> fma(vector3D<T> a, T s, vector3D<T> c) noexcept {
+	return { fma(a.x, s, c.x), fma(a.y, s, c.y), fma(a.z, s, c.z) };
+}
+template<typename T>
+constexpr vector4D<T> fma(vector4D<T> a, T s, vector4D<T> c) noexcept {
+	return { fma(a.x, s, c.x), fma(a.y, s, c.y), fma(a.z, s, c.z), fma(a.w, s, c.w) };
+}
+// Linear interpolation, (b - a) * t + a
+template<typename T>
+constexpr T lerp(T a, T b, T t) noexcept {
+	return fma(b - a, t, a);
+}
+template<typename T>
+constexpr vector2D<T> lerp(vector2D<T> a, vector2D<T> b, T t) noexcept {
+	return { lerp(a.x, b.x, t), lerp(a.y, b.y, t) };
+}
+template<typename T>
+constexpr vector3D<T> lerp(vector3D<T> a, vector3D<T> b, T t) noexcept {
+	return { lerp(a.x, b.x, t), lerp(a.y, b.y, t), lerp(a.z, b.z, t) };
+}
+template<typename T>
+constexpr vector4D<T> lerp(vector4D<T> a, vector4D<T> b, T t) noexcept {
+	return { lerp(a.x, b.x, t), lerp(a.y, b.y, t), lerp(a.z, b.z, t), lerp(a.w, b.w, t) };
+}
 
 // Matrix functions
 // Get identity Matrices
 template<typename T>
-matrix2x2<T> identity2x2() {
+constexpr matrix2x2<T> identity2x2() noexcept {
 	return {
 		{ static_cast<T>(1.0), static_cast<T>(0.0) },
 		{ static_cast<T>(0.0), static_cast<T>(1.0) },
 	};
 }
 template<typename T>
-matrix3x3<T> identity3x3() {
+constexpr matrix3x3<T> identity3x3() noexcept {
 	return {
 		{ static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0) },
 		{ static_cast<T>(0.0), static_cast<T>(1.0), static_cast<T>(0.0) },
@@ -200,7 +452,7 @@ matrix3x3<T> identity3x3() {
 	};
 }
 template<typename T>
-matrix4x4<T> identity4x4() {
+constexpr matrix4x4<T> identity4x4() noexcept {
 	return {
 		{ static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(0.0) },
 		{ static_cast<T>(0.0), static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0) },
@@ -208,9 +460,17 @@ matrix4x4<T> identity4x4() {
 		{ static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(1.0) },
 	};
 }
+template<typename T>
+constexpr matrix3x4<T> identity3x4() noexcept {
+	return {
+		{ static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(0.0) },
+		{ static_cast<T>(0.0), static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0) },
+		{ static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(1.0), static_cast<T>(0.0) },
+	};
+}
 // Position Matrices
 template<typename T>
-matrix3x3<T> position2d(vector2D<T> pos) {
+constexpr matrix3x3<T> position2d(vector2D<T> pos) noexcept {
 	return {
 		{ static_cast<T>(1.0), static_cast<T>(0.0), pos.x },
 		{ static_cast<T>(0.0), static_cast<T>(1.0), pos.y },
@@ -218,7 +478,7 @@ matrix3x3<T> position2d(vector2D<T> pos) {
 	};
 }
 template<typename T>
-matrix4x4<T> position3d(vector3D<T> pos) {
+constexpr matrix4x4<T> position3d(vector3D<T> pos) noexcept {
 	return {
 		{ static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0), pos.x },
 		{ static_cast<T>(0.0), static_cast<T>(1.0), static_cast<T>(0.0), pos.y },
@@ -230,7 +490,7 @@ matrix4x4<T> position3d(vector3D<T> pos) {
 // Projection Matrices
 // ratio = height / width
 template<typename T>
-matrix4x4<T> ortho(T left, T right, T bottom, T top, T near, T far, T ratio) {
+constexpr matrix4x4<T> ortho(T left, T right, T bottom, T top, T near, T far, T ratio) noexcept {
 	return {
 		{ static_cast<T>(2.0) / (right - left) * ratio, static_cast<T>(0),                    static_cast<T>(0),                   -( (right + left) / (right - left) ) },
 		{ static_cast<T>(0),                            static_cast<T>(2.0) / (top - bottom), static_cast<T>(0),                   -( (top + bottom) / (top - bottom) ) },
@@ -239,13 +499,13 @@ matrix4x4<T> ortho(T left, T right, T bottom, T top, T near, T far, T ratio) {
 	};
 }
 template<typename T>
-matrix4x4<T> ortho(T width, T height, T near, T far) {
+constexpr matrix4x4<T> ortho(T width, T height, T near, T far) noexcept {
 	return ortho(-width, width, -height, height, near, far, height / width);
 }
 // ratio = height / width
 template<typename T>
-matrix4x4<T> perspective(T fov, T near, T far, T ratio) {
-	T y = static_cast<T>(1) / std::tan( degrees2radians( fov / static_cast<T>(2) ) );
+constexpr matrix4x4<T> perspective(T fov, T near, T far, T ratio) noexcept {
+	T y = static_cast<T>(1) / tan( degrees2radians( fov / static_cast<T>(2) ) );
 	return {
 		{ y * ratio, 0,  0,                                0 },
 		{ 0,         y,  0,                                0 },
@@ -256,10 +516,10 @@ matrix4x4<T> perspective(T fov, T near, T far, T ratio) {
 
 // Rotation Matrices
 template<typename T>
-matrix2x2<T> rotation2D(T degrees) {
+constexpr matrix2x2<T> rotation2D(T degrees) noexcept {
 	T rad = degrees2radians(degrees);
-	T sinV = std::sin(rad);
-	T cosV = std::cos(rad);
+	T sinV = sin(rad);
+	T cosV = cos(rad);
 	return {
 		{ cosV, sinV },
 		{ -sinV, cosV },
@@ -267,10 +527,10 @@ matrix2x2<T> rotation2D(T degrees) {
 }
 // Axis order: YXZ
 template<typename T>
-matrix3x3<T> rotation3D(vector3D<T> degrees) {
+constexpr matrix3x3<T> rotation3D(vector3D<T> degrees) noexcept {
 	vector3D<T> rad{ degrees2radians(degrees.x), degrees2radians(degrees.y), degrees2radians(degrees.z) };
-	vector3D<T> sinV{ std::sin(rad.x), std::sin(rad.y), std::sin(rad.z) };
-	vector3D<T> cosV{ std::cos(rad.x), std::cos(rad.y), std::cos(rad.z) };
+	vector3D<T> sinV{ sin(rad.x), sin(rad.y), sin(rad.z) };
+	vector3D<T> cosV{ cos(rad.x), cos(rad.y), cos(rad.z) };
 
 	matrix3x3<T> rotX{
 		{ 1,  0,      0      },
@@ -293,7 +553,7 @@ matrix3x3<T> rotation3D(vector3D<T> degrees) {
 
 // Look at matrix
 template<typename T>
-matrix4x4<T> lookAt(vector3D<T> eye, vector3D<T> at, vector3D<T> up) {
+constexpr matrix4x4<T> lookAt(vector3D<T> eye, vector3D<T> at, vector3D<T> up) noexcept {
 	vector3D<T> forward = normalize(at - eye);
 	vector3D<T> right = normalize(cross(forward, up));
 	up = cross(forward, right);
@@ -305,41 +565,595 @@ matrix4x4<T> lookAt(vector3D<T> eye, vector3D<T> at, vector3D<T> up) {
 	};
 }
 
+// Transpose
+template<typename T>
+constexpr matrix2x2<T> transpose(matrix2x2<T> m) noexcept {
+	return {
+		{ m.x.x, m.y.x },
+		{ m.x.y, m.y.y },
+	};
+}
+template<typename T>
+constexpr matrix3x3<T> transpose(matrix3x3<T> m) noexcept {
+	return {
+		{ m.x.x, m.y.x, m.z.x },
+		{ m.x.y, m.y.y, m.z.y },
+		{ m.x.z, m.y.z, m.z.z },
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> transpose(matrix4x4<T> m) noexcept {
+	return {
+		{ m.x.x, m.y.x, m.z.x, m.w.x },
+		{ m.x.y, m.y.y, m.z.y, m.w.y },
+		{ m.x.z, m.y.z, m.z.z, m.w.z },
+		{ m.x.w, m.y.w, m.z.w, m.w.w },
+	};
+}
+
+// Determinant
+template<typename T>
+constexpr T determinant(matrix2x2<T> m) noexcept {
+	return m.x.x * m.y.y - m.x.y * m.y.x;
+}
+template<typename T>
+constexpr T determinant(matrix3x3<T> m) noexcept {
+	return dot(m.x, cross(m.y, m.z));
+}
+template<typename T>
+constexpr T determinant(matrix4x4<T> m) noexcept {
+	T s0 = m.x.x * m.y.y - m.y.x * m.x.y;
+	T s1 = m.x.x * m.y.z - m.y.x * m.x.z;
+	T s2 = m.x.x * m.y.w - m.y.x * m.x.w;
+	T s3 = m.x.y * m.y.z - m.y.y * m.x.z;
+	T s4 = m.x.y * m.y.w - m.y.y * m.x.w;
+	T s5 = m.x.z * m.y.w - m.y.z * m.x.w;
+
+	T c0 = m.z.x * m.w.y - m.w.x * m.z.y;
+	T c1 = m.z.x * m.w.z - m.w.x * m.z.z;
+	T c2 = m.z.x * m.w.w - m.w.x * m.z.w;
+	T c3 = m.z.y * m.w.z - m.w.y * m.z.z;
+	T c4 = m.z.y * m.w.w - m.w.y * m.z.w;
+	T c5 = m.z.z * m.w.w - m.w.z * m.z.w;
+
+	return s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+}
+
+// Inverse
+// Singular matrices give the zero matrix, same as division by zero
+namespace detail {
+template<typename T>
+constexpr matrix4x4<T> inverse(const matrix4x4<T>& m) noexcept {
+	// 2x2 sub determinants of the top and bottom row pairs
+	T s0 = m.x.x * m.y.y - m.y.x * m.x.y;
+	T s1 = m.x.x * m.y.z - m.y.x * m.x.z;
+	T s2 = m.x.x * m.y.w - m.y.x * m.x.w;
+	T s3 = m.x.y * m.y.z - m.y.y * m.x.z;
+	T s4 = m.x.y * m.y.w - m.y.y * m.x.w;
+	T s5 = m.x.z * m.y.w - m.y.z * m.x.w;
+
+	T c0 = m.z.x * m.w.y - m.w.x * m.z.y;
+	T c1 = m.z.x * m.w.z - m.w.x * m.z.z;
+	T c2 = m.z.x * m.w.w - m.w.x * m.z.w;
+	T c3 = m.z.y * m.w.z - m.w.y * m.z.z;
+	T c4 = m.z.y * m.w.w - m.w.y * m.z.w;
+	T c5 = m.z.z * m.w.w - m.w.z * m.z.w;
+
+	T det = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+	if (det == 0)
+		return {};
+	T invDet = static_cast<T>(1) / det;
+
+	return {
+		{
+			( m.y.y * c5 - m.y.z * c4 + m.y.w * c3) * invDet,
+			(-m.x.y * c5 + m.x.z * c4 - m.x.w * c3) * invDet,
+			( m.w.y * s5 - m.w.z * s4 + m.w.w * s3) * invDet,
+			(-m.z.y * s5 + m.z.z * s4 - m.z.w * s3) * invDet,
+		},
+		{
+			(-m.y.x * c5 + m.y.z * c2 - m.y.w * c1) * invDet,
+			( m.x.x * c5 - m.x.z * c2 + m.x.w * c1) * invDet,
+			(-m.w.x * s5 + m.w.z * s2 - m.w.w * s1) * invDet,
+			( m.z.x * s5 - m.z.z * s2 + m.z.w * s1) * invDet,
+		},
+		{
+			( m.y.x * c4 - m.y.y * c2 + m.y.w * c0) * invDet,
+			(-m.x.x * c4 + m.x.y * c2 - m.x.w * c0) * invDet,
+			( m.w.x * s4 - m.w.y * s2 + m.w.w * s0) * invDet,
+			(-m.z.x * s4 + m.z.y * s2 - m.z.w * s0) * invDet,
+		},
+		{
+			(-m.y.x * c3 + m.y.y * c1 - m.y.z * c0) * invDet,
+			( m.x.x * c3 - m.x.y * c1 + m.x.z * c0) * invDet,
+			(-m.w.x * s3 + m.w.y * s1 - m.w.z * s0) * invDet,
+			( m.z.x * s3 - m.z.y * s1 + m.z.z * s0) * invDet,
+		},
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> inverseAffine(const matrix4x4<T>& m) noexcept {
+	vector3D<T> a{ m.x.x, m.x.y, m.x.z };
+	vector3D<T> b{ m.y.x, m.y.y, m.y.z };
+	vector3D<T> c{ m.z.x, m.z.y, m.z.z };
+	// Columns of the inverse linear part, scaled by the determinant
+	vector3D<T> bc = cross(b, c);
+	vector3D<T> ca = cross(c, a);
+	vector3D<T> ab = cross(a, b);
+	T det = dot(a, bc);
+	T invDet = det != 0 ? static_cast<T>(1) / det : static_cast<T>(0);
+	bc = bc * invDet;
+	ca = ca * invDet;
+	ab = ab * invDet;
+	vector3D<T> pos = -(bc * m.x.w + ca * m.y.w + ab * m.z.w);
+	return {
+		{ bc.x, ca.x, ab.x, pos.x },
+		{ bc.y, ca.y, ab.y, pos.y },
+		{ bc.z, ca.z, ab.z, pos.z },
+		{ 0,    0,    0,    1     },
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> inverseRigid(const matrix4x4<T>& m) noexcept {
+	vector3D<T> pos = -(vector3D<T>{ m.x.x, m.x.y, m.x.z } * m.x.w +
+	                    vector3D<T>{ m.y.x, m.y.y, m.y.z } * m.y.w +
+	                    vector3D<T>{ m.z.x, m.z.y, m.z.z } * m.z.w);
+	return {
+		{ m.x.x, m.y.x, m.z.x, pos.x },
+		{ m.x.y, m.y.y, m.z.y, pos.y },
+		{ m.x.z, m.y.z, m.z.z, pos.z },
+		{ 0,     0,     0,     1     },
+	};
+}
+} // namespace detail
+
+template<typename T>
+constexpr matrix2x2<T> inverse(matrix2x2<T> m) noexcept {
+	T det = determinant(m);
+	if (det == 0)
+		return {};
+	T invDet = static_cast<T>(1) / det;
+	return {
+		{  m.y.y * invDet, -m.x.y * invDet },
+		{ -m.y.x * invDet,  m.x.x * invDet },
+	};
+}
+template<typename T>
+constexpr matrix3x3<T> inverse(matrix3x3<T> m) noexcept {
+	vector3D<T> bc = cross(m.y, m.z);
+	vector3D<T> ca = cross(m.z, m.x);
+	vector3D<T> ab = cross(m.x, m.y);
+	T det = dot(m.x, bc);
+	if (det == 0)
+		return {};
+	T invDet = static_cast<T>(1) / det;
+	bc = bc * invDet;
+	ca = ca * invDet;
+	ab = ab * invDet;
+	return {
+		{ bc.x, ca.x, ab.x },
+		{ bc.y, ca.y, ab.y },
+		{ bc.z, ca.z, ab.z },
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> inverse(matrix4x4<T> m) noexcept {
+	return detail::inverse(m);
+}
+
+// Affine inverse, for matrices whose last row is (0, 0, 0, 1) like the ones built by position and rotation functions
+// A singular linear part gives zero linear part and translation
+template<typename T>
+constexpr matrix3x3<T> inverseAffine(matrix3x3<T> m) noexcept {
+	T det = m.x.x * m.y.y - m.x.y * m.y.x;
+	T invDet = det != 0 ? static_cast<T>(1) / det : static_cast<T>(0);
+	matrix2x2<T> linear{
+		{  m.y.y * invDet, -m.x.y * invDet },
+		{ -m.y.x * invDet,  m.x.x * invDet },
+	};
+	vector2D<T> pos = -(linear * vector2D<T>{ m.x.z, m.y.z });
+	return {
+		{ linear.x.x, linear.x.y, pos.x },
+		{ linear.y.x, linear.y.y, pos.y },
+		{ 0,          0,          1     },
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> inverseAffine(matrix4x4<T> m) noexcept {
+	return detail::inverseAffine(m);
+}
+template<typename T>
+constexpr matrix3x4<T> inverse(matrix3x4<T> m) noexcept {
+	return matrix3x4<T>(inverseAffine(matrix4x4<T>(m)));
+}
+
+// Rigid inverse, for rotation and translation only (orthonormal linear part), the rotation is transposed
+template<typename T>
+constexpr matrix3x3<T> inverseRigid(matrix3x3<T> m) noexcept {
+	vector2D<T> pos = -(vector2D<T>{ m.x.x, m.x.y } * m.x.z + vector2D<T>{ m.y.x, m.y.y } * m.y.z);
+	return {
+		{ m.x.x, m.y.x, pos.x },
+		{ m.x.y, m.y.y, pos.y },
+		{ 0,     0,     1     },
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> inverseRigid(matrix4x4<T> m) noexcept {
+	return detail::inverseRigid(m);
+}
+template<typename T>
+constexpr matrix3x4<T> inverseRigid(matrix3x4<T> m) noexcept {
+	return matrix3x4<T>(inverseRigid(matrix4x4<T>(m)));
+}
+
+// Affine transform of a point (w = 1) and of a direction (w = 0)
+template<typename T>
+constexpr vector3D<T> transformPoint(const matrix3x4<T>& mat, vector3D<T> point) noexcept {
+	return {
+		mat.x.x * point.x + mat.x.y * point.y + mat.x.z * point.z + mat.x.w,
+		mat.y.x * point.x + mat.y.y * point.y + mat.y.z * point.z + mat.y.w,
+		mat.z.x * point.x + mat.z.y * point.y + mat.z.z * point.z + mat.z.w,
+	};
+}
+template<typename T>
+constexpr vector3D<T> transformDirection(const matrix3x4<T>& mat, vector3D<T> direction) noexcept {
+	return {
+		mat.x.x * direction.x + mat.x.y * direction.y + mat.x.z * direction.z,
+		mat.y.x * direction.x + mat.y.y * direction.y + mat.y.z * direction.z,
+		mat.z.x * direction.x + mat.z.y * direction.y + mat.z.z * direction.z,
+	};
+}
+
+// Quaternion functions
+// Quaternions follow the column vector convention of the matrices: rotation by a * b applies b first
+template<typename T>
+constexpr quaternionT<T> identityQuaternion() noexcept {
+	return { static_cast<T>(1.0), static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(0.0) };
+}
+template<typename T>
+constexpr T dot(quaternionT<T> a, quaternionT<T> b) noexcept {
+	return a.w * b.w + a.x * b.x + a.y * b.y + a.z * b.z;
+}
+template<typename T>
+constexpr T magnitudeSquared(quaternionT<T> q) noexcept {
+	return q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z;
+}
+template<typename T>
+constexpr T magnitude(quaternionT<T> q) noexcept {
+	return sqrt(magnitudeSquared(q));
+}
+// Zero quaternion normalizes to identity
+template<typename T>
+constexpr quaternionT<T> normalize(quaternionT<T> q) noexcept {
+	T length = magnitude(q);
+	if (length == 0) {
+		return identityQuaternion<T>();
+	}
+	return { q.w / length, q.x / length, q.y / length, q.z / length };
+}
+template<typename T>
+constexpr quaternionT<T> conjugate(quaternionT<T> q) noexcept {
+	return { q.w, -q.x, -q.y, -q.z };
+}
+template<typename T>
+constexpr quaternionT<T> inverse(quaternionT<T> q) noexcept {
+	T lengthSquared = magnitudeSquared(q);
+	if (lengthSquared == 0) {
+		return identityQuaternion<T>();
+	}
+	return { q.w / lengthSquared, -q.x / lengthSquared, -q.y / lengthSquared, -q.z / lengthSquared };
+}
+
+// Axis angle, positive angles rotate counter-clockwise looking down the axis
+// axis must be normalized
+template<typename T>
+constexpr quaternionT<T> quaternionAxisAngle(vector3D<T> axis, T degrees) noexcept {
+	T half = degrees2radians(degrees) / static_cast<T>(2);
+	T s = sin(half);
+	return { cos(half), axis.x * s, axis.y * s, axis.z * s };
+}
+// Zero rotation gives axis { 0, 0, 1 }
+template<typename T>
+constexpr void quaternion2axisAngle(quaternionT<T> q, vector3D<T>& outAxis, T& outDegrees) noexcept {
+	q = normalize(q);
+	if (q.w < 0) {
+		q = { -q.w, -q.x, -q.y, -q.z };
+	}
+	T s = sqrt(q.x * q.x + q.y * q.y + q.z * q.z);
+	outDegrees = radians2degrees(static_cast<T>(2) * atan2(s, q.w));
+	if (s < static_cast<T>(0.000001)) {
+		outAxis = { static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(1.0) };
+		return;
+	}
+	outAxis = { q.x / s, q.y / s, q.z / s };
+}
+
+// Euler angles, same axis order and directions as rotation3D:
+// quaternion2matrix3x3(quaternionEuler(d)) == rotation3D(d)
+template<typename T>
+constexpr quaternionT<T> quaternionEuler(vector3D<T> degrees) noexcept {
+	T hx = -degrees2radians(degrees.x) / static_cast<T>(2);
+	T hy = degrees2radians(degrees.y) / static_cast<T>(2);
+	T hz = -degrees2radians(degrees.z) / static_cast<T>(2);
+	T sx = sin(hx), cx = cos(hx);
+	T sy = sin(hy), cy = cos(hy);
+	T sz = sin(hz), cz = cos(hz);
+	// qy * qx * qz expanded
+	return {
+		cy * cx * cz + sy * sx * sz,
+		cy * sx * cz + sy * cx * sz,
+		sy * cx * cz - cy * sx * sz,
+		cy * cx * sz - sy * sx * cz,
+	};
+}
+template<typename T>
+constexpr vector3D<T> quaternion2euler(quaternionT<T> q) noexcept {
+	q = normalize(q);
+	T m02 = static_cast<T>(2) * (q.x * q.z + q.w * q.y);
+	T m12 = static_cast<T>(2) * (q.y * q.z - q.w * q.x);
+	T m22 = static_cast<T>(1) - static_cast<T>(2) * (q.x * q.x + q.y * q.y);
+	T m10 = static_cast<T>(2) * (q.x * q.y + q.w * q.z);
+	T m11 = static_cast<T>(1) - static_cast<T>(2) * (q.x * q.x + q.z * q.z);
+
+	T sinX = m12 > static_cast<T>(1) ? static_cast<T>(1) : (m12 < static_cast<T>(-1) ? static_cast<T>(-1) : m12);
+	T angleX = asin(sinX);
+	T angleY, angleZ;
+	if (abs(sinX) < static_cast<T>(0.9999)) {
+		angleY = atan2(m02, m22);
+		angleZ = -atan2(m10, m11);
+	}
+	else {
+		// Gimbal lock, the whole remaining rotation goes to Y
+		T m00 = static_cast<T>(1) - static_cast<T>(2) * (q.y * q.y + q.z * q.z);
+		T m20 = static_cast<T>(2) * (q.x * q.z - q.w * q.y);
+		angleY = atan2(-m20, m00);
+		angleZ = 0;
+	}
+	return { radians2degrees(angleX), radians2degrees(angleY), radians2degrees(angleZ) };
+}
+
+// Conversion to and from rotation matrices
+template<typename T>
+constexpr matrix3x3<T> quaternion2matrix3x3(quaternionT<T> q) noexcept {
+	T xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+	T xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+	T wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+	T one = static_cast<T>(1), two = static_cast<T>(2);
+	return {
+		{ one - two * (yy + zz), two * (xy - wz),       two * (xz + wy) },
+		{ two * (xy + wz),       one - two * (xx + zz), two * (yz - wx) },
+		{ two * (xz - wy),       two * (yz + wx),       one - two * (xx + yy) },
+	};
+}
+template<typename T>
+constexpr matrix4x4<T> quaternion2matrix4x4(quaternionT<T> q) noexcept {
+	matrix3x3<T> m = quaternion2matrix3x3(q);
+	return {
+		{ m.x.x, m.x.y, m.x.z, static_cast<T>(0.0) },
+		{ m.y.x, m.y.y, m.y.z, static_cast<T>(0.0) },
+		{ m.z.x, m.z.y, m.z.z, static_cast<T>(0.0) },
+		{ static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(0.0), static_cast<T>(1.0) },
+	};
+}
+// mat must be a pure rotation (orthonormal, determinant 1)
+template<typename T>
+constexpr quaternionT<T> matrix2quaternion(matrix3x3<T> m) noexcept {
+	T one = static_cast<T>(1);
+	T trace = m.x.x + m.y.y + m.z.z;
+	quaternionT<T> q{};
+	if (trace > 0) {
+		T s = sqrt(trace + one) * static_cast<T>(2);
+		q = { s / 4, (m.z.y - m.y.z) / s, (m.x.z - m.z.x) / s, (m.y.x - m.x.y) / s };
+	}
+	else if (m.x.x > m.y.y && m.x.x > m.z.z) {
+		T s = sqrt(one + m.x.x - m.y.y - m.z.z) * static_cast<T>(2);
+		q = { (m.z.y - m.y.z) / s, s / 4, (m.x.y + m.y.x) / s, (m.x.z + m.z.x) / s };
+	}
+	else if (m.y.y > m.z.z) {
+		T s = sqrt(one + m.y.y - m.x.x - m.z.z) * static_cast<T>(2);
+		q = { (m.x.z - m.z.x) / s, (m.x.y + m.y.x) / s, s / 4, (m.y.z + m.z.y) / s };
+	}
+	else {
+		T s = sqrt(one + m.z.z - m.x.x - m.y.y) * static_cast<T>(2);
+		q = { (m.y.x - m.x.y) / s, (m.x.z + m.z.x) / s, (m.y.z + m.z.y) / s, s / 4 };
+	}
+	return normalize(q);
+}
+
+// Interpolation, both take the shortest path
+template<typename T>
+constexpr quaternionT<T> nlerp(quaternionT<T> a, quaternionT<T> b, T t) noexcept {
+	T sign = dot(a, b) < 0 ? static_cast<T>(-1) : static_cast<T>(1);
+	T ta = static_cast<T>(1) - t;
+	T tb = t * sign;
+	return normalize(quaternionT<T>{ a.w * ta + b.w * tb, a.x * ta + b.x * tb, a.y * ta + b.y * tb, a.z * ta + b.z * tb });
+}
+template<typename T>
+constexpr quaternionT<T> slerp(quaternionT<T> a, quaternionT<T> b, T t) noexcept {
+	T cosTheta = dot(a, b);
+	T sign = static_cast<T>(1);
+	if (cosTheta < 0) {
+		cosTheta = -cosTheta;
+		sign = static_cast<T>(-1);
+	}
+	// Nearly parallel, sin(theta) is too small to divide by
+	if (cosTheta > static_cast<T>(0.9995)) {
+		return nlerp(a, b, t);
+	}
+	T theta = acos(cosTheta);
+	T sinTheta = sin(theta);
+	T ta = sin((static_cast<T>(1) - t) * theta) / sinTheta;
+	T tb = sin(t * theta) / sinTheta * sign;
+	return { a.w * ta + b.w * tb, a.x * ta + b.x * tb, a.y * ta + b.y * tb, a.z * ta + b.z * tb };
+}
+
+// Translation, rotation and scale
+// compose builds translation * rotation * scale, decompose splits such a matrix back
+template<typename T>
+constexpr matrix4x4<T> compose(vector3D<T> position, quaternionT<T> rotation, vector3D<T> scale) noexcept {
+	matrix3x3<T> r = quaternion2matrix3x3(rotation);
+	return {
+		{ r.x.x * scale.x, r.x.y * scale.y, r.x.z * scale.z, position.x },
+		{ r.y.x * scale.x, r.y.y * scale.y, r.y.z * scale.z, position.y },
+		{ r.z.x * scale.x, r.z.y * scale.y, r.z.z * scale.z, position.z },
+		{ 0,               0,               0,               1          },
+	};
+}
+// Shear is not represented and is lost, a reflection is returned as negative scale.x
+// Zero scale axes give an arbitrary rotation for that axis
+template<typename T>
+constexpr void decompose(const matrix4x4<T>& m, vector3D<T>& outPosition, quaternionT<T>& outRotation, vector3D<T>& outScale) noexcept {
+	outPosition = { m.x.w, m.y.w, m.z.w };
+	vector3D<T> columnX{ m.x.x, m.y.x, m.z.x };
+	vector3D<T> columnY{ m.x.y, m.y.y, m.z.y };
+	vector3D<T> columnZ{ m.x.z, m.y.z, m.z.z };
+	outScale = { magnitude(columnX), magnitude(columnY), magnitude(columnZ) };
+	if (dot(columnX, cross(columnY, columnZ)) < 0) {
+		outScale.x = -outScale.x;
+	}
+	columnX = columnX / outScale.x;
+	columnY = columnY / outScale.y;
+	columnZ = columnZ / outScale.z;
+	outRotation = matrix2quaternion(matrix3x3<T>{
+		{ columnX.x, columnY.x, columnZ.x },
+		{ columnX.y, columnY.y, columnZ.y },
+		{ columnX.z, columnY.z, columnZ.z },
+	});
+}
+
+// Symmetric eigen decomposition with cyclic Jacobi rotations, m = vectors * diag(values) * transpose(vectors)
+// Only the upper triangle of m is read. Eigenvalues are sorted largest first, the columns of
+// outVectors are the matching unit eigenvectors and form a rotation
+template<typename T>
+constexpr void eigenSymmetric(matrix3x3<T> m, vector3D<T>& outValues, matrix3x3<T>& outVectors) noexcept {
+	T a[3][3] = {
+		{ m.x.x, m.x.y, m.x.z },
+		{ m.x.y, m.y.y, m.y.z },
+		{ m.x.z, m.y.z, m.z.z },
+	};
+	T v[3][3] = {
+		{ 1, 0, 0 },
+		{ 0, 1, 0 },
+		{ 0, 0, 1 },
+	};
+	constexpr T epsilon = std::numeric_limits<T>::epsilon();
+	// Converges quadratically, a handful of sweeps reach machine precision
+	for (int sweep = 0; sweep < 16; sweep++) {
+		T offDiagonal = a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2];
+		T diagonal = a[0][0] * a[0][0] + a[1][1] * a[1][1] + a[2][2] * a[2][2];
+		if (offDiagonal <= diagonal * epsilon * epsilon) {
+			break;
+		}
+		for (int p = 0; p < 2; p++) {
+			for (int q = p + 1; q < 3; q++) {
+				if (a[p][q] == 0) {
+					continue;
+				}
+				// Rotation in the pq plane that zeroes a[p][q]
+				T theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+				T t = (theta >= 0 ? 1 : -1) / (abs(theta) + sqrt(theta * theta + 1));
+				T c = 1 / sqrt(t * t + 1);
+				T s = t * c;
+				for (int k = 0; k < 3; k++) {
+					T kp = a[k][p], kq = a[k][q];
+					a[k][p] = c * kp - s * kq;
+					a[k][q] = s * kp + c * kq;
+				}
+				for (int k = 0; k < 3; k++) {
+					T pk = a[p][k], qk = a[q][k];
+					a[p][k] = c * pk - s * qk;
+					a[q][k] = s * pk + c * qk;
+				}
+				for (int k = 0; k < 3; k++) {
+					T kp = v[k][p], kq = v[k][q];
+					v[k][p] = c * kp - s * kq;
+					v[k][q] = s * kp + c * kq;
+				}
+			}
+		}
+	}
+	int order[3] = { 0, 1, 2 };
+	for (int i = 0; i < 2; i++) {
+		for (int j = i + 1; j < 3; j++) {
+			if (a[order[j]][order[j]] > a[order[i]][order[i]]) {
+				int swap = order[i];
+				order[i] = order[j];
+				order[j] = swap;
+			}
+		}
+	}
+	outValues = { a[order[0]][order[0]], a[order[1]][order[1]], a[order[2]][order[2]] };
+	vector3D<T> first{ v[0][order[0]], v[1][order[0]], v[2][order[0]] };
+	vector3D<T> second{ v[0][order[1]], v[1][order[1]], v[2][order[1]] };
+	// Right handed, the third vector is only defined up to sign
+	vector3D<T> third = cross(first, second);
+	outVectors = {
+		{ first.x, second.x, third.x },
+		{ first.y, second.y, third.y },
+		{ first.z, second.z, third.z },
+	};
+}
+
 // Equal
 template<typename T>
-bool equal(vector2D<T> a, vector2D<T> b, T epsilon = 0.0001) {
+constexpr bool equal(vector2D<T> a, vector2D<T> b, T epsilon = 0.0001) noexcept {
+	return (
+		abs(a.x - b.x) < epsilon &&
+		abs(a.y - b.y) < epsilon
+		);
+}
+template<typename T>
+constexpr bool equal(vector3D<T> a, vector3D<T> b, T epsilon = 0.0001) noexcept {
 	return (
-		std::abs(a.x - b.x) < epsilon &&
-		std::abs(a.y - b.y) < epsilon
+		abs(a.x - b.x) < epsilon &&
+		abs(a.y - b.y) < epsilon &&
+		abs(a.z - b.z) < epsilon
 		);
 }
 template<typename T>
-bool equal(vector3D<T> a, vector3D<T> b, T epsilon = 0.0001) {
+constexpr bool equal(vector4D<T> a, vector4D<T> b, T epsilon = 0.0001) noexcept {
 	return (
-		std::abs(a.x - b.x) < epsilon &&
-		std::abs(a.y - b.y) < epsilon &&
-		std::abs(a.z - b.z) < epsilon
+		abs(a.x - b.x) < epsilon &&
+		abs(a.y - b.y) < epsilon &&
+		abs(a.z - b.z) < epsilon &&
+		abs(a.w - b.w) < epsilon
 		);
 }
 template<typename T>
-bool equal(vector4D<T> a, vector4D<T> b, T epsilon = 0.0001) {
+constexpr bool equal(quaternionT<T> a, quaternionT<T> b, T epsilon = 0.0001) noexcept {
 	return (
-		std::abs(a.x - b.x) < epsilon &&
-		std::abs(a.y - b.y) < epsilon &&
-		std::abs(a.z - b.z) < epsilon &&
-		std::abs(a.w - b.w) < epsilon
+		abs(a.w - b.w) < epsilon &&
+		abs(a.x - b.x) < epsilon &&
+		abs(a.y - b.y) < epsilon &&
+		abs(a.z - b.z) < epsilon
 		);
 }
 template<typename T>
-bool equal(vector2D<T> a, T b, T epsilon = 0.0001) {
+constexpr bool equal(matrix2x2<T> a, matrix2x2<T> b, T epsilon = 0.0001) noexcept {
+	return equal(a.x, b.x, epsilon) && equal(a.y, b.y, epsilon);
+}
+template<typename T>
+constexpr bool equal(matrix3x3<T> a, matrix3x3<T> b, T epsilon = 0.0001) noexcept {
+	return equal(a.x, b.x, epsilon) && equal(a.y, b.y, epsilon) && equal(a.z, b.z, epsilon);
+}
+template<typename T>
+constexpr bool equal(matrix3x4<T> a, matrix3x4<T> b, T epsilon = 0.0001) noexcept {
+	return equal(a.x, b.x, epsilon) && equal(a.y, b.y, epsilon) && equal(a.z, b.z, epsilon);
+}
+template<typename T>
+constexpr bool equal(matrix4x4<T> a, matrix4x4<T> b, T epsilon = 0.0001) noexcept {
+	return equal(a.x, b.x, epsilon) && equal(a.y, b.y, epsilon) && equal(a.z, b.z, epsilon) && equal(a.w, b.w, epsilon);
+}
+template<typename T>
+constexpr bool equal(vector2D<T> a, T b, T epsilon = 0.0001) noexcept {
 	return equal(a, { b, b }, epsilon);
 }
 template<typename T>
-bool equal(vector3D<T> a, T b, T epsilon = 0.0001) {
+constexpr bool equal(vector3D<T> a, T b, T epsilon = 0.0001) noexcept {
 	return equal(a, { b, b, b }, epsilon);
 }
 template<typename T>
-bool equal(vector4D<T> a, T b, T epsilon = 0.0001) {
+constexpr bool equal(vector4D<T> a, T b, T epsilon = 0.0001) noexcept {
 	return equal(a, { b, b, b, b }, epsilon);
 }
 
@@ -347,19 +1161,19 @@ bool equal(vector4D<T> a, T b, T epsilon = 0.0001) {
 // Component-vise operations
 // vector2D
 template<typename T>
-vector2D<T> operator+(vector2D<T> a, vector2D<T> b) {
+constexpr vector2D<T> operator+(vector2D<T> a, vector2D<T> b) noexcept {
 	return { a.x + b.x, a.y + b.y };
 }
 template<typename T>
-vector2D<T> operator-(vector2D<T> a, vector2D<T> b) {
+constexpr vector2D<T> operator-(vector2D<T> a, vector2D<T> b) noexcept {
 	return { a.x - b.x, a.y - b.y };
 }
 template<typename T>
-vector2D<T> operator*(vector2D<T> a, vector2D<T> b) {
+constexpr vector2D<T> operator*(vector2D<T> a, vector2D<T> b) noexcept {
 	return { a.x * b.x, a.y * b.y };
 }
 template<typename T>
-vector2D<T> operator/(vector2D<T> a, vector2D<T> b) {
+constexpr vector2D<T> operator/(vector2D<T> a, vector2D<T> b) noexcept {
 	return { 
 		b.x != 0 ? a.x / b.x : 0,
 		b.y != 0 ? a.y / b.y : 0
@@ -367,19 +1181,19 @@ vector2D<T> operator/(vector2D<T> a, vector2D<T> b) {
 }
 // vector3D
 template<typename T>
-vector3D<T> operator+(vector3D<T> a, vector3D<T> b) {
+constexpr vector3D<T> operator+(vector3D<T> a, vector3D<T> b) noexcept {
 	return { a.x + b.x, a.y + b.y, a.z + b.z };
 }
 template<typename T>
-vector3D<T> operator-(vector3D<T> a, vector3D<T> b) {
+constexpr vector3D<T> operator-(vector3D<T> a, vector3D<T> b) noexcept {
 	return { a.x - b.x, a.y - b.y, a.z - b.z };
 }
 template<typename T>
-vector3D<T> operator*(vector3D<T> a, vector3D<T> b) {
+constexpr vector3D<T> operator*(vector3D<T> a, vector3D<T> b) noexcept {
 	return { a.x * b.x, a.y * b.y, a.z * b.z };
 }
 template<typename T>
-vector3D<T> operator/(vector3D<T> a, vector3D<T> b) {
+constexpr vector3D<T> operator/(vector3D<T> a, vector3D<T> b) noexcept {
 	return {
 		b.x != 0 ? a.x / b.x : 0,
 		b.y != 0 ? a.y / b.y : 0,
@@ -388,19 +1202,19 @@ vector3D<T> operator/(vector3D<T> a, vector3D<T> b) {
 }
 // vector4D
 template<typename T>
-vector4D<T> operator+(vector4D<T> a, vector4D<T> b) {
+constexpr vector4D<T> operator+(vector4D<T> a, vector4D<T> b) noexcept {
 	return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
 }
 template<typename T>
-vector4D<T> operator-(vector4D<T> a, vector4D<T> b) {
+constexpr vector4D<T> operator-(vector4D<T> a, vector4D<T> b) noexcept {
 	return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
 }
 template<typename T>
-vector4D<T> operator*(vector4D<T> a, vector4D<T> b) {
+constexpr vector4D<T> operator*(vector4D<T> a, vector4D<T> b) noexcept {
 	return { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w };
 }
 template<typename T>
-vector4D<T> operator/(vector4D<T> a, vector4D<T> b) {
+constexpr vector4D<T> operator/(vector4D<T> a, vector4D<T> b) noexcept {
 	return {
 		b.x != 0 ? a.x / b.x : 0,
 		b.y != 0 ? a.y / b.y : 0,
@@ -411,19 +1225,19 @@ vector4D<T> operator/(vector4D<T> a, vector4D<T> b) {
 // Scalar operations
 // vector2D
 template<typename T>
-vector2D<T> operator+(vector2D<T> a, T s) {
+constexpr vector2D<T> operator+(vector2D<T> a, T s) noexcept {
 	return { a.x + s, a.y + s };
 }
 template<typename T>
-vector2D<T> operator-(vector2D<T> a, T s) {
+constexpr vector2D<T> operator-(vector2D<T> a, T s) noexcept {
 	return { a.x - s, a.y - s };
 }
 template<typename T>
-vector2D<T> operator*(vector2D<T> a, T s) {
+constexpr vector2D<T> operator*(vector2D<T> a, T s) noexcept {
 	return { a.x * s, a.y * s };
 }
 template<typename T>
-vector2D<T> operator/(vector2D<T> a, T s) {
+constexpr vector2D<T> operator/(vector2D<T> a, T s) noexcept {
 	if (s == 0) {
 		return { 0, 0 };
 	}
@@ -431,19 +1245,19 @@ vector2D<T> operator/(vector2D<T> a, T s) {
 }
 // vector3D
 template<typename T>
-vector3D<T> operator+(vector3D<T> a, T s) {
+constexpr vector3D<T> operator+(vector3D<T> a, T s) noexcept {
 	return { a.x + s, a.y + s, a.z + s };
 }
 template<typename T>
-vector3D<T> operator-(vector3D<T> a, T s) {
+constexpr vector3D<T> operator-(vector3D<T> a, T s) noexcept {
 	return { a.x - s, a.y - s, a.z - s};
 }
 template<typename T>
-vector3D<T> operator*(vector3D<T> a, T s) {
+constexpr vector3D<T> operator*(vector3D<T> a, T s) noexcept {
 	return { a.x * s, a.y * s, a.z * s };
 }
 template<typename T>
-vector3D<T> operator/(vector3D<T> a, T s) {
+constexpr vector3D<T> operator/(vector3D<T> a, T s) noexcept {
 	if (s == 0) {
 		return { 0, 0 };
 	}
@@ -451,19 +1265,19 @@ vector3D<T> operator/(vector3D<T> a, T s) {
 }
 // vector4D
 template<typename T>
-vector4D<T> operator+(vector4D<T> a, T s) {
+constexpr vector4D<T> operator+(vector4D<T> a, T s) noexcept {
 	return { a.x + s, a.y + s, a.z + s, a.w + s };
 }
 template<typename T>
-vector4D<T> operator-(vector4D<T> a, T s) {
+constexpr vector4D<T> operator-(vector4D<T> a, T s) noexcept {
 	return { a.x - s, a.y - s, a.z - s, a.w - s };
 }
 template<typename T>
-vector4D<T> operator*(vector4D<T> a, T s) {
+constexpr vector4D<T> operator*(vector4D<T> a, T s) noexcept {
 	return { a.x * s, a.y * s, a.z * s, a.w * s };
 }
 template<typename T>
-vector4D<T> operator/(vector4D<T> a, T s) {
+constexpr vector4D<T> operator/(vector4D<T> a, T s) noexcept {
 	if (s == 0) {
 		return { 0, 0 };
 	}
@@ -471,199 +1285,266 @@ vector4D<T> operator/(vector4D<T> a, T s) {
 }
 // Modulo
 template<typename T>
-vector2D<T> operator%(vector2D<T> a, T s) {
+constexpr vector2D<T> operator%(vector2D<T> a, T s) noexcept {
 	if (s == 0) {
 		return { 0,  0 };
 	}
-	return { std::fmod(a.x, s), std::fmod(a.y, s) };
+	return { fmod(a.x, s), fmod(a.y, s) };
 }
 template<typename T>
-vector3D<T> operator%(vector3D<T> a, T s) {
+constexpr vector3D<T> operator%(vector3D<T> a, T s) noexcept {
 	if (s == 0) {
 		return { 0,  0 };
 	}
-	return { std::fmod(a.x, s), std::fmod(a.y, s), std::fmod(a.z, s) };
+	return { fmod(a.x, s), fmod(a.y, s), fmod(a.z, s) };
 }
 template<typename T>
-vector4D<T> operator%(vector4D<T> a, T s) {
+constexpr vector4D<T> operator%(vector4D<T> a, T s) noexcept {
 	if (s == 0) {
 		return { 0,  0 };
 	}
-	return { std::fmod(a.x, s), std::fmod(a.y, s), std::fmod(a.z, s), std::fmod(a.w, s) };
+	return { fmod(a.x, s), fmod(a.y, s), fmod(a.z, s), fmod(a.w, s) };
 }
 // With vectors
 template<typename T>
-vector2D<T> operator%(vector2D<T> a, vector2D<T> b) {
+constexpr vector2D<T> operator%(vector2D<T> a, vector2D<T> b) noexcept {
 	return {
-		b.x != 0 ? std::fmod(a.x, b.x) : 0,
-		b.y != 0 ? std::fmod(a.y, b.y) : 0
+		b.x != 0 ? fmod(a.x, b.x) : 0,
+		b.y != 0 ? fmod(a.y, b.y) : 0
 	};
 }
 template<typename T>
-vector3D<T> operator%(vector3D<T> a, vector3D<T> b) {
+constexpr vector3D<T> operator%(vector3D<T> a, vector3D<T> b) noexcept {
 	return {
-		b.x != 0 ? std::fmod(a.x, b.x) : 0,
-		b.y != 0 ? std::fmod(a.y, b.y) : 0,
-		b.z != 0 ? std::fmod(a.z, b.z) : 0
+		b.x != 0 ? fmod(a.x, b.x) : 0,
+		b.y != 0 ? fmod(a.y, b.y) : 0,
+		b.z != 0 ? fmod(a.z, b.z) : 0
 	};
 }
 template<typename T>
-vector4D<T> operator%(vector4D<T> a, vector4D<T> b) {
+constexpr vector4D<T> operator%(vector4D<T> a, vector4D<T> b) noexcept {
 	return {
-		b.x != 0 ? std::fmod(a.x, b.x) : 0,
-		b.y != 0 ? std::fmod(a.y, b.y) : 0,
-		b.z != 0 ? std::fmod(a.z, b.z) : 0,
-		b.w != 0 ? std::fmod(a.w, b.w) : 0
+		b.x != 0 ? fmod(a.x, b.x) : 0,
+		b.y != 0 ? fmod(a.y, b.y) : 0,
+		b.z != 0 ? fmod(a.z, b.z) : 0,
+		b.w != 0 ? fmod(a.w, b.w) : 0
 	};
 }
 // Compound assign operations
 // vector2D
 template<typename T>
-vector2D<T>& operator+=(vector2D<T>& a, vector2D<T> b) {
+constexpr vector2D<T>& operator+=(vector2D<T>& a, vector2D<T> b) noexcept {
 	return a = a + b;
 }
 template<typename T>
-vector2D<T>& operator-=(vector2D<T>& a, vector2D<T> b) {
+constexpr vector2D<T>& operator-=(vector2D<T>& a, vector2D<T> b) noexcept {
 	return a = a - b;
 }
 template<typename T>
-vector2D<T>& operator*=(vector2D<T>& a, vector2D<T> b) {
+constexpr vector2D<T>& operator*=(vector2D<T>& a, vector2D<T> b) noexcept {
 	return a = a * b;
 }
 template<typename T>
-vector2D<T>& operator/=(vector2D<T>& a, vector2D<T> b) {
+constexpr vector2D<T>& operator/=(vector2D<T>& a, vector2D<T> b) noexcept {
 	return a = a / b;
 }
 // vector3D
 template<typename T>
-vector3D<T>& operator+=(vector3D<T>& a, vector3D<T> b) {
+constexpr vector3D<T>& operator+=(vector3D<T>& a, vector3D<T> b) noexcept {
 	return a = a + b;
 }
 template<typename T>
-vector3D<T>& operator-=(vector3D<T>& a, vector3D<T> b) {
+constexpr vector3D<T>& operator-=(vector3D<T>& a, vector3D<T> b) noexcept {
 	return a = a - b;
 }
 template<typename T>
-vector3D<T>& operator*=(vector3D<T>& a, vector3D<T> b) {
+constexpr vector3D<T>& operator*=(vector3D<T>& a, vector3D<T> b) noexcept {
 	return a = a * b;
 }
 template<typename T>
-vector3D<T>& operator/=(vector3D<T>& a, vector3D<T> b) {
+constexpr vector3D<T>& operator/=(vector3D<T>& a, vector3D<T> b) noexcept {
 	return a = a / b;
 }
 // vector4D
 template<typename T>
-vector4D<T>& operator+=(vector4D<T>& a, vector4D<T> b) {
+constexpr vector4D<T>& operator+=(vector4D<T>& a, vector4D<T> b) noexcept {
 	return a = a + b;
 }
 template<typename T>
-vector4D<T>& operator-=(vector4D<T>& a, vector4D<T> b) {
+constexpr vector4D<T>& operator-=(vector4D<T>& a, vector4D<T> b) noexcept {
 	return a = a - b;
 }
 template<typename T>
-vector4D<T>& operator*=(vector4D<T>& a, vector4D<T> b) {
+constexpr vector4D<T>& operator*=(vector4D<T>& a, vector4D<T> b) noexcept {
 	return a = a * b;
 }
 template<typename T>
-vector4D<T>& operator/=(vector4D<T>& a, vector4D<T> b) {
+constexpr vector4D<T>& operator/=(vector4D<T>& a, vector4D<T> b) noexcept {
 	return a = a / b;
 }
 // Compound assign operations with scalar
 // vector2D
 template<typename T>
-vector2D<T>& operator+=(vector2D<T>& a, T s) {
+constexpr vector2D<T>& operator+=(vector2D<T>& a, T s) noexcept {
 	return a = a + s;
 }
 template<typename T>
-vector2D<T>& operator-=(vector2D<T>& a, T s) {
+constexpr vector2D<T>& operator-=(vector2D<T>& a, T s) noexcept {
 	return a = a - s;
 }
 template<typename T>
-vector2D<T>& operator*=(vector2D<T>& a, T s) {
+constexpr vector2D<T>& operator*=(vector2D<T>& a, T s) noexcept {
 	return a = a * s;
 }
 template<typename T>
-vector2D<T>& operator/=(vector2D<T>& a, T s) {
+constexpr vector2D<T>& operator/=(vector2D<T>& a, T s) noexcept {
 	return a = a / s;
 }
 // vector3D
 template<typename T>
-vector3D<T>& operator+=(vector3D<T>& a, T s) {
+constexpr vector3D<T>& operator+=(vector3D<T>& a, T s) noexcept {
 	return a = a + s;
 }
 template<typename T>
-vector3D<T>& operator-=(vector3D<T>& a, T s) {
+constexpr vector3D<T>& operator-=(vector3D<T>& a, T s) noexcept {
 	return a = a - s;
 }
 template<typename T>
-vector3D<T>& operator*=(vector3D<T>& a, T s) {
+constexpr vector3D<T>& operator*=(vector3D<T>& a, T s) noexcept {
 	return a = a * s;
 }
 template<typename T>
-vector3D<T>& operator/=(vector3D<T>& a, T s) {
+constexpr vector3D<T>& operator/=(vector3D<T>& a, T s) noexcept {
 	return a = a / s;
 }
 // vector4D
 template<typename T>
-vector4D<T>& operator+=(vector4D<T>& a, T s) {
+constexpr vector4D<T>& operator+=(vector4D<T>& a, T s) noexcept {
 	return a = a + s;
 }
 template<typename T>
-vector4D<T>& operator-=(vector4D<T>& a, T s) {
+constexpr vector4D<T>& operator-=(vector4D<T>& a, T s) noexcept {
 	return a = a - s;
 }
 template<typename T>
-vector4D<T>& operator*=(vector4D<T>& a, T s) {
+constexpr vector4D<T>& operator*=(vector4D<T>& a, T s) noexcept {
 	return a = a * s;
 }
 template<typename T>
-vector4D<T>& operator/=(vector4D<T>& a, T s) {
+constexpr vector4D<T>& operator/=(vector4D<T>& a, T s) noexcept {
 	return a = a / s;
 }
 // Modulo
 template<typename T>
-vector2D<T>& operator%=(vector2D<T>& a, T s) {
+constexpr vector2D<T>& operator%=(vector2D<T>& a, T s) noexcept {
 	return a = a % s;
 }
 template<typename T>
-vector3D<T>& operator%=(vector3D<T>& a, T s) {
+constexpr vector3D<T>& operator%=(vector3D<T>& a, T s) noexcept {
 	return a = a % s;
 }
 template<typename T>
-vector4D<T>& operator%=(vector4D<T>& a, T s) {
+constexpr vector4D<T>& operator%=(vector4D<T>& a, T s) noexcept {
 	return a = a % s;
 }
 
+// Unchecked division
+// Same as operator/, operator% and their compound forms, but without the zero divisor checks,
+// so loops over them vectorize into straight-line code. A zero divisor gives inf / nan
+namespace unchecked {
+
+// Divide
+template<typename T>
+constexpr vector2D<T> divide(vector2D<T> a, vector2D<T> b) noexcept {
+	return { a.x / b.x, a.y / b.y };
+}
+template<typename T>
+constexpr vector3D<T> divide(vector3D<T> a, vector3D<T> b) noexcept {
+	return { a.x / b.x, a.y / b.y, a.z / b.z };
+}
+template<typename T>
+constexpr vector4D<T> divide(vector4D<T> a, vector4D<T> b) noexcept {
+	return { a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w };
+}
+template<typename T>
+constexpr vector2D<T> divide(vector2D<T> a, T s) noexcept {
+	return { a.x / s, a.y / s };
+}
+template<typename T>
+constexpr vector3D<T> divide(vector3D<T> a, T s) noexcept {
+	return { a.x / s, a.y / s, a.z / s };
+}
+template<typename T>
+constexpr vector4D<T> divide(vector4D<T> a, T s) noexcept {
+	return { a.x / s, a.y / s, a.z / s, a.w / s };
+}
+// Modulo
+template<typename T>
+constexpr vector2D<T> modulo(vector2D<T> a, vector2D<T> b) noexcept {
+	return { fmod(a.x, b.x), fmod(a.y, b.y) };
+}
+template<typename T>
+constexpr vector3D<T> modulo(vector3D<T> a, vector3D<T> b) noexcept {
+	return { fmod(a.x, b.x), fmod(a.y, b.y), fmod(a.z, b.z) };
+}
+template<typename T>
+constexpr vector4D<T> modulo(vector4D<T> a, vector4D<T> b) noexcept {
+	return { fmod(a.x, b.x), fmod(a.y, b.y), fmod(a.z, b.z), fmod(a.w, b.w) };
+}
+template<typename T>
+constexpr vector2D<T> modulo(vector2D<T> a, T s) noexcept {
+	return { fmod(a.x, s), fmod(a.y, s) };
+}
+template<typename T>
+constexpr vector3D<T> modulo(vector3D<T> a, T s) noexcept {
+	return { fmod(a.x, s), fmod(a.y, s), fmod(a.z, s) };
+}
+template<typename T>
+constexpr vector4D<T> modulo(vector4D<T> a, T s) noexcept {
+	return { fmod(a.x, s), fmod(a.y, s), fmod(a.z, s), fmod(a.w, s) };
+}
+// Compound forms
+template<typename V, typename D>
+constexpr V& divideAssign(V& a, D b) noexcept {
+	return a = divide(a, b);
+}
+template<typename V, typename D>
+constexpr V& moduloAssign(V& a, D b) noexcept {
+	return a = modulo(a, b);
+}
+
+} // namespace unchecked
+
 // Unary operations
 // Negate
 template<typename T>
-vector2D<T> operator-(vector2D<T> a) {
+constexpr vector2D<T> operator-(vector2D<T> a) noexcept {
 	return { -a.x, -a.y };
 }
 template<typename T>
-vector3D<T> operator-(vector3D<T> a) {
+constexpr vector3D<T> operator-(vector3D<T> a) noexcept {
 	return { -a.x, -a.y, -a.z };
 }
 template<typename T>
-vector4D<T> operator-(vector4D<T> a) {
+constexpr vector4D<T> operator-(vector4D<T> a) noexcept {
 	return { -a.x, -a.y, -a.z, -a.w };
 }
 // Increment
 template<typename T>
-vector2D<T>& operator++(vector2D<T>& a) {
+constexpr vector2D<T>& operator++(vector2D<T>& a) noexcept {
 	++a.x;
 	++a.y;
 	return a;
 }
 template<typename T>
-vector3D<T>& operator++(vector3D<T>& a) {
+constexpr vector3D<T>& operator++(vector3D<T>& a) noexcept {
 	++a.x;
 	++a.y;
 	++a.z;
 	return a;
 }
 template<typename T>
-vector4D<T>& operator++(vector4D<T>& a) {
+constexpr vector4D<T>& operator++(vector4D<T>& a) noexcept {
 	++a.x;
 	++a.y;
 	++a.z;
@@ -672,20 +1553,20 @@ vector4D<T>& operator++(vector4D<T>& a) {
 }
 // Decrement
 template<typename T>
-vector2D<T>& operator--(vector2D<T>& a) {
+constexpr vector2D<T>& operator--(vector2D<T>& a) noexcept {
 	--a.x;
 	--a.y;
 	return a;
 }
 template<typename T>
-vector3D<T>& operator--(vector3D<T>& a) {
+constexpr vector3D<T>& operator--(vector3D<T>& a) noexcept {
 	--a.x;
 	--a.y;
 	--a.z;
 	return a;
 }
 template<typename T>
-vector4D<T>& operator--(vector4D<T>& a) {
+constexpr vector4D<T>& operator--(vector4D<T>& a) noexcept {
 	--a.x;
 	--a.y;
 	--a.z;
@@ -696,14 +1577,23 @@ vector4D<T>& operator--(vector4D<T>& a) {
 // Matrix multiplications
 // With vector
 template<typename T>
-vector2D<T> operator*(matrix2x2<T> mat, vector2D<T> vec) {
+constexpr vector2D<T> operator*(matrix2x2<T> mat, vector2D<T> vec) noexcept {
+	return {
+		dot(mat.x, vec),
+		dot(mat.y, vec),
+	};
+}
+template<typename T>
+constexpr vector3D<T> operator*(matrix3x3<T> mat, vector3D<T> vec) noexcept {
 	return {
 		dot(mat.x, vec),
 		dot(mat.y, vec),
+		dot(mat.z, vec),
 	};
 }
+// The implied last row gives w = vec.w, so only x, y and z are returned
 template<typename T>
-vector3D<T> operator*(matrix3x3<T> mat, vector3D<T> vec) {
+constexpr vector3D<T> operator*(matrix3x4<T> mat, vector4D<T> vec) noexcept {
 	return {
 		dot(mat.x, vec),
 		dot(mat.y, vec),
@@ -711,7 +1601,7 @@ vector3D<T> operator*(matrix3x3<T> mat, vector3D<T> vec) {
 	};
 }
 template<typename T>
-vector4D<T> operator*(matrix4x4<T> mat, vector4D<T> vec) {
+constexpr vector4D<T> operator*(matrix4x4<T> mat, vector4D<T> vec) noexcept {
 	return {
 		dot(mat.x, vec),
 		dot(mat.y, vec),
@@ -721,22 +1611,31 @@ vector4D<T> operator*(matrix4x4<T> mat, vector4D<T> vec) {
 }
 // With matrix
 template<typename T>
-matrix2x2<T> operator*(matrix2x2<T> a, matrix2x2<T> b) {
+constexpr matrix2x2<T> operator*(matrix2x2<T> a, matrix2x2<T> b) noexcept {
 	return {
 		{ dot(a.x, { b.x.x, b.y.x }), dot(a.x, { b.x.y, b.y.y }) },
 		{ dot(a.y, { b.x.x, b.y.x }), dot(a.y, { b.x.y, b.y.y }) },
 	};
 }
 template<typename T>
-matrix3x3<T> operator*(matrix3x3<T> a, matrix3x3<T> b) {
+constexpr matrix3x3<T> operator*(matrix3x3<T> a, matrix3x3<T> b) noexcept {
 	return {
 		{ dot(a.x, { b.x.x, b.y.x, b.z.x }), dot(a.x, { b.x.y, b.y.y, b.z.y }), dot(a.x, { b.x.z, b.y.z, b.z.z }) },
 		{ dot(a.y, { b.x.x, b.y.x, b.z.x }), dot(a.y, { b.x.y, b.y.y, b.z.y }), dot(a.y, { b.x.z, b.y.z, b.z.z }) },
 		{ dot(a.z, { b.x.x, b.y.x, b.z.x }), dot(a.z, { b.x.y, b.y.y, b.z.y }), dot(a.z, { b.x.z, b.y.z, b.z.z }) },
 	};
 }
+// Affine composition, the implied last rows are multiplied too
+template<typename T>
+constexpr matrix3x4<T> operator*(matrix3x4<T> a, matrix3x4<T> b) noexcept {
+	return {
+		{ dot(a.x, { b.x.x, b.y.x, b.z.x, 0 }), dot(a.x, { b.x.y, b.y.y, b.z.y, 0 }), dot(a.x, { b.x.z, b.y.z, b.z.z, 0 }), dot(a.x, { b.x.w, b.y.w, b.z.w, 1 }) },
+		{ dot(a.y, { b.x.x, b.y.x, b.z.x, 0 }), dot(a.y, { b.x.y, b.y.y, b.z.y, 0 }), dot(a.y, { b.x.z, b.y.z, b.z.z, 0 }), dot(a.y, { b.x.w, b.y.w, b.z.w, 1 }) },
+		{ dot(a.z, { b.x.x, b.y.x, b.z.x, 0 }), dot(a.z, { b.x.y, b.y.y, b.z.y, 0 }), dot(a.z, { b.x.z, b.y.z, b.z.z, 0 }), dot(a.z, { b.x.w, b.y.w, b.z.w, 1 }) },
+	};
+}
 template<typename T>
-matrix4x4<T> operator*(matrix4x4<T> a, matrix4x4<T> b) {
+constexpr matrix4x4<T> operator*(matrix4x4<T> a, matrix4x4<T> b) noexcept {
 	return {
 		{ dot(a.x, { b.x.x, b.y.x, b.z.x, b.w.x }), dot(a.x, { b.x.y, b.y.y, b.z.y, b.w.y }), dot(a.x, { b.x.z, b.y.z, b.z.z, b.w.z }), dot(a.x, { b.x.w, b.y.w, b.z.w, b.w.w }) },
 		{ dot(a.y, { b.x.x, b.y.x, b.z.x, b.w.x }), dot(a.y, { b.x.y, b.y.y, b.z.y, b.w.y }), dot(a.y, { b.x.z, b.y.z, b.z.z, b.w.z }), dot(a.y, { b.x.w, b.y.w, b.z.w, b.w.w }) },
@@ -745,6 +1644,45 @@ matrix4x4<T> operator*(matrix4x4<T> a, matrix4x4<T> b) {
 	};
 }
 
+// Quaternion operations
+template<typename T>
+constexpr quaternionT<T> operator+(quaternionT<T> a, quaternionT<T> b) noexcept {
+	return { a.w + b.w, a.x + b.x, a.y + b.y, a.z + b.z };
+}
+template<typename T>
+constexpr quaternionT<T> operator-(quaternionT<T> a, quaternionT<T> b) noexcept {
+	return { a.w - b.w, a.x - b.x, a.y - b.y, a.z - b.z };
+}
+template<typename T>
+constexpr quaternionT<T> operator*(quaternionT<T> a, T s) noexcept {
+	return { a.w * s, a.x * s, a.y * s, a.z * s };
+}
+template<typename T>
+constexpr quaternionT<T> operator-(quaternionT<T> a) noexcept {
+	return { -a.w, -a.x, -a.y, -a.z };
+}
+// Composition, a * b rotates by b and then by a
+template<typename T>
+constexpr quaternionT<T> operator*(quaternionT<T> a, quaternionT<T> b) noexcept {
+	return {
+		a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z,
+		a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+		a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+		a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+	};
+}
+// Rotate vector, q must be normalized
+template<typename T>
+constexpr vector3D<T> operator*(quaternionT<T> q, vector3D<T> vec) noexcept {
+	vector3D<T> u{ q.x, q.y, q.z };
+	vector3D<T> t = cross(u, vec) * static_cast<T>(2);
+	return vec + t * q.w + cross(u, t);
+}
+template<typename T>
+constexpr quaternionT<T>& operator*=(quaternionT<T>& a, quaternionT<T> b) noexcept {
+	return a = a * b;
+}
+
 
 #ifndef LM2_NO_OUTPUT_FUNCTIONS
 
@@ -774,10 +1712,24 @@ std::ostream& operator<<(std::ostream& os, matrix3x3<T> mat) {
 	return os << "X - " << mat.x << "\nY - " << mat.y << "\nZ - " << mat.z;
 }
 
+template<typename T>
+std::ostream& operator<<(std::ostream& os, matrix3x4<T> mat) {
+	return os << "X - " << mat.x << "\nY - " << mat.y << "\nZ - " << mat.z;
+}
+
 template<typename T>
 std::ostream& operator<<(std::ostream& os, matrix4x4<T> mat) {
 	return os << "X - " << mat.x << "\nY - " << mat.y << "\nZ - " << mat.z << "\nW - " << mat.w;
 }
 
+template<typename T>
+std::ostream& operator<<(std::ostream& os, quaternionT<T> q) {
+	return os << "W: " << q.w << " X: " << q.x << " Y: " << q.y << " Z: " << q.z;
+}
+
 #endif // #ifndef LM2_NO_OUTPUT_FUNCTIONS
 } // namespace lm2
+
+#ifdef LM2_SIMD
+#include "lm2_simd.hpp"
+#endif
@@ -0,0 +1,443 @@
+/*
+* Bounding volumes and frustum culling for lm2
+*
+* Scalar bounding types and tests, plus batch culling kernels over lm2::soa streams.
+* Batch kernels write a visibility bitmask: bit (i % 8) of byte (i / 8) is set when object i
+* may be visible, so one block of blockSize objects fills one byte.
+* Culling is conservative, objects just outside a frustum corner can be reported as visible.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_soa.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace lm2 {
+
+// Axis aligned bounding box
+template<typename T>
+struct aabbT {
+	vector3D<T> min;
+	vector3D<T> max;
+};
+
+// Bounding sphere
+template<typename T>
+struct sphereT {
+	vector3D<T> center;
+	T radius;
+};
+
+// Points with dot(normal, point) + distance >= 0 are on the inner side
+template<typename T>
+struct planeT {
+	vector3D<T> normal;
+	T distance;
+};
+
+// Planes in order left, right, bottom, top, near, far, all normals point inside
+template<typename T>
+struct frustumT {
+	planeT<T> planes[6];
+};
+
+using aabb = aabbT<float>;
+using sphere = sphereT<float>;
+using plane = planeT<float>;
+using frustum = frustumT<float>;
+
+// AABB
+template<typename T>
+constexpr vector3D<T> center(aabbT<T> box) noexcept {
+	return (box.min + box.max) * static_cast<T>(0.5);
+}
+// Half size on every axis
+template<typename T>
+constexpr vector3D<T> extents(aabbT<T> box) noexcept {
+	return (box.max - box.min) * static_cast<T>(0.5);
+}
+template<typename T>
+constexpr aabbT<T> merge(aabbT<T> a, aabbT<T> b) noexcept {
+	return {
+		{ a.min.x < b.min.x ? a.min.x : b.min.x, a.min.y < b.min.y ? a.min.y : b.min.y, a.min.z < b.min.z ? a.min.z : b.min.z },
+		{ a.max.x > b.max.x ? a.max.x : b.max.x, a.max.y > b.max.y ? a.max.y : b.max.y, a.max.z > b.max.z ? a.max.z : b.max.z },
+	};
+}
+template<typename T>
+constexpr aabbT<T> merge(aabbT<T> box, vector3D<T> point) noexcept {
+	return merge(box, aabbT<T>{ point, point });
+}
+// Bounds of count points, stride is the distance in bytes between two points like in lm2::soa::fromAoS
+template<typename T>
+aabbT<T> computeAABB(const vector3D<T>* points, size_t count, size_t stride = sizeof(vector3D<T>)) noexcept {
+	if (count == 0) {
+		return {};
+	}
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(points);
+	aabbT<T> box{ points[0], points[0] };
+	for (size_t i = 1; i < count; i++) {
+		box = merge(box, *reinterpret_cast<const vector3D<T>*>(bytes + i * stride));
+	}
+	return box;
+}
+
+// Box enclosing the transformed box, J. Arvo, "Transforming Axis-Aligned Bounding Boxes" (1990)
+// in center / extent form
+template<typename T>
+constexpr aabbT<T> transformAABB(const matrix4x4<T>& m, aabbT<T> box) noexcept {
+	vector3D<T> c = center(box);
+	vector3D<T> e = extents(box);
+	vector3D<T> worldCenter{
+		m.x.x * c.x + m.x.y * c.y + m.x.z * c.z + m.x.w,
+		m.y.x * c.x + m.y.y * c.y + m.y.z * c.z + m.y.w,
+		m.z.x * c.x + m.z.y * c.y + m.z.z * c.z + m.z.w,
+	};
+	vector3D<T> worldExtents{
+		abs(m.x.x) * e.x + abs(m.x.y) * e.y + abs(m.x.z) * e.z,
+		abs(m.y.x) * e.x + abs(m.y.y) * e.y + abs(m.y.z) * e.z,
+		abs(m.z.x) * e.x + abs(m.z.y) * e.y + abs(m.z.z) * e.z,
+	};
+	return { worldCenter - worldExtents, worldCenter + worldExtents };
+}
+
+// Plane
+template<typename T>
+constexpr planeT<T> normalize(planeT<T> p) noexcept {
+	T length = magnitude(p.normal);
+	if (length == 0) {
+		return p;
+	}
+	return { p.normal / length, p.distance / length };
+}
+template<typename T>
+constexpr T signedDistance(planeT<T> p, vector3D<T> point) noexcept {
+	return dot(p.normal, point) + p.distance;
+}
+
+// Frustum planes of a projection * view matrix, G. Gribb and K. Hartmann (2001)
+// Expects clip space z in [-w, w] like lm2::perspective and lm2::ortho
+template<typename T>
+constexpr frustumT<T> matrix2frustum(const matrix4x4<T>& viewProjection) noexcept {
+	const matrix4x4<T>& m = viewProjection;
+	auto toPlane = [](vector4D<T> v) {
+		return normalize(planeT<T>{ { v.x, v.y, v.z }, v.w });
+	};
+	return { {
+		toPlane(m.w + m.x),
+		toPlane(m.w - m.x),
+		toPlane(m.w + m.y),
+		toPlane(m.w - m.y),
+		toPlane(m.w + m.z),
+		toPlane(m.w - m.z),
+	} };
+}
+
+// Frustum tests, true when the volume may be visible
+// Boxes are tested with the corner furthest along each plane normal
+template<typename T>
+constexpr bool intersects(const frustumT<T>& f, aabbT<T> box) noexcept {
+	for (const planeT<T>& p : f.planes) {
+		vector3D<T> corner{
+			p.normal.x >= 0 ? box.max.x : box.min.x,
+			p.normal.y >= 0 ? box.max.y : box.min.y,
+			p.normal.z >= 0 ? box.max.z : box.min.z,
+		};
+		if (signedDistance(p, corner) < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+template<typename T>
+constexpr bool intersects(const frustumT<T>& f, sphereT<T> s) noexcept {
+	for (const planeT<T>& p : f.planes) {
+		if (signedDistance(p, s.center) < -s.radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+namespace soa {
+
+// Blocks and streams of bounding volumes
+template<typename T>
+struct alignas(32) aabbBlock {
+	T minX[blockSize];
+	T minY[blockSize];
+	T minZ[blockSize];
+	T maxX[blockSize];
+	T maxY[blockSize];
+	T maxZ[blockSize];
+};
+
+template<typename T>
+struct alignas(32) sphereBlock {
+	T x[blockSize];
+	T y[blockSize];
+	T z[blockSize];
+	T radius[blockSize];
+};
+
+template<typename T>
+struct aabbStream : stream<aabbBlock<T>> {
+	aabbT<T> get(size_t i) const {
+		const aabbBlock<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		return { { b.minX[l], b.minY[l], b.minZ[l] }, { b.maxX[l], b.maxY[l], b.maxZ[l] } };
+	}
+	void set(size_t i, aabbT<T> box) {
+		aabbBlock<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		b.minX[l] = box.min.x;
+		b.minY[l] = box.min.y;
+		b.minZ[l] = box.min.z;
+		b.maxX[l] = box.max.x;
+		b.maxY[l] = box.max.y;
+		b.maxZ[l] = box.max.z;
+	}
+};
+
+template<typename T>
+struct sphereStream : stream<sphereBlock<T>> {
+	sphereT<T> get(size_t i) const {
+		const sphereBlock<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		return { { b.x[l], b.y[l], b.z[l] }, b.radius[l] };
+	}
+	void set(size_t i, sphereT<T> s) {
+		sphereBlock<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		b.x[l] = s.center.x;
+		b.y[l] = s.center.y;
+		b.z[l] = s.center.z;
+		b.radius[l] = s.radius;
+	}
+};
+
+using aabbStreamF = aabbStream<float>;
+using sphereStreamF = sphereStream<float>;
+
+template<typename T>
+void fromAoS(const aabbT<T>* src, size_t count, aabbStream<T>& out, size_t stride = sizeof(aabbT<T>)) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(src);
+	out.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		out.set(i, *reinterpret_cast<const aabbT<T>*>(bytes + i * stride));
+	}
+}
+template<typename T>
+void fromAoS(const sphereT<T>* src, size_t count, sphereStream<T>& out, size_t stride = sizeof(sphereT<T>)) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(src);
+	out.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		out.set(i, *reinterpret_cast<const sphereT<T>*>(bytes + i * stride));
+	}
+}
+
+// Visibility masks
+constexpr size_t maskBytes(size_t count) noexcept {
+	return (count + 7) / 8;
+}
+constexpr bool maskBit(const uint8_t* mask, size_t i) noexcept {
+	return (mask[i / 8] >> (i % 8)) & 1;
+}
+
+namespace detail {
+static_assert(blockSize == 8, "Culling kernels write one mask byte per block");
+
+// Bits of the lanes of block b that hold objects
+constexpr int laneBits(size_t count, size_t b) noexcept {
+	size_t lanes = count - b * blockSize < blockSize ? count - b * blockSize : blockSize;
+	return static_cast<int>((1u << lanes) - 1);
+}
+
+// Frustum planes broadcast to every lane
+struct planeLanes {
+	simd::float8 x, y, z, w;
+	simd::float8 absX, absY, absZ;
+	bool positiveX, positiveY, positiveZ;
+};
+inline void broadcastPlanes(const frustumT<float>& f, planeLanes (&out)[6]) {
+	for (int i = 0; i < 6; i++) {
+		const planeT<float>& p = f.planes[i];
+		out[i].x = simd::set1x8(p.normal.x);
+		out[i].y = simd::set1x8(p.normal.y);
+		out[i].z = simd::set1x8(p.normal.z);
+		out[i].w = simd::set1x8(p.distance);
+		out[i].absX = simd::abs(out[i].x);
+		out[i].absY = simd::abs(out[i].y);
+		out[i].absZ = simd::abs(out[i].z);
+		out[i].positiveX = p.normal.x >= 0;
+		out[i].positiveY = p.normal.y >= 0;
+		out[i].positiveZ = p.normal.z >= 0;
+	}
+}
+
+// Visible lanes of boxes in center / extent form
+inline int cullCenterExtent(const planeLanes (&planes)[6], simd::float8 cx, simd::float8 cy, simd::float8 cz,
+                            simd::float8 ex, simd::float8 ey, simd::float8 ez) {
+	simd::float8 outside = simd::zero8();
+	for (const planeLanes& p : planes) {
+		simd::float8 d = simd::add(simd::add(simd::add(simd::mul(p.x, cx), simd::mul(p.y, cy)), simd::mul(p.z, cz)), p.w);
+		simd::float8 r = simd::add(simd::add(simd::mul(p.absX, ex), simd::mul(p.absY, ey)), simd::mul(p.absZ, ez));
+		outside = simd::bitOr(outside, simd::cmpLess(simd::add(d, r), simd::zero8()));
+	}
+	return ~simd::moveMask(outside) & 0xFF;
+}
+
+// Boxes of every model matrix lane, transformed to center / extent form as in lm2::transformAABB
+inline int cullTransformed(const planeLanes (&planes)[6], const float (&m)[16][blockSize],
+                           simd::float8 cx, simd::float8 cy, simd::float8 cz, simd::float8 ex, simd::float8 ey, simd::float8 ez) {
+	simd::float8 world[6];
+	for (int row = 0; row < 3; row++) {
+		simd::float8 m0 = simd::load8(m[row * 4 + 0]);
+		simd::float8 m1 = simd::load8(m[row * 4 + 1]);
+		simd::float8 m2 = simd::load8(m[row * 4 + 2]);
+		simd::float8 m3 = simd::load8(m[row * 4 + 3]);
+		world[row] = simd::add(simd::add(simd::add(simd::mul(m0, cx), simd::mul(m1, cy)), simd::mul(m2, cz)), m3);
+		world[row + 3] = simd::add(simd::add(simd::mul(simd::abs(m0), ex), simd::mul(simd::abs(m1), ey)), simd::mul(simd::abs(m2), ez));
+	}
+	return cullCenterExtent(planes, world[0], world[1], world[2], world[3], world[4], world[5]);
+}
+} // namespace detail
+
+// Frustum culling, returns the number of visible objects
+// outVisible must hold maskBytes(count) bytes, bits past count are cleared
+template<typename T>
+size_t cull(const frustumT<T>& f, const aabbStream<T>& boxes, uint8_t* outVisible) {
+	size_t visible = 0;
+	if constexpr (std::is_same_v<T, float>) {
+		detail::planeLanes planes[6];
+		detail::broadcastPlanes(f, planes);
+		for (size_t b = 0; b < boxes.blockCount(); b++) {
+			const aabbBlock<float>& box = boxes.blocks[b];
+			simd::float8 outside = simd::zero8();
+			for (const detail::planeLanes& p : planes) {
+				// Corner furthest along the plane normal, same as lm2::intersects
+				simd::float8 d = simd::mul(p.x, simd::load8(p.positiveX ? box.maxX : box.minX));
+				d = simd::add(d, simd::mul(p.y, simd::load8(p.positiveY ? box.maxY : box.minY)));
+				d = simd::add(d, simd::mul(p.z, simd::load8(p.positiveZ ? box.maxZ : box.minZ)));
+				outside = simd::bitOr(outside, simd::cmpLess(simd::add(d, p.w), simd::zero8()));
+			}
+			int bits = ~simd::moveMask(outside) & detail::laneBits(boxes.size(), b);
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	else {
+		for (size_t b = 0; b < boxes.blockCount(); b++) {
+			int bits = 0;
+			for (size_t l = 0; l < blockSize && b * blockSize + l < boxes.size(); l++) {
+				bits |= intersects(f, boxes.get(b * blockSize + l)) << l;
+			}
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	return visible;
+}
+template<typename T>
+size_t cull(const frustumT<T>& f, const sphereStream<T>& spheres, uint8_t* outVisible) {
+	size_t visible = 0;
+	if constexpr (std::is_same_v<T, float>) {
+		detail::planeLanes planes[6];
+		detail::broadcastPlanes(f, planes);
+		for (size_t b = 0; b < spheres.blockCount(); b++) {
+			const sphereBlock<float>& s = spheres.blocks[b];
+			simd::float8 x = simd::load8(s.x), y = simd::load8(s.y), z = simd::load8(s.z);
+			simd::float8 negRadius = simd::sub(simd::zero8(), simd::load8(s.radius));
+			simd::float8 outside = simd::zero8();
+			for (const detail::planeLanes& p : planes) {
+				simd::float8 d = simd::add(simd::add(simd::add(simd::mul(p.x, x), simd::mul(p.y, y)), simd::mul(p.z, z)), p.w);
+				outside = simd::bitOr(outside, simd::cmpLess(d, negRadius));
+			}
+			int bits = ~simd::moveMask(outside) & detail::laneBits(spheres.size(), b);
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	else {
+		for (size_t b = 0; b < spheres.blockCount(); b++) {
+			int bits = 0;
+			for (size_t l = 0; l < blockSize && b * blockSize + l < spheres.size(); l++) {
+				bits |= intersects(f, spheres.get(b * blockSize + l)) << l;
+			}
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	return visible;
+}
+// One local box shared by count instances, each with its own model matrix
+template<typename T>
+size_t cull(const frustumT<T>& f, aabbT<T> localBox, const matrix4x4<T>* models, size_t count, uint8_t* outVisible) {
+	size_t visible = 0;
+	if constexpr (std::is_same_v<T, float>) {
+		detail::planeLanes planes[6];
+		detail::broadcastPlanes(f, planes);
+		vector3D<float> c = center(localBox), e = extents(localBox);
+		simd::float8 cx = simd::set1x8(c.x), cy = simd::set1x8(c.y), cz = simd::set1x8(c.z);
+		simd::float8 ex = simd::set1x8(e.x), ey = simd::set1x8(e.y), ez = simd::set1x8(e.z);
+		for (size_t b = 0; b * blockSize < count; b++) {
+			alignas(32) float m[16][blockSize];
+			detail::loadMatrixLanes(models + b * blockSize, count - b * blockSize < blockSize ? count - b * blockSize : blockSize, m);
+			int bits = detail::cullTransformed(planes, m, cx, cy, cz, ex, ey, ez) & detail::laneBits(count, b);
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	else {
+		for (size_t b = 0; b * blockSize < count; b++) {
+			int bits = 0;
+			for (size_t l = 0; l < blockSize && b * blockSize + l < count; l++) {
+				bits |= intersects(f, transformAABB(models[b * blockSize + l], localBox)) << l;
+			}
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	return visible;
+}
+// Local box i transformed by models[i]
+template<typename T>
+size_t cull(const frustumT<T>& f, const aabbStream<T>& localBoxes, const matrix4x4<T>* models, uint8_t* outVisible) {
+	size_t visible = 0;
+	size_t count = localBoxes.size();
+	if constexpr (std::is_same_v<T, float>) {
+		detail::planeLanes planes[6];
+		detail::broadcastPlanes(f, planes);
+		simd::float8 half = simd::set1x8(0.5f);
+		for (size_t b = 0; b < localBoxes.blockCount(); b++) {
+			const aabbBlock<float>& box = localBoxes.blocks[b];
+			simd::float8 minX = simd::load8(box.minX), minY = simd::load8(box.minY), minZ = simd::load8(box.minZ);
+			simd::float8 maxX = simd::load8(box.maxX), maxY = simd::load8(box.maxY), maxZ = simd::load8(box.maxZ);
+			alignas(32) float m[16][blockSize];
+			detail::loadMatrixLanes(models + b * blockSize, count - b * blockSize < blockSize ? count - b * blockSize : blockSize, m);
+			int bits = detail::cullTransformed(planes, m,
+				simd::mul(simd::add(minX, maxX), half), simd::mul(simd::add(minY, maxY), half), simd::mul(simd::add(minZ, maxZ), half),
+				simd::mul(simd::sub(maxX, minX), half), simd::mul(simd::sub(maxY, minY), half), simd::mul(simd::sub(maxZ, minZ), half));
+			bits &= detail::laneBits(count, b);
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	else {
+		for (size_t b = 0; b < localBoxes.blockCount(); b++) {
+			int bits = 0;
+			for (size_t l = 0; l < blockSize && b * blockSize + l < count; l++) {
+				bits |= intersects(f, transformAABB(models[b * blockSize + l], localBoxes.get(b * blockSize + l))) << l;
+			}
+			outVisible[b] = static_cast<uint8_t>(bits);
+			visible += std::popcount(static_cast<unsigned>(bits));
+		}
+	}
+	return visible;
+}
+
+} // namespace soa
+} // namespace lm2
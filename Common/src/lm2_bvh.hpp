@@ -0,0 +1,959 @@
+/*
+* Bounding volume hierarchy over triangle meshes for lm2
+*
+* buildBVH builds a binary BVH with binned SAH, 16 bins over the centroid bounds of every axis.
+* Given a threadPool the top of the tree is split on the calling thread and the subtrees below
+* it are built in parallel, the tree is the same as the single threaded one.
+* buildLBVH sorts triangles along a Morton curve (lm2_morton.hpp) and splits at the highest
+* differing bit of the codes instead, a build in a few linear passes for meshes that change every
+* frame, at the cost of a slower tree to trace.
+*
+* Nodes are 32 bytes in depth first order, the first child directly follows its parent.
+* Leaves hold up to 8 triangles in one triangleBlock (first vertex and two edges in lanes), so a
+* leaf is one 8 wide Moller-Trumbore test. Packet queries run 8 rays together against every node
+* and triangle, they pay off for coherent rays like a picking grid or checks from one eye point.
+*
+* Hits need tMin < t < tMax, back faces are hit too. Triangles are copied into the tree, the
+* mesh can be freed after the build.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_bounds.hpp"
+#include "lm2_morton.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_simd.hpp"
+#include "lm2_soa.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace lm2 {
+
+// Rays
+template<typename T>
+struct rayT {
+	vector3D<T> origin;
+	vector3D<T> direction;
+	T tMin = 0;
+	T tMax = std::numeric_limits<T>::max();
+};
+
+using ray = rayT<float>;
+
+// Triangle index of a ray that hit nothing
+constexpr uint32_t noHit = 0xFFFFFFFFu;
+
+// u and v are the barycentric weights of the second and third vertex
+struct rayHit {
+	float t = std::numeric_limits<float>::max();
+	float u = 0;
+	float v = 0;
+	uint32_t triangle = noHit;
+};
+
+// Slab test, outNear is the distance where the ray enters the box
+template<typename T>
+constexpr bool intersect(const rayT<T>& r, aabbT<T> box, T& outNear) noexcept {
+	const T origin[3] = { r.origin.x, r.origin.y, r.origin.z };
+	const T direction[3] = { r.direction.x, r.direction.y, r.direction.z };
+	const T min[3] = { box.min.x, box.min.y, box.min.z };
+	const T max[3] = { box.max.x, box.max.y, box.max.z };
+	T tNear = r.tMin;
+	T tFar = r.tMax;
+	for (int axis = 0; axis < 3; axis++) {
+		if (direction[axis] == 0) {
+			if (origin[axis] < min[axis] || origin[axis] > max[axis]) {
+				return false;
+			}
+			continue;
+		}
+		T inverse = static_cast<T>(1) / direction[axis];
+		T t0 = (min[axis] - origin[axis]) * inverse;
+		T t1 = (max[axis] - origin[axis]) * inverse;
+		if (t0 > t1) {
+			std::swap(t0, t1);
+		}
+		tNear = t0 > tNear ? t0 : tNear;
+		tFar = t1 < tFar ? t1 : tFar;
+		if (tNear > tFar) {
+			return false;
+		}
+	}
+	outNear = tNear;
+	return true;
+}
+
+// Moller-Trumbore
+template<typename T>
+constexpr bool intersect(const rayT<T>& r, vector3D<T> a, vector3D<T> b, vector3D<T> c, T& outT, T& outU, T& outV) noexcept {
+	vector3D<T> e1 = b - a;
+	vector3D<T> e2 = c - a;
+	vector3D<T> p = cross(r.direction, e2);
+	T det = dot(e1, p);
+	if (det == 0) {
+		return false;
+	}
+	T inverse = static_cast<T>(1) / det;
+	vector3D<T> s = r.origin - a;
+	T u = dot(s, p) * inverse;
+	vector3D<T> q = cross(s, e1);
+	T v = dot(r.direction, q) * inverse;
+	T t = dot(e2, q) * inverse;
+	if (u < 0 || v < 0 || u + v > 1 || !(t > r.tMin && t < r.tMax)) {
+		return false;
+	}
+	outT = t;
+	outU = u;
+	outV = v;
+	return true;
+}
+
+// Tree
+// Inner nodes: count is 0, the first child follows the node and offset is the second child
+// Leaves: count triangles in blocks[offset]
+struct bvhNode {
+	vector3D<float> min;
+	uint32_t offset;
+	vector3D<float> max;
+	uint32_t count;
+};
+static_assert(sizeof(bvhNode) == 32, "two nodes per cache line");
+
+// Up to 8 triangles in lanes, unused lanes have zero edges and are never hit
+struct alignas(32) triangleBlock {
+	float ax[soa::blockSize], ay[soa::blockSize], az[soa::blockSize];
+	float e1x[soa::blockSize], e1y[soa::blockSize], e1z[soa::blockSize];
+	float e2x[soa::blockSize], e2y[soa::blockSize], e2z[soa::blockSize];
+	uint32_t triangle[soa::blockSize];
+
+	// Left uninitialized, the builders write every lane
+	triangleBlock() noexcept {}
+};
+
+struct bvh {
+	std::vector<bvhNode> nodes;
+	std::vector<triangleBlock> blocks;
+	size_t triangleCount = 0;
+};
+
+namespace detail {
+constexpr uint32_t bvhBinCount = 16;
+constexpr uint32_t bvhLeafSize = soa::blockSize;
+// Traversal stack size, SAH splits stop at bvhSahDepth and median splits take over,
+// which keeps the depth below 64 + 32 for any triangle count that fits in uint32_t
+constexpr int bvhStackSize = 128;
+constexpr uint32_t bvhSahDepth = 64;
+// SAH costs, relative to one 8 wide leaf test
+constexpr float bvhTraversalCost = 0.5f;
+
+constexpr float surfaceArea(aabbT<float> box) noexcept {
+	vector3D<float> d = box.max - box.min;
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+constexpr aabbT<float> emptyAABB() noexcept {
+	constexpr float big = std::numeric_limits<float>::max();
+	return { { big, big, big }, { -big, -big, -big } };
+}
+constexpr float component(vector3D<float> v, int axis) noexcept {
+	return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+constexpr float leafCost(uint32_t count) noexcept {
+	return static_cast<float>((count + bvhLeafSize - 1) / bvhLeafSize);
+}
+
+struct bvhBuildNode {
+	aabbT<float> bounds;
+	uint32_t begin = 0;
+	uint32_t count = 0;
+	// Children in the same build tree, -1 for leaves
+	int32_t left = -1;
+	int32_t right = -1;
+	// Top of the tree only, index of a subtree built separately
+	int32_t subtree = -1;
+};
+
+struct bvhRange {
+	uint32_t begin;
+	uint32_t count;
+	uint32_t depth;
+};
+
+class bvhBuilder {
+public:
+	bvhBuilder(const std::vector<aabbT<float>>& bounds, const std::vector<vector3D<float>>& centroids, std::vector<uint32_t>& order)
+		: mBounds(bounds), mCentroids(centroids), mOrder(order) {}
+
+	// Splits [begin, begin + count) of the order, false when it should be a leaf
+	bool split(uint32_t begin, uint32_t count, uint32_t depth, aabbT<float>& outBounds, uint32_t& outLeftCount) {
+		aabbT<float> centroidBounds = emptyAABB();
+		outBounds = emptyAABB();
+		for (uint32_t i = begin; i < begin + count; i++) {
+			outBounds = merge(outBounds, mBounds[mOrder[i]]);
+			centroidBounds = merge(centroidBounds, mCentroids[mOrder[i]]);
+		}
+		if (count == 1) {
+			return false;
+		}
+
+		int bestAxis = -1;
+		uint32_t bestSplit = 0;
+		float bestCost = std::numeric_limits<float>::max();
+		if (depth < bvhSahDepth) {
+			for (int axis = 0; axis < 3; axis++) {
+				float low = component(centroidBounds.min, axis);
+				float extent = component(centroidBounds.max, axis) - low;
+				if (!(extent > 0)) {
+					continue;
+				}
+				float scale = bvhBinCount / extent;
+				aabbT<float> bins[bvhBinCount];
+				uint32_t counts[bvhBinCount] = {};
+				for (aabbT<float>& bin : bins) {
+					bin = emptyAABB();
+				}
+				for (uint32_t i = begin; i < begin + count; i++) {
+					uint32_t bin = binOf(component(mCentroids[mOrder[i]], axis), low, scale);
+					bins[bin] = merge(bins[bin], mBounds[mOrder[i]]);
+					counts[bin]++;
+				}
+
+				// Cost of splitting after bin k, left side swept forwards and right side backwards
+				float rightArea[bvhBinCount];
+				uint32_t rightCount[bvhBinCount];
+				aabbT<float> sweep = emptyAABB();
+				uint32_t sweepCount = 0;
+				for (uint32_t k = bvhBinCount - 1; k > 0; k--) {
+					sweep = merge(sweep, bins[k]);
+					sweepCount += counts[k];
+					rightArea[k] = surfaceArea(sweep);
+					rightCount[k] = sweepCount;
+				}
+				sweep = emptyAABB();
+				sweepCount = 0;
+				for (uint32_t k = 1; k < bvhBinCount; k++) {
+					sweep = merge(sweep, bins[k - 1]);
+					sweepCount += counts[k - 1];
+					if (sweepCount == 0 || rightCount[k] == 0) {
+						continue;
+					}
+					float cost = surfaceArea(sweep) * leafCost(sweepCount) + rightArea[k] * leafCost(rightCount[k]);
+					if (cost < bestCost) {
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = k;
+					}
+				}
+			}
+		}
+
+		if (bestAxis < 0) {
+			// Every centroid in one spot, or too deep for SAH: split in the middle of the order
+			if (count <= bvhLeafSize) {
+				return false;
+			}
+			int axis = 0;
+			vector3D<float> extent = centroidBounds.max - centroidBounds.min;
+			axis = extent.y > extent.x ? 1 : 0;
+			axis = extent.z > component(extent, axis) ? 2 : axis;
+			outLeftCount = count / 2;
+			std::nth_element(mOrder.begin() + begin, mOrder.begin() + begin + outLeftCount, mOrder.begin() + begin + count,
+				[&](uint32_t a, uint32_t b) { return component(mCentroids[a], axis) < component(mCentroids[b], axis); });
+			return true;
+		}
+
+		float area = surfaceArea(outBounds);
+		bestCost = bvhTraversalCost + (area > 0 ? bestCost / area : 0.0f);
+		if (count <= bvhLeafSize && bestCost >= leafCost(count)) {
+			return false;
+		}
+
+		float low = component(centroidBounds.min, bestAxis);
+		float scale = bvhBinCount / (component(centroidBounds.max, bestAxis) - low);
+		auto middle = std::partition(mOrder.begin() + begin, mOrder.begin() + begin + count, [&](uint32_t i) {
+			return binOf(component(mCentroids[i], bestAxis), low, scale) < bestSplit;
+		});
+		outLeftCount = static_cast<uint32_t>(middle - (mOrder.begin() + begin));
+		return true;
+	}
+
+	// Builds the subtree of a range into nodes, its root is the first node added
+	int32_t build(std::vector<bvhBuildNode>& nodes, uint32_t begin, uint32_t count, uint32_t depth) {
+		int32_t index = static_cast<int32_t>(nodes.size());
+		nodes.emplace_back();
+		aabbT<float> bounds;
+		uint32_t leftCount = 0;
+		bool inner = split(begin, count, depth, bounds, leftCount);
+		nodes[index].bounds = bounds;
+		nodes[index].begin = begin;
+		nodes[index].count = count;
+		if (inner) {
+			int32_t left = build(nodes, begin, leftCount, depth + 1);
+			int32_t right = build(nodes, begin + leftCount, count - leftCount, depth + 1);
+			nodes[index].left = left;
+			nodes[index].right = right;
+		}
+		return index;
+	}
+
+	// Like build, but ranges up to subtreeSize become subtrees to be built later
+	int32_t buildTop(std::vector<bvhBuildNode>& nodes, std::vector<bvhRange>& subtrees, uint32_t begin, uint32_t count, uint32_t depth, uint32_t subtreeSize) {
+		int32_t index = static_cast<int32_t>(nodes.size());
+		nodes.emplace_back();
+		if (count <= subtreeSize) {
+			nodes[index].subtree = static_cast<int32_t>(subtrees.size());
+			subtrees.push_back({ begin, count, depth });
+			return index;
+		}
+		aabbT<float> bounds;
+		uint32_t leftCount = 0;
+		bool inner = split(begin, count, depth, bounds, leftCount);
+		nodes[index].bounds = bounds;
+		nodes[index].begin = begin;
+		nodes[index].count = count;
+		if (inner) {
+			int32_t left = buildTop(nodes, subtrees, begin, leftCount, depth + 1, subtreeSize);
+			int32_t right = buildTop(nodes, subtrees, begin + leftCount, count - leftCount, depth + 1, subtreeSize);
+			nodes[index].left = left;
+			nodes[index].right = right;
+		}
+		return index;
+	}
+
+private:
+	static uint32_t binOf(float value, float low, float scale) noexcept {
+		float bin = (value - low) * scale;
+		return bin >= bvhBinCount - 1 ? bvhBinCount - 1 : (bin > 0 ? static_cast<uint32_t>(bin) : 0);
+	}
+
+	const std::vector<aabbT<float>>& mBounds;
+	const std::vector<vector3D<float>>& mCentroids;
+	std::vector<uint32_t>& mOrder;
+};
+
+// Splits sorted Morton codes at their highest differing bit, bounds are merged bottom up
+class lbvhBuilder {
+public:
+	lbvhBuilder(const std::vector<aabbT<float>>& bounds, const std::vector<uint32_t>& codes, const std::vector<uint32_t>& order)
+		: mBounds(bounds), mCodes(codes), mOrder(order) {}
+
+	// Size of the left half of [begin, begin + count), ranges of one code split in the middle
+	uint32_t split(uint32_t begin, uint32_t count) const noexcept {
+		uint32_t first = mCodes[begin];
+		uint32_t last = mCodes[begin + count - 1];
+		if (first == last) {
+			return count / 2;
+		}
+		uint32_t bit = 1u << (31 - std::countl_zero(first ^ last));
+		auto middle = std::partition_point(mCodes.begin() + begin, mCodes.begin() + begin + count, [&](uint32_t code) {
+			return (code & bit) == 0;
+		});
+		return static_cast<uint32_t>(middle - (mCodes.begin() + begin));
+	}
+
+	int32_t build(std::vector<bvhBuildNode>& nodes, uint32_t begin, uint32_t count) {
+		int32_t index = static_cast<int32_t>(nodes.size());
+		nodes.emplace_back();
+		nodes[index].begin = begin;
+		nodes[index].count = count;
+		if (count <= bvhLeafSize) {
+			aabbT<float> bounds = emptyAABB();
+			for (uint32_t i = begin; i < begin + count; i++) {
+				bounds = merge(bounds, mBounds[mOrder[i]]);
+			}
+			nodes[index].bounds = bounds;
+			return index;
+		}
+		uint32_t leftCount = split(begin, count);
+		int32_t left = build(nodes, begin, leftCount);
+		int32_t right = build(nodes, begin + leftCount, count - leftCount);
+		nodes[index].left = left;
+		nodes[index].right = right;
+		nodes[index].bounds = merge(nodes[left].bounds, nodes[right].bounds);
+		return index;
+	}
+
+	// Like build, but ranges up to subtreeSize become subtrees, bounds are left to refitTop
+	int32_t buildTop(std::vector<bvhBuildNode>& nodes, std::vector<bvhRange>& subtrees, uint32_t begin, uint32_t count, uint32_t subtreeSize) {
+		int32_t index = static_cast<int32_t>(nodes.size());
+		nodes.emplace_back();
+		if (count <= subtreeSize) {
+			nodes[index].subtree = static_cast<int32_t>(subtrees.size());
+			subtrees.push_back({ begin, count, 0 });
+			return index;
+		}
+		nodes[index].begin = begin;
+		nodes[index].count = count;
+		uint32_t leftCount = split(begin, count);
+		int32_t left = buildTop(nodes, subtrees, begin, leftCount, subtreeSize);
+		int32_t right = buildTop(nodes, subtrees, begin + leftCount, count - leftCount, subtreeSize);
+		nodes[index].left = left;
+		nodes[index].right = right;
+		return index;
+	}
+
+private:
+	const std::vector<aabbT<float>>& mBounds;
+	const std::vector<uint32_t>& mCodes;
+	const std::vector<uint32_t>& mOrder;
+};
+
+// Bounds of the top of the tree from the roots of its subtrees
+inline aabbT<float> refitTop(std::vector<bvhBuildNode>& top, int32_t index, const std::vector<std::vector<bvhBuildNode>>& subtrees) {
+	bvhBuildNode& node = top[index];
+	if (node.subtree >= 0) {
+		return subtrees[node.subtree][0].bounds;
+	}
+	if (node.left >= 0) {
+		aabbT<float> left = refitTop(top, node.left, subtrees);
+		aabbT<float> right = refitTop(top, node.right, subtrees);
+		top[index].bounds = merge(left, right);
+	}
+	return top[index].bounds;
+}
+
+// Triangles of the mesh gathered for the builders, corners 3i to 3i + 2 are triangle i
+struct bvhInput {
+	std::vector<vector3D<float>> corners;
+	std::vector<aabbT<float>> bounds;
+	std::vector<vector3D<float>> centroids;
+};
+
+inline void prepareBVHInput(const vector3D<float>* positions, size_t triangleCount, size_t stride, const uint32_t* indices, threadPool* pool, bvhInput& out) {
+	const char* base = reinterpret_cast<const char*>(positions);
+	out.corners.resize(triangleCount * 3);
+	out.bounds.resize(triangleCount);
+	out.centroids.resize(triangleCount);
+	auto prepare = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			for (size_t k = 0; k < 3; k++) {
+				size_t vertex = indices ? indices[i * 3 + k] : i * 3 + k;
+				out.corners[i * 3 + k] = *reinterpret_cast<const vector3D<float>*>(base + vertex * stride);
+			}
+			aabbT<float> box{ out.corners[i * 3], out.corners[i * 3] };
+			box = merge(box, out.corners[i * 3 + 1]);
+			box = merge(box, out.corners[i * 3 + 2]);
+			out.bounds[i] = box;
+			out.centroids[i] = center(box);
+		}
+	};
+	parallelFor(pool, triangleCount, parallel::minChunkSize, prepare);
+}
+
+// The top of the tree is split on the calling thread until there are a few ranges per thread
+inline uint32_t subtreeSize(const threadPool* pool, size_t triangleCount) noexcept {
+	size_t threads = pool ? pool->getThreadCount() : 1;
+	return static_cast<uint32_t>(threads > 1 ? std::max<size_t>(triangleCount / (threads * 4), 1024) : triangleCount);
+}
+
+// Calls task(i) for every i in [0, count), on the pool when there is one
+template<typename Task>
+void runTasks(threadPool* pool, size_t count, Task task) {
+	parallelFor(pool, count, 1, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			task(i);
+		}
+	});
+}
+
+inline uint32_t leafCount(const std::vector<bvhBuildNode>& tree) noexcept {
+	uint32_t count = 0;
+	for (const bvhBuildNode& node : tree) {
+		count += node.left < 0 && node.subtree < 0 ? 1 : 0;
+	}
+	return count;
+}
+
+inline void writeLeaf(const bvhBuildNode& node, const std::vector<uint32_t>& order, const std::vector<vector3D<float>>& corners, triangleBlock& block) noexcept {
+	for (uint32_t l = 0; l < soa::blockSize; l++) {
+		vector3D<float> a{}, e1{}, e2{};
+		uint32_t triangle = noHit;
+		if (l < node.count) {
+			triangle = order[node.begin + l];
+			a = corners[triangle * 3];
+			e1 = corners[triangle * 3 + 1] - a;
+			e2 = corners[triangle * 3 + 2] - a;
+		}
+		block.ax[l] = a.x;
+		block.ay[l] = a.y;
+		block.az[l] = a.z;
+		block.e1x[l] = e1.x;
+		block.e1y[l] = e1.y;
+		block.e1z[l] = e1.z;
+		block.e2x[l] = e2.x;
+		block.e2y[l] = e2.y;
+		block.e2z[l] = e2.z;
+		block.triangle[l] = triangle;
+	}
+}
+
+// Where a subtree starts in the flat arrays
+struct bvhPlace {
+	uint32_t node;
+	uint32_t block;
+};
+
+// Writes the build tree depth first starting at place, out is sized already
+// Subtree placeholders only reserve their space and record it in subtreePlaces
+inline void flattenBVH(const std::vector<bvhBuildNode>& tree, int32_t index, const std::vector<std::vector<bvhBuildNode>>& subtrees,
+	const std::vector<uint32_t>& leafCounts, const std::vector<uint32_t>& order, const std::vector<vector3D<float>>& corners,
+	bvh& out, bvhPlace& place, std::vector<bvhPlace>& subtreePlaces) {
+	const bvhBuildNode& node = tree[index];
+	if (node.subtree >= 0) {
+		subtreePlaces[node.subtree] = place;
+		place.node += static_cast<uint32_t>(subtrees[node.subtree].size());
+		place.block += leafCounts[node.subtree];
+		return;
+	}
+	uint32_t at = place.node++;
+	out.nodes[at] = { node.bounds.min, 0, node.bounds.max, 0 };
+	if (node.left < 0) {
+		out.nodes[at].offset = place.block;
+		out.nodes[at].count = node.count;
+		writeLeaf(node, order, corners, out.blocks[place.block++]);
+		return;
+	}
+	flattenBVH(tree, node.left, subtrees, leafCounts, order, corners, out, place, subtreePlaces);
+	out.nodes[at].offset = place.node;
+	flattenBVH(tree, node.right, subtrees, leafCounts, order, corners, out, place, subtreePlaces);
+}
+
+// Lays out the top of the tree, then writes every subtree into its place in parallel
+inline void finishBVH(const std::vector<bvhBuildNode>& top, const std::vector<std::vector<bvhBuildNode>>& subtrees,
+	const std::vector<uint32_t>& order, const std::vector<vector3D<float>>& corners, threadPool* pool, bvh& out) {
+	std::vector<uint32_t> leafCounts(subtrees.size());
+	runTasks(pool, subtrees.size(), [&](size_t i) {
+		leafCounts[i] = leafCount(subtrees[i]);
+	});
+	size_t nodeCount = 0;
+	size_t blockCount = leafCount(top);
+	for (size_t i = 0; i < top.size(); i++) {
+		nodeCount += top[i].subtree >= 0 ? subtrees[top[i].subtree].size() : 1;
+	}
+	for (uint32_t count : leafCounts) {
+		blockCount += count;
+	}
+	out.nodes.resize(nodeCount);
+	out.blocks.resize(blockCount);
+
+	const std::vector<std::vector<bvhBuildNode>> noSubtrees;
+	std::vector<bvhPlace> subtreePlaces(subtrees.size());
+	std::vector<bvhPlace> noPlaces;
+	bvhPlace place{ 0, 0 };
+	flattenBVH(top, 0, subtrees, leafCounts, order, corners, out, place, subtreePlaces);
+	runTasks(pool, subtrees.size(), [&](size_t i) {
+		bvhPlace subtreePlace = subtreePlaces[i];
+		flattenBVH(subtrees[i], 0, noSubtrees, leafCounts, order, corners, out, subtreePlace, noPlaces);
+	});
+}
+} // namespace detail
+
+// Builds a BVH over triangleCount triangles
+// Triangle i is positions[indices[3i]], positions[indices[3i + 1]], positions[indices[3i + 2]],
+// or positions[3i], positions[3i + 1], positions[3i + 2] without indices
+// stride is the distance between positions in bytes, so positions can point into a vertex array
+inline bvh buildBVH(const vector3D<float>* positions, size_t triangleCount, size_t stride = sizeof(vector3D<float>),
+	const uint32_t* indices = nullptr, threadPool* pool = nullptr) {
+	bvh result;
+	result.triangleCount = triangleCount;
+	if (triangleCount == 0) {
+		return result;
+	}
+	detail::bvhInput input;
+	detail::prepareBVHInput(positions, triangleCount, stride, indices, pool, input);
+	std::vector<uint32_t> order(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++) {
+		order[i] = static_cast<uint32_t>(i);
+	}
+
+	detail::bvhBuilder builder(input.bounds, input.centroids, order);
+	std::vector<detail::bvhBuildNode> top;
+	std::vector<detail::bvhRange> ranges;
+	builder.buildTop(top, ranges, 0, static_cast<uint32_t>(triangleCount), 0, detail::subtreeSize(pool, triangleCount));
+
+	std::vector<std::vector<detail::bvhBuildNode>> subtrees(ranges.size());
+	detail::runTasks(pool, ranges.size(), [&](size_t i) {
+		builder.build(subtrees[i], ranges[i].begin, ranges[i].count, ranges[i].depth);
+	});
+	detail::finishBVH(top, subtrees, order, input.corners, pool, result);
+	return result;
+}
+
+// Builds a linear BVH: triangles are sorted by the Morton code of their centroid and the tree
+// splits at the highest differing bit of the codes. Much faster to build than buildBVH, for meshes
+// that change every frame, but slower to trace. Same arguments and queries as buildBVH
+inline bvh buildLBVH(const vector3D<float>* positions, size_t triangleCount, size_t stride = sizeof(vector3D<float>),
+	const uint32_t* indices = nullptr, threadPool* pool = nullptr) {
+	bvh result;
+	result.triangleCount = triangleCount;
+	if (triangleCount == 0) {
+		return result;
+	}
+	detail::bvhInput input;
+	detail::prepareBVHInput(positions, triangleCount, stride, indices, pool, input);
+
+	size_t chunkCount = detail::chunkCount(pool, triangleCount, parallel::minChunkSize);
+	std::vector<aabbT<float>> chunkBounds(chunkCount);
+	detail::forChunks(pool, chunkCount, triangleCount, [&](size_t chunk, size_t begin, size_t end) {
+		chunkBounds[chunk] = computeAABB(input.centroids.data() + begin, end - begin);
+	});
+	aabbT<float> centroidBounds = chunkBounds[0];
+	for (const aabbT<float>& box : chunkBounds) {
+		centroidBounds = merge(centroidBounds, box);
+	}
+
+	std::vector<uint32_t> codes(triangleCount);
+	std::vector<uint32_t> order(triangleCount);
+	detail::forChunks(pool, chunkCount, triangleCount, [&](size_t, size_t begin, size_t end) {
+		morton::codes(input.centroids.data() + begin, end - begin, centroidBounds, codes.data() + begin);
+		for (size_t i = begin; i < end; i++) {
+			order[i] = static_cast<uint32_t>(i);
+		}
+	});
+	radixSort(codes.data(), order.data(), triangleCount, pool);
+
+	detail::lbvhBuilder builder(input.bounds, codes, order);
+	std::vector<detail::bvhBuildNode> top;
+	std::vector<detail::bvhRange> ranges;
+	builder.buildTop(top, ranges, 0, static_cast<uint32_t>(triangleCount), detail::subtreeSize(pool, triangleCount));
+
+	std::vector<std::vector<detail::bvhBuildNode>> subtrees(ranges.size());
+	detail::runTasks(pool, ranges.size(), [&](size_t i) {
+		subtrees[i].reserve(ranges[i].count / 2);
+		builder.build(subtrees[i], ranges[i].begin, ranges[i].count);
+	});
+	detail::refitTop(top, 0, subtrees);
+	detail::finishBVH(top, subtrees, order, input.corners, pool, result);
+	return result;
+}
+
+namespace detail {
+// Small direction components are nudged away from zero so the slab distances stay finite
+inline float safeInverse(float d) noexcept {
+	constexpr float tiny = 1e-30f;
+	return 1.0f / (d >= 0 ? (d < tiny ? tiny : d) : (d > -tiny ? -tiny : d));
+}
+
+// 8 lanes of rays, for packets every lane is a ray, for single rays every lane is the same ray
+struct rayLanes {
+	simd::float8 ox, oy, oz;
+	simd::float8 dx, dy, dz;
+	simd::float8 ix, iy, iz;
+	simd::float8 tMin;
+};
+
+// Moller-Trumbore on 8 lanes, returns the mask of lanes hit closer than tMax
+inline int intersectLanes(simd::float8 ax, simd::float8 ay, simd::float8 az,
+	simd::float8 e1x, simd::float8 e1y, simd::float8 e1z, simd::float8 e2x, simd::float8 e2y, simd::float8 e2z,
+	const rayLanes& r, simd::float8 tMax, simd::float8& outT, simd::float8& outU, simd::float8& outV) {
+	using namespace simd;
+	float8 px = sub(mul(r.dy, e2z), mul(r.dz, e2y));
+	float8 py = sub(mul(r.dz, e2x), mul(r.dx, e2z));
+	float8 pz = sub(mul(r.dx, e2y), mul(r.dy, e2x));
+	float8 det = add(add(mul(e1x, px), mul(e1y, py)), mul(e1z, pz));
+	float8 inverse = div(set1x8(1.0f), det);
+	float8 sx = sub(r.ox, ax);
+	float8 sy = sub(r.oy, ay);
+	float8 sz = sub(r.oz, az);
+	float8 u = mul(add(add(mul(sx, px), mul(sy, py)), mul(sz, pz)), inverse);
+	float8 qx = sub(mul(sy, e1z), mul(sz, e1y));
+	float8 qy = sub(mul(sz, e1x), mul(sx, e1z));
+	float8 qz = sub(mul(sx, e1y), mul(sy, e1x));
+	float8 v = mul(add(add(mul(r.dx, qx), mul(r.dy, qy)), mul(r.dz, qz)), inverse);
+	float8 t = mul(add(add(mul(e2x, qx), mul(e2y, qy)), mul(e2z, qz)), inverse);
+
+	int valid = moveMask(cmpNotEqual(det, zero8())) & moveMask(cmpLess(r.tMin, t)) & moveMask(cmpLess(t, tMax));
+	int outside = moveMask(cmpLess(u, zero8())) | moveMask(cmpLess(v, zero8())) | moveMask(cmpLess(set1x8(1.0f), add(u, v)));
+	outT = t;
+	outU = u;
+	outV = v;
+	return valid & ~outside;
+}
+
+// Slab test on 8 lanes, returns the mask of lanes entering the box before tMax
+inline int intersectLanes(const bvhNode& node, const rayLanes& r, simd::float8 tMax, simd::float8& outNear) {
+	using namespace simd;
+	float8 tx0 = mul(sub(set1x8(node.min.x), r.ox), r.ix);
+	float8 tx1 = mul(sub(set1x8(node.max.x), r.ox), r.ix);
+	float8 ty0 = mul(sub(set1x8(node.min.y), r.oy), r.iy);
+	float8 ty1 = mul(sub(set1x8(node.max.y), r.oy), r.iy);
+	float8 tz0 = mul(sub(set1x8(node.min.z), r.oz), r.iz);
+	float8 tz1 = mul(sub(set1x8(node.max.z), r.oz), r.iz);
+	float8 tNear = max(max(min(tx0, tx1), min(ty0, ty1)), max(min(tz0, tz1), r.tMin));
+	float8 tFar = min(min(max(tx0, tx1), max(ty0, ty1)), min(max(tz0, tz1), tMax));
+	outNear = tNear;
+	return ~moveMask(cmpLess(tFar, tNear)) & 0xFF;
+}
+
+// Scalar slab test with the precomputed inverse direction
+inline bool intersectNode(const bvhNode& node, vector3D<float> origin, vector3D<float> inverse, float tMin, float tMax, float& outNear) noexcept {
+	float tx0 = (node.min.x - origin.x) * inverse.x, tx1 = (node.max.x - origin.x) * inverse.x;
+	float ty0 = (node.min.y - origin.y) * inverse.y, ty1 = (node.max.y - origin.y) * inverse.y;
+	float tz0 = (node.min.z - origin.z) * inverse.z, tz1 = (node.max.z - origin.z) * inverse.z;
+	float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), tMin));
+	float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), tMax));
+	outNear = tNear;
+	return tNear <= tFar;
+}
+
+inline rayLanes broadcastRay(const ray& r) {
+	return {
+		simd::set1x8(r.origin.x), simd::set1x8(r.origin.y), simd::set1x8(r.origin.z),
+		simd::set1x8(r.direction.x), simd::set1x8(r.direction.y), simd::set1x8(r.direction.z),
+		simd::set1x8(safeInverse(r.direction.x)), simd::set1x8(safeInverse(r.direction.y)), simd::set1x8(safeInverse(r.direction.z)),
+		simd::set1x8(r.tMin),
+	};
+}
+
+// Closest or any hit of one ray, the 8 triangles of a leaf are tested together
+template<bool AnyHit>
+rayHit traverse(const bvh& tree, const ray& r) {
+	rayHit result;
+	if (tree.nodes.empty()) {
+		return result;
+	}
+	rayLanes lanes = broadcastRay(r);
+	vector3D<float> inverse{ safeInverse(r.direction.x), safeInverse(r.direction.y), safeInverse(r.direction.z) };
+	float tMax = r.tMax;
+
+	struct entry {
+		uint32_t node;
+		float tNear;
+	};
+	entry stack[bvhStackSize];
+	int top = 0;
+	float rootNear = 0;
+	if (!intersectNode(tree.nodes[0], r.origin, inverse, r.tMin, tMax, rootNear)) {
+		return result;
+	}
+	stack[top++] = { 0, rootNear };
+
+	while (top > 0) {
+		entry current = stack[--top];
+		if (current.tNear > tMax) {
+			continue;
+		}
+		uint32_t index = current.node;
+		// Walk down to a leaf, pushing the far child of every node hit on both sides
+		while (tree.nodes[index].count == 0) {
+			const bvhNode& node = tree.nodes[index];
+			uint32_t first = index + 1;
+			uint32_t second = node.offset;
+			float nearFirst = 0, nearSecond = 0;
+			bool hitFirst = intersectNode(tree.nodes[first], r.origin, inverse, r.tMin, tMax, nearFirst);
+			bool hitSecond = intersectNode(tree.nodes[second], r.origin, inverse, r.tMin, tMax, nearSecond);
+			if (hitFirst && hitSecond) {
+				if (nearSecond < nearFirst) {
+					std::swap(first, second);
+					std::swap(nearFirst, nearSecond);
+				}
+				stack[top++] = { second, nearSecond };
+				index = first;
+			}
+			else if (hitFirst) {
+				index = first;
+			}
+			else if (hitSecond) {
+				index = second;
+			}
+			else {
+				index = noHit;
+				break;
+			}
+		}
+		if (index == noHit) {
+			continue;
+		}
+
+		const bvhNode& leaf = tree.nodes[index];
+		const triangleBlock& block = tree.blocks[leaf.offset];
+		simd::float8 t, u, v;
+		int hits = intersectLanes(
+			simd::load8(block.ax), simd::load8(block.ay), simd::load8(block.az),
+			simd::load8(block.e1x), simd::load8(block.e1y), simd::load8(block.e1z),
+			simd::load8(block.e2x), simd::load8(block.e2y), simd::load8(block.e2z),
+			lanes, simd::set1x8(tMax), t, u, v);
+		if (hits == 0) {
+			continue;
+		}
+		alignas(32) float ts[soa::blockSize], us[soa::blockSize], vs[soa::blockSize];
+		simd::store(ts, t);
+		simd::store(us, u);
+		simd::store(vs, v);
+		for (uint32_t l = 0; l < soa::blockSize; l++) {
+			if ((hits >> l) & 1 && ts[l] < tMax) {
+				tMax = ts[l];
+				result = { ts[l], us[l], vs[l], block.triangle[l] };
+			}
+		}
+		if constexpr (AnyHit) {
+			return result;
+		}
+	}
+	return result;
+}
+
+// Closest or any hit of up to 8 rays, active is the mask of rays in use
+template<bool AnyHit>
+void traversePacket(const bvh& tree, const ray* rays, int active, rayHit* out) {
+	for (uint32_t l = 0; l < soa::blockSize; l++) {
+		if ((active >> l) & 1) {
+			out[l] = rayHit{};
+		}
+	}
+	if (tree.nodes.empty() || active == 0) {
+		return;
+	}
+
+	alignas(32) float lane[10][soa::blockSize];
+	alignas(32) float tMaxLanes[soa::blockSize];
+	for (uint32_t l = 0; l < soa::blockSize; l++) {
+		const ray& r = rays[(active >> l) & 1 ? l : 0];
+		lane[0][l] = r.origin.x;
+		lane[1][l] = r.origin.y;
+		lane[2][l] = r.origin.z;
+		lane[3][l] = r.direction.x;
+		lane[4][l] = r.direction.y;
+		lane[5][l] = r.direction.z;
+		lane[6][l] = safeInverse(r.direction.x);
+		lane[7][l] = safeInverse(r.direction.y);
+		lane[8][l] = safeInverse(r.direction.z);
+		lane[9][l] = r.tMin;
+		// Inactive lanes end before they start and never hit anything
+		tMaxLanes[l] = (active >> l) & 1 ? r.tMax : -std::numeric_limits<float>::max();
+	}
+	rayLanes lanes{
+		simd::load8(lane[0]), simd::load8(lane[1]), simd::load8(lane[2]),
+		simd::load8(lane[3]), simd::load8(lane[4]), simd::load8(lane[5]),
+		simd::load8(lane[6]), simd::load8(lane[7]), simd::load8(lane[8]),
+		simd::load8(lane[9]),
+	};
+	simd::float8 tMax = simd::load8(tMaxLanes);
+
+	// Children are ordered by the distances of the first active ray
+	const int leader = std::countr_zero(static_cast<unsigned>(active));
+	uint32_t stack[bvhStackSize];
+	int top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		uint32_t index = stack[--top];
+		const bvhNode& node = tree.nodes[index];
+		simd::float8 tNear;
+		if (intersectLanes(node, lanes, tMax, tNear) == 0) {
+			continue;
+		}
+		if (node.count == 0) {
+			// Near child first
+			uint32_t first = index + 1;
+			uint32_t second = node.offset;
+			simd::float8 nearFirst, nearSecond;
+			int maskFirst = intersectLanes(tree.nodes[first], lanes, tMax, nearFirst);
+			int maskSecond = intersectLanes(tree.nodes[second], lanes, tMax, nearSecond);
+			alignas(32) float a[soa::blockSize], b[soa::blockSize];
+			simd::store(a, nearFirst);
+			simd::store(b, nearSecond);
+			if (b[leader] < a[leader]) {
+				std::swap(first, second);
+				std::swap(maskFirst, maskSecond);
+			}
+			if (maskSecond) {
+				stack[top++] = second;
+			}
+			if (maskFirst) {
+				stack[top++] = first;
+			}
+			continue;
+		}
+
+		const triangleBlock& block = tree.blocks[node.offset];
+		alignas(32) float tMaxStore[soa::blockSize];
+		for (uint32_t k = 0; k < node.count; k++) {
+			simd::float8 t, u, v;
+			int hits = intersectLanes(
+				simd::set1x8(block.ax[k]), simd::set1x8(block.ay[k]), simd::set1x8(block.az[k]),
+				simd::set1x8(block.e1x[k]), simd::set1x8(block.e1y[k]), simd::set1x8(block.e1z[k]),
+				simd::set1x8(block.e2x[k]), simd::set1x8(block.e2y[k]), simd::set1x8(block.e2z[k]),
+				lanes, tMax, t, u, v);
+			if (hits == 0) {
+				continue;
+			}
+			alignas(32) float ts[soa::blockSize], us[soa::blockSize], vs[soa::blockSize];
+			simd::store(ts, t);
+			simd::store(us, u);
+			simd::store(vs, v);
+			simd::store(tMaxStore, tMax);
+			for (uint32_t l = 0; l < soa::blockSize; l++) {
+				if ((hits >> l) & 1) {
+					out[l] = { ts[l], us[l], vs[l], block.triangle[k] };
+					// Any hit is done with a ray once it hits, an empty interval takes it out
+					tMaxStore[l] = AnyHit ? -std::numeric_limits<float>::max() : ts[l];
+				}
+			}
+			tMax = simd::load8(tMaxStore);
+		}
+		if constexpr (AnyHit) {
+			simd::store(tMaxStore, tMax);
+			bool done = true;
+			for (uint32_t l = 0; l < soa::blockSize; l++) {
+				done = done && tMaxStore[l] == -std::numeric_limits<float>::max();
+			}
+			if (done) {
+				return;
+			}
+		}
+	}
+}
+} // namespace detail
+
+// Queries
+// Closest hit
+inline rayHit intersect(const bvh& tree, const ray& r) {
+	return detail::traverse<false>(tree, r);
+}
+// True when anything is hit between tMin and tMax, stops at the first hit found
+inline bool occluded(const bvh& tree, const ray& r) {
+	return detail::traverse<true>(tree, r).triangle != noHit;
+}
+
+// Closest hits of count rays, traced in packets of 8 consecutive rays
+inline void intersect(const bvh& tree, const ray* rays, size_t count, rayHit* out) {
+#if defined(LM2_SIMD_BACKEND_SCALAR)
+	// Packets only add work without vector registers, every ray is traced alone
+	for (size_t i = 0; i < count; i++) {
+		out[i] = intersect(tree, rays[i]);
+	}
+	return;
+#endif
+	for (size_t i = 0; i < count; i += soa::blockSize) {
+		int active = soa::detail::laneBits(count, i / soa::blockSize);
+		detail::traversePacket<false>(tree, rays + i, active, out + i);
+	}
+}
+// Occlusion of count rays in packets of 8, bit (i % 8) of byte (i / 8) is set when ray i hits anything
+// outOccluded needs soa::maskBytes(count) bytes, read it with soa::maskBit
+inline void occluded(const bvh& tree, const ray* rays, size_t count, uint8_t* outOccluded) {
+#if defined(LM2_SIMD_BACKEND_SCALAR)
+	std::fill(outOccluded, outOccluded + soa::maskBytes(count), uint8_t(0));
+	for (size_t i = 0; i < count; i++) {
+		outOccluded[i / soa::blockSize] |= static_cast<uint8_t>(occluded(tree, rays[i]) ? 1 << (i % soa::blockSize) : 0);
+	}
+	return;
+#endif
+	for (size_t i = 0; i < count; i += soa::blockSize) {
+		int active = soa::detail::laneBits(count, i / soa::blockSize);
+		rayHit hits[soa::blockSize];
+		detail::traversePacket<true>(tree, rays + i, active, hits);
+		uint8_t bits = 0;
+		for (uint32_t l = 0; l < soa::blockSize; l++) {
+			bits |= static_cast<uint8_t>(((active >> l) & 1) && hits[l].triangle != noHit ? 1 << l : 0);
+		}
+		outOccluded[i / soa::blockSize] = bits;
+	}
+}
+
+} // namespace lm2
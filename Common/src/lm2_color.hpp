@@ -0,0 +1,445 @@
+/*
+* Color conversion for lm2: sRGB transfer functions and pixel format kernels
+*
+* srgbToLinear / linearToSrgb on single floats are the exact reference. The array versions run an
+* exp2(p * log2(x)) polynomial over 8 lanes, within 2e-6 relative error of the reference. 8 bit
+* channels go through tables: decoding is a 256 entry lookup, encoding looks up the code at the
+* start of a bucket of float bits and compares with the one threshold a bucket can hold, so it
+* matches rounding the reference exactly without a pow per channel.
+*
+* convert moves images between the formats swapchains and textures use, premultiply and
+* unpremultiply work on linear values, so sRGB images are decoded and encoded around them. Alpha
+* is always linear. Rows are independent and run on the threadPool when one is passed; the
+* kernels work on simd::float8, pixels are gathered into channel lanes around them.
+*/
+#pragma once
+
+#include "lm2_parallel.hpp"
+#include "lm2_simd.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace lm2 {
+namespace color {
+
+// Same memory layout as the Vulkan formats of the same name, 16 bit floats are IEEE halves
+enum class format {
+	rgba8Unorm,
+	bgra8Unorm,
+	rgba8Srgb,
+	bgra8Srgb,
+	rgba16Float,
+	rgba32Float,
+};
+
+constexpr size_t bytesPerPixel(format f) noexcept {
+	switch (f) {
+	case format::rgba16Float: return 8;
+	case format::rgba32Float: return 16;
+	default: return 4;
+	}
+}
+
+// Exact transfer functions of the sRGB standard
+inline float srgbToLinear(float c) noexcept {
+	return c <= 0.04045f ? c / 12.92f : static_cast<float>(std::pow((c + 0.055) / 1.055, 2.4));
+}
+inline float linearToSrgb(float c) noexcept {
+	return c <= 0.0031308f ? c * 12.92f : static_cast<float>(1.055 * std::pow(static_cast<double>(c), 1 / 2.4) - 0.055);
+}
+
+namespace detail {
+constexpr size_t lanes = 8;
+
+// Encoding buckets are the top 8 mantissa bits of floats in [2^-13, 1), below 2^-13 every value
+// encodes to 0. No bucket is wide enough to hold two code thresholds
+constexpr uint32_t bucketBase = (127u - 13u) << 23;
+constexpr size_t bucketShift = 15;
+constexpr size_t bucketCount = 13 << 8;
+
+struct tables {
+	float decode[256];
+	// threshold[k] is the smallest float that encodes to k or more, threshold[256] is +inf
+	float threshold[257];
+	uint8_t encode[bucketCount];
+	uint8_t unormToSrgb[256];
+	uint8_t srgbToUnorm[256];
+};
+
+// Rounding the reference in double precision, what every table reproduces
+inline uint8_t encodeReference(float c) noexcept {
+	double x = c > 0.0f ? c : 0.0;
+	double s = x <= 0.0031308 ? x * 12.92 : 1.055 * std::pow(x, 1 / 2.4) - 0.055;
+	s = s < 1.0 ? s : 1.0;
+	return static_cast<uint8_t>(s * 255 + 0.5);
+}
+
+inline tables makeTables() {
+	tables t{};
+	for (int i = 0; i < 256; i++) {
+		double c = i / 255.0;
+		t.decode[i] = static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+	}
+	t.threshold[0] = 0.0f;
+	t.threshold[256] = INFINITY;
+	for (int k = 1; k < 256; k++) {
+		// Start at the double threshold and walk to the exact float boundary of the reference
+		double s = (k - 0.5) / 255.0;
+		float x = static_cast<float>(s <= 0.04045 ? s / 12.92 : std::pow((s + 0.055) / 1.055, 2.4));
+		while (encodeReference(x) >= k) {
+			x = std::nextafter(x, 0.0f);
+		}
+		while (encodeReference(x) < k) {
+			x = std::nextafter(x, 1.0f);
+		}
+		t.threshold[k] = x;
+	}
+	for (size_t b = 0; b < bucketCount; b++) {
+		t.encode[b] = encodeReference(std::bit_cast<float>(bucketBase + (static_cast<uint32_t>(b) << bucketShift)));
+	}
+	for (int i = 0; i < 256; i++) {
+		t.unormToSrgb[i] = encodeReference(i / 255.0f);
+		t.srgbToUnorm[i] = static_cast<uint8_t>(t.decode[i] * 255 + 0.5f);
+	}
+	return t;
+}
+
+inline const tables& lookup() {
+	static const tables t = makeTables();
+	return t;
+}
+
+inline uint8_t encode8(const tables& t, float c) noexcept {
+	// NaN and negative values encode to 0, values from 1 up to 255
+	c = c > 0.0f ? c : 0.0f;
+	c = c < 1.0f ? c : 0.99999994f;
+	uint32_t bits = std::bit_cast<uint32_t>(c);
+	bits = bits > bucketBase ? bits : bucketBase;
+	uint32_t code = t.encode[(bits - bucketBase) >> bucketShift];
+	return static_cast<uint8_t>(code + (c >= t.threshold[code + 1]));
+}
+
+inline simd::float8 splat(uint32_t bits) noexcept {
+	return simd::set1x8(std::bit_cast<float>(bits));
+}
+
+// log2 of positive normal floats, atanh series of the mantissa folded into [sqrt(1/2), sqrt(2))
+inline simd::float8 log2Lanes(simd::float8 x) noexcept {
+	simd::float8 one = simd::set1x8(1.0f);
+	simd::float8 exponent = simd::mulAdd(simd::intToFloat(simd::bitAnd(x, splat(0x7F800000u))), simd::set1x8(1.0f / (1 << 23)),
+		simd::set1x8(-127.0f));
+	simd::float8 m = simd::bitOr(simd::bitAnd(x, splat(0x7FFFFFu)), one);
+	simd::float8 fold = simd::cmpLess(simd::set1x8(1.41421356f), m);
+	m = simd::select(fold, simd::mul(m, simd::set1x8(0.5f)), m);
+	exponent = simd::add(exponent, simd::bitAnd(fold, one));
+	simd::float8 t = simd::div(simd::sub(m, one), simd::add(m, one));
+	simd::float8 t2 = simd::mul(t, t);
+	// 2 / ln 2 * (t + t^3 / 3 + t^5 / 5 + t^7 / 7)
+	simd::float8 series = simd::mulAdd(t2, simd::set1x8(0.412198583f), simd::set1x8(0.577078016f));
+	series = simd::mulAdd(t2, series, simd::set1x8(0.961796694f));
+	series = simd::mulAdd(t2, series, simd::set1x8(2.88539008f));
+	return simd::mulAdd(t, series, exponent);
+}
+
+// 2^x for x in [-126, 127], Taylor series of the fraction around the nearest integer
+inline simd::float8 exp2Lanes(simd::float8 x) noexcept {
+	simd::float8 v = simd::min(simd::max(x, simd::set1x8(-126.0f)), simd::set1x8(127.0f));
+	simd::float8 n = simd::floor(simd::add(v, simd::set1x8(0.5f)));
+	simd::float8 f = simd::mul(simd::sub(v, n), simd::set1x8(0.693147181f));
+	simd::float8 p = simd::mulAdd(f, simd::set1x8(0.00138888889f), simd::set1x8(0.00833333333f));
+	p = simd::mulAdd(f, p, simd::set1x8(0.0416666667f));
+	p = simd::mulAdd(f, p, simd::set1x8(0.166666667f));
+	p = simd::mulAdd(f, p, simd::set1x8(0.5f));
+	p = simd::mulAdd(f, p, simd::set1x8(1.0f));
+	p = simd::mulAdd(f, p, simd::set1x8(1.0f));
+	// (n + 127) << 23 are the bits of 2^n
+	return simd::mul(p, simd::floatToInt(simd::mul(simd::add(n, simd::set1x8(127.0f)), simd::set1x8(1 << 23))));
+}
+
+inline simd::float8 srgbToLinearLanes(simd::float8 c) noexcept {
+	simd::float8 base = simd::mul(simd::add(c, simd::set1x8(0.055f)), simd::set1x8(1 / 1.055f));
+	base = simd::max(base, simd::set1x8(1e-30f));
+	simd::float8 power = exp2Lanes(simd::mul(log2Lanes(base), simd::set1x8(2.4f)));
+	return simd::select(simd::cmpLess(simd::set1x8(0.04045f), c), power, simd::mul(c, simd::set1x8(1 / 12.92f)));
+}
+inline simd::float8 linearToSrgbLanes(simd::float8 c) noexcept {
+	simd::float8 power = exp2Lanes(simd::mul(log2Lanes(simd::max(c, simd::set1x8(1e-30f))), simd::set1x8(1 / 2.4f)));
+	power = simd::mulAdd(power, simd::set1x8(1.055f), simd::set1x8(-0.055f));
+	return simd::select(simd::cmpLess(simd::set1x8(0.0031308f), c), power, simd::mul(c, simd::set1x8(12.92f)));
+}
+
+// IEEE half conversions on lanes holding the 16 bits as float values in [0, 65536), round to
+// nearest even, infinities and NaN kept. A half shifted up by 13 bits is the float 2^-112 times
+// smaller, which floatToInt and intToFloat move between the bits and the value
+inline simd::float8 halfToFloatLanes(simd::float8 h) noexcept {
+	simd::float8 negative = simd::cmpLess(simd::set1x8(32767.5f), h);
+	simd::float8 magnitude = simd::sub(h, simd::bitAnd(negative, simd::set1x8(32768.0f)));
+	simd::float8 value = simd::mul(simd::floatToInt(simd::mul(magnitude, simd::set1x8(8192.0f))), simd::set1x8(0x1p112f));
+	simd::float8 special = simd::select(simd::cmpNotEqual(magnitude, simd::set1x8(31744.0f)), simd::set1x8(NAN), simd::set1x8(INFINITY));
+	value = simd::select(simd::cmpLess(magnitude, simd::set1x8(31744.0f)), value, special);
+	return simd::bitOr(value, simd::bitAnd(negative, simd::set1x8(-0.0f)));
+}
+inline simd::float8 floatToHalfLanes(simd::float8 x) noexcept {
+	simd::float8 a = simd::abs(x);
+	// Adding and removing 1.5 * 2^13 times the power of two of a rounds it to the 11 bits of a half,
+	// subnormal halves share the spacing of 2^-14
+	simd::float8 magic = simd::max(simd::mul(simd::bitAnd(a, splat(0x7F800000u)), simd::set1x8(12288.0f)), simd::set1x8(0.75f));
+	simd::float8 rounded = simd::sub(simd::add(a, magic), magic);
+	simd::float8 h = simd::mul(simd::intToFloat(simd::mul(rounded, simd::set1x8(0x1p-112f))), simd::set1x8(1.0f / 8192));
+	h = simd::select(simd::cmpLess(a, simd::set1x8(65520.0f)), h, simd::set1x8(31744.0f));
+	h = simd::select(simd::cmpNotEqual(a, a), simd::set1x8(32256.0f), h);
+	// The sign bit as an int32 is -2^31
+	return simd::mulAdd(simd::intToFloat(simd::bitAnd(x, simd::set1x8(-0.0f))), simd::set1x8(-1.0f / 65536), h);
+}
+
+// Clamps to [0, 1] and scales to the nearest code, NaN becomes 0
+inline simd::float8 unormLanes(simd::float8 c) noexcept {
+	simd::float8 clamped = simd::select(simd::cmpLess(simd::zero8(), c), simd::min(c, simd::set1x8(1.0f)), simd::zero8());
+	return simd::floor(simd::mulAdd(clamped, simd::set1x8(255.0f), simd::set1x8(0.5f)));
+}
+
+constexpr bool isBytes(format f) noexcept {
+	return bytesPerPixel(f) == 4;
+}
+constexpr bool isSrgb(format f) noexcept {
+	return f == format::rgba8Srgb || f == format::bgra8Srgb;
+}
+constexpr bool isBgra(format f) noexcept {
+	return f == format::bgra8Unorm || f == format::bgra8Srgb;
+}
+
+// count <= 8 pixels to linear rgba[channel], lanes past count are zero
+inline void loadLanes(const tables& t, format f, const unsigned char* src, size_t count, simd::float8 (&rgba)[4]) noexcept {
+	alignas(32) float channels[4][lanes] = {};
+	if (f == format::rgba32Float) {
+		for (size_t l = 0; l < count; l++) {
+			float pixel[4];
+			std::memcpy(pixel, src + l * 16, 16);
+			for (size_t channel = 0; channel < 4; channel++) {
+				channels[channel][l] = pixel[channel];
+			}
+		}
+	}
+	else if (f == format::rgba16Float) {
+		for (size_t l = 0; l < count; l++) {
+			uint16_t pixel[4];
+			std::memcpy(pixel, src + l * 8, 8);
+			for (size_t channel = 0; channel < 4; channel++) {
+				channels[channel][l] = pixel[channel];
+			}
+		}
+		for (size_t channel = 0; channel < 4; channel++) {
+			rgba[channel] = halfToFloatLanes(simd::load8(channels[channel]));
+		}
+		return;
+	}
+	else {
+		size_t red = isBgra(f) ? 2 : 0;
+		const float* decode = t.decode;
+		bool srgb = isSrgb(f);
+		for (size_t l = 0; l < count; l++) {
+			const unsigned char* pixel = src + l * 4;
+			unsigned char rgb[3] = { pixel[red], pixel[1], pixel[2 - red] };
+			for (size_t channel = 0; channel < 3; channel++) {
+				channels[channel][l] = srgb ? decode[rgb[channel]] : rgb[channel] * (1 / 255.0f);
+			}
+			channels[3][l] = pixel[3] * (1 / 255.0f);
+		}
+	}
+	for (size_t channel = 0; channel < 4; channel++) {
+		rgba[channel] = simd::load8(channels[channel]);
+	}
+}
+
+inline void storeLanes(const tables& t, format f, const simd::float8 (&rgba)[4], size_t count, unsigned char* dst) noexcept {
+	alignas(32) float channels[4][lanes];
+	if (f == format::rgba32Float) {
+		for (size_t channel = 0; channel < 4; channel++) {
+			simd::store(channels[channel], rgba[channel]);
+		}
+		for (size_t l = 0; l < count; l++) {
+			float pixel[4] = { channels[0][l], channels[1][l], channels[2][l], channels[3][l] };
+			std::memcpy(dst + l * 16, pixel, 16);
+		}
+	}
+	else if (f == format::rgba16Float) {
+		for (size_t channel = 0; channel < 4; channel++) {
+			simd::store(channels[channel], floatToHalfLanes(rgba[channel]));
+		}
+		for (size_t l = 0; l < count; l++) {
+			uint16_t pixel[4];
+			for (size_t channel = 0; channel < 4; channel++) {
+				pixel[channel] = static_cast<uint16_t>(channels[channel][l]);
+			}
+			std::memcpy(dst + l * 8, pixel, 8);
+		}
+	}
+	else {
+		size_t red = isBgra(f) ? 2 : 0;
+		bool srgb = isSrgb(f);
+		for (size_t channel = 0; channel < 4; channel++) {
+			simd::store(channels[channel], srgb && channel < 3 ? rgba[channel] : unormLanes(rgba[channel]));
+		}
+		for (size_t l = 0; l < count; l++) {
+			unsigned char* pixel = dst + l * 4;
+			unsigned char rgb[3];
+			for (size_t channel = 0; channel < 3; channel++) {
+				rgb[channel] = srgb ? encode8(t, channels[channel][l]) : static_cast<unsigned char>(channels[channel][l]);
+			}
+			pixel[red] = rgb[0];
+			pixel[1] = rgb[1];
+			pixel[2 - red] = rgb[2];
+			pixel[3] = static_cast<unsigned char>(channels[3][l]);
+		}
+	}
+}
+
+// Calls row(y) for every row, on the pool when there is one
+template<typename Row>
+void forRows(size_t height, threadPool* pool, Row row) {
+	parallelFor(pool, height, 4, [&](size_t begin, size_t end) {
+		for (size_t y = begin; y < end; y++) {
+			row(y);
+		}
+	});
+}
+
+// Decodes every pixel of a row to linear lanes, calls kernel(rgba) and encodes the result to dst
+template<typename Kernel>
+void transformRow(const tables& t, format srcFormat, const unsigned char* src, format dstFormat, unsigned char* dst, size_t width,
+	Kernel kernel) noexcept {
+	size_t srcBytes = bytesPerPixel(srcFormat);
+	size_t dstBytes = bytesPerPixel(dstFormat);
+	for (size_t x = 0; x < width; x += lanes) {
+		size_t count = width - x < lanes ? width - x : lanes;
+		simd::float8 rgba[4];
+		loadLanes(t, srcFormat, src + x * srcBytes, count, rgba);
+		kernel(rgba);
+		storeLanes(t, dstFormat, rgba, count, dst + x * dstBytes);
+	}
+}
+
+// Runs kernel over whole blocks of 8, the tail goes through a zero padded block
+template<typename Kernel>
+void mapLanes(const float* in, float* out, size_t count, Kernel kernel) noexcept {
+	size_t i = 0;
+	for (; i + lanes <= count; i += lanes) {
+		simd::store(out + i, kernel(simd::load8(in + i)));
+	}
+	if (i < count) {
+		float c[lanes] = {};
+		std::memcpy(c, in + i, (count - i) * sizeof(float));
+		simd::store(c, kernel(simd::load8(c)));
+		std::memcpy(out + i, c, (count - i) * sizeof(float));
+	}
+}
+} // namespace detail
+
+// sRGB encoded values to linear and back, 8 lanes at a time, within 2e-6 relative error of the
+// scalar versions
+inline void srgbToLinear(const float* in, float* out, size_t count) noexcept {
+	detail::mapLanes(in, out, count, detail::srgbToLinearLanes);
+}
+inline void linearToSrgb(const float* in, float* out, size_t count) noexcept {
+	detail::mapLanes(in, out, count, detail::linearToSrgbLanes);
+}
+
+// 8 bit sRGB codes to linear and back, the encoding matches rounding linearToSrgb(c) * 255
+inline float srgb8ToLinear(uint8_t c) {
+	return detail::lookup().decode[c];
+}
+inline uint8_t linearToSrgb8(float c) {
+	return detail::encode8(detail::lookup(), c);
+}
+
+// Converts a width x height image, pitch is the distance in bytes between rows, 0 for packed rows
+// Channels outside [0, 1] clamp when written to 8 bit formats
+inline void convert(const void* src, format srcFormat, size_t srcPitch, void* dst, format dstFormat, size_t dstPitch, size_t width,
+	size_t height, threadPool* pool = nullptr) {
+	const detail::tables& t = detail::lookup();
+	srcPitch = srcPitch ? srcPitch : width * bytesPerPixel(srcFormat);
+	dstPitch = dstPitch ? dstPitch : width * bytesPerPixel(dstFormat);
+	const unsigned char* srcBytes = static_cast<const unsigned char*>(src);
+	unsigned char* dstBytes = static_cast<unsigned char*>(dst);
+
+	if (srcFormat == dstFormat) {
+		detail::forRows(height, pool, [&](size_t y) {
+			std::memcpy(dstBytes + y * dstPitch, srcBytes + y * srcPitch, width * bytesPerPixel(srcFormat));
+		});
+	}
+	else if (detail::isBytes(srcFormat) && detail::isBytes(dstFormat) && detail::isSrgb(srcFormat) == detail::isSrgb(dstFormat)) {
+		// Swapping red and blue
+		detail::forRows(height, pool, [&](size_t y) {
+			const unsigned char* in = srcBytes + y * srcPitch;
+			unsigned char* out = dstBytes + y * dstPitch;
+			for (size_t x = 0; x < width; x++) {
+				uint32_t p;
+				std::memcpy(&p, in + x * 4, 4);
+				p = (p & 0xFF00FF00u) | ((p >> 16) & 0xFFu) | ((p & 0xFFu) << 16);
+				std::memcpy(out + x * 4, &p, 4);
+			}
+		});
+	}
+	else if (detail::isBytes(srcFormat) && detail::isBytes(dstFormat)) {
+		// Between unorm and sRGB through one byte table
+		const uint8_t* table = detail::isSrgb(srcFormat) ? t.srgbToUnorm : t.unormToSrgb;
+		size_t srcRed = detail::isBgra(srcFormat) ? 2 : 0;
+		size_t dstRed = detail::isBgra(dstFormat) ? 2 : 0;
+		detail::forRows(height, pool, [&](size_t y) {
+			const unsigned char* in = srcBytes + y * srcPitch;
+			unsigned char* out = dstBytes + y * dstPitch;
+			for (size_t x = 0; x < width; x++) {
+				const unsigned char* p = in + x * 4;
+				unsigned char* q = out + x * 4;
+				unsigned char r = table[p[srcRed]], g = table[p[1]], b = table[p[2 - srcRed]], a = p[3];
+				q[dstRed] = r;
+				q[1] = g;
+				q[2 - dstRed] = b;
+				q[3] = a;
+			}
+		});
+	}
+	else {
+		detail::forRows(height, pool, [&](size_t y) {
+			detail::transformRow(t, srcFormat, srcBytes + y * srcPitch, dstFormat, dstBytes + y * dstPitch, width, [](simd::float8 (&)[4]) {});
+		});
+	}
+}
+
+// Multiplies color by alpha in place, on linear values
+inline void premultiply(void* pixels, format f, size_t pitch, size_t width, size_t height, threadPool* pool = nullptr) {
+	const detail::tables& t = detail::lookup();
+	pitch = pitch ? pitch : width * bytesPerPixel(f);
+	unsigned char* bytes = static_cast<unsigned char*>(pixels);
+	detail::forRows(height, pool, [&](size_t y) {
+		unsigned char* row = bytes + y * pitch;
+		detail::transformRow(t, f, row, f, row, width, [](simd::float8 (&rgba)[4]) {
+			for (size_t channel = 0; channel < 3; channel++) {
+				rgba[channel] = simd::mul(rgba[channel], rgba[3]);
+			}
+		});
+	});
+}
+
+// Divides color by alpha in place, pixels with zero alpha become transparent black
+inline void unpremultiply(void* pixels, format f, size_t pitch, size_t width, size_t height, threadPool* pool = nullptr) {
+	const detail::tables& t = detail::lookup();
+	pitch = pitch ? pitch : width * bytesPerPixel(f);
+	unsigned char* bytes = static_cast<unsigned char*>(pixels);
+	detail::forRows(height, pool, [&](size_t y) {
+		unsigned char* row = bytes + y * pitch;
+		detail::transformRow(t, f, row, f, row, width, [](simd::float8 (&rgba)[4]) {
+			simd::float8 scale = simd::select(simd::cmpLess(simd::zero8(), rgba[3]), simd::div(simd::set1x8(1.0f), rgba[3]), simd::zero8());
+			for (size_t channel = 0; channel < 3; channel++) {
+				rgba[channel] = simd::mul(rgba[channel], scale);
+			}
+		});
+	});
+}
+
+} // namespace color
+} // namespace lm2
@@ -0,0 +1,293 @@
+/*
+* Fast approximations for lm2
+*
+* lm2::fast trades accuracy for throughput, for float only as the polynomials are fitted to float
+* precision. Maximum errors against the double precision <cmath> results:
+*   rsqrt, normalize  relative 3e-7 (SSE / AVX), 3e-5 (NEON), one Newton step on the hardware estimate
+*   sin, cos, sincos  absolute 1e-7 for |x| <= 8192, 1e-6 for |x| <= 1e5, larger arguments and NaN
+*                     go through lm2::sin / lm2::cos
+*   tan               relative 3e-7 for |x| <= 1.5
+*   atan, atan2       absolute 3e-7
+* Constant evaluation uses the same polynomials, rsqrt starts from the integer estimate instead.
+* Angles are radians like lm2::sin, the rotation functions take degrees like their lm2 versions.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_simd.hpp"
+#include "lm2_soa.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+namespace lm2 {
+namespace fast {
+
+namespace detail {
+constexpr float twoOverPi = 0.636619772367581343f;
+constexpr float halfPi = 1.57079632679489662f;
+constexpr float pi = 3.14159265358979324f;
+// Largest argument of the polynomial sincos, past it the reduction loses the result
+constexpr float sincosLimit = 1e5f;
+// pi / 2 split in three parts, q * piOver2Hi is exact for |q| < 2^16
+constexpr float piOver2Hi = 1.5703125f;
+constexpr float piOver2Mid = 4.837512969970703125e-4f;
+constexpr float piOver2Lo = 7.54978995489188216e-8f;
+
+// Minimax polynomials on [-pi / 4, pi / 4] from the Cephes library
+constexpr float sinCoefficients[3] = { -1.6666654611e-1f, 8.3321608736e-3f, -1.9515295891e-4f };
+constexpr float cosCoefficients[3] = { 4.166664568298827e-2f, -1.388731625493765e-3f, 2.443315711809948e-5f };
+// atan(z) / z on [0, 1], Abramowitz and Stegun 4.4.49
+constexpr float atanCoefficients[8] = {
+	-0.3333314528f, 0.1999355085f, -0.1420889944f, 0.1065626393f,
+	-0.0752896400f, 0.0429096138f, -0.0161657367f, 0.0028662257f,
+};
+
+constexpr float sinPolynomial(float r) noexcept {
+	float r2 = r * r;
+	return r + r * r2 * (sinCoefficients[0] + r2 * (sinCoefficients[1] + r2 * sinCoefficients[2]));
+}
+constexpr float cosPolynomial(float r) noexcept {
+	float r2 = r * r;
+	return 1.0f - 0.5f * r2 + r2 * r2 * (cosCoefficients[0] + r2 * (cosCoefficients[1] + r2 * cosCoefficients[2]));
+}
+constexpr float atanPolynomial(float z) noexcept {
+	float z2 = z * z;
+	float p = atanCoefficients[7];
+	for (int i = 6; i >= 0; i--) {
+		p = atanCoefficients[i] + z2 * p;
+	}
+	return z + z * z2 * p;
+}
+
+inline simd::float8 sinPolynomial(simd::float8 r) {
+	simd::float8 r2 = simd::mul(r, r);
+	simd::float8 p = simd::add(simd::set1x8(sinCoefficients[1]), simd::mul(r2, simd::set1x8(sinCoefficients[2])));
+	p = simd::add(simd::set1x8(sinCoefficients[0]), simd::mul(r2, p));
+	return simd::add(r, simd::mul(simd::mul(r, r2), p));
+}
+inline simd::float8 cosPolynomial(simd::float8 r) {
+	simd::float8 r2 = simd::mul(r, r);
+	simd::float8 p = simd::add(simd::set1x8(cosCoefficients[1]), simd::mul(r2, simd::set1x8(cosCoefficients[2])));
+	p = simd::add(simd::set1x8(cosCoefficients[0]), simd::mul(r2, p));
+	simd::float8 c = simd::sub(simd::set1x8(1.0f), simd::mul(simd::set1x8(0.5f), r2));
+	return simd::add(c, simd::mul(simd::mul(r2, r2), p));
+}
+inline simd::float8 atanPolynomial(simd::float8 z) {
+	simd::float8 z2 = simd::mul(z, z);
+	simd::float8 p = simd::set1x8(atanCoefficients[7]);
+	for (int i = 6; i >= 0; i--) {
+		p = simd::add(simd::set1x8(atanCoefficients[i]), simd::mul(z2, p));
+	}
+	return simd::add(z, simd::mul(simd::mul(z, z2), p));
+}
+
+inline simd::float8 signBit8() {
+	return simd::set1x8(-0.0f);
+}
+inline void sincos(simd::float8 x, simd::float8& outSin, simd::float8& outCos) {
+	simd::float8 q = simd::floor(simd::add(simd::mul(x, simd::set1x8(twoOverPi)), simd::set1x8(0.5f)));
+	simd::float8 r = simd::sub(x, simd::mul(q, simd::set1x8(piOver2Hi)));
+	r = simd::sub(r, simd::mul(q, simd::set1x8(piOver2Mid)));
+	r = simd::sub(r, simd::mul(q, simd::set1x8(piOver2Lo)));
+	simd::float8 s = sinPolynomial(r);
+	simd::float8 c = cosPolynomial(r);
+
+	// Quadrant q mod 4 from the fraction of q / 4, one of 0, 0.25, 0.5 or 0.75
+	simd::float8 quarter = simd::mul(q, simd::set1x8(0.25f));
+	simd::float8 fraction = simd::sub(quarter, simd::floor(quarter));
+	simd::float8 half = simd::mul(q, simd::set1x8(0.5f));
+	simd::float8 odd = simd::cmpNotEqual(half, simd::floor(half));
+	simd::float8 negateSin = simd::cmpLess(simd::set1x8(0.375f), fraction);
+	simd::float8 negateCos = simd::bitAnd(simd::cmpLess(simd::set1x8(0.125f), fraction), simd::cmpLess(fraction, simd::set1x8(0.625f)));
+	outSin = simd::bitXor(simd::select(odd, c, s), simd::bitAnd(negateSin, signBit8()));
+	outCos = simd::bitXor(simd::select(odd, s, c), simd::bitAnd(negateCos, signBit8()));
+
+	// Rare lanes outside the polynomial range, NaN lanes stay NaN without the fallback
+	int far = simd::moveMask(simd::cmpLess(simd::set1x8(sincosLimit), simd::abs(x)));
+	if (far != 0) {
+		alignas(32) float angles[8], sines[8], cosines[8];
+		simd::store(angles, x);
+		simd::store(sines, outSin);
+		simd::store(cosines, outCos);
+		for (int l = 0; l < 8; l++) {
+			if (far & (1 << l)) {
+				sines[l] = lm2::sin(angles[l]);
+				cosines[l] = lm2::cos(angles[l]);
+			}
+		}
+		outSin = simd::load8(sines);
+		outCos = simd::load8(cosines);
+	}
+}
+inline simd::float8 atan2(simd::float8 y, simd::float8 x) {
+	simd::float8 ax = simd::abs(x), ay = simd::abs(y);
+	simd::float8 a = atanPolynomial(simd::divChecked(simd::min(ax, ay), simd::max(ax, ay)));
+	a = simd::select(simd::cmpLess(ax, ay), simd::sub(simd::set1x8(halfPi), a), a);
+	a = simd::select(simd::cmpLess(x, simd::zero8()), simd::sub(simd::set1x8(pi), a), a);
+	return simd::bitXor(a, simd::bitAnd(y, signBit8()));
+}
+inline simd::float8 rsqrt(simd::float8 x) {
+	simd::float8 y = simd::rsqrt(x);
+	simd::float8 halfXYY = simd::mul(simd::mul(simd::mul(simd::set1x8(0.5f), x), y), y);
+	return simd::mul(y, simd::sub(simd::set1x8(1.5f), halfXYY));
+}
+} // namespace detail
+
+// Reciprocal square root
+constexpr float rsqrt(float x) noexcept {
+	if (std::is_constant_evaluated()) {
+		// Three Newton steps bring the integer estimate to float precision
+		float y = std::bit_cast<float>(0x5F375A86u - (std::bit_cast<uint32_t>(x) >> 1));
+		y = y * (1.5f - 0.5f * x * y * y);
+		y = y * (1.5f - 0.5f * x * y * y);
+		return y * (1.5f - 0.5f * x * y * y);
+	}
+	float y = simd::first(simd::rsqrt(simd::set1(x)));
+	return y * (1.5f - 0.5f * x * y * y);
+}
+
+// Normalize, zero length vectors stay zero without a branch
+// (the squared length is clamped to the smallest normal float, 0 times its rsqrt is 0)
+constexpr vector2D<float> normalize(vector2D<float> v) noexcept {
+	float lengthSquared = v.x * v.x + v.y * v.y;
+	return v * rsqrt(lengthSquared > std::numeric_limits<float>::min() ? lengthSquared : std::numeric_limits<float>::min());
+}
+constexpr vector3D<float> normalize(vector3D<float> v) noexcept {
+	float lengthSquared = v.x * v.x + v.y * v.y + v.z * v.z;
+	return v * rsqrt(lengthSquared > std::numeric_limits<float>::min() ? lengthSquared : std::numeric_limits<float>::min());
+}
+constexpr vector4D<float> normalize(vector4D<float> v) noexcept {
+	float lengthSquared = v.x * v.x + v.y * v.y + v.z * v.z + v.w * v.w;
+	return v * rsqrt(lengthSquared > std::numeric_limits<float>::min() ? lengthSquared : std::numeric_limits<float>::min());
+}
+
+// Trigonometry
+constexpr void sincos(float x, float& outSin, float& outCos) noexcept {
+	// Also keeps the quadrant below inside int32_t
+	if (!(lm2::abs(x) <= detail::sincosLimit)) {
+		outSin = lm2::sin(x);
+		outCos = lm2::cos(x);
+		return;
+	}
+	float t = x * detail::twoOverPi;
+	int32_t q = static_cast<int32_t>(t >= 0 ? t + 0.5f : t - 0.5f);
+	float qf = static_cast<float>(q);
+	float r = ((x - qf * detail::piOver2Hi) - qf * detail::piOver2Mid) - qf * detail::piOver2Lo;
+	float s = detail::sinPolynomial(r);
+	float c = detail::cosPolynomial(r);
+	switch (q & 3) {
+	case 0: outSin = s;  outCos = c;  break;
+	case 1: outSin = c;  outCos = -s; break;
+	case 2: outSin = -s; outCos = -c; break;
+	default: outSin = -c; outCos = s; break;
+	}
+}
+constexpr float sin(float x) noexcept {
+	float s = 0, c = 0;
+	sincos(x, s, c);
+	return s;
+}
+constexpr float cos(float x) noexcept {
+	float s = 0, c = 0;
+	sincos(x, s, c);
+	return c;
+}
+constexpr float tan(float x) noexcept {
+	float s = 0, c = 0;
+	sincos(x, s, c);
+	return s / c;
+}
+constexpr float atan(float x) noexcept {
+	float a = lm2::abs(x);
+	float r = a > 1.0f ? detail::halfPi - detail::atanPolynomial(1.0f / a) : detail::atanPolynomial(a);
+	return x < 0 ? -r : r;
+}
+// The sign of the result follows the sign bit of y like std::atan2, x = -0 is treated as +0
+constexpr float atan2(float y, float x) noexcept {
+	float ax = lm2::abs(x), ay = lm2::abs(y);
+	float big = ax > ay ? ax : ay;
+	float small = ax > ay ? ay : ax;
+	float a = detail::atanPolynomial(big != 0 ? small / big : 0.0f);
+	if (ax < ay)
+		a = detail::halfPi - a;
+	if (x < 0)
+		a = detail::pi - a;
+	return std::bit_cast<uint32_t>(y) >> 31 ? -a : a;
+}
+
+// Rotation matrices with one sincos per axis, same conventions as lm2::rotation2D / lm2::rotation3D
+constexpr matrix2x2<float> rotation2D(float degrees) noexcept {
+	float s = 0, c = 0;
+	sincos(degrees2radians(degrees), s, c);
+	return {
+		{ c, s },
+		{ -s, c },
+	};
+}
+// Axis order: YXZ
+constexpr matrix3x3<float> rotation3D(vector3D<float> degrees) noexcept {
+	vector3D<float> s{}, c{};
+	sincos(degrees2radians(degrees.x), s.x, c.x);
+	sincos(degrees2radians(degrees.y), s.y, c.y);
+	sincos(degrees2radians(degrees.z), s.z, c.z);
+	// rotY * rotX * rotZ expanded
+	return {
+		{  c.y * c.z + s.y * s.x * s.z,  c.y * s.z - s.y * s.x * c.z, s.y * c.x },
+		{ -c.x * s.z,                    c.x * c.z,                   s.x       },
+		{ -s.y * c.z + c.y * s.x * s.z, -s.y * s.z - c.y * s.x * c.z, c.y * c.x },
+	};
+}
+
+// Stream versions, out is resized to the input size
+inline void sincos(const soa::scalarStream<float>& angles, soa::scalarStream<float>& outSin, soa::scalarStream<float>& outCos) {
+	outSin.resize(angles.size());
+	outCos.resize(angles.size());
+	for (size_t b = 0; b < angles.blockCount(); b++) {
+		simd::float8 s, c;
+		detail::sincos(simd::load8(angles.blocks[b].v), s, c);
+		simd::store(outSin.blocks[b].v, s);
+		simd::store(outCos.blocks[b].v, c);
+	}
+}
+inline void sin(const soa::scalarStream<float>& angles, soa::scalarStream<float>& out) {
+	out.resize(angles.size());
+	for (size_t b = 0; b < angles.blockCount(); b++) {
+		simd::float8 s, c;
+		detail::sincos(simd::load8(angles.blocks[b].v), s, c);
+		simd::store(out.blocks[b].v, s);
+	}
+}
+inline void cos(const soa::scalarStream<float>& angles, soa::scalarStream<float>& out) {
+	out.resize(angles.size());
+	for (size_t b = 0; b < angles.blockCount(); b++) {
+		simd::float8 s, c;
+		detail::sincos(simd::load8(angles.blocks[b].v), s, c);
+		simd::store(out.blocks[b].v, c);
+	}
+}
+// out gets the size of the shorter input
+inline void atan2(const soa::scalarStream<float>& y, const soa::scalarStream<float>& x, soa::scalarStream<float>& out) {
+	out.resize(y.size() < x.size() ? y.size() : x.size());
+	for (size_t b = 0; b < out.blockCount(); b++) {
+		simd::store(out.blocks[b].v, detail::atan2(simd::load8(y.blocks[b].v), simd::load8(x.blocks[b].v)));
+	}
+}
+inline void normalize(const soa::vector3Stream<float>& in, soa::vector3Stream<float>& out) {
+	out.resize(in.size());
+	const simd::float8 smallest = simd::set1x8(std::numeric_limits<float>::min());
+	for (size_t b = 0; b < in.blockCount(); b++) {
+		const soa::vector3Block<float>& src = in.blocks[b];
+		soa::vector3Block<float>& dst = out.blocks[b];
+		simd::float8 x = simd::load8(src.x), y = simd::load8(src.y), z = simd::load8(src.z);
+		simd::float8 lengthSquared = simd::add(simd::add(simd::mul(x, x), simd::mul(y, y)), simd::mul(z, z));
+		simd::float8 scale = detail::rsqrt(simd::max(lengthSquared, smallest));
+		simd::store(dst.x, simd::mul(x, scale));
+		simd::store(dst.y, simd::mul(y, scale));
+		simd::store(dst.z, simd::mul(z, scale));
+	}
+}
+
+} // namespace fast
+} // namespace lm2
@@ -0,0 +1,216 @@
+/*
+* GPU buffer layouts for lm2
+*
+* Aligned variants of the vector and matrix types, with the base alignment GLSL / Slang gives
+* them in uniform and storage buffers, and std140 / std430 arrays whose element stride matches
+* the GPU. std140::layout and std430::layout compute the offset of every member of a buffer
+* struct from the rules, so CPU side structs can be checked at compile time:
+*
+*   using MeshLayout = lm2::std140::layout<lm2::mat4, lm2::vec3, float>;
+*   static_assert(offsetof(MeshUB, tint) == MeshLayout::offset(1));
+*   static_assert(sizeof(MeshUB) == MeshLayout::size);
+*
+* Matrices are laid out as an array of their rows, so they reach the GPU in the same order as a
+* memcpy of a plain lm2 matrix. A vec3 is 12 bytes on the GPU but alignedVec3 is 16 in C++, so a
+* scalar that the GPU packs right after a vec3 ends up 4 bytes off. The offset checks catch that.
+* Nested structs are not handled by layout.
+*/
+#pragma once
+
+#include "lm2.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+
+namespace lm2 {
+
+// Aligned variants, usable wherever the plain types are
+template<typename T>
+struct alignas(2 * sizeof(T)) alignedVector2D : vector2D<T> {
+	constexpr alignedVector2D() noexcept : vector2D<T>{} {}
+	constexpr alignedVector2D(T x, T y) noexcept : vector2D<T>{ x, y } {}
+	constexpr alignedVector2D(vector2D<T> v) noexcept : vector2D<T>(v) {}
+};
+
+template<typename T>
+struct alignas(4 * sizeof(T)) alignedVector3D : vector3D<T> {
+	constexpr alignedVector3D() noexcept : vector3D<T>{} {}
+	constexpr alignedVector3D(T x, T y, T z) noexcept : vector3D<T>{ x, y, z } {}
+	constexpr alignedVector3D(vector3D<T> v) noexcept : vector3D<T>(v) {}
+};
+
+template<typename T>
+struct alignas(4 * sizeof(T)) alignedVector4D : vector4D<T> {
+	constexpr alignedVector4D() noexcept : vector4D<T>{} {}
+	constexpr alignedVector4D(T x, T y, T z, T w) noexcept : vector4D<T>{ x, y, z, w } {}
+	constexpr alignedVector4D(vector4D<T> v) noexcept : vector4D<T>(v) {}
+};
+
+// Rows padded to 4 components
+template<typename T>
+struct alignedMatrix3x3 {
+	alignedVector3D<T> x, y, z;
+
+	constexpr alignedMatrix3x3() noexcept = default;
+	constexpr alignedMatrix3x3(const matrix3x3<T>& m) noexcept : x(m.x), y(m.y), z(m.z) {}
+
+	constexpr operator matrix3x3<T>() const noexcept {
+		return { x, y, z };
+	}
+};
+
+template<typename T>
+struct alignas(4 * sizeof(T)) alignedMatrix4x4 : matrix4x4<T> {
+	constexpr alignedMatrix4x4() noexcept : matrix4x4<T>{} {}
+	constexpr alignedMatrix4x4(const matrix4x4<T>& m) noexcept : matrix4x4<T>(m) {}
+};
+
+using alignedVec2 = alignedVector2D<float>;
+using alignedVec3 = alignedVector3D<float>;
+using alignedVec4 = alignedVector4D<float>;
+using alignedMat3 = alignedMatrix3x3<float>;
+using alignedMat4 = alignedMatrix4x4<float>;
+
+static_assert(sizeof(alignedVec3) == 16 && alignof(alignedVec3) == 16);
+static_assert(sizeof(alignedMat3) == 48 && alignof(alignedMat3) == 16);
+static_assert(sizeof(alignedMat4) == 64 && alignof(alignedMat4) == 16);
+
+namespace detail {
+enum class layoutRules {
+	std140,
+	std430,
+};
+
+constexpr size_t roundUp(size_t value, size_t alignment) noexcept {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+// Base alignment and size of a type on the GPU
+// Scalars, bool is 4 bytes on the GPU and has no matching C++ type
+template<layoutRules Rules, typename T>
+struct layoutOf {
+	static_assert(std::is_arithmetic_v<T> && !std::is_same_v<T, bool> && sizeof(T) >= 4, "type has no GPU layout");
+	static constexpr size_t alignment = sizeof(T);
+	static constexpr size_t size = sizeof(T);
+};
+
+// Arrays, std140 rounds the element alignment up to 16 bytes
+template<layoutRules Rules, typename T, size_t N>
+struct arrayLayout {
+	static constexpr size_t alignment = Rules == layoutRules::std140 ? roundUp(layoutOf<Rules, T>::alignment, 16) : layoutOf<Rules, T>::alignment;
+	static constexpr size_t stride = roundUp(layoutOf<Rules, T>::size, alignment);
+	static constexpr size_t size = stride * N;
+};
+
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, vector2D<T>> {
+	static constexpr size_t alignment = 2 * layoutOf<Rules, T>::size;
+	static constexpr size_t size = 2 * layoutOf<Rules, T>::size;
+};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, vector3D<T>> {
+	static constexpr size_t alignment = 4 * layoutOf<Rules, T>::size;
+	static constexpr size_t size = 3 * layoutOf<Rules, T>::size;
+};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, vector4D<T>> {
+	static constexpr size_t alignment = 4 * layoutOf<Rules, T>::size;
+	static constexpr size_t size = 4 * layoutOf<Rules, T>::size;
+};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, matrix3x3<T>> : arrayLayout<Rules, vector3D<T>, 3> {};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, matrix3x4<T>> : arrayLayout<Rules, vector4D<T>, 3> {};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, matrix4x4<T>> : arrayLayout<Rules, vector4D<T>, 4> {};
+
+// The aligned variants only change the C++ side
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, alignedVector2D<T>> : layoutOf<Rules, vector2D<T>> {};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, alignedVector3D<T>> : layoutOf<Rules, vector3D<T>> {};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, alignedVector4D<T>> : layoutOf<Rules, vector4D<T>> {};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, alignedMatrix3x3<T>> : layoutOf<Rules, matrix3x3<T>> {};
+template<layoutRules Rules, typename T>
+struct layoutOf<Rules, alignedMatrix4x4<T>> : layoutOf<Rules, matrix4x4<T>> {};
+
+template<layoutRules Rules, typename T, size_t N>
+struct layoutOf<Rules, T[N]> : arrayLayout<Rules, T, N> {};
+
+// Array with the element stride of Rules, elements are padded in C++ to match
+template<layoutRules Rules, typename T, size_t N>
+struct layoutArray {
+	struct alignas(arrayLayout<Rules, T, N>::alignment) element {
+		T value;
+	};
+	static_assert(sizeof(element) == arrayLayout<Rules, T, N>::stride, "element does not match the GPU stride, use the aligned lm2 types");
+
+	element elements[N];
+
+	constexpr T& operator[](size_t i) noexcept { return elements[i].value; }
+	constexpr const T& operator[](size_t i) const noexcept { return elements[i].value; }
+	static constexpr size_t size() noexcept { return N; }
+};
+
+template<layoutRules Rules, typename T, size_t N>
+struct layoutOf<Rules, layoutArray<Rules, T, N>> : arrayLayout<Rules, T, N> {};
+
+// Offset of member index of a struct made of Members in order, index == count gives the end of the last member
+template<layoutRules Rules, typename... Members>
+constexpr size_t memberOffset(size_t index) noexcept {
+	constexpr size_t alignments[] = { layoutOf<Rules, Members>::alignment... };
+	constexpr size_t sizes[] = { layoutOf<Rules, Members>::size... };
+	size_t current = 0;
+	for (size_t i = 0; i < index; i++) {
+		current = roundUp(current, alignments[i]) + sizes[i];
+	}
+	return index < sizeof...(Members) ? roundUp(current, alignments[index]) : current;
+}
+
+// std140 rounds the struct alignment up to 16 bytes
+template<layoutRules Rules, typename... Members>
+constexpr size_t structAlignment() noexcept {
+	size_t result = Rules == layoutRules::std140 ? 16 : 1;
+	for (size_t alignment : { layoutOf<Rules, Members>::alignment... }) {
+		result = alignment > result ? alignment : result;
+	}
+	return result;
+}
+
+template<layoutRules Rules, typename... Members>
+struct structLayout {
+	static_assert(sizeof...(Members) > 0, "layout needs at least one member");
+
+	static constexpr size_t count = sizeof...(Members);
+	static constexpr size_t alignment = structAlignment<Rules, Members...>();
+	static constexpr size_t size = roundUp(memberOffset<Rules, Members...>(count), alignment);
+
+	static constexpr size_t offset(size_t index) noexcept {
+		return memberOffset<Rules, Members...>(index);
+	}
+};
+} // namespace detail
+
+// Uniform buffers
+namespace std140 {
+template<typename... Members>
+using layout = detail::structLayout<detail::layoutRules::std140, Members...>;
+
+template<typename T, size_t N>
+using array = detail::layoutArray<detail::layoutRules::std140, T, N>;
+} // namespace std140
+
+// Storage buffers and push constants
+namespace std430 {
+template<typename... Members>
+using layout = detail::structLayout<detail::layoutRules::std430, Members...>;
+
+template<typename T, size_t N>
+using array = detail::layoutArray<detail::layoutRules::std430, T, N>;
+} // namespace std430
+
+} // namespace lm2
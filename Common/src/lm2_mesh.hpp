@@ -0,0 +1,385 @@
+/*
+* Mesh processing for lm2: vertex normals, tangent frames and vertex welding
+*
+* computeNormals sums the normal of every triangle into its three vertices, weighted by area, by
+* the angle of the triangle at the vertex or by both. computeTangents follows the MikkTSpace
+* conventions: per vertex the tangent is the angle weighted sum of the triangle tangents projected
+* onto the plane of the vertex normal, w holds the bitangent sign so that
+* bitangent = w * cross(normal, tangent.xyz). Vertices shared by triangles with mirrored uvs must be
+* split first, as MikkTSpace does, weld with the uv orientation in the key for that.
+*
+* Triangles are handled 8 at a time with lm2_simd kernels. Instead of adding into shared vertices,
+* corners are sorted by vertex (radixSort) and every vertex sums its own corners in corner order,
+* so the results are the same for any threadPool or none.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_fast.hpp"
+#include "lm2_morton.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_simd.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace lm2 {
+namespace mesh {
+
+// What a triangle normal is weighted by when summed into a vertex normal
+enum class normalWeight {
+	area,
+	angle,
+	areaAngle,
+};
+
+namespace detail {
+constexpr size_t lanes = 8;
+
+inline uint32_t cornerVertex(const uint32_t* indices, size_t corner) noexcept {
+	return indices ? indices[corner] : static_cast<uint32_t>(corner);
+}
+
+template<typename V>
+const V& attributeAt(const V* data, size_t stride, size_t vertex) noexcept {
+	return *reinterpret_cast<const V*>(reinterpret_cast<const unsigned char*>(data) + vertex * (stride ? stride : sizeof(V)));
+}
+template<typename V>
+V& attributeAt(V* data, size_t stride, size_t vertex) noexcept {
+	return *reinterpret_cast<V*>(reinterpret_cast<unsigned char*>(data) + vertex * (stride ? stride : sizeof(V)));
+}
+
+// Corners of vertex v are corners[offsets[v]..offsets[v + 1]], in ascending order
+struct adjacency {
+	std::vector<uint32_t> offsets;
+	std::vector<uint32_t> corners;
+};
+
+inline void buildAdjacency(const uint32_t* indices, size_t cornerCount, size_t vertexCount, threadPool* pool, adjacency& out) {
+	std::vector<uint32_t> keys(cornerCount);
+	out.corners.resize(cornerCount);
+	size_t chunks = lm2::detail::chunkCount(pool, cornerCount, parallel::minChunkSize);
+	lm2::detail::forChunks(pool, chunks, cornerCount, [&](size_t, size_t begin, size_t end) {
+		for (size_t c = begin; c < end; c++) {
+			keys[c] = cornerVertex(indices, c);
+			out.corners[c] = static_cast<uint32_t>(c);
+		}
+	});
+	// Stable, equal vertices keep their corners in order
+	radixSort(keys.data(), out.corners.data(), cornerCount, pool);
+
+	// offsets[v] is the first sorted corner of a vertex >= v, every entry is written by one i
+	out.offsets.resize(vertexCount + 1);
+	lm2::detail::forChunks(pool, chunks, cornerCount + 1, [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			size_t low = i == 0 ? 0 : size_t(keys[i - 1]) + 1;
+			size_t high = i == cornerCount ? vertexCount : keys[i];
+			for (size_t v = low; v <= high; v++) {
+				out.offsets[v] = static_cast<uint32_t>(i);
+			}
+		}
+	});
+}
+
+// Corners of 8 triangles, corner[k][axis][lane]; lanes past the last triangle stay zero
+struct triangleLanes {
+	float position[3][3][lanes] = {};
+	float uv[3][2][lanes] = {};
+};
+
+inline size_t gatherTriangles(const vector3D<float>* positions, const vector2D<float>* uvs, size_t stride, const uint32_t* indices,
+	size_t first, size_t triangleCount, triangleLanes& out) noexcept {
+	size_t count = triangleCount - first < lanes ? triangleCount - first : lanes;
+	for (size_t l = 0; l < count; l++) {
+		for (size_t k = 0; k < 3; k++) {
+			uint32_t vertex = cornerVertex(indices, (first + l) * 3 + k);
+			const vector3D<float>& p = attributeAt(positions, stride, vertex);
+			out.position[k][0][l] = p.x;
+			out.position[k][1][l] = p.y;
+			out.position[k][2][l] = p.z;
+			if (uvs) {
+				const vector2D<float>& t = attributeAt(uvs, stride, vertex);
+				out.uv[k][0][l] = t.x;
+				out.uv[k][1][l] = t.y;
+			}
+		}
+	}
+	return count;
+}
+
+// Edges and normal of 8 triangles, and the angle at every corner
+struct faceLanes {
+	simd::float8 e1[3], e2[3];
+	simd::float8 normal[3];
+	simd::float8 length;
+	simd::float8 angle[3];
+};
+
+inline void faceKernel(const triangleLanes& t, faceLanes& out) {
+	simd::float8 a[3], e3[3];
+	for (int axis = 0; axis < 3; axis++) {
+		a[axis] = simd::load8(t.position[0][axis]);
+		out.e1[axis] = simd::sub(simd::load8(t.position[1][axis]), a[axis]);
+		out.e2[axis] = simd::sub(simd::load8(t.position[2][axis]), a[axis]);
+		e3[axis] = simd::sub(out.e2[axis], out.e1[axis]);
+	}
+	const simd::float8* e1 = out.e1;
+	const simd::float8* e2 = out.e2;
+	out.normal[0] = simd::sub(simd::mul(e1[1], e2[2]), simd::mul(e1[2], e2[1]));
+	out.normal[1] = simd::sub(simd::mul(e1[2], e2[0]), simd::mul(e1[0], e2[2]));
+	out.normal[2] = simd::sub(simd::mul(e1[0], e2[1]), simd::mul(e1[1], e2[0]));
+	out.length = simd::sqrt(simd::add(simd::add(simd::mul(out.normal[0], out.normal[0]), simd::mul(out.normal[1], out.normal[1])),
+		simd::mul(out.normal[2], out.normal[2])));
+
+	// |cross| is twice the area for every pair of edges, so angle = atan2(length, dot of the edges)
+	auto dot = [](const simd::float8* u, const simd::float8* v) {
+		return simd::add(simd::add(simd::mul(u[0], v[0]), simd::mul(u[1], v[1])), simd::mul(u[2], v[2]));
+	};
+	out.angle[0] = fast::detail::atan2(out.length, dot(e1, e2));
+	out.angle[1] = fast::detail::atan2(out.length, simd::sub(simd::zero8(), dot(e1, e3)));
+	out.angle[2] = fast::detail::atan2(out.length, dot(e2, e3));
+}
+
+// Weighted triangle normal at every corner, 3i + k for corner k of triangle i
+inline void cornerNormals(const vector3D<float>* positions, size_t stride, const uint32_t* indices, size_t triangleCount,
+	normalWeight weight, threadPool* pool, std::vector<vector3D<float>>& out) {
+	out.resize(triangleCount * 3);
+	size_t blockCount = (triangleCount + lanes - 1) / lanes;
+	size_t chunks = lm2::detail::chunkCount(pool, blockCount, parallel::minChunkSize);
+	lm2::detail::forChunks(pool, chunks, blockCount, [&](size_t, size_t begin, size_t end) {
+		for (size_t block = begin; block < end; block++) {
+			triangleLanes t;
+			size_t count = gatherTriangles(positions, nullptr, stride, indices, block * lanes, triangleCount, t);
+			faceLanes f;
+			faceKernel(t, f);
+			float weighted[3][3][lanes];
+			for (int k = 0; k < 3; k++) {
+				simd::float8 scale = simd::set1x8(1.0f);
+				if (weight == normalWeight::angle) {
+					scale = simd::divChecked(f.angle[k], f.length);
+				}
+				else if (weight == normalWeight::areaAngle) {
+					scale = f.angle[k];
+				}
+				for (int axis = 0; axis < 3; axis++) {
+					simd::store(weighted[k][axis], simd::mul(f.normal[axis], scale));
+				}
+			}
+			for (size_t l = 0; l < count; l++) {
+				for (int k = 0; k < 3; k++) {
+					out[(block * lanes + l) * 3 + k] = { weighted[k][0][l], weighted[k][1][l], weighted[k][2][l] };
+				}
+			}
+		}
+	});
+}
+
+// Unit tangent direction of the triangle at every corner with the corner angle in w, and the
+// bitangent direction times the angle
+inline void cornerTangents(const vector3D<float>* positions, const vector2D<float>* uvs, size_t stride, const uint32_t* indices,
+	size_t triangleCount, threadPool* pool, std::vector<vector4D<float>>& outTangents, std::vector<vector3D<float>>& outBitangents) {
+	outTangents.resize(triangleCount * 3);
+	outBitangents.resize(triangleCount * 3);
+	size_t blockCount = (triangleCount + lanes - 1) / lanes;
+	size_t chunks = lm2::detail::chunkCount(pool, blockCount, parallel::minChunkSize);
+	lm2::detail::forChunks(pool, chunks, blockCount, [&](size_t, size_t begin, size_t end) {
+		const simd::float8 smallest = simd::set1x8(std::numeric_limits<float>::min());
+		for (size_t block = begin; block < end; block++) {
+			triangleLanes t;
+			size_t count = gatherTriangles(positions, uvs, stride, indices, block * lanes, triangleCount, t);
+			faceLanes f;
+			faceKernel(t, f);
+			simd::float8 u0 = simd::load8(t.uv[0][0]), v0 = simd::load8(t.uv[0][1]);
+			simd::float8 du1 = simd::sub(simd::load8(t.uv[1][0]), u0), dv1 = simd::sub(simd::load8(t.uv[1][1]), v0);
+			simd::float8 du2 = simd::sub(simd::load8(t.uv[2][0]), u0), dv2 = simd::sub(simd::load8(t.uv[2][1]), v0);
+			// Twice the signed uv area, its sign turns the directions towards +u and +v, degenerate
+			// uvs give no direction at all
+			simd::float8 r = simd::sub(simd::mul(du1, dv2), simd::mul(du2, dv1));
+			simd::float8 valid = simd::cmpNotEqual(r, simd::zero8());
+			simd::float8 sign = simd::bitOr(simd::set1x8(1.0f), simd::bitAnd(r, fast::detail::signBit8()));
+			simd::float8 tangent[3], bitangent[3];
+			for (int axis = 0; axis < 3; axis++) {
+				tangent[axis] = simd::mul(simd::sub(simd::mul(f.e1[axis], dv2), simd::mul(f.e2[axis], dv1)), sign);
+				bitangent[axis] = simd::mul(simd::sub(simd::mul(f.e2[axis], du1), simd::mul(f.e1[axis], du2)), sign);
+			}
+			auto normalizeLanes = [&](simd::float8* v) {
+				simd::float8 lengthSquared = simd::add(simd::add(simd::mul(v[0], v[0]), simd::mul(v[1], v[1])), simd::mul(v[2], v[2]));
+				simd::float8 scale = simd::bitAnd(fast::detail::rsqrt(simd::max(lengthSquared, smallest)), valid);
+				for (int axis = 0; axis < 3; axis++) {
+					v[axis] = simd::mul(v[axis], scale);
+				}
+			};
+			normalizeLanes(tangent);
+			normalizeLanes(bitangent);
+
+			float tangentOut[3][lanes], bitangentOut[3][3][lanes], angleOut[3][lanes];
+			for (int axis = 0; axis < 3; axis++) {
+				simd::store(tangentOut[axis], tangent[axis]);
+			}
+			for (int k = 0; k < 3; k++) {
+				simd::store(angleOut[k], f.angle[k]);
+				for (int axis = 0; axis < 3; axis++) {
+					simd::store(bitangentOut[k][axis], simd::mul(bitangent[axis], f.angle[k]));
+				}
+			}
+			for (size_t l = 0; l < count; l++) {
+				for (int k = 0; k < 3; k++) {
+					size_t corner = (block * lanes + l) * 3 + k;
+					outTangents[corner] = { tangentOut[0][l], tangentOut[1][l], tangentOut[2][l], angleOut[k][l] };
+					outBitangents[corner] = { bitangentOut[k][0][l], bitangentOut[k][1][l], bitangentOut[k][2][l] };
+				}
+			}
+		}
+	});
+}
+
+// Any unit vector perpendicular to unit n, Duff et al. 2017
+inline vector3D<float> perpendicular(vector3D<float> n) noexcept {
+	float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+	float a = -1.0f / (sign + n.z);
+	return { 1.0f + sign * n.x * n.x * a, sign * n.x * n.y * a, -sign * n.x };
+}
+
+// + 0.0f turns -0 into +0, so both hash the same as they compare equal
+inline uint32_t hashFloats(const float* key, size_t componentCount) noexcept {
+	uint32_t h = 0x811C9DC5u;
+	for (size_t i = 0; i < componentCount; i++) {
+		h = (h ^ std::bit_cast<uint32_t>(key[i] + 0.0f)) * 0x01000193u;
+		h ^= h >> 15;
+	}
+	h *= 0x2C1B3C6Du;
+	return h ^ (h >> 12);
+}
+
+inline bool equalFloats(const float* a, const float* b, size_t componentCount) noexcept {
+	for (size_t i = 0; i < componentCount; i++) {
+		if (a[i] != b[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+} // namespace detail
+
+// Vertex normals of triangleCount triangles over vertexCount vertices
+// Triangle i is vertices indices[3i], indices[3i + 1], indices[3i + 2], or 3i, 3i + 1, 3i + 2 without
+// indices. stride is the distance in bytes between two vertices for positions and normals, so both
+// can point into one vertex array, 0 when each is its own tightly packed array. Vertices without
+// triangles, or only degenerate ones, get a zero normal
+inline void computeNormals(const vector3D<float>* positions, size_t vertexCount, const uint32_t* indices, size_t triangleCount,
+	vector3D<float>* outNormals, normalWeight weight = normalWeight::angle, size_t stride = 0, threadPool* pool = nullptr) {
+	std::vector<vector3D<float>> corners;
+	detail::cornerNormals(positions, stride, indices, triangleCount, weight, pool, corners);
+	detail::adjacency adjacent;
+	detail::buildAdjacency(indices, triangleCount * 3, vertexCount, pool, adjacent);
+
+	size_t chunks = lm2::detail::chunkCount(pool, vertexCount, parallel::minChunkSize);
+	lm2::detail::forChunks(pool, chunks, vertexCount, [&](size_t, size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			vector3D<float> sum{};
+			for (uint32_t i = adjacent.offsets[v]; i < adjacent.offsets[v + 1]; i++) {
+				sum = sum + corners[adjacent.corners[i]];
+			}
+			detail::attributeAt(outNormals, stride, v) = normalize(sum);
+		}
+	});
+}
+
+// Tangent frames for unit vertex normals, same triangles and stride as computeNormals
+// tangent.xyz is a unit vector perpendicular to the normal pointing towards +u, tangent.w is +1 or -1
+// with bitangent = w * cross(normal, tangent.xyz) pointing towards +v. Vertices without usable uvs get
+// some tangent perpendicular to the normal and w = 1
+inline void computeTangents(const vector3D<float>* positions, const vector2D<float>* uvs, const vector3D<float>* normals,
+	size_t vertexCount, const uint32_t* indices, size_t triangleCount, vector4D<float>* outTangents, size_t stride = 0,
+	threadPool* pool = nullptr) {
+	std::vector<vector4D<float>> tangents;
+	std::vector<vector3D<float>> bitangents;
+	detail::cornerTangents(positions, uvs, stride, indices, triangleCount, pool, tangents, bitangents);
+	detail::adjacency adjacent;
+	detail::buildAdjacency(indices, triangleCount * 3, vertexCount, pool, adjacent);
+
+	size_t chunks = lm2::detail::chunkCount(pool, vertexCount, parallel::minChunkSize);
+	lm2::detail::forChunks(pool, chunks, vertexCount, [&](size_t, size_t begin, size_t end) {
+		for (size_t v = begin; v < end; v++) {
+			vector3D<float> n = detail::attributeAt(normals, stride, v);
+			vector3D<float> tangent{}, bitangent{};
+			for (uint32_t i = adjacent.offsets[v]; i < adjacent.offsets[v + 1]; i++) {
+				uint32_t corner = adjacent.corners[i];
+				vector4D<float> t = tangents[corner];
+				vector3D<float> direction{ t.x, t.y, t.z };
+				tangent = tangent + normalize(direction - n * dot(n, direction)) * t.w;
+				bitangent = bitangent + bitangents[corner];
+			}
+			tangent = normalize(tangent);
+			if (dot(tangent, tangent) == 0.0f) {
+				tangent = detail::perpendicular(n);
+			}
+			float w = dot(cross(n, tangent), bitangent) < 0.0f ? -1.0f : 1.0f;
+			detail::attributeAt(outTangents, stride, v) = { tangent.x, tangent.y, tangent.z, w };
+		}
+	});
+}
+
+// Maps every vertex to the first vertex with an equal key and returns the number of unique keys,
+// outRemap[i] <= i. key holds componentCount floats per vertex, stride bytes apart (0 when packed).
+// Components compare with ==, so -0 welds with +0 and a key containing NaN stays unique. Remapped vertices are the shared vertices computeNormals and computeTangents smooth over,
+// e.g. weld positions only for smooth normals of a triangle soup
+inline size_t weld(const float* key, size_t count, size_t componentCount, size_t stride, uint32_t* outRemap, threadPool* pool = nullptr) {
+	if (count == 0) {
+		return 0;
+	}
+	stride = stride ? stride : componentCount * sizeof(float);
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(key);
+	auto keyAt = [&](uint32_t i) {
+		return reinterpret_cast<const float*>(bytes + i * stride);
+	};
+	std::vector<uint32_t> hashes(count);
+	std::vector<uint32_t> order(count);
+	size_t chunks = lm2::detail::chunkCount(pool, count, parallel::minChunkSize);
+	lm2::detail::forChunks(pool, chunks, count, [&](size_t, size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			hashes[i] = detail::hashFloats(keyAt(static_cast<uint32_t>(i)), componentCount);
+			order[i] = static_cast<uint32_t>(i);
+		}
+	});
+	radixSort(hashes.data(), order.data(), count, pool);
+
+	// Runs of equal hashes are in ascending vertex order, every run belongs to the chunk it starts in
+	std::vector<size_t> unique(chunks);
+	lm2::detail::forChunks(pool, chunks, count, [&](size_t chunk, size_t begin, size_t end) {
+		std::vector<uint32_t> representatives;
+		for (size_t i = begin; i < end; i++) {
+			if (i > 0 && hashes[i] == hashes[i - 1]) {
+				continue;
+			}
+			representatives.clear();
+			for (size_t j = i; j < count && hashes[j] == hashes[i]; j++) {
+				uint32_t vertex = order[j];
+				uint32_t target = vertex;
+				for (uint32_t candidate : representatives) {
+					if (detail::equalFloats(keyAt(candidate), keyAt(vertex), componentCount)) {
+						target = candidate;
+						break;
+					}
+				}
+				if (target == vertex) {
+					representatives.push_back(vertex);
+				}
+				outRemap[vertex] = target;
+			}
+			unique[chunk] += representatives.size();
+		}
+	});
+	size_t total = 0;
+	for (size_t u : unique) {
+		total += u;
+	}
+	return total;
+}
+
+} // namespace mesh
+} // namespace lm2
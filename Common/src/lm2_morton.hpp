@@ -0,0 +1,256 @@
+/*
+* Morton codes and radix sort for lm2
+*
+* morton::encode interleaves 10 bits of x, y and z into a 30 bit code, morton::encode64 interleaves
+* 21 bits of each into a 63 bit code, x takes the lowest bit. morton::code quantizes a point
+* inside a box to the grid of the code, points outside the box are clamped to it.
+* The array kernels work on blocks of 8 points with the per lane loops written so the compiler
+* turns them into 8 lane float and integer SIMD.
+*
+* radixSort is a stable least significant digit sort, 8 bits per pass, that skips passes where
+* every key has the same digit. Given a threadPool every pass splits the keys into one chunk per
+* thread, the result is the same as the single threaded sort.
+*
+* morton::order sorts indices of points along the curve, so neighbouring indices are close in
+* space. Use it to reorder particles or draws for cache locality, buildLBVH in lm2_bvh.hpp builds
+* a tree on top of it.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_bounds.hpp"
+#include "lm2_parallel.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lm2 {
+
+namespace detail {
+constexpr size_t radixBits = 8;
+constexpr size_t radixBuckets = size_t(1) << radixBits;
+} // namespace detail
+
+// Sorts keys ascending and moves values[i] along with keys[i], equal keys keep their order
+template<typename Key>
+void radixSort(Key* keys, uint32_t* values, size_t count, threadPool* pool = nullptr) {
+	static_assert(std::is_unsigned_v<Key>, "radixSort needs unsigned keys");
+	if (count < 2) {
+		return;
+	}
+	size_t chunkCount = detail::chunkCount(pool, count, parallel::minChunkSize);
+
+	std::vector<Key> keyScratch(count);
+	std::vector<uint32_t> valueScratch(count);
+	// Digit counts of every chunk, turned into the write position of every digit in every chunk
+	std::vector<size_t> histograms(chunkCount * detail::radixBuckets);
+	Key* keysIn = keys;
+	Key* keysOut = keyScratch.data();
+	uint32_t* valuesIn = values;
+	uint32_t* valuesOut = valueScratch.data();
+
+	for (size_t shift = 0; shift < sizeof(Key) * 8; shift += detail::radixBits) {
+		detail::forChunks(pool, chunkCount, count, [&](size_t chunk, size_t begin, size_t end) {
+			size_t* histogram = &histograms[chunk * detail::radixBuckets];
+			std::fill(histogram, histogram + detail::radixBuckets, size_t(0));
+			for (size_t i = begin; i < end; i++) {
+				histogram[(keysIn[i] >> shift) & (detail::radixBuckets - 1)]++;
+			}
+		});
+
+		// Digit major, chunk minor order keeps equal digits in their current order
+		bool sameDigit = false;
+		size_t position = 0;
+		for (size_t digit = 0; digit < detail::radixBuckets; digit++) {
+			size_t digitCount = 0;
+			for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+				size_t& entry = histograms[chunk * detail::radixBuckets + digit];
+				size_t entryCount = entry;
+				entry = position;
+				position += entryCount;
+				digitCount += entryCount;
+			}
+			sameDigit = sameDigit || digitCount == count;
+		}
+		if (sameDigit) {
+			continue;
+		}
+
+		detail::forChunks(pool, chunkCount, count, [&](size_t chunk, size_t begin, size_t end) {
+			size_t* offsets = &histograms[chunk * detail::radixBuckets];
+			for (size_t i = begin; i < end; i++) {
+				size_t at = offsets[(keysIn[i] >> shift) & (detail::radixBuckets - 1)]++;
+				keysOut[at] = keysIn[i];
+				valuesOut[at] = valuesIn[i];
+			}
+		});
+		std::swap(keysIn, keysOut);
+		std::swap(valuesIn, valuesOut);
+	}
+
+	if (keysIn != keys) {
+		std::copy(keysIn, keysIn + count, keys);
+		std::copy(valuesIn, valuesIn + count, values);
+	}
+}
+
+namespace morton {
+
+// Bits per axis
+constexpr uint32_t bits30 = 10;
+constexpr uint32_t bits63 = 21;
+
+namespace detail {
+// Spreads the low 10 bits of v to every third bit
+constexpr uint32_t expandBits(uint32_t v) noexcept {
+	v &= 0x000003FFu;
+	v = (v | (v << 16)) & 0x030000FFu;
+	v = (v | (v << 8)) & 0x0300F00Fu;
+	v = (v | (v << 4)) & 0x030C30C3u;
+	v = (v | (v << 2)) & 0x09249249u;
+	return v;
+}
+constexpr uint32_t compactBits(uint32_t v) noexcept {
+	v &= 0x09249249u;
+	v = (v | (v >> 2)) & 0x030C30C3u;
+	v = (v | (v >> 4)) & 0x0300F00Fu;
+	v = (v | (v >> 8)) & 0x030000FFu;
+	v = (v | (v >> 16)) & 0x000003FFu;
+	return v;
+}
+// Spreads the low 21 bits of v to every third bit
+constexpr uint64_t expandBits64(uint64_t v) noexcept {
+	v &= 0x00000000001FFFFFull;
+	v = (v | (v << 32)) & 0x001F00000000FFFFull;
+	v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+	v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+	v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+	v = (v | (v << 2)) & 0x1249249249249249ull;
+	return v;
+}
+constexpr uint64_t compactBits64(uint64_t v) noexcept {
+	v &= 0x1249249249249249ull;
+	v = (v | (v >> 2)) & 0x10C30C30C30C30C3ull;
+	v = (v | (v >> 4)) & 0x100F00F00F00F00Full;
+	v = (v | (v >> 8)) & 0x001F0000FF0000FFull;
+	v = (v | (v >> 16)) & 0x001F00000000FFFFull;
+	v = (v | (v >> 32)) & 0x00000000001FFFFFull;
+	return v;
+}
+
+// Maps a box onto a grid of 2^bits cells per axis, a flat axis maps to cell 0
+struct quantizer {
+	vector3D<float> min;
+	vector3D<float> scale;
+	float last;
+
+	constexpr quantizer(aabbT<float> bounds, uint32_t bits) noexcept
+		: min(bounds.min), scale{}, last(static_cast<float>((1u << bits) - 1)) {
+		float cells = static_cast<float>(1u << bits);
+		vector3D<float> extent = bounds.max - bounds.min;
+		scale = {
+			extent.x > 0 ? cells / extent.x : 0.0f,
+			extent.y > 0 ? cells / extent.y : 0.0f,
+			extent.z > 0 ? cells / extent.z : 0.0f,
+		};
+	}
+
+	// NaN goes to cell 0
+	constexpr uint32_t cell(float value, float low, float axisScale) const noexcept {
+		float q = (value - low) * axisScale;
+		return static_cast<uint32_t>(q > 0 ? (q < last ? q : last) : 0.0f);
+	}
+};
+
+} // namespace detail
+
+constexpr uint32_t encode(uint32_t x, uint32_t y, uint32_t z) noexcept {
+	return detail::expandBits(x) | (detail::expandBits(y) << 1) | (detail::expandBits(z) << 2);
+}
+constexpr void decode(uint32_t code, uint32_t& outX, uint32_t& outY, uint32_t& outZ) noexcept {
+	outX = detail::compactBits(code);
+	outY = detail::compactBits(code >> 1);
+	outZ = detail::compactBits(code >> 2);
+}
+constexpr uint64_t encode64(uint32_t x, uint32_t y, uint32_t z) noexcept {
+	return detail::expandBits64(x) | (detail::expandBits64(y) << 1) | (detail::expandBits64(z) << 2);
+}
+constexpr void decode64(uint64_t code, uint32_t& outX, uint32_t& outY, uint32_t& outZ) noexcept {
+	outX = static_cast<uint32_t>(detail::compactBits64(code));
+	outY = static_cast<uint32_t>(detail::compactBits64(code >> 1));
+	outZ = static_cast<uint32_t>(detail::compactBits64(code >> 2));
+}
+
+// Code of a point in bounds
+constexpr uint32_t code(vector3D<float> p, aabbT<float> bounds) noexcept {
+	detail::quantizer q(bounds, bits30);
+	return encode(q.cell(p.x, q.min.x, q.scale.x), q.cell(p.y, q.min.y, q.scale.y), q.cell(p.z, q.min.z, q.scale.z));
+}
+constexpr uint64_t code64(vector3D<float> p, aabbT<float> bounds) noexcept {
+	detail::quantizer q(bounds, bits63);
+	return encode64(q.cell(p.x, q.min.x, q.scale.x), q.cell(p.y, q.min.y, q.scale.y), q.cell(p.z, q.min.z, q.scale.z));
+}
+
+namespace detail {
+template<typename Code, typename Encode>
+void codes(const vector3D<float>* points, size_t count, aabbT<float> bounds, uint32_t bits, Code* out, size_t stride, Encode encodeCell) noexcept {
+	const char* base = reinterpret_cast<const char*>(points);
+	quantizer q(bounds, bits);
+	alignas(32) float x[8], y[8], z[8];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		for (size_t l = 0; l < lanes; l++) {
+			const vector3D<float>& p = *reinterpret_cast<const vector3D<float>*>(base + (i + l) * stride);
+			x[l] = p.x;
+			y[l] = p.y;
+			z[l] = p.z;
+		}
+		Code block[8];
+		for (size_t l = 0; l < 8; l++) {
+			block[l] = encodeCell(q.cell(x[l], q.min.x, q.scale.x), q.cell(y[l], q.min.y, q.scale.y), q.cell(z[l], q.min.z, q.scale.z));
+		}
+		std::copy(block, block + lanes, out + i);
+	});
+}
+} // namespace detail
+
+// Codes of count points, stride is the distance between points in bytes
+inline void codes(const vector3D<float>* points, size_t count, aabbT<float> bounds, uint32_t* out, size_t stride = sizeof(vector3D<float>)) noexcept {
+	detail::codes(points, count, bounds, bits30, out, stride, [](uint32_t x, uint32_t y, uint32_t z) { return encode(x, y, z); });
+}
+inline void codes64(const vector3D<float>* points, size_t count, aabbT<float> bounds, uint64_t* out, size_t stride = sizeof(vector3D<float>)) noexcept {
+	detail::codes(points, count, bounds, bits63, out, stride, [](uint32_t x, uint32_t y, uint32_t z) { return encode64(x, y, z); });
+}
+
+// Indices of count points sorted along the 63 bit curve through their bounds, equal codes keep
+// their index order. outOrder needs count entries
+inline void order(const vector3D<float>* points, size_t count, uint32_t* outOrder, size_t stride = sizeof(vector3D<float>), threadPool* pool = nullptr) {
+	if (count == 0) {
+		return;
+	}
+	aabbT<float> bounds = computeAABB(points, count, stride);
+	std::vector<uint64_t> keys(count);
+	auto encodeChunk = [&](size_t begin, size_t end) {
+		const char* base = reinterpret_cast<const char*>(points);
+		codes64(reinterpret_cast<const vector3D<float>*>(base + begin * stride), end - begin, bounds, keys.data() + begin, stride);
+		for (size_t i = begin; i < end; i++) {
+			outOrder[i] = static_cast<uint32_t>(i);
+		}
+	};
+	parallelFor(pool, count, parallel::minChunkSize, encodeChunk);
+	radixSort(keys.data(), outOrder, count, pool);
+}
+
+// out[i] = in[order[i]], applies an order to an array of particles, draws or any other items
+template<typename T>
+void reorder(const T* in, const uint32_t* order, size_t count, T* out) {
+	for (size_t i = 0; i < count; i++) {
+		out[i] = in[order[i]];
+	}
+}
+
+} // namespace morton
+} // namespace lm2
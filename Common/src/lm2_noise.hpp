@@ -0,0 +1,474 @@
+/*
+* Gradient and value noise for lm2
+*
+* Perlin and simplex noise in 2D, 3D and 4D, value noise in 2D, 3D and 4D, and fBm / ridged
+* fractal sums over any of them. Results are roughly in [-1, 1], ridged sums are in [0, 1].
+*
+* Lattice corners are hashed from their integer coordinates and the seed, there is no permutation
+* table, so every seed gives its own deterministic field and the kernels need no table lookups.
+* Every kernel is written as a run of branch free loops over lanes: with 8 lanes (the soa stream
+* and fillGrid paths) an optimized build turns each loop into 8 wide float and integer SIMD, the
+* scalar functions run the same code with one lane and match up to rounding.
+*
+* Coordinates have to stay within +-2^31, the lattice uses 32 bit integer cells.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_soa.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace lm2 {
+namespace noise {
+
+enum class basis {
+	perlin,
+	simplex,
+	value,
+};
+
+enum class fractal {
+	// One octave
+	none,
+	// Sum of octaves with growing frequency and shrinking amplitude
+	fbm,
+	// Sum of (1 - |noise|)^2, sharp crests for mountain ranges
+	ridged,
+};
+
+struct settings {
+	basis type = basis::simplex;
+	fractal mode = fractal::fbm;
+	uint32_t octaves = 5;
+	// Frequency of the first octave, every octave multiplies it by lacunarity and its amplitude by gain
+	float frequency = 1.0f;
+	float lacunarity = 2.0f;
+	float gain = 0.5f;
+	uint32_t seed = 0;
+};
+
+namespace detail {
+// lowbias32 integer hash
+constexpr uint32_t mix(uint32_t x) noexcept {
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+// Corners hash as mix(seed ^ x * primes[0] ^ y * primes[1] ...), one mix per corner instead of
+// one per axis
+constexpr uint32_t primes[4] = { 501125321u, 1136930381u, 1720413743u, 1066037191u };
+constexpr uint32_t primed(int32_t cell, size_t axis) noexcept {
+	return static_cast<uint32_t>(cell) * primes[axis];
+}
+
+constexpr int32_t floorCell(float x) noexcept {
+	int32_t i = static_cast<int32_t>(x);
+	return i - (x < static_cast<float>(i) ? 1 : 0);
+}
+constexpr float fade(float t) noexcept {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+constexpr float lerp(float a, float b, float t) noexcept {
+	return a + (b - a) * t;
+}
+// Corner value in [-1, 1) for value noise
+constexpr float hashValue(uint32_t h) noexcept {
+	return static_cast<float>(h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// Branch free select and sign flip, a branch on hash bits mispredicts half the time and keeps
+// the lane loops from vectorizing
+constexpr float pick(bool first, float a, float b) noexcept {
+	uint32_t mask = 0u - static_cast<uint32_t>(first);
+	return std::bit_cast<float>((std::bit_cast<uint32_t>(a) & mask) | (std::bit_cast<uint32_t>(b) & ~mask));
+}
+constexpr float flip(float v, uint32_t bit) noexcept {
+	return std::bit_cast<float>(std::bit_cast<uint32_t>(v) ^ ((bit & 1u) << 31));
+}
+
+// Gradient dot offset, Perlin's gradient sets picked from the low hash bits
+constexpr float gradient(uint32_t h, float x, float y) noexcept {
+	h &= 7;
+	float u = pick(h < 4, x, y);
+	float v = pick(h < 4, y, x);
+	return flip(u, h) + flip(v, h >> 1) * 2.0f;
+}
+constexpr float gradient(uint32_t h, float x, float y, float z) noexcept {
+	h &= 15;
+	float u = pick(h < 8, x, y);
+	float v = pick(h < 4, y, pick((h | 2) == 14, x, z));
+	return flip(u, h) + flip(v, h >> 1);
+}
+constexpr float gradient(uint32_t h, float x, float y, float z, float w) noexcept {
+	h &= 31;
+	float u = pick(h < 24, x, y);
+	float v = pick(h < 16, y, z);
+	float t = pick(h < 8, z, w);
+	return flip(u, h) + flip(v, h >> 1) + flip(t, h >> 2);
+}
+// Gradient of lane l, offsets stored as D lane arrays
+template<size_t D, size_t N>
+constexpr float gradient(uint32_t h, const float (&offset)[D][N], size_t l) noexcept {
+	if constexpr (D == 2) {
+		return gradient(h, offset[0][l], offset[1][l]);
+	}
+	else if constexpr (D == 3) {
+		return gradient(h, offset[0][l], offset[1][l], offset[2][l]);
+	}
+	else {
+		return gradient(h, offset[0][l], offset[1][l], offset[2][l], offset[3][l]);
+	}
+}
+
+// Per dimension constants, scales bring every kernel to about [-1, 1]
+template<size_t D>
+struct constants;
+template<>
+struct constants<2> {
+	static constexpr float perlinScale = 0.507f;
+	static constexpr float skew = 0.366025403784f;
+	static constexpr float unskew = 0.211324865405f;
+	static constexpr float radius = 0.5f;
+	static constexpr float simplexScale = 40.0f;
+};
+template<>
+struct constants<3> {
+	static constexpr float perlinScale = 0.936f;
+	static constexpr float skew = 1.0f / 3.0f;
+	static constexpr float unskew = 1.0f / 6.0f;
+	static constexpr float radius = 0.6f;
+	static constexpr float simplexScale = 32.0f;
+};
+template<>
+struct constants<4> {
+	static constexpr float perlinScale = 0.87f;
+	static constexpr float skew = 0.309016994375f;
+	static constexpr float unskew = 0.138196601125f;
+	static constexpr float radius = 0.6f;
+	static constexpr float simplexScale = 27.0f;
+};
+
+// Lattice noise on N lanes of D coordinate arrays, Perlin with Gradient set and value noise without.
+// Every step is a loop over lanes so each one vectorizes on its own
+template<bool Gradient, size_t N, size_t D>
+void lattice(const float* const (&p)[D], uint32_t seed, float* out) noexcept {
+	constexpr size_t corners = size_t(1) << D;
+	int32_t cell[D][N];
+	float f[D][N], s[D][N];
+	for (size_t axis = 0; axis < D; axis++) {
+		for (size_t l = 0; l < N; l++) {
+			cell[axis][l] = floorCell(p[axis][l]);
+			f[axis][l] = p[axis][l] - static_cast<float>(cell[axis][l]);
+			s[axis][l] = fade(f[axis][l]);
+		}
+	}
+	// Bit a of a corner index is its step along axis a. Hashing every corner before using any
+	// keeps one sample's corners in one vector when N is 1
+	uint32_t h[corners][N];
+	for (size_t corner = 0; corner < corners; corner++) {
+		for (size_t l = 0; l < N; l++) {
+			h[corner][l] = seed;
+		}
+		for (size_t axis = 0; axis < D; axis++) {
+			uint32_t step = ((corner >> axis) & 1) ? primes[axis] : 0u;
+			for (size_t l = 0; l < N; l++) {
+				h[corner][l] ^= primed(cell[axis][l], axis) + step;
+			}
+		}
+		for (size_t l = 0; l < N; l++) {
+			h[corner][l] = mix(h[corner][l]);
+		}
+	}
+	float c[corners][N];
+	for (size_t corner = 0; corner < corners; corner++) {
+		if constexpr (Gradient) {
+			float offset[D][N];
+			for (size_t axis = 0; axis < D; axis++) {
+				float step = static_cast<float>((corner >> axis) & 1);
+				for (size_t l = 0; l < N; l++) {
+					offset[axis][l] = f[axis][l] - step;
+				}
+			}
+			for (size_t l = 0; l < N; l++) {
+				c[corner][l] = gradient(h[corner][l], offset, l);
+			}
+		}
+		else {
+			for (size_t l = 0; l < N; l++) {
+				c[corner][l] = hashValue(h[corner][l]);
+			}
+		}
+	}
+	// Collapse one axis at a time
+	for (size_t axis = 0; axis < D; axis++) {
+		size_t count = corners >> (axis + 1);
+		for (size_t pair = 0; pair < count; pair++) {
+			for (size_t l = 0; l < N; l++) {
+				c[pair][l] = lerp(c[pair * 2][l], c[pair * 2 + 1][l], s[axis][l]);
+			}
+		}
+	}
+	for (size_t l = 0; l < N; l++) {
+		out[l] = Gradient ? c[0][l] * constants<D>::perlinScale : c[0][l];
+	}
+}
+
+// Simplex noise on N lanes of D coordinate arrays, Gustavson's formulation with the corner order
+// taken from the rank of every axis so there are no branches
+template<size_t N, size_t D>
+void simplex(const float* const (&p)[D], uint32_t seed, float* out) noexcept {
+	using k = constants<D>;
+	float skew[N] = {}, unskew[N] = {}, sum[N] = {};
+	for (size_t axis = 0; axis < D; axis++) {
+		for (size_t l = 0; l < N; l++) {
+			skew[l] += p[axis][l];
+		}
+	}
+	int32_t cell[D][N];
+	for (size_t axis = 0; axis < D; axis++) {
+		for (size_t l = 0; l < N; l++) {
+			cell[axis][l] = floorCell(p[axis][l] + skew[l] * k::skew);
+			unskew[l] += static_cast<float>(cell[axis][l]);
+		}
+	}
+	float origin[D][N];
+	for (size_t axis = 0; axis < D; axis++) {
+		for (size_t l = 0; l < N; l++) {
+			origin[axis][l] = p[axis][l] - (static_cast<float>(cell[axis][l]) - unskew[l] * k::unskew);
+		}
+	}
+	// Ranks are a permutation of 0..D-1, ties go to the earlier axis
+	int32_t rank[D][N] = {};
+	for (size_t a = 0; a < D; a++) {
+		for (size_t b = 0; b < D; b++) {
+			if (b < a) {
+				for (size_t l = 0; l < N; l++) {
+					rank[a][l] += origin[a][l] >= origin[b][l] ? 1 : 0;
+				}
+			}
+			else if (b > a) {
+				for (size_t l = 0; l < N; l++) {
+					rank[a][l] += origin[a][l] > origin[b][l] ? 1 : 0;
+				}
+			}
+		}
+	}
+	// Corner c steps along the c axes with the largest offsets
+	for (size_t corner = 0; corner <= D; corner++) {
+		int32_t threshold = static_cast<int32_t>(D - corner);
+		float shift = static_cast<float>(corner) * k::unskew;
+		float offset[D][N], t[N];
+		uint32_t h[N];
+		for (size_t l = 0; l < N; l++) {
+			t[l] = k::radius;
+			h[l] = seed;
+		}
+		for (size_t axis = 0; axis < D; axis++) {
+			for (size_t l = 0; l < N; l++) {
+				int32_t step = rank[axis][l] >= threshold ? 1 : 0;
+				offset[axis][l] = origin[axis][l] - static_cast<float>(step) + shift;
+				h[l] ^= primed(cell[axis][l] + step, axis);
+				t[l] -= offset[axis][l] * offset[axis][l];
+			}
+		}
+		for (size_t l = 0; l < N; l++) {
+			float falloff = pick(t[l] > 0, t[l], 0.0f);
+			falloff *= falloff;
+			sum[l] += falloff * falloff * gradient(mix(h[l]), offset, l);
+		}
+	}
+	for (size_t l = 0; l < N; l++) {
+		out[l] = sum[l] * k::simplexScale;
+	}
+}
+
+// One octave of the chosen basis on N lanes of 2, 3 or 4 coordinate arrays
+template<size_t N, size_t D>
+void basisLanes(basis type, const float* const (&p)[D], uint32_t seed, float* out) noexcept {
+	static_assert(D >= 2 && D <= 4, "noise is 2D, 3D or 4D");
+	switch (type) {
+	case basis::perlin: lattice<true, N, D>(p, seed, out); break;
+	case basis::simplex: simplex<N, D>(p, seed, out); break;
+	case basis::value: lattice<false, N, D>(p, seed, out); break;
+	}
+}
+
+// Fractal sum on N lanes, normalized by the sum of the octave amplitudes
+template<size_t N, size_t D>
+void sampleLanes(const settings& s, const float* const (&p)[D], float* out) noexcept {
+	uint32_t octaves = s.mode == fractal::none ? 1 : (s.octaves > 0 ? s.octaves : 1);
+	float scaled[D][N];
+	const float* scaledLanes[D];
+	for (size_t axis = 0; axis < D; axis++) {
+		scaledLanes[axis] = scaled[axis];
+	}
+	float octave[N];
+	float sum[N] = {};
+	float frequency = s.frequency;
+	float amplitude = 1.0f;
+	float total = 0.0f;
+	for (uint32_t o = 0; o < octaves; o++) {
+		for (size_t axis = 0; axis < D; axis++) {
+			for (size_t l = 0; l < N; l++) {
+				scaled[axis][l] = p[axis][l] * frequency;
+			}
+		}
+		// Every octave gets its own field, stacking one field on itself shows its lattice
+		basisLanes<N, D>(s.type, scaledLanes, mix(s.seed + o), octave);
+		if (s.mode == fractal::ridged) {
+			for (size_t l = 0; l < N; l++) {
+				float ridge = 1.0f - flip(octave[l], octave[l] < 0);
+				sum[l] += ridge * ridge * amplitude;
+			}
+		}
+		else {
+			for (size_t l = 0; l < N; l++) {
+				sum[l] += octave[l] * amplitude;
+			}
+		}
+		total += amplitude;
+		frequency *= s.lacunarity;
+		amplitude *= s.gain;
+	}
+	float scale = total > 0 ? 1.0f / total : 0.0f;
+	for (size_t l = 0; l < N; l++) {
+		out[l] = sum[l] * scale;
+	}
+}
+} // namespace detail
+
+// Single samples
+inline float perlin(vector2D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[2] = { &p.x, &p.y };
+	float out;
+	detail::lattice<true, 1, 2>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float perlin(vector3D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[3] = { &p.x, &p.y, &p.z };
+	float out;
+	detail::lattice<true, 1, 3>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float perlin(vector4D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[4] = { &p.x, &p.y, &p.z, &p.w };
+	float out;
+	detail::lattice<true, 1, 4>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float simplex(vector2D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[2] = { &p.x, &p.y };
+	float out;
+	detail::simplex<1, 2>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float simplex(vector3D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[3] = { &p.x, &p.y, &p.z };
+	float out;
+	detail::simplex<1, 3>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float simplex(vector4D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[4] = { &p.x, &p.y, &p.z, &p.w };
+	float out;
+	detail::simplex<1, 4>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float value(vector2D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[2] = { &p.x, &p.y };
+	float out;
+	detail::lattice<false, 1, 2>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float value(vector3D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[3] = { &p.x, &p.y, &p.z };
+	float out;
+	detail::lattice<false, 1, 3>(lanes, detail::mix(seed), &out);
+	return out;
+}
+inline float value(vector4D<float> p, uint32_t seed = 0) noexcept {
+	const float* const lanes[4] = { &p.x, &p.y, &p.z, &p.w };
+	float out;
+	detail::lattice<false, 1, 4>(lanes, detail::mix(seed), &out);
+	return out;
+}
+
+// Basis and fractal sum picked by settings
+inline float sample(const settings& s, vector2D<float> p) noexcept {
+	const float* const lanes[2] = { &p.x, &p.y };
+	float out;
+	detail::sampleLanes<1, 2>(s, lanes, &out);
+	return out;
+}
+inline float sample(const settings& s, vector3D<float> p) noexcept {
+	const float* const lanes[3] = { &p.x, &p.y, &p.z };
+	float out;
+	detail::sampleLanes<1, 3>(s, lanes, &out);
+	return out;
+}
+inline float sample(const settings& s, vector4D<float> p) noexcept {
+	const float* const lanes[4] = { &p.x, &p.y, &p.z, &p.w };
+	float out;
+	detail::sampleLanes<1, 4>(s, lanes, &out);
+	return out;
+}
+
+// Streams, 8 samples per block
+inline void sample(const settings& s, const soa::vec2Stream& in, soa::floatStream& out) {
+	out.resize(in.size());
+	for (size_t i = 0; i < in.blockCount(); i++) {
+		const float* const lanes[2] = { in.blocks[i].x, in.blocks[i].y };
+		detail::sampleLanes<soa::blockSize, 2>(s, lanes, out.blocks[i].v);
+	}
+}
+inline void sample(const settings& s, const soa::vec3Stream& in, soa::floatStream& out) {
+	out.resize(in.size());
+	for (size_t i = 0; i < in.blockCount(); i++) {
+		const float* const lanes[3] = { in.blocks[i].x, in.blocks[i].y, in.blocks[i].z };
+		detail::sampleLanes<soa::blockSize, 3>(s, lanes, out.blocks[i].v);
+	}
+}
+inline void sample(const settings& s, const soa::vec4Stream& in, soa::floatStream& out) {
+	out.resize(in.size());
+	for (size_t i = 0; i < in.blockCount(); i++) {
+		const float* const lanes[4] = { in.blocks[i].x, in.blocks[i].y, in.blocks[i].z, in.blocks[i].w };
+		detail::sampleLanes<soa::blockSize, 4>(s, lanes, out.blocks[i].v);
+	}
+}
+
+// Heightfields and textures: out[y * width + x] = sample(s, origin + spacing * (x, y)), rows are
+// split across the pool
+inline void fillGrid(const settings& s, vector2D<float> origin, vector2D<float> spacing, size_t width, size_t height, float* out, threadPool* pool = nullptr) {
+	auto fillRows = [&](size_t begin, size_t end) {
+		float x[soa::blockSize], y[soa::blockSize];
+		const float* const lanes[2] = { x, y };
+		float values[soa::blockSize];
+		for (size_t r = begin; r < end; r++) {
+			float* row = out + r * width;
+			float rowY = origin.y + spacing.y * static_cast<float>(static_cast<int32_t>(r));
+			for (size_t column = 0; column < width; column += soa::blockSize) {
+				for (size_t l = 0; l < soa::blockSize; l++) {
+					x[l] = origin.x + spacing.x * static_cast<float>(static_cast<int32_t>(column + l));
+					y[l] = rowY;
+				}
+				detail::sampleLanes<soa::blockSize, 2>(s, lanes, values);
+				size_t lanesUsed = width - column < soa::blockSize ? width - column : soa::blockSize;
+				for (size_t l = 0; l < lanesUsed; l++) {
+					row[column + l] = values[l];
+				}
+			}
+		}
+	};
+	// Rows are cheap to split, a few rows per chunk keeps every thread busy
+	parallelFor(pool, height, 4, fillRows);
+}
+
+} // namespace noise
+} // namespace lm2
@@ -0,0 +1,361 @@
+/*
+* Oriented bounding boxes for lm2
+*
+* Boxes are fitted with principal component analysis: the eigenvectors of the point covariance
+* (lm2::eigenSymmetric) are the box axes and the points projected on them give its size. PCA axes
+* drift on sampled or unevenly tessellated shapes, so the box is then turned about each axis to the
+* smallest rectangle around the points extremal along 13 directions, and the tightest of the PCA,
+* refined and axis aligned boxes is kept. Every box contains all of its points.
+* computeOBBs fits many point sets at once, every mesh of a scene or every meshlet of a mesh, and
+* spreads them over a threadPool. Results do not depend on the pool.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_bounds.hpp"
+#include "lm2_parallel.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace lm2 {
+
+template<typename T>
+struct obbT {
+	vector3D<T> center;
+	// Half size along every box axis
+	vector3D<T> extents;
+	// Columns are the box axes, a point in box space maps to center + axes * local
+	matrix3x3<T> axes;
+};
+
+using obb = obbT<float>;
+
+template<typename T>
+constexpr T volume(const obbT<T>& box) noexcept {
+	return 8 * box.extents.x * box.extents.y * box.extents.z;
+}
+// Box on the world axes
+template<typename T>
+constexpr obbT<T> aabb2obb(aabbT<T> box) noexcept {
+	return { center(box), extents(box), identity3x3<T>() };
+}
+// AABB enclosing the oriented box
+template<typename T>
+constexpr aabbT<T> obb2aabb(const obbT<T>& box) noexcept {
+	const matrix3x3<T>& a = box.axes;
+	vector3D<T> e = box.extents;
+	vector3D<T> worldExtents{
+		abs(a.x.x) * e.x + abs(a.x.y) * e.y + abs(a.x.z) * e.z,
+		abs(a.y.x) * e.x + abs(a.y.y) * e.y + abs(a.y.z) * e.z,
+		abs(a.z.x) * e.x + abs(a.z.y) * e.y + abs(a.z.z) * e.z,
+	};
+	return { box.center - worldExtents, box.center + worldExtents };
+}
+// Box space position of a world point, inside the box when every component is within extents
+template<typename T>
+constexpr vector3D<T> toBoxSpace(const obbT<T>& box, vector3D<T> point) noexcept {
+	return transpose(box.axes) * (point - box.center);
+}
+
+// Frustum test, true when the box may be visible
+// The box is projected on every plane normal, like a sphere with a per plane radius
+template<typename T>
+constexpr bool intersects(const frustumT<T>& f, const obbT<T>& box) noexcept {
+	const matrix3x3<T>& a = box.axes;
+	for (const planeT<T>& p : f.planes) {
+		T radius =
+			abs(p.normal.x * a.x.x + p.normal.y * a.y.x + p.normal.z * a.z.x) * box.extents.x +
+			abs(p.normal.x * a.x.y + p.normal.y * a.y.y + p.normal.z * a.z.y) * box.extents.y +
+			abs(p.normal.x * a.x.z + p.normal.y * a.y.z + p.normal.z * a.z.z) * box.extents.z;
+		if (signedDistance(p, box.center) < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+namespace detail {
+// Point i of a point set, read through indices when there are any
+template<typename T>
+const vector3D<T>& pointAt(const unsigned char* bytes, size_t stride, const uint32_t* indices, size_t i) noexcept {
+	size_t index = indices ? indices[i] : i;
+	return *reinterpret_cast<const vector3D<T>*>(bytes + index * stride);
+}
+
+// Sums are kept in double for float points, long meshes lose the small terms otherwise
+template<typename T>
+using covarianceSum = std::conditional_t<(sizeof(T) < sizeof(double)), double, T>;
+
+// Mean and covariance of points begin..begin + count, plus their AABB
+// Points are shifted by the first one before summing, so far away clusters keep their precision
+template<typename T>
+void covariance(const unsigned char* bytes, size_t stride, const uint32_t* indices, size_t begin, size_t count,
+	vector3D<T>& outMean, matrix3x3<T>& outCovariance, aabbT<T>& outBounds) noexcept {
+	using S = covarianceSum<T>;
+	vector3D<T> origin = pointAt<T>(bytes, stride, indices, begin);
+	S sx = 0, sy = 0, sz = 0;
+	S sxx = 0, sxy = 0, sxz = 0, syy = 0, syz = 0, szz = 0;
+	aabbT<T> bounds{ origin, origin };
+	for (size_t i = begin; i < begin + count; i++) {
+		vector3D<T> p = pointAt<T>(bytes, stride, indices, i);
+		bounds = merge(bounds, p);
+		S dx = p.x - origin.x, dy = p.y - origin.y, dz = p.z - origin.z;
+		sx += dx;
+		sy += dy;
+		sz += dz;
+		sxx += dx * dx;
+		sxy += dx * dy;
+		sxz += dx * dz;
+		syy += dy * dy;
+		syz += dy * dz;
+		szz += dz * dz;
+	}
+	S n = static_cast<S>(count);
+	S mx = sx / n, my = sy / n, mz = sz / n;
+	T xx = static_cast<T>(sxx / n - mx * mx);
+	T xy = static_cast<T>(sxy / n - mx * my);
+	T xz = static_cast<T>(sxz / n - mx * mz);
+	T yy = static_cast<T>(syy / n - my * my);
+	T yz = static_cast<T>(syz / n - my * mz);
+	T zz = static_cast<T>(szz / n - mz * mz);
+	outMean = { static_cast<T>(origin.x + mx), static_cast<T>(origin.y + my), static_cast<T>(origin.z + mz) };
+	outCovariance = {
+		{ xx, xy, xz },
+		{ xy, yy, yz },
+		{ xz, yz, zz },
+	};
+	outBounds = bounds;
+}
+
+// Box space extents of points begin..begin + count along axes, measured from origin to stay precise
+// far from the world origin
+template<typename T>
+void projectExtents(const unsigned char* bytes, size_t stride, const uint32_t* indices, size_t begin, size_t count,
+	vector3D<T> origin, const matrix3x3<T>& axes, vector3D<T>& outLow, vector3D<T>& outHigh) noexcept {
+	matrix3x3<T> toLocal = transpose(axes);
+	vector3D<T> low = toLocal * (pointAt<T>(bytes, stride, indices, begin) - origin);
+	vector3D<T> high = low;
+	for (size_t i = begin + 1; i < begin + count; i++) {
+		vector3D<T> local = toLocal * (pointAt<T>(bytes, stride, indices, i) - origin);
+		low = { local.x < low.x ? local.x : low.x, local.y < low.y ? local.y : low.y, local.z < low.z ? local.z : low.z };
+		high = { local.x > high.x ? local.x : high.x, local.y > high.y ? local.y : high.y, local.z > high.z ? local.z : high.z };
+	}
+	outLow = low;
+	outHigh = high;
+}
+
+// Directions, in box space, whose extremal points stand in for the convex hull while refining. Padded
+// to 16 lanes with repeats of the first
+constexpr int hullDirections = 13;
+constexpr int hullLanes = 16;
+constexpr float hullDirection[3][hullLanes] = {
+	{ 1, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 1, 1, 1, 1, 1 },
+	{ 0, 1, 0, 1, -1, 0, 0, 1, 1, 1, 1, -1, -1, 0, 0, 0 },
+	{ 0, 0, 1, 0, 0, 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0 },
+};
+
+// Direction (outCos, outSin) of the first side of the smallest rectangle around points (u, v), false
+// when it is not clearly smaller than the axis aligned one. One side of the smallest rectangle lies on
+// an edge of the convex hull, so every hull edge is tried
+template<typename T>
+bool smallestRectangle(const T* u, const T* v, int count, T& outCos, T& outSin) noexcept {
+	if (count < 3) {
+		return false;
+	}
+	// Gift wrapping from the leftmost point, cheap for the few points here and needs no sort
+	int start = 0;
+	for (int i = 1; i < count; i++) {
+		start = (u[i] < u[start]) | ((u[i] == u[start]) & (v[i] < v[start])) ? i : start;
+	}
+	int hull[hullDirections * 2];
+	int size = 0;
+	int current = start;
+	do {
+		hull[size++] = current;
+		int next = current == 0 ? 1 : 0;
+		T nu = u[next] - u[current], nv = v[next] - v[current];
+		for (int i = 0; i < count; i++) {
+			T iu = u[i] - u[current], iv = v[i] - v[current];
+			T turn = nu * iv - nv * iu;
+			// Clockwise of the candidate, or on its line and farther
+			bool take = (turn < 0) | ((turn == 0) & (iu * iu + iv * iv > nu * nu + nv * nv));
+			next = take ? i : next;
+			nu = take ? iu : nu;
+			nv = take ? iv : nv;
+		}
+		current = next;
+	} while (current != start && size < count);
+	T lowU = u[hull[0]], highU = lowU, lowV = v[hull[0]], highV = lowV;
+	for (int k = 1; k < size; k++) {
+		lowU = u[hull[k]] < lowU ? u[hull[k]] : lowU;
+		highU = u[hull[k]] > highU ? u[hull[k]] : highU;
+		lowV = v[hull[k]] < lowV ? v[hull[k]] : lowV;
+		highV = v[hull[k]] > highV ? v[hull[k]] : highV;
+	}
+	T aligned = (highU - lowU) * (highV - lowV);
+	T best = aligned * static_cast<T>(0.999);
+	bool found = false;
+	for (int e = 0; e < size; e++) {
+		int a = hull[e], b = hull[(e + 1) % size];
+		T du = u[b] - u[a], dv = v[b] - v[a];
+		T length = du * du + dv * dv;
+		if (length == 0) {
+			continue;
+		}
+		lowU = 0, highU = 0, lowV = 0, highV = 0;
+		for (int k = 0; k < size; k++) {
+			T ru = (u[hull[k]] - u[a]) * du + (v[hull[k]] - v[a]) * dv;
+			T rv = (v[hull[k]] - v[a]) * du - (u[hull[k]] - u[a]) * dv;
+			lowU = ru < lowU ? ru : lowU;
+			highU = ru > highU ? ru : highU;
+			lowV = rv < lowV ? rv : lowV;
+			highV = rv > highV ? rv : highV;
+		}
+		// Both sides are scaled by the edge length
+		T area = (highU - lowU) * (highV - lowV) / length;
+		if (area < best) {
+			T scale = 1 / lm2::sqrt(length);
+			best = area;
+			outCos = du * scale;
+			outSin = dv * scale;
+			found = true;
+		}
+	}
+	return found;
+}
+
+// PCA box refined by rotating it about each of its axes to the smallest rectangle around the
+// extremal points, then the AABB when that is smaller still
+template<typename T>
+obbT<T> fitOBB(const unsigned char* bytes, size_t stride, const uint32_t* indices, size_t begin, size_t count) noexcept {
+	if (count == 0) {
+		return { {}, {}, identity3x3<T>() };
+	}
+	vector3D<T> mean;
+	matrix3x3<T> cov;
+	aabbT<T> bounds;
+	covariance(bytes, stride, indices, begin, count, mean, cov, bounds);
+	vector3D<T> values;
+	matrix3x3<T> axes;
+	eigenSymmetric(cov, values, axes);
+
+	// Extremal points along every direction, kept once each in box space
+	matrix3x3<T> toLocal = transpose(axes);
+	uint32_t lowestAt[hullLanes], highestAt[hullLanes];
+	T lowest[hullLanes], highest[hullLanes];
+	vector3D<T> start = toLocal * (pointAt<T>(bytes, stride, indices, begin) - mean);
+	for (int d = 0; d < hullLanes; d++) {
+		lowest[d] = highest[d] = start.x * hullDirection[0][d] + start.y * hullDirection[1][d] + start.z * hullDirection[2][d];
+		lowestAt[d] = highestAt[d] = 0;
+	}
+	for (size_t i = 1; i < count; i++) {
+		vector3D<T> local = toLocal * (pointAt<T>(bytes, stride, indices, begin + i) - mean);
+		uint32_t at = static_cast<uint32_t>(i);
+		for (int d = 0; d < hullLanes; d++) {
+			T along = local.x * hullDirection[0][d] + local.y * hullDirection[1][d] + local.z * hullDirection[2][d];
+			lowestAt[d] = along < lowest[d] ? at : lowestAt[d];
+			lowest[d] = along < lowest[d] ? along : lowest[d];
+			highestAt[d] = along > highest[d] ? at : highestAt[d];
+			highest[d] = along > highest[d] ? along : highest[d];
+		}
+	}
+	uint32_t extremal[hullDirections * 2];
+	int n = 0;
+	for (int d = 0; d < hullDirections * 2; d++) {
+		uint32_t at = d & 1 ? highestAt[d / 2] : lowestAt[d / 2];
+		bool seen = false;
+		for (int k = 0; k < n; k++) {
+			seen = seen || extremal[k] == at;
+		}
+		if (!seen) {
+			extremal[n++] = at;
+		}
+	}
+	T hull[3][hullDirections * 2];
+	for (int k = 0; k < n; k++) {
+		vector3D<T> local = toLocal * (pointAt<T>(bytes, stride, indices, begin + extremal[k]) - mean);
+		hull[0][k] = local.x;
+		hull[1][k] = local.y;
+		hull[2][k] = local.z;
+	}
+	vector3D<T> low{ lowest[0], lowest[1], lowest[2] };
+	vector3D<T> high{ highest[0], highest[1], highest[2] };
+	obbT<T> best{ mean + axes * ((low + high) * static_cast<T>(0.5)), (high - low) * static_cast<T>(0.5), axes };
+
+	// Turning about one axis moves the other two, a few rounds settle all three
+	matrix3x3<T> refined = axes;
+	bool turned = true;
+	for (int round = 0; round < 2 && turned; round++) {
+		turned = false;
+		for (int axis = 0; axis < 3; axis++) {
+			T* u = hull[(axis + 1) % 3];
+			T* v = hull[(axis + 2) % 3];
+			T cs, sn;
+			if (!smallestRectangle(u, v, n, cs, sn)) {
+				continue;
+			}
+			turned = true;
+			// Rotate the other two axes and the extremal points with them
+			for (int i = 0; i < n; i++) {
+				T ru = u[i] * cs + v[i] * sn;
+				T rv = v[i] * cs - u[i] * sn;
+				u[i] = ru;
+				v[i] = rv;
+			}
+			matrix3x3<T> columns = transpose(refined);
+			vector3D<T>* column = &columns.x;
+			vector3D<T> first = column[(axis + 1) % 3], second = column[(axis + 2) % 3];
+			column[(axis + 1) % 3] = first * cs + second * sn;
+			column[(axis + 2) % 3] = second * cs - first * sn;
+			refined = transpose(columns);
+		}
+	}
+	projectExtents(bytes, stride, indices, begin, count, mean, refined, low, high);
+	obbT<T> candidate{ mean + refined * ((low + high) * static_cast<T>(0.5)), (high - low) * static_cast<T>(0.5), refined };
+	if (volume(candidate) < volume(best)) {
+		best = candidate;
+	}
+	obbT<T> aligned = aabb2obb(bounds);
+	return volume(aligned) <= volume(best) ? aligned : best;
+}
+} // namespace detail
+
+// Mean and covariance matrix of count points, stride is the distance in bytes between two points
+template<typename T>
+void computeCovariance(const vector3D<T>* points, size_t count, vector3D<T>& outMean, matrix3x3<T>& outCovariance,
+	size_t stride = sizeof(vector3D<T>)) noexcept {
+	if (count == 0) {
+		outMean = {};
+		outCovariance = {};
+		return;
+	}
+	aabbT<T> bounds;
+	detail::covariance<T>(reinterpret_cast<const unsigned char*>(points), stride, nullptr, 0, count, outMean, outCovariance, bounds);
+}
+
+// Box of count points, no points give an empty box at the origin
+template<typename T>
+obbT<T> computeOBB(const vector3D<T>* points, size_t count, size_t stride = sizeof(vector3D<T>)) noexcept {
+	return detail::fitOBB<T>(reinterpret_cast<const unsigned char*>(points), stride, nullptr, 0, count);
+}
+
+// Boxes per point set
+constexpr size_t obbChunkSize = 32;
+
+// One box per point set, set i is points offsets[i]..offsets[i + 1], so offsets holds boxCount + 1
+// entries. With indices the sets are ranges of indices into points instead, e.g. meshlet vertex lists
+template<typename T>
+void computeOBBs(const vector3D<T>* points, const uint32_t* offsets, size_t boxCount, obbT<T>* out,
+	size_t stride = sizeof(vector3D<T>), const uint32_t* indices = nullptr, threadPool* pool = nullptr) {
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(points);
+	auto fit = [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			out[i] = detail::fitOBB<T>(bytes, stride, indices, offsets[i], offsets[i + 1] - offsets[i]);
+		}
+	};
+	parallelFor(pool, boxCount, obbChunkSize, fit);
+}
+
+} // namespace lm2
@@ -0,0 +1,299 @@
+/*
+* Thread pool and multithreaded versions of the lm2::soa matrix array kernels
+*
+* lm2::parallel functions split the array into contiguous chunks and run the soa kernel on every
+* chunk, so each thread reads and writes its own range of memory. Results are identical to the
+* single threaded kernels. Small arrays, below minChunkSize matrices per thread, stay on the
+* calling thread since waking the workers costs more than the work.
+* Requires linking with the platform thread library (Threads::Threads in CMake).
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_soa.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace lm2 {
+
+// Fixed set of worker threads, the thread calling run works on the tasks too
+class threadPool {
+public:
+	// threadCount includes the calling thread, 0 uses every hardware thread
+	explicit threadPool(size_t threadCount = 0) {
+		if (threadCount == 0) {
+			threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+		mWorkers.reserve(threadCount - 1);
+		for (size_t i = 1; i < threadCount; i++) {
+			mWorkers.emplace_back([this] { workerLoop(); });
+		}
+	}
+	~threadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+		mWake.notify_all();
+		for (std::thread& worker : mWorkers) {
+			worker.join();
+		}
+	}
+	threadPool(const threadPool&) = delete;
+	threadPool& operator=(const threadPool&) = delete;
+
+	size_t getThreadCount() const noexcept {
+		return mWorkers.size() + 1;
+	}
+
+	// Calls task(i) for every i in [0, taskCount) and returns once all calls finished
+	// Calls from several threads at once are serialized
+	void run(size_t taskCount, const std::function<void(size_t)>& task) {
+		if (taskCount == 0) {
+			return;
+		}
+		std::lock_guard<std::mutex> runLock(mRunMutex);
+		{
+			// A worker that woke up too late for the previous run may still be looking for tasks
+			std::unique_lock<std::mutex> lock(mMutex);
+			mDone.wait(lock, [this] { return mActiveWorkers == 0; });
+			mTask = &task;
+			mTaskCount = taskCount;
+			mNextTask = 0;
+			mFinishedTasks = 0;
+			mGeneration++;
+		}
+		mWake.notify_all();
+		workOnTasks();
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		mDone.wait(lock, [this] { return mFinishedTasks == mTaskCount && mActiveWorkers == 0; });
+		mTask = nullptr;
+	}
+
+private:
+	void workerLoop() {
+		uint64_t seenGeneration = 0;
+		while (true) {
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWake.wait(lock, [&] { return mStopping || mGeneration != seenGeneration; });
+				if (mStopping) {
+					return;
+				}
+				seenGeneration = mGeneration;
+				mActiveWorkers++;
+			}
+			workOnTasks();
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+				mActiveWorkers--;
+			}
+			mDone.notify_one();
+		}
+	}
+	void workOnTasks() {
+		size_t finished = 0;
+		for (size_t i = mNextTask++; i < mTaskCount; i = mNextTask++) {
+			(*mTask)(i);
+			finished++;
+		}
+		if (finished > 0) {
+			mFinishedTasks += finished;
+		}
+	}
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mRunMutex;
+	std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mDone;
+	const std::function<void(size_t)>* mTask = nullptr;
+	size_t mTaskCount = 0;
+	std::atomic<size_t> mNextTask = 0;
+	std::atomic<size_t> mFinishedTasks = 0;
+	size_t mActiveWorkers = 0;
+	uint64_t mGeneration = 0;
+	bool mStopping = false;
+};
+
+// Calls func(begin, end) on contiguous ranges covering [0, count), at least minChunkSize long
+template<typename Func>
+void parallelFor(threadPool& pool, size_t count, size_t minChunkSize, Func func) {
+	if (count == 0) {
+		return;
+	}
+	minChunkSize = std::max<size_t>(minChunkSize, 1);
+	size_t chunks = std::min(pool.getThreadCount(), (count + minChunkSize - 1) / minChunkSize);
+	if (chunks <= 1) {
+		func(size_t(0), count);
+		return;
+	}
+	pool.run(chunks, [&](size_t chunk) {
+		func(count * chunk / chunks, count * (chunk + 1) / chunks);
+	});
+}
+// Same as above on an optional pool, without one func(0, count) runs on the calling thread
+template<typename Func>
+void parallelFor(threadPool* pool, size_t count, size_t minChunkSize, Func func) {
+	if (pool) {
+		parallelFor(*pool, count, minChunkSize, func);
+	}
+	else if (count > 0) {
+		func(size_t(0), count);
+	}
+}
+
+namespace detail {
+// One chunk per thread, none smaller than minChunkSize
+inline size_t chunkCount(const threadPool* pool, size_t count, size_t minChunkSize) noexcept {
+	if (!pool) {
+		return 1;
+	}
+	minChunkSize = std::max<size_t>(minChunkSize, 1);
+	return std::max<size_t>(std::min(pool->getThreadCount(), (count + minChunkSize - 1) / minChunkSize), 1);
+}
+
+// Calls task(chunk, begin, end) for chunkCount contiguous ranges covering [0, count), for work that
+// keeps a result per chunk, e.g. the histograms of radixSort
+template<typename Task>
+void forChunks(threadPool* pool, size_t chunkCount, size_t count, Task task) {
+	auto run = [&](size_t chunk) {
+		task(chunk, count * chunk / chunkCount, count * (chunk + 1) / chunkCount);
+	};
+	if (pool && chunkCount > 1) {
+		pool->run(chunkCount, run);
+	}
+	else {
+		run(0);
+	}
+}
+
+// Nodes sorted by depth, nodes[levelStarts[d]]..nodes[levelStarts[d + 1]] are the nodes of depth d in
+// index order. Level 0 holds the roots
+inline void hierarchyLevels(const int32_t* parents, size_t count, std::vector<uint32_t>& nodes, std::vector<size_t>& levelStarts) {
+	std::vector<uint32_t> depth(count);
+	levelStarts.assign(2, 0);
+	for (size_t i = 0; i < count; i++) {
+		depth[i] = parents[i] < 0 ? 0 : depth[parents[i]] + 1;
+		if (depth[i] + 2 >= levelStarts.size()) {
+			levelStarts.resize(depth[i] + 3, 0);
+		}
+		levelStarts[depth[i] + 2]++;
+	}
+	// Counts to starts, shifted by one so the placement below moves them to their final value
+	for (size_t d = 2; d < levelStarts.size(); d++) {
+		levelStarts[d] += levelStarts[d - 1];
+	}
+	nodes.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		nodes[levelStarts[depth[i] + 1]++] = static_cast<uint32_t>(i);
+	}
+	levelStarts.pop_back();
+}
+
+// worlds of nodes[0]..nodes[count - 1], all from the same level below the roots. Runs of consecutive
+// nodes go through the array products as one batch, reading their locals and writing their worlds in
+// place, only their parents are gathered
+template<typename Matrix>
+void composeLevel(const Matrix* local, const int32_t* parents, const uint32_t* nodes, size_t count, Matrix* worlds) {
+	constexpr size_t runSize = 64;
+	Matrix parentWorlds[runSize];
+	for (size_t i = 0; i < count;) {
+		uint32_t first = nodes[i];
+		size_t run = 0;
+		for (; run < runSize && i + run < count && nodes[i + run] == first + run; run++) {
+			parentWorlds[run] = worlds[parents[first + run]];
+		}
+		soa::multiply(parentWorlds, local + first, run, worlds + first);
+		i += run;
+	}
+}
+} // namespace detail
+
+namespace parallel {
+
+// Matrices per thread below which the work stays on one thread
+constexpr size_t minChunkSize = 1024;
+
+// shared * in[i] for every matrix, see soa::multiply
+template<typename Matrix>
+void multiply(threadPool& pool, const Matrix& shared, const Matrix* in, size_t count, Matrix* out) {
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		soa::multiply(shared, in + begin, end - begin, out + begin);
+	});
+}
+// in[i] * shared for every matrix
+template<typename Matrix>
+void multiply(threadPool& pool, const Matrix* in, const Matrix& shared, size_t count, Matrix* out) {
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		soa::multiply(in + begin, shared, end - begin, out + begin);
+	});
+}
+// a[i] * b[i] for every pair
+template<typename Matrix>
+void multiply(threadPool& pool, const Matrix* a, const Matrix* b, size_t count, Matrix* out) {
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		soa::multiply(a + begin, b + begin, end - begin, out + begin);
+	});
+}
+
+// Inverse of every matrix, see soa::inverse, soa::inverseAffine and soa::inverseRigid
+template<typename Matrix>
+void inverse(threadPool& pool, const Matrix* in, size_t count, Matrix* out) {
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		soa::inverse(in + begin, end - begin, out + begin);
+	});
+}
+template<typename T>
+void inverseAffine(threadPool& pool, const matrix4x4<T>* in, size_t count, matrix4x4<T>* out) {
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		soa::inverseAffine(in + begin, end - begin, out + begin);
+	});
+}
+template<typename Matrix>
+void inverseRigid(threadPool& pool, const Matrix* in, size_t count, Matrix* out) {
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		soa::inverseRigid(in + begin, end - begin, out + begin);
+	});
+}
+
+// World matrices of a hierarchy, see soa::composeHierarchy. The levels of the tree run one after
+// another, the nodes of every level are split across the pool. Walking the tree by level reads the
+// arrays out of order, about 3x slower per thread than the index order of soa::composeHierarchy,
+// so small hierarchies stay on the calling thread. Results are identical either way
+template<typename Matrix>
+void composeHierarchy(threadPool& pool, const Matrix* local, const int32_t* parents, size_t count, Matrix* world) {
+	if (pool.getThreadCount() < 4 || count < minChunkSize * 4) {
+		soa::composeHierarchy(local, parents, count, world);
+		return;
+	}
+	std::vector<uint32_t> nodes;
+	std::vector<size_t> levelStarts;
+	detail::hierarchyLevels(parents, count, nodes, levelStarts);
+	std::unique_ptr<Matrix[]> worlds = std::make_unique_for_overwrite<Matrix[]>(count);
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		std::copy(local + begin, local + end, worlds.get() + begin);
+	});
+	for (size_t level = 1; level + 1 < levelStarts.size(); level++) {
+		const uint32_t* levelNodes = nodes.data() + levelStarts[level];
+		parallelFor(pool, levelStarts[level + 1] - levelStarts[level], minChunkSize, [&](size_t begin, size_t end) {
+			detail::composeLevel(local, parents, levelNodes + begin, end - begin, worlds.get());
+		});
+	}
+	parallelFor(pool, count, minChunkSize, [&](size_t begin, size_t end) {
+		std::copy(worlds.get() + begin, worlds.get() + end, world + begin);
+	});
+}
+
+} // namespace parallel
+} // namespace lm2
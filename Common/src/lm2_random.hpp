@@ -0,0 +1,318 @@
+/*
+* Random numbers for lm2
+*
+* generator is xoshiro128+, generator8 runs 8 independent xoshiro128+ states side by side with
+* the state stored per lane, so one call produces 8 values and the update compiles to 8 lane
+* integer SIMD. The array functions take a generator8 and fill caller arrays 8 elements at a time.
+*
+* Seeding is deterministic: (seed, stream) goes through splitmix64, every pair gives its own
+* sequence. Lane l of generator8(seed, stream) is generator(seed, stream * 8 + l), so threads
+* working on separate chunks should use the same seed with their chunk index as the stream.
+*
+* Floats come from the top 24 bits of a draw and are uniform in [0, 1).
+* Angles use full precision pi, not lm2::PI.
+* Not for cryptography.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_simd.hpp"
+#include "lm2_fast.hpp"
+#include "lm2_soa.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace lm2 {
+namespace random {
+
+// Lanes per generator8 call
+constexpr size_t laneCount = 8;
+
+namespace detail {
+constexpr float twoPi = 6.28318530717958648f;
+
+constexpr uint64_t splitMix64(uint64_t& state) noexcept {
+	uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+constexpr uint32_t rotl(uint32_t x, int k) noexcept {
+	return (x << k) | (x >> (32 - k));
+}
+
+// Top 24 bits to [0, 1)
+constexpr float toUnitFloat(uint32_t bits) noexcept {
+	return static_cast<float>(bits >> 8) * (1.0f / 16777216.0f);
+}
+} // namespace detail
+
+// Generators
+struct generator {
+	uint32_t state[4];
+
+	constexpr explicit generator(uint64_t seed, uint64_t stream = 0) noexcept : state{} {
+		// Hash the stream first, so neighbouring streams don't start at neighbouring splitmix states
+		uint64_t streamHash = stream;
+		uint64_t mixed = seed ^ detail::splitMix64(streamHash);
+		uint64_t a = detail::splitMix64(mixed);
+		uint64_t b = detail::splitMix64(mixed);
+		state[0] = static_cast<uint32_t>(a);
+		state[1] = static_cast<uint32_t>(a >> 32);
+		state[2] = static_cast<uint32_t>(b);
+		state[3] = static_cast<uint32_t>(b >> 32);
+		// All zero is the one state xoshiro never leaves
+		if ((state[0] | state[1] | state[2] | state[3]) == 0) {
+			state[0] = 1;
+		}
+	}
+
+	constexpr uint32_t next() noexcept {
+		uint32_t result = state[0] + state[3];
+		uint32_t t = state[1] << 9;
+		state[2] ^= state[0];
+		state[3] ^= state[1];
+		state[1] ^= state[2];
+		state[0] ^= state[3];
+		state[2] ^= t;
+		state[3] = detail::rotl(state[3], 11);
+		return result;
+	}
+};
+
+struct alignas(32) generator8 {
+	uint32_t state[4][laneCount];
+
+	explicit generator8(uint64_t seed, uint64_t stream = 0) noexcept {
+		for (size_t l = 0; l < laneCount; l++) {
+			generator lane(seed, stream * laneCount + l);
+			for (size_t i = 0; i < 4; i++) {
+				state[i][l] = lane.state[i];
+			}
+		}
+	}
+
+	void next(uint32_t (&out)[laneCount]) noexcept {
+		uint32_t* s0 = state[0];
+		uint32_t* s1 = state[1];
+		uint32_t* s2 = state[2];
+		uint32_t* s3 = state[3];
+		for (size_t l = 0; l < laneCount; l++) {
+			out[l] = s0[l] + s3[l];
+			uint32_t t = s1[l] << 9;
+			s2[l] ^= s0[l];
+			s3[l] ^= s1[l];
+			s1[l] ^= s2[l];
+			s0[l] ^= s3[l];
+			s2[l] ^= t;
+			s3[l] = (s3[l] << 11) | (s3[l] >> 21);
+		}
+	}
+	// 8 floats in [0, 1)
+	void uniform(float (&out)[laneCount]) noexcept {
+		alignas(32) uint32_t bits[laneCount];
+		next(bits);
+		for (size_t l = 0; l < laneCount; l++) {
+			out[l] = detail::toUnitFloat(bits[l]);
+		}
+	}
+};
+
+// Uniform, [0, 1) and [min, max)
+constexpr float uniform(generator& g) noexcept {
+	return detail::toUnitFloat(g.next());
+}
+constexpr float uniform(generator& g, float min, float max) noexcept {
+	return min + (max - min) * uniform(g);
+}
+constexpr vector2D<float> uniform(generator& g, vector2D<float> min, vector2D<float> max) noexcept {
+	float x = uniform(g, min.x, max.x);
+	float y = uniform(g, min.y, max.y);
+	return { x, y };
+}
+constexpr vector3D<float> uniform(generator& g, vector3D<float> min, vector3D<float> max) noexcept {
+	float x = uniform(g, min.x, max.x);
+	float y = uniform(g, min.y, max.y);
+	float z = uniform(g, min.z, max.z);
+	return { x, y, z };
+}
+constexpr vector4D<float> uniform(generator& g, vector4D<float> min, vector4D<float> max) noexcept {
+	float x = uniform(g, min.x, max.x);
+	float y = uniform(g, min.y, max.y);
+	float z = uniform(g, min.z, max.z);
+	float w = uniform(g, min.w, max.w);
+	return { x, y, z, w };
+}
+
+// Shapes
+constexpr vector2D<float> onUnitCircle(generator& g) noexcept {
+	float s = 0, c = 0;
+	fast::sincos(uniform(g) * detail::twoPi, s, c);
+	return { c, s };
+}
+// Uniform over the area, radius sqrt(u)
+constexpr vector2D<float> inUnitDisk(generator& g) noexcept {
+	float r = sqrt(uniform(g));
+	return onUnitCircle(g) * r;
+}
+constexpr vector3D<float> onUnitSphere(generator& g) noexcept {
+	float z = 1.0f - 2.0f * uniform(g);
+	float r = sqrt(std::max(0.0f, 1.0f - z * z));
+	float s = 0, c = 0;
+	fast::sincos(uniform(g) * detail::twoPi, s, c);
+	return { r * c, r * s, z };
+}
+// Uniform over the volume, the largest of three uniforms has the distribution of cbrt(u)
+constexpr vector3D<float> inUnitSphere(generator& g) noexcept {
+	vector3D<float> direction = onUnitSphere(g);
+	float a = uniform(g);
+	float b = uniform(g);
+	float c = uniform(g);
+	return direction * std::max(a, std::max(b, c));
+}
+// Uniform on the half of the unit sphere around normal
+constexpr vector3D<float> onHemisphere(generator& g, vector3D<float> normal) noexcept {
+	vector3D<float> v = onUnitSphere(g);
+	return dot(v, normal) < 0 ? -v : v;
+}
+
+// Arrays, same distributions as above, 8 elements per generator8 call
+namespace detail {
+static_assert(laneCount == soa::blockSize, "array functions walk soa::forEachBlock blocks");
+
+// Points on the unit sphere in lanes
+inline void unitSphere8(generator8& g, float (&x)[laneCount], float (&y)[laneCount], float (&z)[laneCount]) noexcept {
+	alignas(32) float u[laneCount];
+	alignas(32) float angle[laneCount];
+	g.uniform(u);
+	g.uniform(angle);
+	for (size_t l = 0; l < laneCount; l++) {
+		angle[l] *= twoPi;
+	}
+	simd::float8 s, c;
+	fast::detail::sincos(simd::load8(angle), s, c);
+	simd::store(x, c);
+	simd::store(y, s);
+	for (size_t l = 0; l < laneCount; l++) {
+		z[l] = 1.0f - 2.0f * u[l];
+		float r = std::sqrt(std::max(0.0f, 1.0f - z[l] * z[l]));
+		x[l] *= r;
+		y[l] *= r;
+	}
+}
+} // namespace detail
+
+inline void uniform(generator8& g, float* out, size_t count, float min = 0.0f, float max = 1.0f) noexcept {
+	alignas(32) float u[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		g.uniform(u);
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = min + (max - min) * u[l];
+		}
+	});
+}
+inline void uniform(generator8& g, vector2D<float>* out, size_t count, vector2D<float> min, vector2D<float> max) noexcept {
+	alignas(32) float x[laneCount], y[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		g.uniform(x);
+		g.uniform(y);
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = { min.x + (max.x - min.x) * x[l], min.y + (max.y - min.y) * y[l] };
+		}
+	});
+}
+inline void uniform(generator8& g, vector3D<float>* out, size_t count, vector3D<float> min, vector3D<float> max) noexcept {
+	alignas(32) float x[laneCount], y[laneCount], z[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		g.uniform(x);
+		g.uniform(y);
+		g.uniform(z);
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = {
+				min.x + (max.x - min.x) * x[l],
+				min.y + (max.y - min.y) * y[l],
+				min.z + (max.z - min.z) * z[l],
+			};
+		}
+	});
+}
+inline void uniform(generator8& g, vector4D<float>* out, size_t count, vector4D<float> min, vector4D<float> max) noexcept {
+	alignas(32) float x[laneCount], y[laneCount], z[laneCount], w[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		g.uniform(x);
+		g.uniform(y);
+		g.uniform(z);
+		g.uniform(w);
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = {
+				min.x + (max.x - min.x) * x[l],
+				min.y + (max.y - min.y) * y[l],
+				min.z + (max.z - min.z) * z[l],
+				min.w + (max.w - min.w) * w[l],
+			};
+		}
+	});
+}
+
+inline void inUnitDisk(generator8& g, vector2D<float>* out, size_t count) noexcept {
+	alignas(32) float u[laneCount], angle[laneCount], x[laneCount], y[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		g.uniform(u);
+		g.uniform(angle);
+		for (size_t l = 0; l < laneCount; l++) {
+			angle[l] *= detail::twoPi;
+		}
+		simd::float8 s, c;
+		fast::detail::sincos(simd::load8(angle), s, c);
+		simd::float8 r = simd::sqrt(simd::load8(u));
+		simd::store(x, simd::mul(c, r));
+		simd::store(y, simd::mul(s, r));
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = { x[l], y[l] };
+		}
+	});
+}
+inline void onUnitSphere(generator8& g, vector3D<float>* out, size_t count) noexcept {
+	alignas(32) float x[laneCount], y[laneCount], z[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		detail::unitSphere8(g, x, y, z);
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = { x[l], y[l], z[l] };
+		}
+	});
+}
+inline void inUnitSphere(generator8& g, vector3D<float>* out, size_t count) noexcept {
+	alignas(32) float x[laneCount], y[laneCount], z[laneCount], a[laneCount], b[laneCount], c[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		detail::unitSphere8(g, x, y, z);
+		g.uniform(a);
+		g.uniform(b);
+		g.uniform(c);
+		for (size_t l = 0; l < lanes; l++) {
+			float r = std::max(a[l], std::max(b[l], c[l]));
+			out[i + l] = { x[l] * r, y[l] * r, z[l] * r };
+		}
+	});
+}
+inline void onHemisphere(generator8& g, vector3D<float> normal, vector3D<float>* out, size_t count) noexcept {
+	alignas(32) float x[laneCount], y[laneCount], z[laneCount];
+	soa::forEachBlock(count, [&](size_t i, size_t lanes) {
+		detail::unitSphere8(g, x, y, z);
+		for (size_t l = 0; l < laneCount; l++) {
+			float sign = x[l] * normal.x + y[l] * normal.y + z[l] * normal.z < 0 ? -1.0f : 1.0f;
+			x[l] *= sign;
+			y[l] *= sign;
+			z[l] *= sign;
+		}
+		for (size_t l = 0; l < lanes; l++) {
+			out[i + l] = { x[l], y[l], z[l] };
+		}
+	});
+}
+
+} // namespace random
+} // namespace lm2
@@ -0,0 +1,392 @@
+/*
+* Spherical harmonics for lm2: L1 and L2 RGB lighting
+*
+* rgbT<T, 2> holds the 4 coefficients of L1 and rgbT<T, 3> the 9 of L2, in the usual l * (l + 1) + m
+* order of the real basis. Signals are projected from direction samples or a cubemap, rotated with a
+* matrix or quaternion and evaluated per direction. irradiance convolves radiance with the clamped
+* cosine, so a lambert surface reflects albedo * irradiance / pi.
+*
+* packIrradiance turns radiance into packedIrradiance, 7 float4 for a shader uniform or storage
+* buffer (std140 and std430 alike):
+*   float4 n1 = float4(n, 1), q = n.xyzz * n.yzzx;
+*   e.r = dot(a[0], n1) + dot(b[0], q) ... e += c.rgb * (n.x * n.x - n.y * n.y)
+* The batched irradiance runs the same polynomial over 8 lanes.
+*
+* Projections sum per cubemap row or per block of samples and add those partial sums in order, so the
+* results are the same with or without a threadPool.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_simd.hpp"
+#include "lm2_soa.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace lm2 {
+namespace sh {
+
+// Coefficients of an RGB signal over Order bands
+template<typename T, size_t Order>
+struct rgbT {
+	static_assert(Order == 2 || Order == 3, "lm2::sh supports L1 and L2");
+	static constexpr size_t coefficientCount = Order * Order;
+
+	vector3D<T> coefficients[coefficientCount] = {};
+};
+
+using l1 = rgbT<float, 2>;
+using l2 = rgbT<float, 3>;
+
+// L2 irradiance as 7 float4, see the header comment for the shader side
+struct packedIrradiance {
+	vector4D<float> a[3];
+	vector4D<float> b[3];
+	vector4D<float> c;
+};
+static_assert(sizeof(packedIrradiance) == 7 * 4 * sizeof(float));
+
+namespace detail {
+// Basis constants, Y00 = k0, Y1m = k1 * (y, z, x), Y2-2 = k2 xy, Y2-1 = k2 yz, Y20 = k3 (3z^2 - 1),
+// Y21 = k2 xz, Y22 = k4 (x^2 - y^2)
+constexpr float k0 = 0.282094792f;
+constexpr float k1 = 0.488602512f;
+constexpr float k2 = 1.092548431f;
+constexpr float k3 = 0.315391565f;
+constexpr float k4 = 0.546274215f;
+constexpr float pi = 3.14159265358979f;
+
+// Clamped cosine convolution per band
+constexpr float cosineBand[3] = { pi, 2 * pi / 3, pi / 4 };
+
+constexpr size_t lanes = soa::blockSize;
+
+// Basis of 8 unit directions, out[coefficient][lane]
+template<size_t Order>
+inline void basisLanes(const float* x, const float* y, const float* z, float (&out)[Order * Order][lanes]) noexcept {
+	for (size_t l = 0; l < lanes; l++) {
+		out[0][l] = k0;
+		out[1][l] = k1 * y[l];
+		out[2][l] = k1 * z[l];
+		out[3][l] = k1 * x[l];
+		if constexpr (Order == 3) {
+			out[4][l] = k2 * x[l] * y[l];
+			out[5][l] = k2 * y[l] * z[l];
+			out[6][l] = k3 * (3 * z[l] * z[l] - 1);
+			out[7][l] = k2 * x[l] * z[l];
+			out[8][l] = k4 * (x[l] * x[l] - y[l] * y[l]);
+		}
+	}
+}
+
+// Adds color * weight * basis of 8 lanes into sum[coefficient][channel][lane]
+template<size_t Order>
+inline void accumulateLanes(const float* x, const float* y, const float* z, const float* const (&color)[3], const float* weight,
+	float (&sum)[Order * Order][3][lanes]) noexcept {
+	float basis[Order * Order][lanes];
+	basisLanes<Order>(x, y, z, basis);
+	for (size_t i = 0; i < Order * Order; i++) {
+		for (size_t channel = 0; channel < 3; channel++) {
+			for (size_t l = 0; l < lanes; l++) {
+				sum[i][channel][l] += basis[i][l] * color[channel][l] * weight[l];
+			}
+		}
+	}
+}
+
+template<size_t Order>
+inline rgbT<float, Order> reduceLanes(const float (&sum)[Order * Order][3][lanes]) noexcept {
+	rgbT<float, Order> out;
+	for (size_t i = 0; i < Order * Order; i++) {
+		float channels[3] = {};
+		for (size_t channel = 0; channel < 3; channel++) {
+			for (size_t l = 0; l < lanes; l++) {
+				channels[channel] += sum[i][channel][l];
+			}
+		}
+		out.coefficients[i] = { channels[0], channels[1], channels[2] };
+	}
+	return out;
+}
+
+// Integral of the solid angle over the cube face from (0, 0) to (x, y)
+inline float areaElement(float x, float y) noexcept {
+	return std::atan2(x * y, std::sqrt(x * x + y * y + 1));
+}
+
+// Direction of face coordinates u, v in [-1, 1], v pointing down, Vulkan / D3D face order
+inline void faceDirection(size_t face, float u, float v, float& x, float& y, float& z) noexcept {
+	switch (face) {
+	case 0: x = 1; y = -v; z = -u; break;
+	case 1: x = -1; y = -v; z = u; break;
+	case 2: x = u; y = 1; z = v; break;
+	case 3: x = u; y = -1; z = -v; break;
+	case 4: x = u; y = -v; z = 1; break;
+	default: x = -u; y = -v; z = -1; break;
+	}
+}
+
+} // namespace detail
+
+template<typename T, size_t Order>
+constexpr rgbT<T, Order> operator+(const rgbT<T, Order>& a, const rgbT<T, Order>& b) noexcept {
+	rgbT<T, Order> out;
+	for (size_t i = 0; i < out.coefficientCount; i++) {
+		out.coefficients[i] = a.coefficients[i] + b.coefficients[i];
+	}
+	return out;
+}
+template<typename T, size_t Order>
+constexpr rgbT<T, Order> operator*(const rgbT<T, Order>& a, T scale) noexcept {
+	rgbT<T, Order> out;
+	for (size_t i = 0; i < out.coefficientCount; i++) {
+		out.coefficients[i] = a.coefficients[i] * scale;
+	}
+	return out;
+}
+
+// Basis functions at unit direction d
+template<size_t Order, typename T>
+constexpr void basis(vector3D<T> d, T (&out)[Order * Order]) noexcept {
+	out[0] = T(detail::k0);
+	out[1] = T(detail::k1) * d.y;
+	out[2] = T(detail::k1) * d.z;
+	out[3] = T(detail::k1) * d.x;
+	if constexpr (Order == 3) {
+		out[4] = T(detail::k2) * d.x * d.y;
+		out[5] = T(detail::k2) * d.y * d.z;
+		out[6] = T(detail::k3) * (3 * d.z * d.z - 1);
+		out[7] = T(detail::k2) * d.x * d.z;
+		out[8] = T(detail::k4) * (d.x * d.x - d.y * d.y);
+	}
+}
+
+// Adds a sample of color from unit direction d, weight is the solid angle it stands for
+template<typename T, size_t Order>
+constexpr void addSample(rgbT<T, Order>& s, vector3D<T> d, vector3D<T> color, T weight) noexcept {
+	T y[Order * Order];
+	basis<Order>(d, y);
+	for (size_t i = 0; i < s.coefficientCount; i++) {
+		s.coefficients[i] = s.coefficients[i] + color * (y[i] * weight);
+	}
+}
+
+// Value of the signal in unit direction d
+template<typename T, size_t Order>
+constexpr vector3D<T> evaluate(const rgbT<T, Order>& s, vector3D<T> d) noexcept {
+	T y[Order * Order];
+	basis<Order>(d, y);
+	vector3D<T> out{};
+	for (size_t i = 0; i < s.coefficientCount; i++) {
+		out = out + s.coefficients[i] * y[i];
+	}
+	return out;
+}
+
+// Radiance convolved with the clamped cosine, evaluate gives the irradiance around a normal
+template<typename T, size_t Order>
+constexpr rgbT<T, Order> convolveCosine(const rgbT<T, Order>& radiance) noexcept {
+	rgbT<T, Order> out;
+	for (size_t band = 0; band < Order; band++) {
+		for (size_t i = band * band; i < (band + 1) * (band + 1); i++) {
+			out.coefficients[i] = radiance.coefficients[i] * T(detail::cosineBand[band]);
+		}
+	}
+	return out;
+}
+
+template<typename T, size_t Order>
+constexpr vector3D<T> irradiance(const rgbT<T, Order>& radiance, vector3D<T> normal) noexcept {
+	return evaluate(convolveCosine(radiance), normal);
+}
+
+// The signal rotated by r, rotate(s, r) at d equals s at transpose(r) * d
+// Band 1 is dot(d, (c3, c1, c2)) and band 2 the traceless quadratic form d^T Q d, rotating the
+// function rotates the vector and turns Q into r Q r^T
+template<typename T, size_t Order>
+constexpr rgbT<T, Order> rotate(const rgbT<T, Order>& s, const matrix3x3<T>& r) noexcept {
+	rgbT<T, Order> out;
+	const vector3D<T>* c = s.coefficients;
+	out.coefficients[0] = c[0];
+	out.coefficients[3] = c[3] * r.x.x + c[1] * r.x.y + c[2] * r.x.z;
+	out.coefficients[1] = c[3] * r.y.x + c[1] * r.y.y + c[2] * r.y.z;
+	out.coefficients[2] = c[3] * r.z.x + c[1] * r.z.y + c[2] * r.z.z;
+	if constexpr (Order == 3) {
+		constexpr T h2 = T(detail::k2) / 2;
+		T vector3D<T>::*channels[3] = { &vector3D<T>::x, &vector3D<T>::y, &vector3D<T>::z };
+		for (auto channel : channels) {
+			T xy = c[4].*channel * h2, yz = c[5].*channel * h2, xz = c[7].*channel * h2;
+			T zz = c[6].*channel * T(detail::k3), xxyy = c[8].*channel * T(detail::k4);
+			matrix3x3<T> q{
+				{ xxyy - zz, xy, xz },
+				{ xy, -xxyy - zz, yz },
+				{ xz, yz, 2 * zz },
+			};
+			q = r * q * transpose(r);
+			out.coefficients[4].*channel = q.x.y / h2;
+			out.coefficients[5].*channel = q.y.z / h2;
+			out.coefficients[6].*channel = q.z.z / (2 * T(detail::k3));
+			out.coefficients[7].*channel = q.x.z / h2;
+			out.coefficients[8].*channel = (q.x.x - q.y.y) / (2 * T(detail::k4));
+		}
+	}
+	return out;
+}
+template<typename T, size_t Order>
+constexpr rgbT<T, Order> rotate(const rgbT<T, Order>& s, quaternionT<T> q) noexcept {
+	return rotate(s, quaternion2matrix3x3(q));
+}
+
+// Irradiance of radiance in the 7 float4 shader layout, L1 leaves b and c zero
+template<size_t Order>
+constexpr packedIrradiance packIrradiance(const rgbT<float, Order>& radiance) noexcept {
+	rgbT<float, 3> e;
+	rgbT<float, Order> convolved = convolveCosine(radiance);
+	for (size_t i = 0; i < convolved.coefficientCount; i++) {
+		e.coefficients[i] = convolved.coefficients[i];
+	}
+	using namespace detail;
+	const vector3D<float>* c = e.coefficients;
+	packedIrradiance out{};
+	float vector3D<float>::*channels[3] = { &vector3D<float>::x, &vector3D<float>::y, &vector3D<float>::z };
+	for (size_t i = 0; i < 3; i++) {
+		auto channel = channels[i];
+		out.a[i] = { k1 * c[3].*channel, k1 * c[1].*channel, k1 * c[2].*channel, k0 * c[0].*channel - k3 * c[6].*channel };
+		out.b[i] = { k2 * c[4].*channel, k2 * c[5].*channel, 3 * k3 * c[6].*channel, k2 * c[7].*channel };
+	}
+	out.c = { k4 * c[8].x, k4 * c[8].y, k4 * c[8].z, 0 };
+	return out;
+}
+
+// What the shader computes, irradiance around unit normal n
+constexpr vector3D<float> irradiance(const packedIrradiance& p, vector3D<float> n) noexcept {
+	vector4D<float> n1{ n.x, n.y, n.z, 1 };
+	vector4D<float> q{ n.x * n.y, n.y * n.z, n.z * n.z, n.z * n.x };
+	vector3D<float> out{ dot(p.a[0], n1) + dot(p.b[0], q), dot(p.a[1], n1) + dot(p.b[1], q), dot(p.a[2], n1) + dot(p.b[2], q) };
+	return out + vector3D<float>{ p.c.x, p.c.y, p.c.z } * (n.x * n.x - n.y * n.y);
+}
+
+// Irradiance around every normal of the stream, 8 lanes per block
+inline void irradiance(const packedIrradiance& p, const soa::vec3Stream& normals, soa::vec3Stream& out, threadPool* pool = nullptr) {
+	out.resize(normals.size());
+	parallelFor(pool, normals.blockCount(), parallel::minChunkSize / soa::blockSize, [&](size_t begin, size_t end) {
+		for (size_t b = begin; b < end; b++) {
+			const soa::vector3Block<float>& n = normals.blocks[b];
+			soa::vector3Block<float>& e = out.blocks[b];
+			simd::float8 x = simd::load8(n.x), y = simd::load8(n.y), z = simd::load8(n.z);
+			simd::float8 xy = simd::mul(x, y), yz = simd::mul(y, z), zz = simd::mul(z, z), zx = simd::mul(z, x);
+			simd::float8 xxyy = simd::sub(simd::mul(x, x), simd::mul(y, y));
+			float* channels[3] = { e.x, e.y, e.z };
+			float c[3] = { p.c.x, p.c.y, p.c.z };
+			for (size_t i = 0; i < 3; i++) {
+				vector4D<float> a = p.a[i], q = p.b[i];
+				simd::float8 sum = simd::mulAdd(x, simd::set1x8(a.x), simd::set1x8(a.w));
+				sum = simd::mulAdd(y, simd::set1x8(a.y), sum);
+				sum = simd::mulAdd(z, simd::set1x8(a.z), sum);
+				sum = simd::mulAdd(xy, simd::set1x8(q.x), sum);
+				sum = simd::mulAdd(yz, simd::set1x8(q.y), sum);
+				sum = simd::mulAdd(zz, simd::set1x8(q.z), sum);
+				sum = simd::mulAdd(zx, simd::set1x8(q.w), sum);
+				simd::store(channels[i], simd::mulAdd(xxyy, simd::set1x8(c[i]), sum));
+			}
+		}
+	});
+}
+
+// Projection of count colors from unit directions spread uniformly over the sphere, each sample
+// stands for 4 pi / count of solid angle
+template<size_t Order = 3>
+rgbT<float, Order> projectSamples(const vector3D<float>* directions, const vector3D<float>* colors, size_t count, threadPool* pool = nullptr) {
+	constexpr size_t blockSamples = 256;
+	size_t blockCount = (count + blockSamples - 1) / blockSamples;
+	std::vector<rgbT<float, Order>> partial(blockCount);
+	float weight = count ? 4 * detail::pi / static_cast<float>(count) : 0.0f;
+	parallelFor(pool, blockCount, 4, [&](size_t begin, size_t end) {
+		for (size_t block = begin; block < end; block++) {
+			float sum[Order * Order][3][detail::lanes] = {};
+			size_t last = std::min(count, (block + 1) * blockSamples);
+			for (size_t i = block * blockSamples; i < last; i += detail::lanes) {
+				float x[detail::lanes] = {}, y[detail::lanes] = {}, z[detail::lanes] = {};
+				float r[detail::lanes] = {}, g[detail::lanes] = {}, b[detail::lanes] = {}, w[detail::lanes] = {};
+				for (size_t l = 0; l < detail::lanes && i + l < last; l++) {
+					x[l] = directions[i + l].x;
+					y[l] = directions[i + l].y;
+					z[l] = directions[i + l].z;
+					r[l] = colors[i + l].x;
+					g[l] = colors[i + l].y;
+					b[l] = colors[i + l].z;
+					w[l] = weight;
+				}
+				detail::accumulateLanes<Order>(x, y, z, { r, g, b }, w, sum);
+			}
+			partial[block] = detail::reduceLanes<Order>(sum);
+		}
+	});
+	rgbT<float, Order> out;
+	for (const rgbT<float, Order>& p : partial) {
+		out = out + p;
+	}
+	return out;
+}
+
+// Projection of a cubemap of 6 size x size faces, face after face in +X, -X, +Y, -Y, +Z, -Z order
+// and rows top to bottom as Vulkan and D3D lay them out. Texels are weighted by their exact solid angle
+template<size_t Order = 3>
+rgbT<float, Order> projectCubemap(const vector3D<float>* texels, size_t size, threadPool* pool = nullptr) {
+	size_t rowCount = size * 6;
+	std::vector<rgbT<float, Order>> partial(rowCount);
+	float step = 2.0f / static_cast<float>(size);
+	// areaElement at every texel corner, the same for all faces
+	size_t corners = size + 1;
+	std::vector<float> area(corners * corners);
+	parallelFor(pool, corners, 16, [&](size_t begin, size_t end) {
+		for (size_t j = begin; j < end; j++) {
+			for (size_t i = 0; i < corners; i++) {
+				area[j * corners + i] = detail::areaElement(-1 + step * static_cast<float>(i), -1 + step * static_cast<float>(j));
+			}
+		}
+	});
+	parallelFor(pool, rowCount, 4, [&](size_t begin, size_t end) {
+		for (size_t row = begin; row < end; row++) {
+			size_t face = row / size;
+			size_t j = row % size;
+			float v = -1 + step * (static_cast<float>(j) + 0.5f);
+			const float* top = area.data() + j * corners;
+			const float* bottom = top + corners;
+			float sum[Order * Order][3][detail::lanes] = {};
+			const vector3D<float>* rowTexels = texels + row * size;
+			for (size_t i = 0; i < size; i += detail::lanes) {
+				float x[detail::lanes] = {}, y[detail::lanes] = {}, z[detail::lanes] = {};
+				float r[detail::lanes] = {}, g[detail::lanes] = {}, b[detail::lanes] = {}, w[detail::lanes] = {};
+				for (size_t l = 0; l < detail::lanes && i + l < size; l++) {
+					size_t t = i + l;
+					float u = -1 + step * (static_cast<float>(t) + 0.5f);
+					float dx, dy, dz;
+					detail::faceDirection(face, u, v, dx, dy, dz);
+					float scale = 1 / std::sqrt(dx * dx + dy * dy + dz * dz);
+					x[l] = dx * scale;
+					y[l] = dy * scale;
+					z[l] = dz * scale;
+					r[l] = rowTexels[t].x;
+					g[l] = rowTexels[t].y;
+					b[l] = rowTexels[t].z;
+					w[l] = bottom[t + 1] - bottom[t] - top[t + 1] + top[t];
+				}
+				detail::accumulateLanes<Order>(x, y, z, { r, g, b }, w, sum);
+			}
+			partial[row] = detail::reduceLanes<Order>(sum);
+		}
+	});
+	rgbT<float, Order> out;
+	for (const rgbT<float, Order>& p : partial) {
+		out = out + p;
+	}
+	return out;
+}
+
+} // namespace sh
+} // namespace lm2
@@ -0,0 +1,710 @@
+/*
+* SIMD backend for lm2
+*
+* Opt-in: define LM2_SIMD before including lm2.hpp to replace the float vector4D / matrix4x4
+* operations with the specializations at the bottom of this file.
+* The backend is selected at compile time from the target architecture:
+*   AVX2   - __AVX2__ (-mavx2, /arch:AVX2)
+*   SSE4.1 - __SSE4_1__ (-msse4.1) or MSVC x64
+*   NEON   - AArch64 __ARM_NEON or MSVC ARM64
+*   Scalar - anything else, or LM2_SIMD_FORCE_SCALAR
+*
+* Precision: every kernel keeps the operation order of the scalar templates, so results are
+* bit-for-bit identical to the scalar path as long as the compiler does not contract a * b + c
+* into FMA (-ffp-contract=fast together with -mfma, which the default LM2_SIMD_FLAGS enable).
+* With contraction enabled each dot product term may differ by up to 1 ULP.
+* fma and lerp use mulAdd, which is fused exactly where lm2::fma is, so they agree bit-for-bit.
+* The exceptions are matrix products, which sum the four terms in pairs to shorten the dependency
+* chain and may differ by 1 ULP per element, and the general matrix4x4 inverse, which uses 2x2
+* blocks instead of the scalar cofactor expansion and agrees with it to a few ULP of the
+* determinant.
+*
+* Only operations that beat the compiler's own code are specialized: dot and matrix4x4 * vector4D
+* stay on the scalar templates, the transposes and horizontal sums they need cost more than the
+* scalar dot products GCC and Clang already vectorize.
+*/
+#pragma once
+
+#include "lm2.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(LM2_SIMD_FORCE_SCALAR)
+#define LM2_SIMD_BACKEND_SCALAR 1
+#elif defined(__AVX2__)
+#define LM2_SIMD_BACKEND_AVX2 1
+#define LM2_SIMD_BACKEND_SSE41 1
+#elif defined(__SSE4_1__) || defined(__AVX__) || (defined(_MSC_VER) && !defined(__clang__) && defined(_M_X64))
+#define LM2_SIMD_BACKEND_SSE41 1
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+#define LM2_SIMD_BACKEND_NEON 1
+#else
+#define LM2_SIMD_BACKEND_SCALAR 1
+#endif
+
+#if defined(LM2_SIMD_BACKEND_SSE41)
+#include <immintrin.h>
+#elif defined(LM2_SIMD_BACKEND_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace lm2 {
+namespace simd {
+
+#if defined(LM2_SIMD_BACKEND_AVX2)
+constexpr const char* backendName = "AVX2";
+#elif defined(LM2_SIMD_BACKEND_SSE41)
+constexpr const char* backendName = "SSE4.1";
+#elif defined(LM2_SIMD_BACKEND_NEON)
+constexpr const char* backendName = "NEON";
+#else
+constexpr const char* backendName = "Scalar";
+#endif
+
+// 4 lane float register
+// Masks returned by compare functions have all bits of a lane set when true,
+// moveMask packs the top bit of every lane into bit i of an int
+// select(mask, a, b) takes a where mask is set, the mask must come from a compare function
+// rsqrt is the hardware estimate (about 12 bits on SSE / AVX, 8 bits on NEON, exact on scalar)
+// shuffle<I0, I1, I2, I3>(a, b) is (a[I0], a[I1], b[I2], b[I3])
+// intToFloat converts lanes holding int32 bit patterns to float, floatToInt rounds to the nearest
+// int32 (ties to even) and returns the bit patterns, for exponent tricks without integer registers
+#if defined(LM2_SIMD_BACKEND_SSE41)
+
+using float4 = __m128;
+
+inline float4 load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, float4 a) { _mm_storeu_ps(p, a); }
+inline float4 set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+inline float4 set1(float s) { return _mm_set1_ps(s); }
+inline float4 zero() { return _mm_setzero_ps(); }
+
+inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+inline float4 div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a, b); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a, b); }
+inline float4 rsqrt(float4 a) { return _mm_rsqrt_ps(a); }
+inline float4 floor(float4 a) { return _mm_floor_ps(a); }
+
+inline float4 cmpNotEqual(float4 a, float4 b) { return _mm_cmpneq_ps(a, b); }
+inline float4 cmpLess(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+inline float4 bitAnd(float4 a, float4 b) { return _mm_and_ps(a, b); }
+inline float4 bitOr(float4 a, float4 b) { return _mm_or_ps(a, b); }
+inline float4 bitXor(float4 a, float4 b) { return _mm_xor_ps(a, b); }
+inline int moveMask(float4 a) { return _mm_movemask_ps(a); }
+inline float4 select(float4 mask, float4 a, float4 b) { return _mm_blendv_ps(b, a, mask); }
+inline float4 intToFloat(float4 a) { return _mm_cvtepi32_ps(_mm_castps_si128(a)); }
+inline float4 floatToInt(float4 a) { return _mm_castsi128_ps(_mm_cvtps_epi32(a)); }
+
+template<int I>
+float4 splat(float4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(I, I, I, I)); }
+template<int I0, int I1, int I2, int I3>
+float4 shuffle(float4 a, float4 b) { return _mm_shuffle_ps(a, b, _MM_SHUFFLE(I3, I2, I1, I0)); }
+inline float first(float4 a) { return _mm_cvtss_f32(a); }
+
+inline void transpose(float4& r0, float4& r1, float4& r2, float4& r3) { _MM_TRANSPOSE4_PS(r0, r1, r2, r3); }
+
+#elif defined(LM2_SIMD_BACKEND_NEON)
+
+using float4 = float32x4_t;
+
+inline float4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, float4 a) { vst1q_f32(p, a); }
+inline float4 set(float x, float y, float z, float w) { const float v[4] = { x, y, z, w }; return vld1q_f32(v); }
+inline float4 set1(float s) { return vdupq_n_f32(s); }
+inline float4 zero() { return vdupq_n_f32(0.0f); }
+
+inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+inline float4 div(float4 a, float4 b) { return vdivq_f32(a, b); }
+inline float4 sqrt(float4 a) { return vsqrtq_f32(a); }
+inline float4 min(float4 a, float4 b) { return vminq_f32(a, b); }
+inline float4 max(float4 a, float4 b) { return vmaxq_f32(a, b); }
+inline float4 rsqrt(float4 a) { return vrsqrteq_f32(a); }
+inline float4 floor(float4 a) { return vrndmq_f32(a); }
+
+inline float4 cmpNotEqual(float4 a, float4 b) { return vreinterpretq_f32_u32(vmvnq_u32(vceqq_f32(a, b))); }
+inline float4 cmpLess(float4 a, float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a, b)); }
+inline float4 bitAnd(float4 a, float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline float4 bitOr(float4 a, float4 b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline float4 bitXor(float4 a, float4 b) { return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b))); }
+inline int moveMask(float4 a) {
+	const int32_t shifts[4] = { 0, 1, 2, 3 };
+	uint32x4_t bits = vshlq_u32(vshrq_n_u32(vreinterpretq_u32_f32(a), 31), vld1q_s32(shifts));
+	return static_cast<int>(vaddvq_u32(bits));
+}
+inline float4 select(float4 mask, float4 a, float4 b) { return vbslq_f32(vreinterpretq_u32_f32(mask), a, b); }
+inline float4 intToFloat(float4 a) { return vcvtq_f32_s32(vreinterpretq_s32_f32(a)); }
+inline float4 floatToInt(float4 a) { return vreinterpretq_f32_s32(vcvtnq_s32_f32(a)); }
+
+template<int I>
+float4 splat(float4 a) { return vdupq_laneq_f32(a, I); }
+template<int I0, int I1, int I2, int I3>
+float4 shuffle(float4 a, float4 b) {
+	float4 r = vdupq_n_f32(vgetq_lane_f32(a, I0));
+	r = vsetq_lane_f32(vgetq_lane_f32(a, I1), r, 1);
+	r = vsetq_lane_f32(vgetq_lane_f32(b, I2), r, 2);
+	return vsetq_lane_f32(vgetq_lane_f32(b, I3), r, 3);
+}
+inline float first(float4 a) { return vgetq_lane_f32(a, 0); }
+
+inline void transpose(float4& r0, float4& r1, float4& r2, float4& r3) {
+	float32x4x2_t t01 = vtrnq_f32(r0, r1);
+	float32x4x2_t t23 = vtrnq_f32(r2, r3);
+	r0 = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+	r1 = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+	r2 = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+	r3 = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+}
+
+#else
+
+struct float4 {
+	float v[4];
+};
+
+inline float4 load(const float* p) { return { p[0], p[1], p[2], p[3] }; }
+inline void store(float* p, float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+inline float4 set(float x, float y, float z, float w) { return { x, y, z, w }; }
+inline float4 set1(float s) { return { s, s, s, s }; }
+inline float4 zero() { return { 0.0f, 0.0f, 0.0f, 0.0f }; }
+
+inline float4 add(float4 a, float4 b) { return { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] }; }
+inline float4 sub(float4 a, float4 b) { return { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] }; }
+inline float4 mul(float4 a, float4 b) { return { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] }; }
+inline float4 div(float4 a, float4 b) { return { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] }; }
+inline float4 sqrt(float4 a) { return { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) }; }
+inline float4 rsqrt(float4 a) { return { 1.0f / std::sqrt(a.v[0]), 1.0f / std::sqrt(a.v[1]), 1.0f / std::sqrt(a.v[2]), 1.0f / std::sqrt(a.v[3]) }; }
+inline float4 floor(float4 a) { return { std::floor(a.v[0]), std::floor(a.v[1]), std::floor(a.v[2]), std::floor(a.v[3]) }; }
+inline float4 min(float4 a, float4 b) {
+	return { a.v[0] < b.v[0] ? a.v[0] : b.v[0], a.v[1] < b.v[1] ? a.v[1] : b.v[1], a.v[2] < b.v[2] ? a.v[2] : b.v[2], a.v[3] < b.v[3] ? a.v[3] : b.v[3] };
+}
+inline float4 max(float4 a, float4 b) {
+	return { a.v[0] > b.v[0] ? a.v[0] : b.v[0], a.v[1] > b.v[1] ? a.v[1] : b.v[1], a.v[2] > b.v[2] ? a.v[2] : b.v[2], a.v[3] > b.v[3] ? a.v[3] : b.v[3] };
+}
+
+inline float4 cmpNotEqual(float4 a, float4 b) {
+	const float t = std::bit_cast<float>(0xFFFFFFFFu);
+	return { a.v[0] != b.v[0] ? t : 0.0f, a.v[1] != b.v[1] ? t : 0.0f, a.v[2] != b.v[2] ? t : 0.0f, a.v[3] != b.v[3] ? t : 0.0f };
+}
+inline float4 cmpLess(float4 a, float4 b) {
+	const float t = std::bit_cast<float>(0xFFFFFFFFu);
+	return { a.v[0] < b.v[0] ? t : 0.0f, a.v[1] < b.v[1] ? t : 0.0f, a.v[2] < b.v[2] ? t : 0.0f, a.v[3] < b.v[3] ? t : 0.0f };
+}
+inline float4 bitAnd(float4 a, float4 b) {
+	float4 r;
+	for (int i = 0; i < 4; i++) {
+		r.v[i] = std::bit_cast<float>(std::bit_cast<uint32_t>(a.v[i]) & std::bit_cast<uint32_t>(b.v[i]));
+	}
+	return r;
+}
+inline float4 bitOr(float4 a, float4 b) {
+	float4 r;
+	for (int i = 0; i < 4; i++) {
+		r.v[i] = std::bit_cast<float>(std::bit_cast<uint32_t>(a.v[i]) | std::bit_cast<uint32_t>(b.v[i]));
+	}
+	return r;
+}
+inline float4 bitXor(float4 a, float4 b) {
+	float4 r;
+	for (int i = 0; i < 4; i++) {
+		r.v[i] = std::bit_cast<float>(std::bit_cast<uint32_t>(a.v[i]) ^ std::bit_cast<uint32_t>(b.v[i]));
+	}
+	return r;
+}
+inline int moveMask(float4 a) {
+	int mask = 0;
+	for (int i = 0; i < 4; i++) {
+		mask |= static_cast<int>(std::bit_cast<uint32_t>(a.v[i]) >> 31) << i;
+	}
+	return mask;
+}
+inline float4 select(float4 mask, float4 a, float4 b) {
+	float4 r;
+	for (int i = 0; i < 4; i++) {
+		r.v[i] = std::bit_cast<uint32_t>(mask.v[i]) >> 31 ? a.v[i] : b.v[i];
+	}
+	return r;
+}
+inline float4 intToFloat(float4 a) {
+	float4 r;
+	for (int i = 0; i < 4; i++) {
+		r.v[i] = static_cast<float>(std::bit_cast<int32_t>(a.v[i]));
+	}
+	return r;
+}
+inline float4 floatToInt(float4 a) {
+	float4 r;
+	for (int i = 0; i < 4; i++) {
+		r.v[i] = std::bit_cast<float>(static_cast<int32_t>(std::nearbyint(a.v[i])));
+	}
+	return r;
+}
+
+template<int I>
+float4 splat(float4 a) { return { a.v[I], a.v[I], a.v[I], a.v[I] }; }
+template<int I0, int I1, int I2, int I3>
+float4 shuffle(float4 a, float4 b) { return { a.v[I0], a.v[I1], b.v[I2], b.v[I3] }; }
+inline float first(float4 a) { return a.v[0]; }
+
+inline void transpose(float4& r0, float4& r1, float4& r2, float4& r3) {
+	float4 t0 = r0, t1 = r1, t2 = r2, t3 = r3;
+	r0 = { t0.v[0], t1.v[0], t2.v[0], t3.v[0] };
+	r1 = { t0.v[1], t1.v[1], t2.v[1], t3.v[1] };
+	r2 = { t0.v[2], t1.v[2], t2.v[2], t3.v[2] };
+	r3 = { t0.v[3], t1.v[3], t2.v[3], t3.v[3] };
+}
+
+#endif
+
+// 8 lane float register, native on AVX2 and a pair of float4 elsewhere
+#if defined(LM2_SIMD_BACKEND_AVX2)
+
+using float8 = __m256;
+
+inline float8 load8(const float* p) { return _mm256_loadu_ps(p); }
+inline void store(float* p, float8 a) { _mm256_storeu_ps(p, a); }
+inline float8 set1x8(float s) { return _mm256_set1_ps(s); }
+inline float8 zero8() { return _mm256_setzero_ps(); }
+
+inline float8 add(float8 a, float8 b) { return _mm256_add_ps(a, b); }
+inline float8 sub(float8 a, float8 b) { return _mm256_sub_ps(a, b); }
+inline float8 mul(float8 a, float8 b) { return _mm256_mul_ps(a, b); }
+inline float8 div(float8 a, float8 b) { return _mm256_div_ps(a, b); }
+inline float8 sqrt(float8 a) { return _mm256_sqrt_ps(a); }
+inline float8 min(float8 a, float8 b) { return _mm256_min_ps(a, b); }
+inline float8 max(float8 a, float8 b) { return _mm256_max_ps(a, b); }
+inline float8 rsqrt(float8 a) { return _mm256_rsqrt_ps(a); }
+inline float8 floor(float8 a) { return _mm256_floor_ps(a); }
+
+inline float8 cmpNotEqual(float8 a, float8 b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+inline float8 cmpLess(float8 a, float8 b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline float8 bitAnd(float8 a, float8 b) { return _mm256_and_ps(a, b); }
+inline float8 bitOr(float8 a, float8 b) { return _mm256_or_ps(a, b); }
+inline float8 bitXor(float8 a, float8 b) { return _mm256_xor_ps(a, b); }
+inline int moveMask(float8 a) { return _mm256_movemask_ps(a); }
+inline float8 select(float8 mask, float8 a, float8 b) { return _mm256_blendv_ps(b, a, mask); }
+inline float8 intToFloat(float8 a) { return _mm256_cvtepi32_ps(_mm256_castps_si256(a)); }
+inline float8 floatToInt(float8 a) { return _mm256_castsi256_ps(_mm256_cvtps_epi32(a)); }
+
+#else
+
+struct float8 {
+	float4 lo, hi;
+};
+
+inline float8 load8(const float* p) { return { load(p), load(p + 4) }; }
+inline void store(float* p, float8 a) { store(p, a.lo); store(p + 4, a.hi); }
+inline float8 set1x8(float s) { return { set1(s), set1(s) }; }
+inline float8 zero8() { return { zero(), zero() }; }
+
+inline float8 add(float8 a, float8 b) { return { add(a.lo, b.lo), add(a.hi, b.hi) }; }
+inline float8 sub(float8 a, float8 b) { return { sub(a.lo, b.lo), sub(a.hi, b.hi) }; }
+inline float8 mul(float8 a, float8 b) { return { mul(a.lo, b.lo), mul(a.hi, b.hi) }; }
+inline float8 div(float8 a, float8 b) { return { div(a.lo, b.lo), div(a.hi, b.hi) }; }
+inline float8 sqrt(float8 a) { return { sqrt(a.lo), sqrt(a.hi) }; }
+inline float8 min(float8 a, float8 b) { return { min(a.lo, b.lo), min(a.hi, b.hi) }; }
+inline float8 max(float8 a, float8 b) { return { max(a.lo, b.lo), max(a.hi, b.hi) }; }
+inline float8 rsqrt(float8 a) { return { rsqrt(a.lo), rsqrt(a.hi) }; }
+inline float8 floor(float8 a) { return { floor(a.lo), floor(a.hi) }; }
+
+inline float8 cmpNotEqual(float8 a, float8 b) { return { cmpNotEqual(a.lo, b.lo), cmpNotEqual(a.hi, b.hi) }; }
+inline float8 cmpLess(float8 a, float8 b) { return { cmpLess(a.lo, b.lo), cmpLess(a.hi, b.hi) }; }
+inline float8 bitAnd(float8 a, float8 b) { return { bitAnd(a.lo, b.lo), bitAnd(a.hi, b.hi) }; }
+inline float8 bitOr(float8 a, float8 b) { return { bitOr(a.lo, b.lo), bitOr(a.hi, b.hi) }; }
+inline float8 bitXor(float8 a, float8 b) { return { bitXor(a.lo, b.lo), bitXor(a.hi, b.hi) }; }
+inline int moveMask(float8 a) { return moveMask(a.lo) | (moveMask(a.hi) << 4); }
+inline float8 select(float8 mask, float8 a, float8 b) { return { select(mask.lo, a.lo, b.lo), select(mask.hi, a.hi, b.hi) }; }
+inline float8 intToFloat(float8 a) { return { intToFloat(a.lo), intToFloat(a.hi) }; }
+inline float8 floatToInt(float8 a) { return { floatToInt(a.lo), floatToInt(a.hi) }; }
+
+#endif
+
+// Helpers shared by all backends
+inline float4 load(const vector4D<float>& v) { return load(&v.x); }
+inline vector4D<float> toVector(float4 a) {
+	return { first(a), first(splat<1>(a)), first(splat<2>(a)), first(splat<3>(a)) };
+}
+
+// Sum of all lanes, in the same order as the scalar dot: ((x + y) + z) + w
+inline float sumLanes(float4 a) {
+	return first(add(add(add(a, splat<1>(a)), splat<2>(a)), splat<3>(a)));
+}
+
+// Absolute value of every lane
+inline float4 abs(float4 a) { return bitAnd(a, set1(std::bit_cast<float>(0x7FFFFFFFu))); }
+inline float8 abs(float8 a) { return bitAnd(a, set1x8(std::bit_cast<float>(0x7FFFFFFFu))); }
+
+// a * b + c, fused on the same targets where lm2::fma is (FMA on x86, always on NEON),
+// so both round the same way
+inline float4 mulAdd(float4 a, float4 b, float4 c) {
+#if defined(LM2_SIMD_BACKEND_SSE41) && defined(__FMA__)
+	return _mm_fmadd_ps(a, b, c);
+#elif defined(LM2_SIMD_BACKEND_NEON)
+	return vfmaq_f32(c, a, b);
+#elif defined(LM2_SIMD_BACKEND_SCALAR) && defined(FP_FAST_FMAF)
+	return { std::fma(a.v[0], b.v[0], c.v[0]), std::fma(a.v[1], b.v[1], c.v[1]), std::fma(a.v[2], b.v[2], c.v[2]), std::fma(a.v[3], b.v[3], c.v[3]) };
+#else
+	return add(mul(a, b), c);
+#endif
+}
+inline float8 mulAdd(float8 a, float8 b, float8 c) {
+#if defined(LM2_SIMD_BACKEND_AVX2) && defined(__FMA__)
+	return _mm256_fmadd_ps(a, b, c);
+#elif defined(LM2_SIMD_BACKEND_AVX2)
+	return add(mul(a, b), c);
+#else
+	return { mulAdd(a.lo, b.lo, c.lo), mulAdd(a.hi, b.hi, c.hi) };
+#endif
+}
+
+// a / b with lanes where b == 0 set to 0, matching the checked scalar division
+inline float4 divChecked(float4 a, float4 b) {
+	return bitAnd(div(a, b), cmpNotEqual(b, zero()));
+}
+inline float8 divChecked(float8 a, float8 b) {
+	return bitAnd(div(a, b), cmpNotEqual(b, zero8()));
+}
+
+// Matrix kernels, matrices are 16 contiguous floats in row order
+static_assert(sizeof(vector4D<float>) == 4 * sizeof(float), "lm2 SIMD backend requires tightly packed vector4D");
+static_assert(sizeof(matrix4x4<float>) == 16 * sizeof(float), "lm2 SIMD backend requires tightly packed matrix4x4");
+
+// Row i of the result is (a.row[i].x * b.row[0] + a.row[i].y * b.row[1]) + (a.row[i].z * b.row[2] +
+// a.row[i].w * b.row[3]), pairs first to keep the dependency chain short
+inline void mat4Mul(const float* a, const float* b, float* out) {
+#if defined(LM2_SIMD_BACKEND_AVX2)
+	// Two result rows per iteration, each 128 bit half holds one row
+	__m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 0));
+	__m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 4));
+	__m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 8));
+	__m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 12));
+	for (int i = 0; i < 16; i += 8) {
+		__m256 rows = _mm256_loadu_ps(a + i);
+		__m256 xy = _mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(rows, 0x00), b0), _mm256_mul_ps(_mm256_permute_ps(rows, 0x55), b1));
+		__m256 zw = _mm256_add_ps(_mm256_mul_ps(_mm256_permute_ps(rows, 0xAA), b2), _mm256_mul_ps(_mm256_permute_ps(rows, 0xFF), b3));
+		__m256 r = _mm256_add_ps(xy, zw);
+		_mm256_storeu_ps(out + i, r);
+	}
+#else
+	float4 b0 = load(b + 0);
+	float4 b1 = load(b + 4);
+	float4 b2 = load(b + 8);
+	float4 b3 = load(b + 12);
+	for (int i = 0; i < 16; i += 4) {
+		float4 row = load(a + i);
+		float4 r = add(add(mul(splat<0>(row), b0), mul(splat<1>(row), b1)), add(mul(splat<2>(row), b2), mul(splat<3>(row), b3)));
+		store(out + i, r);
+	}
+#endif
+}
+
+// Affine matrices, 12 contiguous floats with the last row (0, 0, 0, 1) implied
+inline void mat3x4Mul(const float* a, const float* b, float* out) {
+	float4 b0 = load(b + 0);
+	float4 b1 = load(b + 4);
+	float4 b2 = load(b + 8);
+	float4 b3 = set(0.0f, 0.0f, 0.0f, 1.0f);
+	for (int i = 0; i < 12; i += 4) {
+		float4 row = load(a + i);
+		float4 r = add(add(mul(splat<0>(row), b0), mul(splat<1>(row), b1)), add(mul(splat<2>(row), b2), mul(splat<3>(row), b3)));
+		store(out + i, r);
+	}
+}
+
+// 2x2 matrices packed in one register as (m00, m01, m10, m11)
+// a * b
+inline float4 mat2Mul(float4 a, float4 b) {
+	return add(mul(a, shuffle<0, 3, 0, 3>(b, b)), mul(shuffle<1, 0, 3, 2>(a, a), shuffle<2, 1, 2, 1>(b, b)));
+}
+// adjugate(a) * b
+inline float4 mat2AdjMul(float4 a, float4 b) {
+	return sub(mul(shuffle<3, 3, 0, 0>(a, a), b), mul(shuffle<1, 1, 2, 2>(a, a), shuffle<2, 3, 0, 1>(b, b)));
+}
+// a * adjugate(b)
+inline float4 mat2MulAdj(float4 a, float4 b) {
+	return sub(mul(a, shuffle<3, 0, 3, 0>(b, b)), mul(shuffle<1, 0, 3, 2>(a, a), shuffle<2, 1, 2, 1>(b, b)));
+}
+
+// General inverse by 2x2 blocks, M = | A B |
+//                                    | C D |
+// Returns false and leaves out untouched when the matrix is singular
+inline bool mat4Inverse(const float* m, float* out) {
+	float4 r0 = load(m + 0), r1 = load(m + 4), r2 = load(m + 8), r3 = load(m + 12);
+	float4 a = shuffle<0, 1, 0, 1>(r0, r1);
+	float4 b = shuffle<2, 3, 2, 3>(r0, r1);
+	float4 c = shuffle<0, 1, 0, 1>(r2, r3);
+	float4 d = shuffle<2, 3, 2, 3>(r2, r3);
+
+	// (|A|, |B|, |C|, |D|)
+	float4 detSub = sub(mul(shuffle<0, 2, 0, 2>(r0, r2), shuffle<1, 3, 1, 3>(r1, r3)),
+	                    mul(shuffle<1, 3, 1, 3>(r0, r2), shuffle<0, 2, 0, 2>(r1, r3)));
+	float4 detA = splat<0>(detSub), detB = splat<1>(detSub), detC = splat<2>(detSub), detD = splat<3>(detSub);
+
+	float4 dc = mat2AdjMul(d, c);
+	float4 ab = mat2AdjMul(a, b);
+	// Adjugates of the blocks of the inverse, scaled by |M|
+	float4 x = sub(mul(detD, a), mat2Mul(b, dc));
+	float4 w = sub(mul(detA, d), mat2Mul(c, ab));
+	float4 y = sub(mul(detB, c), mat2MulAdj(d, ab));
+	float4 z = sub(mul(detC, b), mat2MulAdj(a, dc));
+
+	// |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+	float det = first(detA) * first(detD) + first(detB) * first(detC) - sumLanes(mul(ab, shuffle<0, 2, 1, 3>(dc, dc)));
+	if (det == 0)
+		return false;
+	float4 invDet = div(set(1.0f, -1.0f, -1.0f, 1.0f), set1(det));
+	x = mul(x, invDet);
+	y = mul(y, invDet);
+	z = mul(z, invDet);
+	w = mul(w, invDet);
+
+	// Adjugate of every block and the row layout in one shuffle
+	store(out + 0, shuffle<3, 1, 3, 1>(x, y));
+	store(out + 4, shuffle<2, 0, 2, 0>(x, y));
+	store(out + 8, shuffle<3, 1, 3, 1>(z, w));
+	store(out + 12, shuffle<2, 0, 2, 0>(z, w));
+	return true;
+}
+
+// Inverse of a matrix with (0, 0, 0, 1) as last row, the linear part is inverted from cross products
+inline void mat4InverseAffine(const float* m, float* out) {
+	const float4 xyzMask = cmpNotEqual(set(1.0f, 1.0f, 1.0f, 0.0f), zero());
+	float4 r0 = load(m + 0), r1 = load(m + 4), r2 = load(m + 8);
+	float4 a = bitAnd(r0, xyzMask), b = bitAnd(r1, xyzMask), c = bitAnd(r2, xyzMask);
+	auto cross = [](float4 u, float4 v) {
+		return sub(mul(shuffle<1, 2, 0, 3>(u, u), shuffle<2, 0, 1, 3>(v, v)),
+		           mul(shuffle<2, 0, 1, 3>(u, u), shuffle<1, 2, 0, 3>(v, v)));
+	};
+	float4 bc = cross(b, c);
+	float4 ca = cross(c, a);
+	float4 ab = cross(a, b);
+	float4 invDet = divChecked(set1(1.0f), set1(sumLanes(mul(a, bc))));
+	bc = mul(bc, invDet);
+	ca = mul(ca, invDet);
+	ab = mul(ab, invDet);
+	float4 pos = add(add(mul(bc, splat<3>(r0)), mul(ca, splat<3>(r1))), mul(ab, splat<3>(r2)));
+	pos = sub(set(0.0f, 0.0f, 0.0f, 1.0f), pos);
+	// bc, ca and ab are the columns of the inverse
+	transpose(bc, ca, ab, pos);
+	store(out + 0, bc);
+	store(out + 4, ca);
+	store(out + 8, ab);
+	store(out + 12, pos);
+}
+
+// Inverse of a rotation and translation, the rotation is transposed
+inline void mat4InverseRigid(const float* m, float* out) {
+	const float4 xyzMask = cmpNotEqual(set(1.0f, 1.0f, 1.0f, 0.0f), zero());
+	float4 r0 = load(m + 0), r1 = load(m + 4), r2 = load(m + 8);
+	float4 a = bitAnd(r0, xyzMask), b = bitAnd(r1, xyzMask), c = bitAnd(r2, xyzMask);
+	float4 pos = add(add(mul(a, splat<3>(r0)), mul(b, splat<3>(r1))), mul(c, splat<3>(r2)));
+	pos = sub(set(0.0f, 0.0f, 0.0f, 1.0f), pos);
+	transpose(a, b, c, pos);
+	store(out + 0, a);
+	store(out + 4, b);
+	store(out + 8, c);
+	store(out + 12, pos);
+}
+
+} // namespace simd
+
+#ifdef LM2_SIMD
+
+// Specializations of the float vector4D / matrix4x4 templates
+// They stay constexpr, constant evaluation takes the scalar expressions of the templates
+// Component-vise operations
+template<>
+constexpr vector4D<float> operator+ <float>(vector4D<float> a, vector4D<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+	}
+	return simd::toVector(simd::add(simd::load(a), simd::load(b)));
+}
+template<>
+constexpr vector4D<float> operator- <float>(vector4D<float> a, vector4D<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+	}
+	return simd::toVector(simd::sub(simd::load(a), simd::load(b)));
+}
+template<>
+constexpr vector4D<float> operator* <float>(vector4D<float> a, vector4D<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x * b.x, a.y * b.y, a.z * b.z, a.w * b.w };
+	}
+	return simd::toVector(simd::mul(simd::load(a), simd::load(b)));
+}
+template<>
+constexpr vector4D<float> operator/ <float>(vector4D<float> a, vector4D<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		return {
+			b.x != 0 ? a.x / b.x : 0,
+			b.y != 0 ? a.y / b.y : 0,
+			b.z != 0 ? a.z / b.z : 0,
+			b.w != 0 ? a.w / b.w : 0,
+		};
+	}
+	return simd::toVector(simd::divChecked(simd::load(a), simd::load(b)));
+}
+// Scalar operations
+template<>
+constexpr vector4D<float> operator+ <float>(vector4D<float> a, float s) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x + s, a.y + s, a.z + s, a.w + s };
+	}
+	return simd::toVector(simd::add(simd::load(a), simd::set1(s)));
+}
+template<>
+constexpr vector4D<float> operator- <float>(vector4D<float> a, float s) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x - s, a.y - s, a.z - s, a.w - s };
+	}
+	return simd::toVector(simd::sub(simd::load(a), simd::set1(s)));
+}
+template<>
+constexpr vector4D<float> operator* <float>(vector4D<float> a, float s) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x * s, a.y * s, a.z * s, a.w * s };
+	}
+	return simd::toVector(simd::mul(simd::load(a), simd::set1(s)));
+}
+template<>
+constexpr vector4D<float> operator/ <float>(vector4D<float> a, float s) noexcept {
+	if (s == 0) {
+		return { 0, 0, 0, 0 };
+	}
+	if (std::is_constant_evaluated()) {
+		return { a.x / s, a.y / s, a.z / s, a.w / s };
+	}
+	return simd::toVector(simd::div(simd::load(a), simd::set1(s)));
+}
+// Fused multiply add and lerp
+template<>
+constexpr vector4D<float> fma<float>(vector4D<float> a, vector4D<float> b, vector4D<float> c) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x * b.x + c.x, a.y * b.y + c.y, a.z * b.z + c.z, a.w * b.w + c.w };
+	}
+	return simd::toVector(simd::mulAdd(simd::load(a), simd::load(b), simd::load(c)));
+}
+template<>
+constexpr vector4D<float> fma<float>(vector4D<float> a, float s, vector4D<float> c) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x * s + c.x, a.y * s + c.y, a.z * s + c.z, a.w * s + c.w };
+	}
+	return simd::toVector(simd::mulAdd(simd::load(a), simd::set1(s), simd::load(c)));
+}
+template<>
+constexpr vector4D<float> lerp<float>(vector4D<float> a, vector4D<float> b, float t) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { (b.x - a.x) * t + a.x, (b.y - a.y) * t + a.y, (b.z - a.z) * t + a.z, (b.w - a.w) * t + a.w };
+	}
+	simd::float4 va = simd::load(a);
+	return simd::toVector(simd::mulAdd(simd::sub(simd::load(b), va), simd::set1(t), va));
+}
+template<>
+constexpr vector4D<float> unchecked::divide<float>(vector4D<float> a, vector4D<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x / b.x, a.y / b.y, a.z / b.z, a.w / b.w };
+	}
+	return simd::toVector(simd::div(simd::load(a), simd::load(b)));
+}
+template<>
+constexpr vector4D<float> unchecked::divide<float>(vector4D<float> a, float s) noexcept {
+	if (std::is_constant_evaluated()) {
+		return { a.x / s, a.y / s, a.z / s, a.w / s };
+	}
+	return simd::toVector(simd::div(simd::load(a), simd::set1(s)));
+}
+
+// Normalize
+template<>
+constexpr vector4D<float> normalize<float>(vector4D<float> vec) noexcept {
+	if (std::is_constant_evaluated()) {
+		return vec / magnitude(vec);
+	}
+	simd::float4 v = simd::load(vec);
+	float length = std::sqrt(simd::sumLanes(simd::mul(v, v)));
+	if (length == 0) {
+		return { 0, 0, 0, 0 };
+	}
+	return simd::toVector(simd::div(v, simd::set1(length)));
+}
+
+// Matrix multiplications
+template<>
+constexpr matrix4x4<float> operator* <float>(matrix4x4<float> a, matrix4x4<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		// Row i is a.i.x * b.x + a.i.y * b.y + a.i.z * b.z + a.i.w * b.w, same order as the dot products
+		auto row = [&b](vector4D<float> r) {
+			return b.x * r.x + b.y * r.y + b.z * r.z + b.w * r.w;
+		};
+		return { row(a.x), row(a.y), row(a.z), row(a.w) };
+	}
+	matrix4x4<float> out;
+	simd::mat4Mul(&a.x.x, &b.x.x, &out.x.x);
+	return out;
+}
+template<>
+constexpr matrix3x4<float> operator* <float>(matrix3x4<float> a, matrix3x4<float> b) noexcept {
+	if (std::is_constant_evaluated()) {
+		return matrix3x4<float>(matrix4x4<float>(a) * matrix4x4<float>(b));
+	}
+	matrix3x4<float> out;
+	simd::mat3x4Mul(&a.x.x, &b.x.x, &out.x.x);
+	return out;
+}
+
+// Transpose and inverse
+template<>
+constexpr matrix4x4<float> transpose<float>(matrix4x4<float> m) noexcept {
+	if (std::is_constant_evaluated()) {
+		return {
+			{ m.x.x, m.y.x, m.z.x, m.w.x },
+			{ m.x.y, m.y.y, m.z.y, m.w.y },
+			{ m.x.z, m.y.z, m.z.z, m.w.z },
+			{ m.x.w, m.y.w, m.z.w, m.w.w },
+		};
+	}
+	simd::float4 r0 = simd::load(m.x), r1 = simd::load(m.y), r2 = simd::load(m.z), r3 = simd::load(m.w);
+	simd::transpose(r0, r1, r2, r3);
+	return { simd::toVector(r0), simd::toVector(r1), simd::toVector(r2), simd::toVector(r3) };
+}
+template<>
+constexpr matrix4x4<float> inverse<float>(matrix4x4<float> m) noexcept {
+	if (std::is_constant_evaluated()) {
+		return detail::inverse(m);
+	}
+	matrix4x4<float> out;
+	if (!simd::mat4Inverse(&m.x.x, &out.x.x)) {
+		return {};
+	}
+	return out;
+}
+template<>
+constexpr matrix4x4<float> inverseAffine<float>(matrix4x4<float> m) noexcept {
+	if (std::is_constant_evaluated()) {
+		return detail::inverseAffine(m);
+	}
+	matrix4x4<float> out;
+	simd::mat4InverseAffine(&m.x.x, &out.x.x);
+	return out;
+}
+template<>
+constexpr matrix4x4<float> inverseRigid<float>(matrix4x4<float> m) noexcept {
+	if (std::is_constant_evaluated()) {
+		return detail::inverseRigid(m);
+	}
+	matrix4x4<float> out;
+	simd::mat4InverseRigid(&m.x.x, &out.x.x);
+	return out;
+}
+
+#endif // #ifdef LM2_SIMD
+} // namespace lm2
@@ -0,0 +1,953 @@
+/*
+* Structure of arrays streams and batch kernels for lm2
+*
+* Vectors are stored in blocks of blockSize lanes per component (AoSoA), so a float block
+* maps to one 8 lane register per component. Streams are padded to whole blocks, padding
+* lanes are zero after resize and are processed like any other lane, so a kernel writing to a
+* stream may leave them non-zero.
+* Float kernels use lm2::simd, other types fall back to plain lane loops.
+* Matrix array kernels take AoS arrays. The inverses transpose blocks of matrices into lanes
+* internally, the products run one 4 lane simd::mat4Mul / mat3x4Mul per matrix.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lm2 {
+namespace soa {
+
+// Lanes per block
+constexpr size_t blockSize = 8;
+
+// Calls block(first, lanes) for every blockSize elements of count, lanes is below blockSize only
+// for the last block (the full blocks get a constant lane count, so their copy loops vectorize)
+template<typename Block>
+void forEachBlock(size_t count, Block block) {
+	size_t i = 0;
+	for (; i + blockSize <= count; i += blockSize) {
+		block(i, blockSize);
+	}
+	if (i < count) {
+		block(i, count - i);
+	}
+}
+
+// Blocks
+template<typename T>
+struct alignas(32) scalarBlock {
+	T v[blockSize];
+};
+
+template<typename T>
+struct alignas(32) vector2Block {
+	T x[blockSize];
+	T y[blockSize];
+};
+
+template<typename T>
+struct alignas(32) vector3Block {
+	T x[blockSize];
+	T y[blockSize];
+	T z[blockSize];
+};
+
+template<typename T>
+struct alignas(32) vector4Block {
+	T x[blockSize];
+	T y[blockSize];
+	T z[blockSize];
+	T w[blockSize];
+};
+
+template<typename T>
+struct alignas(32) quaternionBlock {
+	T w[blockSize];
+	T x[blockSize];
+	T y[blockSize];
+	T z[blockSize];
+};
+
+// Streams
+namespace detail {
+// Lane type T of a Block<T>
+template<template<typename> class Block, typename T>
+T laneTypeOf(const Block<T>&);
+} // namespace detail
+
+template<typename Block>
+struct stream {
+	std::vector<Block> blocks;
+	size_t count = 0;
+
+	// New blocks are zero, the lanes past newCount in the last block are zeroed as well since
+	// kernels and set may have written them
+	void resize(size_t newCount) {
+		count = newCount;
+		blocks.resize((newCount + blockSize - 1) / blockSize);
+		size_t used = newCount % blockSize;
+		if (used != 0) {
+			// Every block is a struct of arrays of blockSize lanes
+			using Lane = decltype(detail::laneTypeOf(std::declval<Block>()));
+			constexpr size_t componentBytes = blockSize * sizeof(Lane);
+			static_assert(sizeof(Block) % componentBytes == 0);
+			unsigned char* bytes = reinterpret_cast<unsigned char*>(&blocks.back());
+			for (size_t offset = 0; offset < sizeof(Block); offset += componentBytes) {
+				std::memset(bytes + offset + used * sizeof(Lane), 0, (blockSize - used) * sizeof(Lane));
+			}
+		}
+	}
+	size_t size() const {
+		return count;
+	}
+	size_t blockCount() const {
+		return blocks.size();
+	}
+};
+
+template<typename T>
+struct scalarStream : stream<scalarBlock<T>> {
+	T get(size_t i) const {
+		return this->blocks[i / blockSize].v[i % blockSize];
+	}
+	void set(size_t i, T value) {
+		this->blocks[i / blockSize].v[i % blockSize] = value;
+	}
+};
+
+template<typename T>
+struct vector2Stream : stream<vector2Block<T>> {
+	vector2D<T> get(size_t i) const {
+		const vector2Block<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		return { b.x[l], b.y[l] };
+	}
+	void set(size_t i, vector2D<T> v) {
+		vector2Block<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		b.x[l] = v.x;
+		b.y[l] = v.y;
+	}
+};
+
+template<typename T>
+struct vector3Stream : stream<vector3Block<T>> {
+	vector3D<T> get(size_t i) const {
+		const vector3Block<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		return { b.x[l], b.y[l], b.z[l] };
+	}
+	void set(size_t i, vector3D<T> v) {
+		vector3Block<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		b.x[l] = v.x;
+		b.y[l] = v.y;
+		b.z[l] = v.z;
+	}
+};
+
+template<typename T>
+struct vector4Stream : stream<vector4Block<T>> {
+	vector4D<T> get(size_t i) const {
+		const vector4Block<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		return { b.x[l], b.y[l], b.z[l], b.w[l] };
+	}
+	void set(size_t i, vector4D<T> v) {
+		vector4Block<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		b.x[l] = v.x;
+		b.y[l] = v.y;
+		b.z[l] = v.z;
+		b.w[l] = v.w;
+	}
+};
+
+template<typename T>
+struct quaternionStream : stream<quaternionBlock<T>> {
+	quaternionT<T> get(size_t i) const {
+		const quaternionBlock<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		return { b.w[l], b.x[l], b.y[l], b.z[l] };
+	}
+	void set(size_t i, quaternionT<T> q) {
+		quaternionBlock<T>& b = this->blocks[i / blockSize];
+		size_t l = i % blockSize;
+		b.w[l] = q.w;
+		b.x[l] = q.x;
+		b.y[l] = q.y;
+		b.z[l] = q.z;
+	}
+};
+
+using floatStream = scalarStream<float>;
+using vec2Stream = vector2Stream<float>;
+using vec3Stream = vector3Stream<float>;
+using vec4Stream = vector4Stream<float>;
+using quaternionStreamF = quaternionStream<float>;
+
+// Conversion from / to AoS arrays
+// stride is the distance in bytes between two elements, so vectors inside larger structs
+// (e.g. renderer::vertex::pos) can be converted directly
+template<typename T>
+void fromAoS(const vector2D<T>* src, size_t count, vector2Stream<T>& out, size_t stride = sizeof(vector2D<T>)) {
+	out.resize(count);
+	const char* p = reinterpret_cast<const char*>(src);
+	for (size_t i = 0; i < count; i++, p += stride) {
+		out.set(i, *reinterpret_cast<const vector2D<T>*>(p));
+	}
+}
+template<typename T>
+void fromAoS(const vector3D<T>* src, size_t count, vector3Stream<T>& out, size_t stride = sizeof(vector3D<T>)) {
+	out.resize(count);
+	const char* p = reinterpret_cast<const char*>(src);
+	for (size_t i = 0; i < count; i++, p += stride) {
+		out.set(i, *reinterpret_cast<const vector3D<T>*>(p));
+	}
+}
+template<typename T>
+void fromAoS(const vector4D<T>* src, size_t count, vector4Stream<T>& out, size_t stride = sizeof(vector4D<T>)) {
+	out.resize(count);
+	const char* p = reinterpret_cast<const char*>(src);
+	for (size_t i = 0; i < count; i++, p += stride) {
+		out.set(i, *reinterpret_cast<const vector4D<T>*>(p));
+	}
+}
+template<typename T>
+void fromAoS(const quaternionT<T>* src, size_t count, quaternionStream<T>& out, size_t stride = sizeof(quaternionT<T>)) {
+	out.resize(count);
+	const char* p = reinterpret_cast<const char*>(src);
+	for (size_t i = 0; i < count; i++, p += stride) {
+		out.set(i, *reinterpret_cast<const quaternionT<T>*>(p));
+	}
+}
+template<typename T>
+void toAoS(const vector2Stream<T>& in, vector2D<T>* dst, size_t stride = sizeof(vector2D<T>)) {
+	char* p = reinterpret_cast<char*>(dst);
+	for (size_t i = 0; i < in.size(); i++, p += stride) {
+		*reinterpret_cast<vector2D<T>*>(p) = in.get(i);
+	}
+}
+template<typename T>
+void toAoS(const vector3Stream<T>& in, vector3D<T>* dst, size_t stride = sizeof(vector3D<T>)) {
+	char* p = reinterpret_cast<char*>(dst);
+	for (size_t i = 0; i < in.size(); i++, p += stride) {
+		*reinterpret_cast<vector3D<T>*>(p) = in.get(i);
+	}
+}
+template<typename T>
+void toAoS(const vector4Stream<T>& in, vector4D<T>* dst, size_t stride = sizeof(vector4D<T>)) {
+	char* p = reinterpret_cast<char*>(dst);
+	for (size_t i = 0; i < in.size(); i++, p += stride) {
+		*reinterpret_cast<vector4D<T>*>(p) = in.get(i);
+	}
+}
+template<typename T>
+void toAoS(const quaternionStream<T>& in, quaternionT<T>* dst, size_t stride = sizeof(quaternionT<T>)) {
+	char* p = reinterpret_cast<char*>(dst);
+	for (size_t i = 0; i < in.size(); i++, p += stride) {
+		*reinterpret_cast<quaternionT<T>*>(p) = in.get(i);
+	}
+}
+
+// Transform
+// Points are transformed with w = 1, the w row of the matrix is ignored
+template<typename T>
+void transformPoints(const matrix4x4<T>& mat, const vector3Stream<T>& in, vector3Stream<T>& out) {
+	out.resize(in.size());
+	for (size_t b = 0; b < in.blockCount(); b++) {
+		const vector3Block<T>& src = in.blocks[b];
+		vector3Block<T>& dst = out.blocks[b];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 x = simd::load8(src.x);
+			simd::float8 y = simd::load8(src.y);
+			simd::float8 z = simd::load8(src.z);
+			simd::float8 rx = simd::add(simd::add(simd::add(simd::mul(simd::set1x8(mat.x.x), x), simd::mul(simd::set1x8(mat.x.y), y)), simd::mul(simd::set1x8(mat.x.z), z)), simd::set1x8(mat.x.w));
+			simd::float8 ry = simd::add(simd::add(simd::add(simd::mul(simd::set1x8(mat.y.x), x), simd::mul(simd::set1x8(mat.y.y), y)), simd::mul(simd::set1x8(mat.y.z), z)), simd::set1x8(mat.y.w));
+			simd::float8 rz = simd::add(simd::add(simd::add(simd::mul(simd::set1x8(mat.z.x), x), simd::mul(simd::set1x8(mat.z.y), y)), simd::mul(simd::set1x8(mat.z.z), z)), simd::set1x8(mat.z.w));
+			simd::store(dst.x, rx);
+			simd::store(dst.y, ry);
+			simd::store(dst.z, rz);
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				T x = src.x[l], y = src.y[l], z = src.z[l];
+				dst.x[l] = mat.x.x * x + mat.x.y * y + mat.x.z * z + mat.x.w;
+				dst.y[l] = mat.y.x * x + mat.y.y * y + mat.y.z * z + mat.y.w;
+				dst.z[l] = mat.z.x * x + mat.z.y * y + mat.z.z * z + mat.z.w;
+			}
+		}
+	}
+}
+template<typename T>
+void transformPoints(const matrix3x4<T>& mat, const vector3Stream<T>& in, vector3Stream<T>& out) {
+	transformPoints(matrix4x4<T>(mat), in, out);
+}
+// Homogeneous result, e.g. clip space positions from a projection matrix
+template<typename T>
+void transformPoints(const matrix4x4<T>& mat, const vector3Stream<T>& in, vector4Stream<T>& out) {
+	out.resize(in.size());
+	for (size_t b = 0; b < in.blockCount(); b++) {
+		const vector3Block<T>& src = in.blocks[b];
+		vector4Block<T>& dst = out.blocks[b];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 x = simd::load8(src.x);
+			simd::float8 y = simd::load8(src.y);
+			simd::float8 z = simd::load8(src.z);
+			const vector4D<float>* rows[4] = { &mat.x, &mat.y, &mat.z, &mat.w };
+			float* outs[4] = { dst.x, dst.y, dst.z, dst.w };
+			for (int r = 0; r < 4; r++) {
+				simd::float8 v = simd::add(simd::add(simd::add(simd::mul(simd::set1x8(rows[r]->x), x), simd::mul(simd::set1x8(rows[r]->y), y)), simd::mul(simd::set1x8(rows[r]->z), z)), simd::set1x8(rows[r]->w));
+				simd::store(outs[r], v);
+			}
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				T x = src.x[l], y = src.y[l], z = src.z[l];
+				dst.x[l] = mat.x.x * x + mat.x.y * y + mat.x.z * z + mat.x.w;
+				dst.y[l] = mat.y.x * x + mat.y.y * y + mat.y.z * z + mat.y.w;
+				dst.z[l] = mat.z.x * x + mat.z.y * y + mat.z.z * z + mat.z.w;
+				dst.w[l] = mat.w.x * x + mat.w.y * y + mat.w.z * z + mat.w.w;
+			}
+		}
+	}
+}
+// Directions are transformed with w = 0, translation is ignored
+template<typename T>
+void transformDirections(const matrix4x4<T>& mat, const vector3Stream<T>& in, vector3Stream<T>& out) {
+	out.resize(in.size());
+	for (size_t b = 0; b < in.blockCount(); b++) {
+		const vector3Block<T>& src = in.blocks[b];
+		vector3Block<T>& dst = out.blocks[b];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 x = simd::load8(src.x);
+			simd::float8 y = simd::load8(src.y);
+			simd::float8 z = simd::load8(src.z);
+			simd::float8 rx = simd::add(simd::add(simd::mul(simd::set1x8(mat.x.x), x), simd::mul(simd::set1x8(mat.x.y), y)), simd::mul(simd::set1x8(mat.x.z), z));
+			simd::float8 ry = simd::add(simd::add(simd::mul(simd::set1x8(mat.y.x), x), simd::mul(simd::set1x8(mat.y.y), y)), simd::mul(simd::set1x8(mat.y.z), z));
+			simd::float8 rz = simd::add(simd::add(simd::mul(simd::set1x8(mat.z.x), x), simd::mul(simd::set1x8(mat.z.y), y)), simd::mul(simd::set1x8(mat.z.z), z));
+			simd::store(dst.x, rx);
+			simd::store(dst.y, ry);
+			simd::store(dst.z, rz);
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				T x = src.x[l], y = src.y[l], z = src.z[l];
+				dst.x[l] = mat.x.x * x + mat.x.y * y + mat.x.z * z;
+				dst.y[l] = mat.y.x * x + mat.y.y * y + mat.y.z * z;
+				dst.z[l] = mat.z.x * x + mat.z.y * y + mat.z.z * z;
+			}
+		}
+	}
+}
+template<typename T>
+void transformDirections(const matrix3x4<T>& mat, const vector3Stream<T>& in, vector3Stream<T>& out) {
+	transformDirections(matrix4x4<T>(mat), in, out);
+}
+
+// Dot
+template<typename T>
+void dot(const vector3Stream<T>& a, const vector3Stream<T>& b, scalarStream<T>& out) {
+	out.resize(a.size());
+	for (size_t i = 0; i < a.blockCount(); i++) {
+		const vector3Block<T>& va = a.blocks[i];
+		const vector3Block<T>& vb = b.blocks[i];
+		scalarBlock<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 r = simd::add(simd::add(
+				simd::mul(simd::load8(va.x), simd::load8(vb.x)),
+				simd::mul(simd::load8(va.y), simd::load8(vb.y))),
+				simd::mul(simd::load8(va.z), simd::load8(vb.z)));
+			simd::store(dst.v, r);
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				dst.v[l] = va.x[l] * vb.x[l] + va.y[l] * vb.y[l] + va.z[l] * vb.z[l];
+			}
+		}
+	}
+}
+// Cross
+template<typename T>
+void cross(const vector3Stream<T>& a, const vector3Stream<T>& b, vector3Stream<T>& out) {
+	out.resize(a.size());
+	for (size_t i = 0; i < a.blockCount(); i++) {
+		const vector3Block<T>& va = a.blocks[i];
+		const vector3Block<T>& vb = b.blocks[i];
+		vector3Block<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 ax = simd::load8(va.x), ay = simd::load8(va.y), az = simd::load8(va.z);
+			simd::float8 bx = simd::load8(vb.x), by = simd::load8(vb.y), bz = simd::load8(vb.z);
+			simd::store(dst.x, simd::sub(simd::mul(ay, bz), simd::mul(az, by)));
+			simd::store(dst.y, simd::sub(simd::mul(az, bx), simd::mul(ax, bz)));
+			simd::store(dst.z, simd::sub(simd::mul(ax, by), simd::mul(ay, bx)));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				T ax = va.x[l], ay = va.y[l], az = va.z[l];
+				T bx = vb.x[l], by = vb.y[l], bz = vb.z[l];
+				dst.x[l] = ay * bz - az * by;
+				dst.y[l] = az * bx - ax * bz;
+				dst.z[l] = ax * by - ay * bx;
+			}
+		}
+	}
+}
+// Magnitude
+template<typename T>
+void magnitude(const vector3Stream<T>& in, scalarStream<T>& out) {
+	out.resize(in.size());
+	for (size_t i = 0; i < in.blockCount(); i++) {
+		const vector3Block<T>& src = in.blocks[i];
+		scalarBlock<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 x = simd::load8(src.x), y = simd::load8(src.y), z = simd::load8(src.z);
+			simd::store(dst.v, simd::sqrt(simd::add(simd::add(simd::mul(x, x), simd::mul(y, y)), simd::mul(z, z))));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				dst.v[l] = std::sqrt(src.x[l] * src.x[l] + src.y[l] * src.y[l] + src.z[l] * src.z[l]);
+			}
+		}
+	}
+}
+// Normalize, zero length vectors stay zero like lm2::normalize
+template<typename T>
+void normalize(const vector3Stream<T>& in, vector3Stream<T>& out) {
+	out.resize(in.size());
+	for (size_t i = 0; i < in.blockCount(); i++) {
+		const vector3Block<T>& src = in.blocks[i];
+		vector3Block<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 x = simd::load8(src.x), y = simd::load8(src.y), z = simd::load8(src.z);
+			simd::float8 length = simd::sqrt(simd::add(simd::add(simd::mul(x, x), simd::mul(y, y)), simd::mul(z, z)));
+			simd::store(dst.x, simd::divChecked(x, length));
+			simd::store(dst.y, simd::divChecked(y, length));
+			simd::store(dst.z, simd::divChecked(z, length));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				T x = src.x[l], y = src.y[l], z = src.z[l];
+				T length = std::sqrt(x * x + y * y + z * z);
+				dst.x[l] = length != 0 ? x / length : 0;
+				dst.y[l] = length != 0 ? y / length : 0;
+				dst.z[l] = length != 0 ? z / length : 0;
+			}
+		}
+	}
+}
+// Fused multiply add, a.get(i) * s + c.get(i), the usual integration step p += v * dt
+template<typename T>
+void fma(const vector3Stream<T>& a, T s, const vector3Stream<T>& c, vector3Stream<T>& out) {
+	out.resize(a.size());
+	for (size_t i = 0; i < a.blockCount(); i++) {
+		const vector3Block<T>& va = a.blocks[i];
+		const vector3Block<T>& vc = c.blocks[i];
+		vector3Block<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 vs = simd::set1x8(s);
+			simd::store(dst.x, simd::mulAdd(simd::load8(va.x), vs, simd::load8(vc.x)));
+			simd::store(dst.y, simd::mulAdd(simd::load8(va.y), vs, simd::load8(vc.y)));
+			simd::store(dst.z, simd::mulAdd(simd::load8(va.z), vs, simd::load8(vc.z)));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				dst.x[l] = lm2::fma(va.x[l], s, vc.x[l]);
+				dst.y[l] = lm2::fma(va.y[l], s, vc.y[l]);
+				dst.z[l] = lm2::fma(va.z[l], s, vc.z[l]);
+			}
+		}
+	}
+}
+// Lerp of every pair, a.get(i) to b.get(i) by t.get(i)
+template<typename T>
+void lerp(const vector3Stream<T>& a, const vector3Stream<T>& b, const scalarStream<T>& t, vector3Stream<T>& out) {
+	out.resize(a.size());
+	for (size_t i = 0; i < a.blockCount(); i++) {
+		const vector3Block<T>& va = a.blocks[i];
+		const vector3Block<T>& vb = b.blocks[i];
+		const scalarBlock<T>& tb = t.blocks[i];
+		vector3Block<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 vt = simd::load8(tb.v);
+			simd::float8 ax = simd::load8(va.x), ay = simd::load8(va.y), az = simd::load8(va.z);
+			simd::store(dst.x, simd::mulAdd(simd::sub(simd::load8(vb.x), ax), vt, ax));
+			simd::store(dst.y, simd::mulAdd(simd::sub(simd::load8(vb.y), ay), vt, ay));
+			simd::store(dst.z, simd::mulAdd(simd::sub(simd::load8(vb.z), az), vt, az));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				dst.x[l] = lm2::lerp(va.x[l], vb.x[l], tb.v[l]);
+				dst.y[l] = lm2::lerp(va.y[l], vb.y[l], tb.v[l]);
+				dst.z[l] = lm2::lerp(va.z[l], vb.z[l], tb.v[l]);
+			}
+		}
+	}
+}
+
+// Quaternions
+// Shortest path nlerp of every pair, a.get(i) to b.get(i) by t.get(i)
+template<typename T>
+void nlerp(const quaternionStream<T>& a, const quaternionStream<T>& b, const scalarStream<T>& t, quaternionStream<T>& out) {
+	out.resize(a.size());
+	for (size_t i = 0; i < a.blockCount(); i++) {
+		const quaternionBlock<T>& qa = a.blocks[i];
+		const quaternionBlock<T>& qb = b.blocks[i];
+		const scalarBlock<T>& tb = t.blocks[i];
+		quaternionBlock<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 aw = simd::load8(qa.w), ax = simd::load8(qa.x), ay = simd::load8(qa.y), az = simd::load8(qa.z);
+			simd::float8 bw = simd::load8(qb.w), bx = simd::load8(qb.x), by = simd::load8(qb.y), bz = simd::load8(qb.z);
+			simd::float8 d = simd::add(simd::add(simd::add(simd::mul(aw, bw), simd::mul(ax, bx)), simd::mul(ay, by)), simd::mul(az, bz));
+			simd::float8 sign = simd::bitAnd(d, simd::set1x8(-0.0f));
+			simd::float8 tt = simd::load8(tb.v);
+			simd::float8 ta = simd::sub(simd::set1x8(1.0f), tt);
+			simd::float8 tbs = simd::bitXor(tt, sign);
+			simd::float8 rw = simd::add(simd::mul(aw, ta), simd::mul(bw, tbs));
+			simd::float8 rx = simd::add(simd::mul(ax, ta), simd::mul(bx, tbs));
+			simd::float8 ry = simd::add(simd::mul(ay, ta), simd::mul(by, tbs));
+			simd::float8 rz = simd::add(simd::mul(az, ta), simd::mul(bz, tbs));
+			simd::float8 length = simd::sqrt(simd::add(simd::add(simd::add(simd::mul(rw, rw), simd::mul(rx, rx)), simd::mul(ry, ry)), simd::mul(rz, rz)));
+			simd::store(dst.w, simd::divChecked(rw, length));
+			simd::store(dst.x, simd::divChecked(rx, length));
+			simd::store(dst.y, simd::divChecked(ry, length));
+			simd::store(dst.z, simd::divChecked(rz, length));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				quaternionT<T> r = lm2::nlerp(quaternionT<T>{ qa.w[l], qa.x[l], qa.y[l], qa.z[l] }, quaternionT<T>{ qb.w[l], qb.x[l], qb.y[l], qb.z[l] }, tb.v[l]);
+				dst.w[l] = r.w;
+				dst.x[l] = r.x;
+				dst.y[l] = r.y;
+				dst.z[l] = r.z;
+			}
+		}
+	}
+}
+
+// Shortest path slerp of every pair without trigonometry or branches, using the polynomial
+// 8 term approximation from D. Eberly, "A Fast and Accurate Algorithm for Computing SLERP" (2011).
+// Max component error against the exact lm2::slerp is about 3e-5 for normalized inputs.
+namespace detail {
+constexpr double slerpMu = 1.85298109240830;
+constexpr double slerpU[8] = { 1.0 / (1 * 3), 1.0 / (2 * 5), 1.0 / (3 * 7), 1.0 / (4 * 9), 1.0 / (5 * 11), 1.0 / (6 * 13), 1.0 / (7 * 15), slerpMu / (8 * 17) };
+constexpr double slerpV[8] = { 1.0 / 3, 2.0 / 5, 3.0 / 7, 4.0 / 9, 5.0 / 11, 6.0 / 13, 7.0 / 15, slerpMu * 8 / 17 };
+} // namespace detail
+
+template<typename T>
+void slerp(const quaternionStream<T>& a, const quaternionStream<T>& b, const scalarStream<T>& t, quaternionStream<T>& out) {
+	out.resize(a.size());
+	for (size_t i = 0; i < a.blockCount(); i++) {
+		const quaternionBlock<T>& qa = a.blocks[i];
+		const quaternionBlock<T>& qb = b.blocks[i];
+		const scalarBlock<T>& tb = t.blocks[i];
+		quaternionBlock<T>& dst = out.blocks[i];
+		if constexpr (std::is_same_v<T, float>) {
+			simd::float8 aw = simd::load8(qa.w), ax = simd::load8(qa.x), ay = simd::load8(qa.y), az = simd::load8(qa.z);
+			simd::float8 bw = simd::load8(qb.w), bx = simd::load8(qb.x), by = simd::load8(qb.y), bz = simd::load8(qb.z);
+			simd::float8 d = simd::add(simd::add(simd::add(simd::mul(aw, bw), simd::mul(ax, bx)), simd::mul(ay, by)), simd::mul(az, bz));
+			simd::float8 sign = simd::bitAnd(d, simd::set1x8(-0.0f));
+			simd::float8 xm1 = simd::sub(simd::bitXor(d, sign), simd::set1x8(1.0f));
+			simd::float8 one = simd::set1x8(1.0f);
+			simd::float8 tt = simd::load8(tb.v);
+			simd::float8 td = simd::sub(one, tt);
+			simd::float8 sqrT = simd::mul(tt, tt);
+			simd::float8 sqrD = simd::mul(td, td);
+			simd::float8 fT = one;
+			simd::float8 fD = one;
+			for (int k = 7; k >= 0; k--) {
+				simd::float8 u = simd::set1x8(static_cast<float>(detail::slerpU[k]));
+				simd::float8 v = simd::set1x8(static_cast<float>(detail::slerpV[k]));
+				fT = simd::add(one, simd::mul(simd::mul(simd::sub(simd::mul(u, sqrT), v), xm1), fT));
+				fD = simd::add(one, simd::mul(simd::mul(simd::sub(simd::mul(u, sqrD), v), xm1), fD));
+			}
+			simd::float8 cT = simd::bitXor(simd::mul(tt, fT), sign);
+			simd::float8 cD = simd::mul(td, fD);
+			simd::store(dst.w, simd::add(simd::mul(aw, cD), simd::mul(bw, cT)));
+			simd::store(dst.x, simd::add(simd::mul(ax, cD), simd::mul(bx, cT)));
+			simd::store(dst.y, simd::add(simd::mul(ay, cD), simd::mul(by, cT)));
+			simd::store(dst.z, simd::add(simd::mul(az, cD), simd::mul(bz, cT)));
+		}
+		else {
+			for (size_t l = 0; l < blockSize; l++) {
+				T d = qa.w[l] * qb.w[l] + qa.x[l] * qb.x[l] + qa.y[l] * qb.y[l] + qa.z[l] * qb.z[l];
+				T sign = d < 0 ? static_cast<T>(-1) : static_cast<T>(1);
+				T xm1 = d * sign - static_cast<T>(1);
+				T tt = tb.v[l];
+				T td = static_cast<T>(1) - tt;
+				T fT = 1, fD = 1;
+				for (int k = 7; k >= 0; k--) {
+					fT = 1 + (static_cast<T>(detail::slerpU[k]) * tt * tt - static_cast<T>(detail::slerpV[k])) * xm1 * fT;
+					fD = 1 + (static_cast<T>(detail::slerpU[k]) * td * td - static_cast<T>(detail::slerpV[k])) * xm1 * fD;
+				}
+				T cT = tt * fT * sign;
+				T cD = td * fD;
+				dst.w[l] = qa.w[l] * cD + qb.w[l] * cT;
+				dst.x[l] = qa.x[l] * cD + qb.x[l] * cT;
+				dst.y[l] = qa.y[l] * cD + qb.y[l] * cT;
+				dst.z[l] = qa.z[l] * cD + qb.z[l] * cT;
+			}
+		}
+	}
+}
+
+// Rotation matrices of every quaternion, written to an AoS array of in.size() matrices
+namespace detail {
+// Rows of the rotation matrix for one block, m[row * 3 + column][lane]
+template<typename T>
+void quaternionBlockMatrices(const quaternionBlock<T>& q, T (&m)[9][blockSize]) {
+	if constexpr (std::is_same_v<T, float>) {
+		simd::float8 w = simd::load8(q.w), x = simd::load8(q.x), y = simd::load8(q.y), z = simd::load8(q.z);
+		simd::float8 one = simd::set1x8(1.0f), two = simd::set1x8(2.0f);
+		simd::float8 xx = simd::mul(x, x), yy = simd::mul(y, y), zz = simd::mul(z, z);
+		simd::float8 xy = simd::mul(x, y), xz = simd::mul(x, z), yz = simd::mul(y, z);
+		simd::float8 wx = simd::mul(w, x), wy = simd::mul(w, y), wz = simd::mul(w, z);
+		simd::store(m[0], simd::sub(one, simd::mul(two, simd::add(yy, zz))));
+		simd::store(m[1], simd::mul(two, simd::sub(xy, wz)));
+		simd::store(m[2], simd::mul(two, simd::add(xz, wy)));
+		simd::store(m[3], simd::mul(two, simd::add(xy, wz)));
+		simd::store(m[4], simd::sub(one, simd::mul(two, simd::add(xx, zz))));
+		simd::store(m[5], simd::mul(two, simd::sub(yz, wx)));
+		simd::store(m[6], simd::mul(two, simd::sub(xz, wy)));
+		simd::store(m[7], simd::mul(two, simd::add(yz, wx)));
+		simd::store(m[8], simd::sub(one, simd::mul(two, simd::add(xx, yy))));
+	}
+	else {
+		for (size_t l = 0; l < blockSize; l++) {
+			matrix3x3<T> r = quaternion2matrix3x3(quaternionT<T>{ q.w[l], q.x[l], q.y[l], q.z[l] });
+			m[0][l] = r.x.x; m[1][l] = r.x.y; m[2][l] = r.x.z;
+			m[3][l] = r.y.x; m[4][l] = r.y.y; m[5][l] = r.y.z;
+			m[6][l] = r.z.x; m[7][l] = r.z.y; m[8][l] = r.z.z;
+		}
+	}
+}
+} // namespace detail
+
+template<typename T>
+void quaternion2matrix3x3(const quaternionStream<T>& in, matrix3x3<T>* out) {
+	for (size_t b = 0; b < in.blockCount(); b++) {
+		alignas(32) T m[9][blockSize];
+		detail::quaternionBlockMatrices(in.blocks[b], m);
+		size_t lanes = in.size() - b * blockSize < blockSize ? in.size() - b * blockSize : blockSize;
+		for (size_t l = 0; l < lanes; l++) {
+			out[b * blockSize + l] = {
+				{ m[0][l], m[1][l], m[2][l] },
+				{ m[3][l], m[4][l], m[5][l] },
+				{ m[6][l], m[7][l], m[8][l] },
+			};
+		}
+	}
+}
+template<typename T>
+void quaternion2matrix4x4(const quaternionStream<T>& in, matrix4x4<T>* out) {
+	for (size_t b = 0; b < in.blockCount(); b++) {
+		alignas(32) T m[9][blockSize];
+		detail::quaternionBlockMatrices(in.blocks[b], m);
+		size_t lanes = in.size() - b * blockSize < blockSize ? in.size() - b * blockSize : blockSize;
+		for (size_t l = 0; l < lanes; l++) {
+			out[b * blockSize + l] = {
+				{ m[0][l], m[1][l], m[2][l], 0 },
+				{ m[3][l], m[4][l], m[5][l], 0 },
+				{ m[6][l], m[7][l], m[8][l], 0 },
+				{ 0,       0,       0,       1 },
+			};
+		}
+	}
+}
+
+// Inverse of every matrix of an AoS array, in and out may be the same array
+// Float matrices are transposed into blocks of blockSize matrices so every lane inverts one matrix
+namespace detail {
+// m[row * 4 + column][lane], lanes past count are filled with the identity
+// Whole blocks are transposed 4 matrices and one row at a time in registers
+// Matrix is matrix4x4<float> or matrix3x4<float>, the implied last row of a matrix3x4 is (0, 0, 0, 1)
+template<typename Matrix>
+void loadMatrixLanes(const Matrix* in, size_t count, float (&m)[16][blockSize]) {
+	constexpr size_t rows = sizeof(Matrix) / sizeof(vector4D<float>);
+	if (count < blockSize) {
+		Matrix padded[blockSize];
+		for (size_t l = 0; l < blockSize; l++) {
+			padded[l] = l < count ? in[l] : static_cast<Matrix>(identity4x4<float>());
+		}
+		loadMatrixLanes(padded, blockSize, m);
+		return;
+	}
+	for (size_t l = 0; l < blockSize; l += 4) {
+		for (size_t row = 0; row < rows; row++) {
+			simd::float4 r0 = simd::load(&in[l + 0].x.x + row * 4);
+			simd::float4 r1 = simd::load(&in[l + 1].x.x + row * 4);
+			simd::float4 r2 = simd::load(&in[l + 2].x.x + row * 4);
+			simd::float4 r3 = simd::load(&in[l + 3].x.x + row * 4);
+			simd::transpose(r0, r1, r2, r3);
+			simd::store(m[row * 4 + 0] + l, r0);
+			simd::store(m[row * 4 + 1] + l, r1);
+			simd::store(m[row * 4 + 2] + l, r2);
+			simd::store(m[row * 4 + 3] + l, r3);
+		}
+	}
+	if constexpr (rows == 3) {
+		simd::store(m[12], simd::zero8());
+		simd::store(m[13], simd::zero8());
+		simd::store(m[14], simd::zero8());
+		simd::store(m[15], simd::set1x8(1.0f));
+	}
+}
+template<typename Matrix>
+void storeMatrixLanes(const float (&m)[16][blockSize], size_t count, Matrix* out) {
+	constexpr size_t rows = sizeof(Matrix) / sizeof(vector4D<float>);
+	if (count < blockSize) {
+		Matrix padded[blockSize];
+		storeMatrixLanes(m, blockSize, padded);
+		for (size_t l = 0; l < count; l++) {
+			out[l] = padded[l];
+		}
+		return;
+	}
+	for (size_t l = 0; l < blockSize; l += 4) {
+		for (size_t row = 0; row < rows; row++) {
+			simd::float4 c0 = simd::load(m[row * 4 + 0] + l);
+			simd::float4 c1 = simd::load(m[row * 4 + 1] + l);
+			simd::float4 c2 = simd::load(m[row * 4 + 2] + l);
+			simd::float4 c3 = simd::load(m[row * 4 + 3] + l);
+			simd::transpose(c0, c1, c2, c3);
+			simd::store(&out[l + 0].x.x + row * 4, c0);
+			simd::store(&out[l + 1].x.x + row * 4, c1);
+			simd::store(&out[l + 2].x.x + row * 4, c2);
+			simd::store(&out[l + 3].x.x + row * 4, c3);
+		}
+	}
+}
+
+inline simd::float8 mulSub(simd::float8 a, simd::float8 b, simd::float8 c, simd::float8 d) {
+	return simd::sub(simd::mul(a, b), simd::mul(c, d));
+}
+// a * x - b * y + c * z
+inline simd::float8 cofactor(simd::float8 a, simd::float8 x, simd::float8 b, simd::float8 y, simd::float8 c, simd::float8 z) {
+	return simd::add(mulSub(a, x, b, y), simd::mul(c, z));
+}
+
+// Same expansion as lm2::detail::inverse, singular lanes give the zero matrix
+inline void inverseLanes(const float (&in)[16][blockSize], float (&out)[16][blockSize]) {
+	simd::float8 m[16];
+	for (int i = 0; i < 16; i++) {
+		m[i] = simd::load8(in[i]);
+	}
+	simd::float8 s0 = mulSub(m[0], m[5], m[4], m[1]);
+	simd::float8 s1 = mulSub(m[0], m[6], m[4], m[2]);
+	simd::float8 s2 = mulSub(m[0], m[7], m[4], m[3]);
+	simd::float8 s3 = mulSub(m[1], m[6], m[5], m[2]);
+	simd::float8 s4 = mulSub(m[1], m[7], m[5], m[3]);
+	simd::float8 s5 = mulSub(m[2], m[7], m[6], m[3]);
+
+	simd::float8 c0 = mulSub(m[8], m[13], m[12], m[9]);
+	simd::float8 c1 = mulSub(m[8], m[14], m[12], m[10]);
+	simd::float8 c2 = mulSub(m[8], m[15], m[12], m[11]);
+	simd::float8 c3 = mulSub(m[9], m[14], m[13], m[10]);
+	simd::float8 c4 = mulSub(m[9], m[15], m[13], m[11]);
+	simd::float8 c5 = mulSub(m[10], m[15], m[14], m[11]);
+
+	simd::float8 det = simd::add(simd::sub(simd::add(simd::add(simd::sub(simd::mul(s0, c5), simd::mul(s1, c4)), simd::mul(s2, c3)), simd::mul(s3, c2)), simd::mul(s4, c1)), simd::mul(s5, c0));
+	simd::float8 invDet = simd::divChecked(simd::set1x8(1.0f), det);
+	simd::float8 negInvDet = simd::sub(simd::zero8(), invDet);
+
+	simd::store(out[0],  simd::mul(cofactor(m[5], c5, m[6], c4, m[7], c3), invDet));
+	simd::store(out[1],  simd::mul(cofactor(m[1], c5, m[2], c4, m[3], c3), negInvDet));
+	simd::store(out[2],  simd::mul(cofactor(m[13], s5, m[14], s4, m[15], s3), invDet));
+	simd::store(out[3],  simd::mul(cofactor(m[9], s5, m[10], s4, m[11], s3), negInvDet));
+	simd::store(out[4],  simd::mul(cofactor(m[4], c5, m[6], c2, m[7], c1), negInvDet));
+	simd::store(out[5],  simd::mul(cofactor(m[0], c5, m[2], c2, m[3], c1), invDet));
+	simd::store(out[6],  simd::mul(cofactor(m[12], s5, m[14], s2, m[15], s1), negInvDet));
+	simd::store(out[7],  simd::mul(cofactor(m[8], s5, m[10], s2, m[11], s1), invDet));
+	simd::store(out[8],  simd::mul(cofactor(m[4], c4, m[5], c2, m[7], c0), invDet));
+	simd::store(out[9],  simd::mul(cofactor(m[0], c4, m[1], c2, m[3], c0), negInvDet));
+	simd::store(out[10], simd::mul(cofactor(m[12], s4, m[13], s2, m[15], s0), invDet));
+	simd::store(out[11], simd::mul(cofactor(m[8], s4, m[9], s2, m[11], s0), negInvDet));
+	simd::store(out[12], simd::mul(cofactor(m[4], c3, m[5], c1, m[6], c0), negInvDet));
+	simd::store(out[13], simd::mul(cofactor(m[0], c3, m[1], c1, m[2], c0), invDet));
+	simd::store(out[14], simd::mul(cofactor(m[12], s3, m[13], s1, m[14], s0), negInvDet));
+	simd::store(out[15], simd::mul(cofactor(m[8], s3, m[9], s1, m[10], s0), invDet));
+}
+
+// Same as lm2::detail::inverseAffine
+inline void inverseAffineLanes(const float (&in)[16][blockSize], float (&out)[16][blockSize]) {
+	simd::float8 ax = simd::load8(in[0]), ay = simd::load8(in[1]), az = simd::load8(in[2]);
+	simd::float8 bx = simd::load8(in[4]), by = simd::load8(in[5]), bz = simd::load8(in[6]);
+	simd::float8 cx = simd::load8(in[8]), cy = simd::load8(in[9]), cz = simd::load8(in[10]);
+	simd::float8 tx = simd::load8(in[3]), ty = simd::load8(in[7]), tz = simd::load8(in[11]);
+
+	simd::float8 bcx = mulSub(by, cz, bz, cy), bcy = mulSub(bz, cx, bx, cz), bcz = mulSub(bx, cy, by, cx);
+	simd::float8 cax = mulSub(cy, az, cz, ay), cay = mulSub(cz, ax, cx, az), caz = mulSub(cx, ay, cy, ax);
+	simd::float8 abx = mulSub(ay, bz, az, by), aby = mulSub(az, bx, ax, bz), abz = mulSub(ax, by, ay, bx);
+	simd::float8 det = simd::add(simd::add(simd::mul(ax, bcx), simd::mul(ay, bcy)), simd::mul(az, bcz));
+	simd::float8 invDet = simd::divChecked(simd::set1x8(1.0f), det);
+	bcx = simd::mul(bcx, invDet); bcy = simd::mul(bcy, invDet); bcz = simd::mul(bcz, invDet);
+	cax = simd::mul(cax, invDet); cay = simd::mul(cay, invDet); caz = simd::mul(caz, invDet);
+	abx = simd::mul(abx, invDet); aby = simd::mul(aby, invDet); abz = simd::mul(abz, invDet);
+
+	simd::store(out[0], bcx); simd::store(out[1], cax); simd::store(out[2], abx);
+	simd::store(out[4], bcy); simd::store(out[5], cay); simd::store(out[6], aby);
+	simd::store(out[8], bcz); simd::store(out[9], caz); simd::store(out[10], abz);
+	simd::store(out[3],  simd::sub(simd::zero8(), simd::add(simd::add(simd::mul(bcx, tx), simd::mul(cax, ty)), simd::mul(abx, tz))));
+	simd::store(out[7],  simd::sub(simd::zero8(), simd::add(simd::add(simd::mul(bcy, tx), simd::mul(cay, ty)), simd::mul(aby, tz))));
+	simd::store(out[11], simd::sub(simd::zero8(), simd::add(simd::add(simd::mul(bcz, tx), simd::mul(caz, ty)), simd::mul(abz, tz))));
+	simd::store(out[12], simd::zero8()); simd::store(out[13], simd::zero8()); simd::store(out[14], simd::zero8());
+	simd::store(out[15], simd::set1x8(1.0f));
+}
+
+// Same as lm2::detail::inverseRigid
+inline void inverseRigidLanes(const float (&in)[16][blockSize], float (&out)[16][blockSize]) {
+	simd::float8 tx = simd::load8(in[3]), ty = simd::load8(in[7]), tz = simd::load8(in[11]);
+	for (int i = 0; i < 3; i++) {
+		simd::float8 a = simd::load8(in[i]), b = simd::load8(in[4 + i]), c = simd::load8(in[8 + i]);
+		simd::store(out[i * 4 + 0], a);
+		simd::store(out[i * 4 + 1], b);
+		simd::store(out[i * 4 + 2], c);
+		simd::store(out[i * 4 + 3], simd::sub(simd::zero8(), simd::add(simd::add(simd::mul(a, tx), simd::mul(b, ty)), simd::mul(c, tz))));
+	}
+	simd::store(out[12], simd::zero8()); simd::store(out[13], simd::zero8()); simd::store(out[14], simd::zero8());
+	simd::store(out[15], simd::set1x8(1.0f));
+}
+
+template<typename T, template<typename> class Matrix, typename LaneKernel, typename Scalar>
+void invertMatrices(const Matrix<T>* in, size_t count, Matrix<T>* out, LaneKernel laneKernel, Scalar scalar) {
+	if constexpr (std::is_same_v<T, float>) {
+		for (size_t b = 0; b < count; b += blockSize) {
+			size_t lanes = count - b < blockSize ? count - b : blockSize;
+			alignas(32) float m[16][blockSize];
+			alignas(32) float r[16][blockSize];
+			loadMatrixLanes(in + b, lanes, m);
+			laneKernel(m, r);
+			storeMatrixLanes(r, lanes, out + b);
+		}
+	}
+	else {
+		for (size_t i = 0; i < count; i++) {
+			out[i] = scalar(in[i]);
+		}
+	}
+}
+} // namespace detail
+
+template<typename T>
+void inverse(const matrix4x4<T>* in, size_t count, matrix4x4<T>* out) {
+	detail::invertMatrices(in, count, out, detail::inverseLanes, [](const matrix4x4<T>& m) { return lm2::inverse(m); });
+}
+// Matrices with (0, 0, 0, 1) as last row
+template<typename T>
+void inverseAffine(const matrix4x4<T>* in, size_t count, matrix4x4<T>* out) {
+	detail::invertMatrices(in, count, out, detail::inverseAffineLanes, [](const matrix4x4<T>& m) { return lm2::inverseAffine(m); });
+}
+// Rotation and translation only
+template<typename T>
+void inverseRigid(const matrix4x4<T>* in, size_t count, matrix4x4<T>* out) {
+	detail::invertMatrices(in, count, out, detail::inverseRigidLanes, [](const matrix4x4<T>& m) { return lm2::inverseRigid(m); });
+}
+// Affine matrices
+template<typename T>
+void inverse(const matrix3x4<T>* in, size_t count, matrix3x4<T>* out) {
+	detail::invertMatrices(in, count, out, detail::inverseAffineLanes, [](const matrix3x4<T>& m) { return lm2::inverse(m); });
+}
+template<typename T>
+void inverseRigid(const matrix3x4<T>* in, size_t count, matrix3x4<T>* out) {
+	detail::invertMatrices(in, count, out, detail::inverseRigidLanes, [](const matrix3x4<T>& m) { return lm2::inverseRigid(m); });
+}
+
+// Matrix array products
+// One simd::mat4Mul / mat3x4Mul per matrix: a product is already 4 lane work on AoS rows, and
+// transposing both inputs and the output into 8 lane blocks made the arrays about 4x slower
+// out may be the same array as an input and can be a mapped GPU buffer, every matrix is
+// written once in order with whole rows
+// shared * in[i] for every matrix, e.g. viewProjection * model
+template<typename T>
+void multiply(const matrix4x4<T>& shared, const matrix4x4<T>* in, size_t count, matrix4x4<T>* out) {
+	for (size_t i = 0; i < count; i++) {
+		if constexpr (std::is_same_v<T, float>) {
+			simd::mat4Mul(&shared.x.x, &in[i].x.x, &out[i].x.x);
+		}
+		else {
+			out[i] = shared * in[i];
+		}
+	}
+}
+// in[i] * shared for every matrix
+template<typename T>
+void multiply(const matrix4x4<T>* in, const matrix4x4<T>& shared, size_t count, matrix4x4<T>* out) {
+	for (size_t i = 0; i < count; i++) {
+		if constexpr (std::is_same_v<T, float>) {
+			simd::mat4Mul(&in[i].x.x, &shared.x.x, &out[i].x.x);
+		}
+		else {
+			out[i] = in[i] * shared;
+		}
+	}
+}
+// a[i] * b[i] for every pair
+template<typename T>
+void multiply(const matrix4x4<T>* a, const matrix4x4<T>* b, size_t count, matrix4x4<T>* out) {
+	for (size_t i = 0; i < count; i++) {
+		if constexpr (std::is_same_v<T, float>) {
+			simd::mat4Mul(&a[i].x.x, &b[i].x.x, &out[i].x.x);
+		}
+		else {
+			out[i] = a[i] * b[i];
+		}
+	}
+}
+
+// Product of every pair a[i] * b[i] of affine matrices, e.g. skinning matrices from bone world
+// matrices and inverse bind poses. out may be the same array as a or b
+template<typename T>
+void multiply(const matrix3x4<T>* a, const matrix3x4<T>* b, size_t count, matrix3x4<T>* out) {
+	for (size_t i = 0; i < count; i++) {
+		if constexpr (std::is_same_v<T, float>) {
+			simd::mat3x4Mul(&a[i].x.x, &b[i].x.x, &out[i].x.x);
+		}
+		else {
+			out[i] = a[i] * b[i];
+		}
+	}
+}
+// parent * in[i] for every matrix, e.g. instance matrices moved by the matrix of their group
+template<typename T>
+void multiply(const matrix3x4<T>& parent, const matrix3x4<T>* in, size_t count, matrix3x4<T>* out) {
+	for (size_t i = 0; i < count; i++) {
+		if constexpr (std::is_same_v<T, float>) {
+			simd::mat3x4Mul(&parent.x.x, &in[i].x.x, &out[i].x.x);
+		}
+		else {
+			out[i] = parent * in[i];
+		}
+	}
+}
+
+// World matrices of a hierarchy, world[i] = world[parents[i]] * local[i]
+// Parents must come before their children (parents[i] < i), roots have a negative parent
+// The worlds are composed in scratch memory and every world[i] is written once in order and never
+// read, so world can be a mapped GPU buffer. world must not be the same array as local
+// Runs in index order, which keeps parents in cache; parallel::composeHierarchy splits the levels of
+// the tree over a pool instead
+template<typename Matrix>
+void composeHierarchy(const Matrix* local, const int32_t* parents, size_t count, Matrix* world) {
+	// Not zeroed, every matrix is written before it is read
+	std::unique_ptr<Matrix[]> worlds = std::make_unique_for_overwrite<Matrix[]>(count);
+	for (size_t i = 0; i < count; i++) {
+		if (parents[i] < 0) {
+			worlds[i] = local[i];
+		}
+		else {
+			multiply(&worlds[parents[i]], &local[i], 1, &worlds[i]);
+		}
+		world[i] = worlds[i];
+	}
+}
+
+} // namespace soa
+} // namespace lm2
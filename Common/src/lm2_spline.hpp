@@ -0,0 +1,489 @@
+/*
+* Cubic curves and splines for lm2
+*
+* Every curve is stored as the power basis coefficients of its cubic, p(t) = a t^3 + b t^2 + c t + d
+* for t in [0, 1], so Bezier, Hermite and Catmull-Rom segments all evaluate the same way with
+* three multiply-adds per component. A spline is a list of such segments, parameter u in
+* [0, segmentCount] picks segment floor(u) at t = u - floor(u), parameters outside are clamped.
+*
+* Curves work on vec2 / vec3 / vec4 and quaternions. Quaternion keys are flipped onto the same
+* hemisphere as the previous key when a spline is built, and results are normalized, the same
+* shortest path blend as nlerp. Derivatives of quaternion curves are not normalized.
+*
+* arcLengthTable maps distance along a vector spline back to its parameter, for constant speed
+* camera paths. The bulk functions evaluate many parameters into lm2::soa streams 8 lanes at a
+* time. Blocks whose lanes share one segment broadcast its coefficients and run 8 wide, which is
+* the common case for sample and sorted parameters. Scattered parameters fall back to one lane at
+* a time and cost about as much as the scalar calls.
+*/
+#pragma once
+
+#include "lm2.hpp"
+#include "lm2_simd.hpp"
+#include "lm2_soa.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace lm2 {
+
+// a t^3 + b t^2 + c t + d
+template<typename V>
+struct cubicCurve {
+	V a, b, c, d;
+};
+
+namespace detail {
+template<typename V>
+struct curveTraits;
+
+template<typename T>
+struct curveTraits<vector2D<T>> {
+	using scalar = T;
+	using stream = soa::vector2Stream<T>;
+	static constexpr size_t components = 2;
+	static constexpr bool isQuaternion = false;
+	static constexpr T get(vector2D<T> v, size_t k) noexcept { return k == 0 ? v.x : v.y; }
+	static T* lanes(soa::vector2Block<T>& b, size_t k) noexcept { return k == 0 ? b.x : b.y; }
+};
+template<typename T>
+struct curveTraits<vector3D<T>> {
+	using scalar = T;
+	using stream = soa::vector3Stream<T>;
+	static constexpr size_t components = 3;
+	static constexpr bool isQuaternion = false;
+	static constexpr T get(vector3D<T> v, size_t k) noexcept { return k == 0 ? v.x : (k == 1 ? v.y : v.z); }
+	static T* lanes(soa::vector3Block<T>& b, size_t k) noexcept { return k == 0 ? b.x : (k == 1 ? b.y : b.z); }
+};
+template<typename T>
+struct curveTraits<vector4D<T>> {
+	using scalar = T;
+	using stream = soa::vector4Stream<T>;
+	static constexpr size_t components = 4;
+	static constexpr bool isQuaternion = false;
+	static constexpr T get(vector4D<T> v, size_t k) noexcept { return k == 0 ? v.x : (k == 1 ? v.y : (k == 2 ? v.z : v.w)); }
+	static T* lanes(soa::vector4Block<T>& b, size_t k) noexcept { return k == 0 ? b.x : (k == 1 ? b.y : (k == 2 ? b.z : b.w)); }
+};
+template<typename T>
+struct curveTraits<quaternionT<T>> {
+	using scalar = T;
+	using stream = soa::quaternionStream<T>;
+	static constexpr size_t components = 4;
+	static constexpr bool isQuaternion = true;
+	static constexpr T get(quaternionT<T> q, size_t k) noexcept { return k == 0 ? q.w : (k == 1 ? q.x : (k == 2 ? q.y : q.z)); }
+	static T* lanes(soa::quaternionBlock<T>& b, size_t k) noexcept { return k == 0 ? b.w : (k == 1 ? b.x : (k == 2 ? b.y : b.z)); }
+};
+
+template<typename V>
+using curveScalar = typename curveTraits<V>::scalar;
+
+// Quaternion results are normalized, vectors pass through
+template<typename V>
+constexpr V finishCurve(V v) noexcept {
+	if constexpr (curveTraits<V>::isQuaternion) {
+		return normalize(v);
+	}
+	else {
+		return v;
+	}
+}
+
+// Flips every quaternion key onto the hemisphere of the key before it
+template<typename V>
+std::vector<V> alignKeys(const V* keys, size_t count) {
+	std::vector<V> aligned(keys, keys + count);
+	if constexpr (curveTraits<V>::isQuaternion) {
+		for (size_t i = 1; i < count; i++) {
+			if (dot(aligned[i - 1], aligned[i]) < 0) {
+				aligned[i] = -aligned[i];
+			}
+		}
+	}
+	return aligned;
+}
+} // namespace detail
+
+// Segments
+// Bezier from p0 to p3 with control points p1 and p2
+template<typename V>
+constexpr cubicCurve<V> bezier(V p0, V p1, V p2, V p3) noexcept {
+	using T = detail::curveScalar<V>;
+	const T three = 3;
+	return {
+		p3 - p0 + (p1 - p2) * three,
+		(p0 + p2) * three - p1 * static_cast<T>(6),
+		(p1 - p0) * three,
+		p0,
+	};
+}
+// Hermite from p0 to p1 with tangents m0 and m1
+template<typename V>
+constexpr cubicCurve<V> hermite(V p0, V m0, V p1, V m1) noexcept {
+	using T = detail::curveScalar<V>;
+	return {
+		(p0 - p1) * static_cast<T>(2) + m0 + m1,
+		(p1 - p0) * static_cast<T>(3) - m0 * static_cast<T>(2) - m1,
+		m0,
+		p0,
+	};
+}
+// Uniform Catmull-Rom from p1 to p2, p0 and p3 are the neighbouring points
+template<typename V>
+constexpr cubicCurve<V> catmullRom(V p0, V p1, V p2, V p3) noexcept {
+	using T = detail::curveScalar<V>;
+	const T half = static_cast<T>(0.5);
+	return hermite(p1, (p2 - p0) * half, p2, (p3 - p1) * half);
+}
+
+template<typename V, typename T>
+constexpr V evaluate(const cubicCurve<V>& curve, T t) noexcept {
+	return ((curve.a * t + curve.b) * t + curve.c) * t + curve.d;
+}
+// Tangent, dp / dt
+template<typename V, typename T>
+constexpr V derivative(const cubicCurve<V>& curve, T t) noexcept {
+	return (curve.a * (static_cast<T>(3) * t) + curve.b * static_cast<T>(2)) * t + curve.c;
+}
+template<typename V, typename T>
+constexpr V secondDerivative(const cubicCurve<V>& curve, T t) noexcept {
+	return curve.a * (static_cast<T>(6) * t) + curve.b * static_cast<T>(2);
+}
+// Coefficients of the tangent curve, a is zero
+template<typename V>
+constexpr cubicCurve<V> derivative(const cubicCurve<V>& curve) noexcept {
+	using T = detail::curveScalar<V>;
+	return { curve.a * static_cast<T>(0), curve.a * static_cast<T>(3), curve.b * static_cast<T>(2), curve.c };
+}
+
+// Splines
+template<typename V>
+class spline {
+public:
+	using scalar = detail::curveScalar<V>;
+
+	spline() = default;
+	explicit spline(std::vector<cubicCurve<V>> segments) : mSegments(std::move(segments)) {}
+
+	size_t getSegmentCount() const noexcept {
+		return mSegments.size();
+	}
+	const std::vector<cubicCurve<V>>& getSegments() const noexcept {
+		return mSegments;
+	}
+
+	// Segment of u and the parameter inside it, u is clamped to [0, segmentCount]
+	size_t locate(scalar u, scalar& outT) const noexcept {
+		scalar last = static_cast<scalar>(mSegments.size());
+		u = u > 0 ? (u < last ? u : last) : 0;
+		size_t segment = std::min(static_cast<size_t>(u), mSegments.size() - 1);
+		outT = u - static_cast<scalar>(segment);
+		return segment;
+	}
+
+	// Empty splines evaluate to zero
+	V evaluate(scalar u) const noexcept {
+		if (mSegments.empty()) {
+			return {};
+		}
+		scalar t = 0;
+		const cubicCurve<V>& segment = mSegments[locate(u, t)];
+		return detail::finishCurve(lm2::evaluate(segment, t));
+	}
+	V derivative(scalar u) const noexcept {
+		if (mSegments.empty()) {
+			return {};
+		}
+		scalar t = 0;
+		const cubicCurve<V>& segment = mSegments[locate(u, t)];
+		return lm2::derivative(segment, t);
+	}
+
+private:
+	std::vector<cubicCurve<V>> mSegments;
+};
+
+// Catmull-Rom through every point. Open splines reflect the end points to get their outer
+// neighbours, closed ones wrap around and get a segment from the last point back to the first
+template<typename V>
+spline<V> catmullRomSpline(const V* points, size_t count, bool closed = false) {
+	std::vector<V> keys = detail::alignKeys(points, count);
+	std::vector<cubicCurve<V>> segments;
+	if (count == 1) {
+		segments.push_back(hermite(keys[0], V{}, keys[0], V{}));
+	}
+	if (count < 2) {
+		return spline<V>(std::move(segments));
+	}
+	using T = detail::curveScalar<V>;
+	auto key = [&](ptrdiff_t i) {
+		ptrdiff_t n = static_cast<ptrdiff_t>(count);
+		if (closed) {
+			V value = keys[static_cast<size_t>((i % n + n) % n)];
+			// The wrapped key has to stay on the hemisphere of its neighbours too
+			if constexpr (detail::curveTraits<V>::isQuaternion) {
+				V near = keys[static_cast<size_t>(std::clamp<ptrdiff_t>(i, 0, n - 1))];
+				value = dot(value, near) < 0 ? -value : value;
+			}
+			return value;
+		}
+		if (i < 0) {
+			return keys[0] * static_cast<T>(2) - keys[1];
+		}
+		if (i >= n) {
+			return keys[count - 1] * static_cast<T>(2) - keys[count - 2];
+		}
+		return keys[static_cast<size_t>(i)];
+	};
+	size_t segmentCount = closed ? count : count - 1;
+	segments.reserve(segmentCount);
+	for (size_t i = 0; i < segmentCount; i++) {
+		ptrdiff_t at = static_cast<ptrdiff_t>(i);
+		segments.push_back(catmullRom(key(at - 1), key(at), key(at + 1), key(at + 2)));
+	}
+	return spline<V>(std::move(segments));
+}
+
+// Bezier segments sharing end points, count is 3 * segmentCount + 1, a trailing partial segment
+// is ignored
+template<typename V>
+spline<V> bezierSpline(const V* controlPoints, size_t count) {
+	std::vector<V> keys = detail::alignKeys(controlPoints, count);
+	std::vector<cubicCurve<V>> segments;
+	for (size_t i = 0; i + 3 < count; i += 3) {
+		segments.push_back(bezier(keys[i], keys[i + 1], keys[i + 2], keys[i + 3]));
+	}
+	return spline<V>(std::move(segments));
+}
+
+// Hermite segments through every point with the given tangents
+template<typename V>
+spline<V> hermiteSpline(const V* points, const V* tangents, size_t count) {
+	std::vector<V> keys = detail::alignKeys(points, count);
+	std::vector<cubicCurve<V>> segments;
+	for (size_t i = 0; i + 1 < count; i++) {
+		// A flipped quaternion key flips its tangent with it
+		V m0 = tangents[i], m1 = tangents[i + 1];
+		if constexpr (detail::curveTraits<V>::isQuaternion) {
+			m0 = dot(keys[i], points[i]) < 0 ? -m0 : m0;
+			m1 = dot(keys[i + 1], points[i + 1]) < 0 ? -m1 : m1;
+		}
+		segments.push_back(hermite(keys[i], m0, keys[i + 1], m1));
+	}
+	return spline<V>(std::move(segments));
+}
+
+// Arc length
+// Cumulative length at samplesPerSegment points per segment, each interval integrated with
+// 3 point Gauss-Legendre. Lookups interpolate linearly between the samples
+template<typename V>
+class arcLengthTable {
+public:
+	using scalar = detail::curveScalar<V>;
+	static_assert(!detail::curveTraits<V>::isQuaternion, "arc length needs a vector spline");
+
+	arcLengthTable() = default;
+	explicit arcLengthTable(const spline<V>& curve, size_t samplesPerSegment = 16) : mSamplesPerSegment(std::max<size_t>(samplesPerSegment, 1)) {
+		const scalar nodes[3] = { static_cast<scalar>(-0.7745966692414834), 0, static_cast<scalar>(0.7745966692414834) };
+		const scalar weights[3] = { static_cast<scalar>(5.0 / 9.0), static_cast<scalar>(8.0 / 9.0), static_cast<scalar>(5.0 / 9.0) };
+		scalar step = static_cast<scalar>(1) / static_cast<scalar>(mSamplesPerSegment);
+		mDistances.reserve(curve.getSegmentCount() * mSamplesPerSegment + 1);
+		mDistances.push_back(0);
+		scalar total = 0;
+		for (const cubicCurve<V>& segment : curve.getSegments()) {
+			for (size_t i = 0; i < mSamplesPerSegment; i++) {
+				scalar middle = (static_cast<scalar>(i) + static_cast<scalar>(0.5)) * step;
+				scalar interval = 0;
+				for (size_t k = 0; k < 3; k++) {
+					interval += weights[k] * magnitude(lm2::derivative(segment, middle + nodes[k] * step * static_cast<scalar>(0.5)));
+				}
+				total += interval * step * static_cast<scalar>(0.5);
+				mDistances.push_back(total);
+			}
+		}
+	}
+
+	scalar getLength() const noexcept {
+		return mDistances.empty() ? 0 : mDistances.back();
+	}
+
+	// Spline parameter at distance along the curve, distance is clamped to [0, length]
+	scalar parameter(scalar distance) const noexcept {
+		if (mDistances.size() < 2) {
+			return 0;
+		}
+		auto above = std::upper_bound(mDistances.begin() + 1, mDistances.end() - 1, distance);
+		size_t i = static_cast<size_t>(above - mDistances.begin()) - 1;
+		scalar width = mDistances[i + 1] - mDistances[i];
+		scalar f = width > 0 ? (distance - mDistances[i]) / width : 0;
+		f = f > 0 ? (f < 1 ? f : 1) : 0;
+		return (static_cast<scalar>(i) + f) / static_cast<scalar>(mSamplesPerSegment);
+	}
+
+private:
+	std::vector<scalar> mDistances;
+	size_t mSamplesPerSegment = 16;
+};
+
+// Bulk evaluation
+namespace detail {
+// Same coefficients in every lane
+template<typename T>
+void hornerBroadcast(T a, T b, T c, T d, const T* t, T* out) noexcept {
+	if constexpr (std::is_same_v<T, float>) {
+		simd::float8 vt = simd::load8(t);
+		simd::float8 r = simd::mulAdd(simd::set1x8(a), vt, simd::set1x8(b));
+		r = simd::mulAdd(r, vt, simd::set1x8(c));
+		simd::store(out, simd::mulAdd(r, vt, simd::set1x8(d)));
+	}
+	else {
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			out[l] = ((a * t[l] + b) * t[l] + c) * t[l] + d;
+		}
+	}
+}
+
+template<typename T>
+void normalizeQuaternionLanes(soa::quaternionBlock<T>& q) noexcept {
+	if constexpr (std::is_same_v<T, float>) {
+		simd::float8 w = simd::load8(q.w), x = simd::load8(q.x), y = simd::load8(q.y), z = simd::load8(q.z);
+		simd::float8 lengthSquared = simd::mulAdd(w, w, simd::mulAdd(x, x, simd::mulAdd(y, y, simd::mul(z, z))));
+		simd::float8 scale = simd::div(simd::set1x8(1.0f), simd::sqrt(lengthSquared));
+		simd::store(q.w, simd::mul(w, scale));
+		simd::store(q.x, simd::mul(x, scale));
+		simd::store(q.y, simd::mul(y, scale));
+		simd::store(q.z, simd::mul(z, scale));
+	}
+	else {
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			quaternionT<T> n = normalize(quaternionT<T>{ q.w[l], q.x[l], q.y[l], q.z[l] });
+			q.w[l] = n.w;
+			q.x[l] = n.x;
+			q.y[l] = n.y;
+			q.z[l] = n.z;
+		}
+	}
+}
+
+// Evaluates count parameters into out, parameter(i, u) fills the 8 lanes of block i
+// With Tangent set the derivative is evaluated instead and never normalized
+template<bool Tangent, typename V, typename Parameter>
+void evaluateBlocks(const cubicCurve<V>* segments, size_t segmentCount, size_t count, Parameter parameter, typename curveTraits<V>::stream& out) {
+	using Traits = curveTraits<V>;
+	using T = typename Traits::scalar;
+	constexpr size_t components = Traits::components;
+	out.resize(count);
+	if (segmentCount == 0) {
+		for (auto& block : out.blocks) {
+			block = {};
+		}
+		return;
+	}
+
+	auto coefficients = [&](int32_t s) {
+		if constexpr (Tangent) {
+			return derivative(segments[s]);
+		}
+		else {
+			return segments[s];
+		}
+	};
+	T last = static_cast<T>(segmentCount);
+	alignas(32) T u[soa::blockSize];
+	alignas(32) T t[soa::blockSize];
+	alignas(32) int32_t segment[soa::blockSize];
+	int32_t lastSegment = static_cast<int32_t>(segmentCount - 1);
+	for (size_t i = 0; i < out.blockCount(); i++) {
+		parameter(i, u);
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			// int32_t converts in vector registers, size_t does not
+			T clamped = u[l] > 0 ? (u[l] < last ? u[l] : last) : 0;
+			int32_t s = static_cast<int32_t>(clamped);
+			segment[l] = s < lastSegment ? s : lastSegment;
+			t[l] = clamped - static_cast<T>(segment[l]);
+		}
+
+		auto& block = out.blocks[i];
+		int sharedLanes = 0;
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			sharedLanes += segment[l] == segment[0];
+		}
+		bool shared = sharedLanes == soa::blockSize;
+		if (shared) {
+			cubicCurve<V> curve = coefficients(segment[0]);
+			for (size_t k = 0; k < components; k++) {
+				hornerBroadcast(Traits::get(curve.a, k), Traits::get(curve.b, k), Traits::get(curve.c, k), Traits::get(curve.d, k), t, Traits::lanes(block, k));
+			}
+		}
+		else {
+			// Gathering the coefficients into lanes costs more than evaluating every lane on its own
+			for (size_t l = 0; l < soa::blockSize; l++) {
+				V value = evaluate(coefficients(segment[l]), t[l]);
+				for (size_t k = 0; k < components; k++) {
+					Traits::lanes(block, k)[l] = Traits::get(value, k);
+				}
+			}
+		}
+		if constexpr (Traits::isQuaternion && !Tangent) {
+			normalizeQuaternionLanes(block);
+		}
+	}
+}
+} // namespace detail
+
+// out.get(i) = curve at t.get(i), t is clamped to [0, 1]
+template<typename V>
+void evaluate(const cubicCurve<V>& curve, const soa::scalarStream<detail::curveScalar<V>>& t, typename detail::curveTraits<V>::stream& out) {
+	detail::evaluateBlocks<false>(&curve, 1, t.size(), [&](size_t i, auto& lanes) {
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			lanes[l] = t.blocks[i].v[l];
+		}
+	}, out);
+}
+// out.get(i) = curve at u.get(i)
+template<typename V>
+void evaluate(const spline<V>& curve, const soa::scalarStream<detail::curveScalar<V>>& u, typename detail::curveTraits<V>::stream& out) {
+	detail::evaluateBlocks<false>(curve.getSegments().data(), curve.getSegmentCount(), u.size(), [&](size_t i, auto& lanes) {
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			lanes[l] = u.blocks[i].v[l];
+		}
+	}, out);
+}
+// out.get(i) = tangent at u.get(i)
+template<typename V>
+void derivative(const spline<V>& curve, const soa::scalarStream<detail::curveScalar<V>>& u, typename detail::curveTraits<V>::stream& out) {
+	detail::evaluateBlocks<true>(curve.getSegments().data(), curve.getSegmentCount(), u.size(), [&](size_t i, auto& lanes) {
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			lanes[l] = u.blocks[i].v[l];
+		}
+	}, out);
+}
+
+// count points at evenly spaced parameters from the start to the end of the spline
+template<typename V>
+void sample(const spline<V>& curve, size_t count, typename detail::curveTraits<V>::stream& out) {
+	using T = detail::curveScalar<V>;
+	T step = count > 1 ? static_cast<T>(curve.getSegmentCount()) / static_cast<T>(count - 1) : 0;
+	detail::evaluateBlocks<false>(curve.getSegments().data(), curve.getSegmentCount(), count, [&](size_t i, auto& lanes) {
+		T first = static_cast<T>(i * soa::blockSize);
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			lanes[l] = (first + static_cast<T>(static_cast<int32_t>(l))) * step;
+		}
+	}, out);
+}
+// count points evenly spaced by distance along the curve, table has to be built from curve
+template<typename V>
+void sampleByDistance(const spline<V>& curve, const arcLengthTable<V>& table, size_t count, typename detail::curveTraits<V>::stream& out) {
+	using T = detail::curveScalar<V>;
+	T step = count > 1 ? table.getLength() / static_cast<T>(count - 1) : 0;
+	detail::evaluateBlocks<false>(curve.getSegments().data(), curve.getSegmentCount(), count, [&](size_t i, auto& lanes) {
+		T first = static_cast<T>(i * soa::blockSize);
+		for (size_t l = 0; l < soa::blockSize; l++) {
+			lanes[l] = table.parameter((first + static_cast<T>(static_cast<int32_t>(l))) * step);
+		}
+	}, out);
+}
+
+} // namespace lm2
@@ -0,0 +1,122 @@
+/*
+* Translation, rotation and scale transform with cached matrices
+*
+* The local matrix is rebuilt only after a setter was called, the world matrix only when the
+* local matrix or the parent's world matrix changed. Parents are tracked by a version number
+* that increases every time a world matrix is rebuilt, so children notice a moved parent
+* without the parent keeping a list of children. A parent must outlive its children.
+*/
+#pragma once
+
+#include "lm2.hpp"
+
+#include <cstdint>
+
+namespace lm2 {
+
+template<typename T>
+class transformT {
+public:
+	constexpr transformT() noexcept = default;
+	constexpr transformT(vector3D<T> position, quaternionT<T> rotation = identityQuaternion<T>(), vector3D<T> scale = { 1, 1, 1 }) noexcept
+		: mPosition(position), mRotation(rotation), mScale(scale) {}
+	// Shear of the matrix is lost, see lm2::decompose
+	constexpr explicit transformT(const matrix4x4<T>& local) noexcept {
+		setLocalMatrix(local);
+	}
+
+	constexpr vector3D<T> getPosition() const noexcept { return mPosition; }
+	constexpr quaternionT<T> getRotation() const noexcept { return mRotation; }
+	constexpr vector3D<T> getScale() const noexcept { return mScale; }
+	constexpr const transformT* getParent() const noexcept { return mParent; }
+
+	constexpr void setPosition(vector3D<T> position) noexcept {
+		mPosition = position;
+		markDirty();
+	}
+	constexpr void setRotation(quaternionT<T> rotation) noexcept {
+		mRotation = rotation;
+		markDirty();
+	}
+	constexpr void setScale(vector3D<T> scale) noexcept {
+		mScale = scale;
+		markDirty();
+	}
+	constexpr void setLocalMatrix(const matrix4x4<T>& local) noexcept {
+		decompose(local, mPosition, mRotation, mScale);
+		markDirty();
+	}
+	constexpr void setParent(const transformT* parent) noexcept {
+		mParent = parent;
+		mWorldDirty = true;
+	}
+
+	constexpr void translate(vector3D<T> offset) noexcept {
+		setPosition(mPosition + offset);
+	}
+	// Applied after the current rotation
+	constexpr void rotate(quaternionT<T> rotation) noexcept {
+		setRotation(normalize(rotation * mRotation));
+	}
+
+	constexpr const matrix4x4<T>& getLocalMatrix() const noexcept {
+		if (mLocalDirty) {
+			mLocal = compose(mPosition, mRotation, mScale);
+			mLocalDirty = false;
+		}
+		return mLocal;
+	}
+	constexpr const matrix4x4<T>& getWorldMatrix() const noexcept {
+		if (mParent) {
+			const matrix4x4<T>& parentWorld = mParent->getWorldMatrix();
+			if (mWorldDirty || mParentVersion != mParent->mVersion) {
+				mWorld = parentWorld * getLocalMatrix();
+				mParentVersion = mParent->mVersion;
+				mWorldDirty = false;
+				mVersion++;
+			}
+		}
+		else if (mWorldDirty) {
+			mWorld = getLocalMatrix();
+			mWorldDirty = false;
+			mVersion++;
+		}
+		return mWorld;
+	}
+	// Translation of the world matrix
+	constexpr vector3D<T> getWorldPosition() const noexcept {
+		const matrix4x4<T>& world = getWorldMatrix();
+		return { world.x.w, world.y.w, world.z.w };
+	}
+
+	// True until the next getWorldMatrix call after a change of this transform or a parent
+	constexpr bool isDirty() const noexcept {
+		if (mWorldDirty) {
+			return true;
+		}
+		return mParent && (mParent->isDirty() || mParentVersion != mParent->mVersion);
+	}
+
+private:
+	constexpr void markDirty() noexcept {
+		mLocalDirty = true;
+		mWorldDirty = true;
+	}
+
+	vector3D<T> mPosition{ 0, 0, 0 };
+	quaternionT<T> mRotation = identityQuaternion<T>();
+	vector3D<T> mScale{ 1, 1, 1 };
+	const transformT* mParent = nullptr;
+
+	mutable matrix4x4<T> mLocal{};
+	mutable matrix4x4<T> mWorld{};
+	mutable bool mLocalDirty = true;
+	mutable bool mWorldDirty = true;
+	// Increased on every rebuild of mWorld
+	mutable uint32_t mVersion = 0;
+	mutable uint32_t mParentVersion = 0;
+};
+
+using transform = transformT<float>;
+
+} // namespace lm2
@@ -1,15 +1,50 @@
 /*
 * A simple single header Unit testing library
+*
+* Tests run on a pool of worker threads and are reported in registration order with their wall
+* time, followed by the slowest ones. RUN_TESTS(argc, argv) understands:
+*   --filter=pattern  only tests whose name contains pattern, '*' matches any run of characters
+*   --jobs=N          worker threads, 1 runs every test on the calling thread, default every core
+*   --shard=I/N       only every N-th test starting at I, to split a suite over processes
+*   --slowest=N       how many of the slowest tests to list, default 5
+*   --json=path       write the results as JSON
+*   --junit=path      write the results as JUnit XML
+*   --list            print the selected test names without running them
+*
+* BENCHMARK_CASE(name) bodies set up their data and pass the timed work to bench.Measure. With
+* --bench the benchmarks run one after another instead of the tests: iterations per sample are
+* calibrated to --sample-time after a --warmup, and --samples per iteration times give the median,
+* MAD, p95 and the throughput set with bench.SetItems / bench.SetBytes.
+*   --bench           run the benchmarks, --filter, --json and --junit apply to them
+*   --samples=N       samples per benchmark, default 30
+*   --sample-time=ms  calibrated length of one sample, default 10
+*   --warmup=ms       time spent running the benchmark before sampling, default 100
+*   --baseline=path   compare with a file written by --json, regressions fail the run
+*   --threshold=x     allowed slowdown of the median over the baseline, default 0.1 for 10%
 */
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <exception>
+#include <fstream>
 #include <functional>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 #include <iostream>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
 enum class LogColor {
 	Normal,
 	White,
@@ -22,38 +57,217 @@ struct TestFail_Type {
 	std::string_view what;
 };
 
+struct TestResult {
+	std::string_view name;
+	bool passed = false;
+	std::string message;
+	double seconds = 0.0;
+};
+
+struct TestOptions {
+	std::string filter;
+	unsigned jobs = 0;
+	unsigned shard = 0;
+	unsigned shardCount = 1;
+	size_t slowest = 5;
+	std::string jsonPath;
+	std::string junitPath;
+	bool list = false;
+	bool bench = false;
+	size_t samples = 30;
+	double sampleTime = 0.01;
+	double warmupTime = 0.1;
+	std::string baselinePath;
+	double threshold = 0.1;
+};
+
+// Keeps value and everything it points to alive as if it was read
+template<typename T>
+inline void DoNotOptimize(T&& value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	const volatile void* address = &value;
+	(void)address;
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+// Forces pending writes to memory as if something read them
+inline void ClobberMemory() {
+#if defined(_MSC_VER) && !defined(__clang__)
+	_ReadWriteBarrier();
+#else
+	asm volatile("" : : : "memory");
+#endif
+}
+
+class BenchmarkState {
+public:
+	// Times func, calibrating how many calls make up a sample
+	template<typename Func>
+	void Measure(Func&& func) {
+		auto batch = [&](size_t iterations) {
+			auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < iterations; i++) {
+				func();
+			}
+			ClobberMemory();
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		};
+		// Warmup doubles as calibration, growing the batch until it fills a sample
+		size_t iterations = 1;
+		auto warmupEnd = std::chrono::steady_clock::now() + std::chrono::duration<double>(mWarmupTime);
+		while (true) {
+			double seconds = batch(iterations);
+			if (seconds >= mSampleTime && std::chrono::steady_clock::now() >= warmupEnd) {
+				break;
+			}
+			if (seconds < mSampleTime) {
+				size_t scaled = seconds > 0.0 ? static_cast<size_t>(iterations * mSampleTime / seconds) + 1 : iterations * 10;
+				iterations = std::min(scaled, iterations * 10);
+			}
+		}
+		mIterations = iterations;
+		mSamples.clear();
+		for (size_t i = 0; i < mSampleCount; i++) {
+			mSamples.push_back(batch(iterations) / iterations);
+		}
+	}
+
+	// Work done by one call of the measured function, for the throughput
+	void SetItems(double items) {
+		mItems = items;
+	}
+	void SetBytes(double bytes) {
+		mBytes = bytes;
+	}
+
+private:
+	friend class TestRunner;
+
+	size_t mSampleCount = 30;
+	double mSampleTime = 0.01;
+	double mWarmupTime = 0.1;
+	size_t mIterations = 0;
+	double mItems = 0.0;
+	double mBytes = 0.0;
+	std::vector<double> mSamples;
+};
+
+struct BenchmarkResult {
+	std::string_view name;
+	size_t iterations = 0;
+	// Seconds per iteration
+	double median = 0.0;
+	double mad = 0.0;
+	double p95 = 0.0;
+	double itemsPerSecond = 0.0;
+	double bytesPerSecond = 0.0;
+	double baseline = 0.0;
+	bool regressed = false;
+	std::string message;
+};
+
 static class TestRunner {
 public:
 	void RegisterTest(const char* name, std::function<void()> func) {
 		mTests.emplace_back(name, func);
 	}
 
-	void RunTests(std::string file) {
+	void RegisterBenchmark(const char* name, std::function<void(BenchmarkState&)> func) {
+		mBenchmarks.emplace_back(name, func);
+	}
+
+	// Returns the process exit code, 1 when a test failed
+	int RunTests(std::string file, int argc = 0, char** argv = nullptr) {
+		TestOptions options;
+		if (!ParseOptions(argc, argv, options)) {
+			return 2;
+		}
+		if (options.bench) {
+			return RunBenchmarks(file, options);
+		}
+
+		std::vector<size_t> selected;
+		for (size_t i = 0; i < mTests.size(); i++) {
+			if (i % options.shardCount == options.shard && Matches(options.filter, mTests[i].first)) {
+				selected.push_back(i);
+			}
+		}
+		if (options.list) {
+			for (size_t i : selected) {
+				std::cout << mTests[i].first << "\n";
+			}
+			return 0;
+		}
+
+		unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+		jobs = static_cast<unsigned>(std::min<size_t>(jobs, std::max<size_t>(selected.size(), 1)));
+		Log("Running tests from: " + file, LogColor::White);
+
+		std::vector<TestResult> results(selected.size());
+		std::atomic<size_t> next = 0;
+		auto worker = [&] {
+			for (size_t i = next++; i < selected.size(); i = next++) {
+				results[i] = Run(mTests[selected[i]]);
+			}
+		};
+		auto start = std::chrono::steady_clock::now();
+		if (jobs == 1) {
+			worker();
+		}
+		else {
+			std::vector<std::thread> threads;
+			for (unsigned i = 0; i < jobs; i++) {
+				threads.emplace_back(worker);
+			}
+			for (std::thread& thread : threads) {
+				thread.join();
+			}
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
 		int failed = 0;
 		int passed = 0;
-		Log("Running tests from: " + file, LogColor::White);
-		for (auto& test : mTests) {
+		for (const TestResult& result : results) {
 			std::cout << "  ";
-			Log(test.first, LogColor::White);
-			try {
-				test.second();
-				Log("    passed", LogColor::Green);
+			Log(result.name, LogColor::White);
+			if (result.passed) {
+				Log("    passed (" + FormatTime(result.seconds) + ")", LogColor::Green);
 				passed++;
 			}
-			catch (TestFail_Type fail) {
-				Log("    failed", LogColor::Red);
+			else {
+				Log("    failed (" + FormatTime(result.seconds) + ")", LogColor::Red);
 				std::cout << "    ";
-				Log(fail.what, LogColor::Red);
+				Log(result.message, LogColor::Red);
 				failed++;
 			}
-			catch (std::exception e) {
-				std::cout << "    ";
-				Log(e.what(), LogColor::Red);
-				failed++;
+		}
+
+		std::vector<const TestResult*> slowest;
+		for (const TestResult& result : results) {
+			slowest.push_back(&result);
+		}
+		std::sort(slowest.begin(), slowest.end(), [](const TestResult* a, const TestResult* b) { return a->seconds > b->seconds; });
+		slowest.resize(std::min(slowest.size(), options.slowest));
+		if (!slowest.empty()) {
+			Log("Slowest tests:", LogColor::Yellow);
+			for (const TestResult* result : slowest) {
+				std::cout << "  " << FormatTime(result->seconds) << " " << result->name << "\n";
 			}
 		}
 
+		if (!options.jsonPath.empty()) {
+			WriteJson(options.jsonPath, file, results, seconds);
+		}
+		if (!options.junitPath.empty()) {
+			WriteJUnit(options.junitPath, file, results, seconds);
+		}
+
+		std::cout << "Ran " << results.size() << " tests in " << FormatTime(seconds) << " on " << jobs << " threads\n";
 		std::cout << "Passed: " << passed << ", Failed: " << failed << "\n";
+		return failed ? 1 : 0;
 	}
 
 	void Log(std::string_view log, LogColor color) {
@@ -79,7 +293,384 @@ public:
 	}
 
 private:
-	std::vector< std::pair< std::string_view, std::function<void()> > >  mTests;
+	using Test = std::pair< std::string_view, std::function<void()> >;
+	using Benchmark = std::pair< std::string_view, std::function<void(BenchmarkState&)> >;
+
+	static TestResult Run(const Test& test) {
+		TestResult result;
+		result.name = test.first;
+		auto start = std::chrono::steady_clock::now();
+		try {
+			test.second();
+			result.passed = true;
+		}
+		catch (const TestFail_Type& fail) {
+			result.message = fail.what;
+		}
+		catch (const std::exception& e) {
+			result.message = e.what();
+		}
+		catch (...) {
+			result.message = "unknown exception";
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+	int RunBenchmarks(const std::string& file, const TestOptions& options) {
+		std::vector<std::pair<std::string, double>> baseline;
+		if (!options.baselinePath.empty() && !ReadBaseline(options.baselinePath, baseline)) {
+			Log("Could not read baseline " + options.baselinePath, LogColor::Red);
+			return 2;
+		}
+
+		Log("Running benchmarks from: " + file, LogColor::White);
+		std::vector<BenchmarkResult> results;
+		for (size_t i = 0; i < mBenchmarks.size(); i++) {
+			const Benchmark& benchmark = mBenchmarks[i];
+			if (i % options.shardCount != options.shard || !Matches(options.filter, benchmark.first)) {
+				continue;
+			}
+			if (options.list) {
+				std::cout << benchmark.first << "\n";
+				continue;
+			}
+			BenchmarkState state;
+			state.mSampleCount = options.samples;
+			state.mSampleTime = options.sampleTime;
+			state.mWarmupTime = options.warmupTime;
+			BenchmarkResult result;
+			result.name = benchmark.first;
+			try {
+				benchmark.second(state);
+			}
+			catch (const TestFail_Type& fail) {
+				result.message = fail.what;
+			}
+			catch (const std::exception& e) {
+				result.message = e.what();
+			}
+			catch (...) {
+				result.message = "unknown exception";
+			}
+			if (result.message.empty() && state.mSamples.empty()) {
+				result.message = "bench.Measure was not called";
+			}
+			if (result.message.empty()) {
+				Summarize(state, result);
+				for (const auto& [name, median] : baseline) {
+					if (name == result.name) {
+						result.baseline = median;
+						result.regressed = result.median > median * (1 + options.threshold);
+					}
+				}
+				if (result.regressed) {
+					char text[96];
+					std::snprintf(text, sizeof(text), "median %s is %.1f%% over the baseline %s", FormatDuration(result.median).c_str(),
+						(result.median / result.baseline - 1) * 100, FormatDuration(result.baseline).c_str());
+					result.message = text;
+				}
+			}
+			Report(result);
+			results.push_back(std::move(result));
+		}
+		if (options.list) {
+			return 0;
+		}
+
+		if (!options.jsonPath.empty()) {
+			WriteBenchmarkJson(options.jsonPath, file, results);
+		}
+		if (!options.junitPath.empty()) {
+			std::vector<TestResult> cases;
+			for (const BenchmarkResult& result : results) {
+				cases.push_back({ result.name, result.message.empty(), result.message, result.median });
+			}
+			WriteJUnit(options.junitPath, file, cases, 0.0);
+		}
+
+		int failed = static_cast<int>(std::count_if(results.begin(), results.end(), [](const BenchmarkResult& result) { return !result.message.empty(); }));
+		std::cout << "Passed: " << results.size() - failed << ", Failed: " << failed << "\n";
+		return failed ? 1 : 0;
+	}
+
+	// Linear interpolation between the closest ranks of sorted values
+	static double Quantile(const std::vector<double>& sorted, double q) {
+		double position = q * (sorted.size() - 1);
+		size_t below = static_cast<size_t>(position);
+		size_t above = std::min(below + 1, sorted.size() - 1);
+		return sorted[below] + (sorted[above] - sorted[below]) * (position - below);
+	}
+
+	static void Summarize(const BenchmarkState& state, BenchmarkResult& result) {
+		std::vector<double> sorted = state.mSamples;
+		std::sort(sorted.begin(), sorted.end());
+		result.iterations = state.mIterations;
+		result.median = Quantile(sorted, 0.5);
+		result.p95 = Quantile(sorted, 0.95);
+		std::vector<double> deviations;
+		for (double sample : sorted) {
+			deviations.push_back(std::abs(sample - result.median));
+		}
+		std::sort(deviations.begin(), deviations.end());
+		result.mad = Quantile(deviations, 0.5);
+		if (result.median > 0.0) {
+			result.itemsPerSecond = state.mItems / result.median;
+			result.bytesPerSecond = state.mBytes / result.median;
+		}
+	}
+
+	void Report(const BenchmarkResult& result) {
+		std::cout << "  ";
+		Log(result.name, LogColor::White);
+		if (!result.message.empty() && !result.regressed) {
+			Log("    failed", LogColor::Red);
+			std::cout << "    ";
+			Log(result.message, LogColor::Red);
+			return;
+		}
+		std::string line = "    median " + FormatDuration(result.median) + ", MAD " + FormatDuration(result.mad) + ", p95 " + FormatDuration(result.p95);
+		char text[64];
+		if (result.itemsPerSecond > 0.0) {
+			std::snprintf(text, sizeof(text), ", %.3g items/s", result.itemsPerSecond);
+			line += text;
+		}
+		if (result.bytesPerSecond > 0.0) {
+			std::snprintf(text, sizeof(text), ", %.3g GB/s", result.bytesPerSecond * 1e-9);
+			line += text;
+		}
+		if (result.baseline > 0.0) {
+			std::snprintf(text, sizeof(text), ", x%.2f of baseline", result.median / result.baseline);
+			line += text;
+		}
+		Log(line, result.regressed ? LogColor::Red : LogColor::Green);
+		if (result.regressed) {
+			std::cout << "    ";
+			Log(result.message, LogColor::Red);
+		}
+	}
+
+	static std::string FormatDuration(double seconds) {
+		char text[32];
+		if (seconds < 1e-6) {
+			std::snprintf(text, sizeof(text), "%.2f ns", seconds * 1e9);
+		}
+		else if (seconds < 1e-3) {
+			std::snprintf(text, sizeof(text), "%.2f us", seconds * 1e6);
+		}
+		else {
+			return FormatTime(seconds);
+		}
+		return text;
+	}
+
+	// Name and median of every benchmark in a file written by WriteBenchmarkJson
+	static bool ReadBaseline(const std::string& path, std::vector<std::pair<std::string, double>>& baseline) {
+		std::ifstream in(path);
+		if (!in) {
+			return false;
+		}
+		std::string line;
+		while (std::getline(in, line)) {
+			size_t name = line.find("\"name\": \"");
+			size_t median = line.find("\"median\": ");
+			if (name == std::string::npos || median == std::string::npos) {
+				continue;
+			}
+			name += 9;
+			baseline.emplace_back(line.substr(name, line.find('"', name) - name), std::strtod(line.c_str() + median + 10, nullptr));
+		}
+		return true;
+	}
+
+	void WriteBenchmarkJson(const std::string& path, std::string_view file, const std::vector<BenchmarkResult>& results) {
+		std::ofstream out(path);
+		if (!out) {
+			Log("Could not write " + path, LogColor::Red);
+			return;
+		}
+		out.precision(9);
+		out << "{\n  \"file\": \"" << Escape(file, false) << "\",\n  \"benchmarks\": [";
+		for (size_t i = 0; i < results.size(); i++) {
+			const BenchmarkResult& result = results[i];
+			out << (i ? ",\n" : "\n") << "    { \"name\": \"" << Escape(result.name, false) << "\", \"median\": " << result.median << ", \"mad\": "
+				<< result.mad << ", \"p95\": " << result.p95 << ", \"iterations\": " << result.iterations << ", \"itemsPerSecond\": "
+				<< result.itemsPerSecond << ", \"bytesPerSecond\": " << result.bytesPerSecond << ", \"passed\": "
+				<< (result.message.empty() ? "true" : "false") << ", \"message\": \"" << Escape(result.message, false) << "\" }";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	bool ParseOptions(int argc, char** argv, TestOptions& options) {
+		for (int i = 1; i < argc; i++) {
+			std::string_view arg = argv[i];
+			auto value = [&](std::string_view flag, std::string_view& out) {
+				if (arg.substr(0, flag.size()) != flag) {
+					return false;
+				}
+				out = arg.substr(flag.size());
+				return true;
+			};
+			std::string_view v;
+			if (value("--filter=", v)) {
+				options.filter = v;
+			}
+			else if (value("--jobs=", v)) {
+				options.jobs = static_cast<unsigned>(std::strtoul(std::string(v).c_str(), nullptr, 10));
+			}
+			else if (value("--shard=", v)) {
+				if (std::sscanf(std::string(v).c_str(), "%u/%u", &options.shard, &options.shardCount) != 2 || options.shard >= options.shardCount) {
+					Log("Invalid shard, expected --shard=I/N with I < N: " + std::string(arg), LogColor::Red);
+					return false;
+				}
+			}
+			else if (value("--slowest=", v)) {
+				options.slowest = std::strtoul(std::string(v).c_str(), nullptr, 10);
+			}
+			else if (value("--json=", v)) {
+				options.jsonPath = v;
+			}
+			else if (value("--junit=", v)) {
+				options.junitPath = v;
+			}
+			else if (arg == "--list") {
+				options.list = true;
+			}
+			else if (arg == "--bench") {
+				options.bench = true;
+			}
+			else if (value("--samples=", v)) {
+				options.samples = std::max<size_t>(1, std::strtoul(std::string(v).c_str(), nullptr, 10));
+			}
+			else if (value("--sample-time=", v)) {
+				options.sampleTime = std::strtod(std::string(v).c_str(), nullptr) * 1e-3;
+			}
+			else if (value("--warmup=", v)) {
+				options.warmupTime = std::strtod(std::string(v).c_str(), nullptr) * 1e-3;
+			}
+			else if (value("--baseline=", v)) {
+				options.baselinePath = v;
+			}
+			else if (value("--threshold=", v)) {
+				options.threshold = std::strtod(std::string(v).c_str(), nullptr);
+			}
+			else {
+				Log("Unknown argument: " + std::string(arg), LogColor::Red);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Substring match when the pattern has no '*', a whole name match otherwise
+	static bool Matches(std::string_view pattern, std::string_view name) {
+		if (pattern.find('*') == std::string_view::npos) {
+			return name.find(pattern) != std::string_view::npos;
+		}
+		size_t p = 0, n = 0, star = std::string_view::npos, resume = 0;
+		while (n < name.size()) {
+			if (p < pattern.size() && pattern[p] == '*') {
+				star = p++;
+				resume = n;
+			}
+			else if (p < pattern.size() && pattern[p] == name[n]) {
+				p++;
+				n++;
+			}
+			else if (star != std::string_view::npos) {
+				p = star + 1;
+				n = ++resume;
+			}
+			else {
+				return false;
+			}
+		}
+		while (p < pattern.size() && pattern[p] == '*') {
+			p++;
+		}
+		return p == pattern.size();
+	}
+
+	static std::string FormatTime(double seconds) {
+		char text[32];
+		if (seconds < 1.0) {
+			std::snprintf(text, sizeof(text), "%.2f ms", seconds * 1e3);
+		}
+		else {
+			std::snprintf(text, sizeof(text), "%.2f s", seconds);
+		}
+		return text;
+	}
+
+	static std::string Escape(std::string_view text, bool xml) {
+		std::string out;
+		for (char c : text) {
+			if (xml) {
+				switch (c) {
+				case '&': out += "&amp;"; break;
+				case '<': out += "&lt;"; break;
+				case '>': out += "&gt;"; break;
+				case '"': out += "&quot;"; break;
+				case '\'': out += "&apos;"; break;
+				default: out += c; break;
+				}
+			}
+			else if (c == '"' || c == '\\') {
+				out += '\\';
+				out += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20) {
+				char code[8];
+				std::snprintf(code, sizeof(code), "\\u%04x", c);
+				out += code;
+			}
+			else {
+				out += c;
+			}
+		}
+		return out;
+	}
+
+	void WriteJson(const std::string& path, std::string_view file, const std::vector<TestResult>& results, double seconds) {
+		std::ofstream out(path);
+		if (!out) {
+			Log("Could not write " + path, LogColor::Red);
+			return;
+		}
+		out << "{\n  \"file\": \"" << Escape(file, false) << "\",\n  \"seconds\": " << seconds << ",\n  \"tests\": [";
+		for (size_t i = 0; i < results.size(); i++) {
+			const TestResult& result = results[i];
+			out << (i ? ",\n" : "\n") << "    { \"name\": \"" << Escape(result.name, false) << "\", \"passed\": " << (result.passed ? "true" : "false")
+				<< ", \"seconds\": " << result.seconds << ", \"message\": \"" << Escape(result.message, false) << "\" }";
+		}
+		out << "\n  ]\n}\n";
+	}
+
+	void WriteJUnit(const std::string& path, std::string_view file, const std::vector<TestResult>& results, double seconds) {
+		std::ofstream out(path);
+		if (!out) {
+			Log("Could not write " + path, LogColor::Red);
+			return;
+		}
+		size_t failures = std::count_if(results.begin(), results.end(), [](const TestResult& result) { return !result.passed; });
+		std::string suite = Escape(file, true);
+		out << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+		out << "<testsuites tests=\"" << results.size() << "\" failures=\"" << failures << "\" time=\"" << seconds << "\">\n";
+		out << "  <testsuite name=\"" << suite << "\" tests=\"" << results.size() << "\" failures=\"" << failures << "\" time=\"" << seconds << "\">\n";
+		for (const TestResult& result : results) {
+			out << "    <testcase classname=\"" << suite << "\" name=\"" << Escape(result.name, true) << "\" time=\"" << result.seconds << "\"";
+			if (result.passed) {
+				out << "/>\n";
+			}
+			else {
+				out << ">\n      <failure message=\"" << Escape(result.message, true) << "\"/>\n    </testcase>\n";
+			}
+		}
+		out << "  </testsuite>\n</testsuites>\n";
+	}
+
+	std::vector<Test> mTests;
+	std::vector<Benchmark> mBenchmarks;
 } testRunner_Test;
 
 #define TEST_CASE(testName) \
@@ -91,7 +682,18 @@ private:
 	} testName##_RegInstance;\
 	void testName##_Test()
 
-#define RUN_TESTS() testRunner_Test.RunTests((strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__))
+// The body gets BenchmarkState& bench, reported times are per call of the function passed to bench.Measure
+#define BENCHMARK_CASE(benchName) \
+	void benchName##_Benchmark(BenchmarkState& bench); \
+	struct benchName##_BenchRegistrar { \
+		benchName##_BenchRegistrar() { \
+			testRunner_Test.RegisterBenchmark(#benchName, benchName##_Benchmark); \
+		}\
+	} benchName##_BenchRegInstance;\
+	void benchName##_Benchmark(BenchmarkState& bench)
+
+// RUN_TESTS() or RUN_TESTS(argc, argv) to take the options from the command line
+#define RUN_TESTS(...) testRunner_Test.RunTests((strrchr(__FILE__, '\\') ? strrchr(__FILE__, '\\') + 1 : __FILE__) __VA_OPT__(,) __VA_ARGS__)
 
 #define ASSERT_CONDITION(cond) \
 	if (!(cond)) { \
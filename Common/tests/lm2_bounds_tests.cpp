@@ -0,0 +1,115 @@
+#include "lm2.hpp"
+#include "lm2_bounds.hpp"
+#include "testlib.hpp"
+
+#include <cstdint>
+#include <vector>
+
+using namespace lm2;
+
+// Camera at the origin looking down -z, near 0.5 and far 10
+static frustum testFrustum() {
+	return matrix2frustum(perspective<float>(90.0f, 0.5f, 10.0f, 1) * identity4x4<float>());
+}
+
+TEST_CASE(FrustumExtraction) {
+	frustum f = testFrustum();
+	for (const plane& p : f.planes) {
+		ASSERT_CONDITION(std::abs(magnitude(p.normal) - 1) < 0.0001f);
+		ASSERT_CONDITION(signedDistance(p, vec3{ 0, 0, -5 }) > 0);
+	}
+	ASSERT_CONDITION(std::abs(signedDistance(f.planes[4], vec3{ 0, 0, -0.5f })) < 0.0001f);
+	ASSERT_CONDITION(std::abs(signedDistance(f.planes[5], vec3{ 0, 0, -10 })) < 0.0001f);
+	ASSERT_CONDITION(signedDistance(f.planes[5], vec3{ 0, 0, -11 }) < 0);
+}
+
+TEST_CASE(FrustumIntersection) {
+	frustum f = testFrustum();
+	ASSERT_CONDITION(intersects(f, aabb{ { -1, -1, -6 }, { 1, 1, -4 } }));
+	ASSERT_CONDITION(!intersects(f, aabb{ { -1, -1, 1 }, { 1, 1, 2 } }));
+	ASSERT_CONDITION(!intersects(f, aabb{ { 20, -1, -6 }, { 22, 1, -4 } }));
+	// Straddling the near plane
+	ASSERT_CONDITION(intersects(f, aabb{ { -1, -1, -1 }, { 1, 1, 1 } }));
+
+	ASSERT_CONDITION(intersects(f, sphere{ { 0, 0, -5 }, 1 }));
+	ASSERT_CONDITION(intersects(f, sphere{ { 0, 0, -11 }, 1.5f }));
+	ASSERT_CONDITION(!intersects(f, sphere{ { 0, 0, -12 }, 1.5f }));
+	ASSERT_CONDITION(!intersects(f, sphere{ { 0, 0, 3 }, 1 }));
+}
+
+TEST_CASE(AABBTransform) {
+	aabb box{ { -1, -2, -3 }, { 1, 2, 3 } };
+	ASSERT_CONDITION(equal(center(box), 0.0f) && equal(extents(box), vec3{ 1, 2, 3 }));
+
+	aabb moved = transformAABB(position3d(vec3{ 5, 0, 0 }), box);
+	ASSERT_CONDITION(equal(moved.min, vec3{ 4, -2, -3 }) && equal(moved.max, vec3{ 6, 2, 3 }));
+
+	// 90 degrees around z swaps the x and y extents
+	aabb rotated = transformAABB(mat4(rotation3D(vec3{ 0, 0, 90 })), box);
+	ASSERT_CONDITION(equal(rotated.max, vec3{ 2, 1, 3 }, 0.01f));
+
+	vec3 points[3] = { { 1, 5, -2 }, { -3, 0, 4 }, { 2, 2, 2 } };
+	aabb bounds = computeAABB(points, 3);
+	ASSERT_CONDITION(equal(bounds.min, vec3{ -3, 0, -2 }) && equal(bounds.max, vec3{ 2, 5, 4 }));
+}
+
+TEST_CASE(BatchCulling) {
+	frustum f = testFrustum();
+	const size_t count = 203;
+	std::vector<aabb> boxes(count);
+	std::vector<sphere> spheres(count);
+	std::vector<mat4> models(count);
+	uint32_t seed = 12345;
+	auto random = [&seed](float scale) {
+		seed = seed * 1664525u + 1013904223u;
+		return (float(seed >> 8) / float(1 << 24) * 2 - 1) * scale;
+	};
+	for (size_t i = 0; i < count; i++) {
+		vec3 c{ random(12), random(12), random(12) - 5 };
+		vec3 e{ 0.1f + std::abs(random(1)), 0.1f + std::abs(random(1)), 0.1f + std::abs(random(1)) };
+		boxes[i] = { c - e, c + e };
+		spheres[i] = { c, e.x };
+		models[i] = position3d(vec3{ random(12), random(12), random(12) - 5 }) * mat4(rotation3D(vec3{ random(180), random(180), random(180) }));
+	}
+
+	soa::aabbStreamF boxStream;
+	soa::sphereStreamF sphereStream;
+	soa::fromAoS(boxes.data(), count, boxStream);
+	soa::fromAoS(spheres.data(), count, sphereStream);
+
+	std::vector<uint8_t> boxMask(soa::maskBytes(count));
+	std::vector<uint8_t> sphereMask(soa::maskBytes(count));
+	std::vector<uint8_t> sharedMask(soa::maskBytes(count));
+	std::vector<uint8_t> instanceMask(soa::maskBytes(count));
+	size_t boxVisible = soa::cull(f, boxStream, boxMask.data());
+	size_t sphereVisible = soa::cull(f, sphereStream, sphereMask.data());
+	aabb localBox{ { -1, -1, -1 }, { 1, 1, 1 } };
+	size_t sharedVisible = soa::cull(f, localBox, models.data(), count, sharedMask.data());
+	size_t instanceVisible = soa::cull(f, boxStream, models.data(), instanceMask.data());
+
+	size_t expectedBoxes = 0, expectedSpheres = 0, expectedShared = 0, expectedInstances = 0;
+	for (size_t i = 0; i < count; i++) {
+		bool box = intersects(f, boxes[i]);
+		bool s = intersects(f, spheres[i]);
+		bool shared = intersects(f, transformAABB(models[i], localBox));
+		bool instance = intersects(f, transformAABB(models[i], boxes[i]));
+		ASSERT_CONDITION(soa::maskBit(boxMask.data(), i) == box);
+		ASSERT_CONDITION(soa::maskBit(sphereMask.data(), i) == s);
+		ASSERT_CONDITION(soa::maskBit(sharedMask.data(), i) == shared);
+		ASSERT_CONDITION(soa::maskBit(instanceMask.data(), i) == instance);
+		expectedBoxes += box;
+		expectedSpheres += s;
+		expectedShared += shared;
+		expectedInstances += instance;
+	}
+	ASSERT_CONDITION(boxVisible == expectedBoxes && boxVisible > 0 && boxVisible < count);
+	ASSERT_CONDITION(sphereVisible == expectedSpheres);
+	ASSERT_CONDITION(sharedVisible == expectedShared);
+	ASSERT_CONDITION(instanceVisible == expectedInstances);
+	// Padding bits of the last byte
+	ASSERT_CONDITION((boxMask.back() >> (count % 8)) == 0);
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,232 @@
+#include "lm2.hpp"
+#include "lm2_bvh.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace lm2;
+
+// Vertex layout of the renderer, positions are read with a stride
+struct meshVertex {
+	vec3 pos;
+	vec2 uv;
+};
+
+static_assert([] {
+	float t = 0, u = 0, v = 0;
+	ray r{ { 0.25f, 0.25f, -1 }, { 0, 0, 1 } };
+	return intersect(r, vec3{ 0, 0, 0 }, vec3{ 1, 0, 0 }, vec3{ 0, 1, 0 }, t, u, v) && t == 1 && u == 0.25f && v == 0.25f;
+}());
+static_assert([] {
+	float tNear = 0;
+	ray r{ { -2, 0.5f, 0.5f }, { 1, 0, 0 } };
+	return intersect(r, aabb{ { 0, 0, 0 }, { 1, 1, 1 } }, tNear) && tNear == 2;
+}());
+
+// Random triangle soup in a 20 unit cube
+static std::vector<meshVertex> makeSoup(size_t triangleCount) {
+	random::generator g(11);
+	std::vector<meshVertex> vertices(triangleCount * 3);
+	for (size_t i = 0; i < triangleCount; i++) {
+		vec3 center = random::uniform(g, vec3{ -10, -10, -10 }, vec3{ 10, 10, 10 });
+		for (size_t k = 0; k < 3; k++) {
+			vertices[i * 3 + k] = { center + random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 }), vec2{ 0, 0 } };
+		}
+	}
+	return vertices;
+}
+
+static std::vector<ray> makeRays(size_t count) {
+	random::generator g(12);
+	std::vector<ray> rays(count);
+	for (size_t i = 0; i < count; i++) {
+		rays[i].origin = random::uniform(g, vec3{ -15, -15, -15 }, vec3{ 15, 15, 15 });
+		rays[i].direction = random::onUnitSphere(g);
+		rays[i].tMax = i % 3 == 0 ? 8.0f : std::numeric_limits<float>::max();
+	}
+	// Axis aligned directions take the zero direction path of the slab tests
+	rays[0] = { { 0.1f, 0.2f, -20 }, { 0, 0, 1 } };
+	rays[1] = { { -20, 0.3f, 0.1f }, { 1, 0, 0 } };
+	return rays;
+}
+
+static rayHit bruteForce(const std::vector<meshVertex>& vertices, const ray& r) {
+	rayHit best;
+	for (size_t i = 0; i < vertices.size() / 3; i++) {
+		float t = 0, u = 0, v = 0;
+		if (intersect(r, vertices[i * 3].pos, vertices[i * 3 + 1].pos, vertices[i * 3 + 2].pos, t, u, v) && t < best.t) {
+			best = { t, u, v, static_cast<uint32_t>(i) };
+		}
+	}
+	return best;
+}
+
+static bool sameHit(const rayHit& a, const rayHit& b) {
+	if (a.triangle == noHit || b.triangle == noHit) {
+		return a.triangle == b.triangle;
+	}
+	return std::abs(a.t - b.t) < 1e-4f && (a.triangle == b.triangle || std::abs(a.t - b.t) < 1e-6f);
+}
+
+TEST_CASE(BVHClosestHit) {
+	std::vector<meshVertex> vertices = makeSoup(3000);
+	bvh tree = buildBVH(&vertices[0].pos, 3000, sizeof(meshVertex));
+	ASSERT_CONDITION(tree.triangleCount == 3000);
+	ASSERT_CONDITION(!tree.nodes.empty() && tree.nodes.size() < 3000);
+
+	// Every triangle is in exactly one leaf
+	std::vector<int> seen(3000);
+	for (const bvhNode& node : tree.nodes) {
+		ASSERT_CONDITION(node.count <= soa::blockSize);
+		for (uint32_t l = 0; l < node.count; l++) {
+			seen[tree.blocks[node.offset].triangle[l]]++;
+		}
+	}
+	for (int count : seen) {
+		ASSERT_CONDITION(count == 1);
+	}
+
+	std::vector<ray> rays = makeRays(2000);
+	int hits = 0;
+	for (const ray& r : rays) {
+		rayHit expected = bruteForce(vertices, r);
+		rayHit found = intersect(tree, r);
+		ASSERT_CONDITION(sameHit(found, expected));
+		ASSERT_CONDITION(occluded(tree, r) == (expected.triangle != noHit));
+		hits += expected.triangle != noHit;
+	}
+	// Both hits and misses are covered
+	ASSERT_CONDITION(hits > 200 && hits < 1800);
+}
+
+TEST_CASE(BVHPackets) {
+	std::vector<meshVertex> vertices = makeSoup(2000);
+	bvh tree = buildBVH(&vertices[0].pos, 2000, sizeof(meshVertex));
+
+	// 61 rays, the last packet is partial
+	std::vector<ray> rays = makeRays(61);
+	std::vector<rayHit> hits(61);
+	intersect(tree, rays.data(), rays.size(), hits.data());
+	std::vector<uint8_t> mask(soa::maskBytes(rays.size()));
+	occluded(tree, rays.data(), rays.size(), mask.data());
+	for (size_t i = 0; i < rays.size(); i++) {
+		rayHit single = intersect(tree, rays[i]);
+		ASSERT_CONDITION(sameHit(hits[i], single));
+		ASSERT_CONDITION(soa::maskBit(mask.data(), i) == (single.triangle != noHit));
+	}
+	ASSERT_CONDITION((mask.back() >> 5) == 0);
+
+	// Coherent packet from one eye point
+	std::vector<ray> grid;
+	for (int y = 0; y < 16; y++) {
+		for (int x = 0; x < 16; x++) {
+			grid.push_back({ { 0, 0, -30 }, normalize(vec3{ (x - 8) * 0.04f, (y - 8) * 0.04f, 1 }) });
+		}
+	}
+	std::vector<rayHit> gridHits(grid.size());
+	intersect(tree, grid.data(), grid.size(), gridHits.data());
+	for (size_t i = 0; i < grid.size(); i++) {
+		ASSERT_CONDITION(sameHit(gridHits[i], bruteForce(vertices, grid[i])));
+	}
+}
+
+TEST_CASE(BVHBuildOptions) {
+	// Indexed mesh: a 40 x 40 grid of quads in the z = 0 plane
+	std::vector<vec3> positions;
+	std::vector<uint32_t> indices;
+	for (int y = 0; y <= 40; y++) {
+		for (int x = 0; x <= 40; x++) {
+			positions.push_back({ float(x), float(y), 0 });
+		}
+	}
+	for (uint32_t y = 0; y < 40; y++) {
+		for (uint32_t x = 0; x < 40; x++) {
+			uint32_t i = y * 41 + x;
+			indices.insert(indices.end(), { i, i + 1, i + 42, i, i + 42, i + 41 });
+		}
+	}
+	bvh grid = buildBVH(positions.data(), indices.size() / 3, sizeof(vec3), indices.data());
+	rayHit hit = intersect(grid, ray{ { 10.75f, 20.25f, 5 }, { 0, 0, -1 } });
+	ASSERT_CONDITION(hit.triangle == (20 * 40 + 10) * 2);
+	ASSERT_CONDITION(std::abs(hit.t - 5) < 1e-6f);
+	ASSERT_CONDITION(intersect(grid, ray{ { 10.75f, 20.25f, 5 }, { 0, 0, -1 }, 0, 4 }).triangle == noHit);
+	ASSERT_CONDITION(!occluded(grid, ray{ { 50, 20, 5 }, { 0, 0, -1 } }));
+
+	// Parallel build gives the same tree
+	std::vector<meshVertex> vertices = makeSoup(20000);
+	bvh serial = buildBVH(&vertices[0].pos, 20000, sizeof(meshVertex));
+	threadPool pool(4);
+	bvh threaded = buildBVH(&vertices[0].pos, 20000, sizeof(meshVertex), nullptr, &pool);
+	ASSERT_CONDITION(serial.nodes.size() == threaded.nodes.size());
+	ASSERT_CONDITION(serial.blocks.size() == threaded.blocks.size());
+	ASSERT_CONDITION(std::memcmp(serial.nodes.data(), threaded.nodes.data(), serial.nodes.size() * sizeof(bvhNode)) == 0);
+	ASSERT_CONDITION(std::memcmp(serial.blocks.data(), threaded.blocks.data(), serial.blocks.size() * sizeof(triangleBlock)) == 0);
+
+	// Empty mesh
+	bvh empty = buildBVH(positions.data(), 0);
+	ASSERT_CONDITION(intersect(empty, ray{ { 0, 0, 0 }, { 0, 0, 1 } }).triangle == noHit);
+	rayHit packet[3];
+	ray rays[3] = {};
+	intersect(empty, rays, 3, packet);
+	ASSERT_CONDITION(packet[2].triangle == noHit);
+}
+
+TEST_CASE(LBVH) {
+	std::vector<meshVertex> vertices = makeSoup(3000);
+	bvh tree = buildLBVH(&vertices[0].pos, 3000, sizeof(meshVertex));
+	ASSERT_CONDITION(tree.triangleCount == 3000);
+
+	std::vector<int> seen(3000);
+	for (size_t i = 0; i < tree.nodes.size(); i++) {
+		const bvhNode& node = tree.nodes[i];
+		if (node.count == 0) {
+			// Children lie inside their parent
+			const bvhNode& left = tree.nodes[i + 1];
+			const bvhNode& right = tree.nodes[node.offset];
+			ASSERT_CONDITION(left.min.x >= node.min.x && left.max.y <= node.max.y && right.min.z >= node.min.z && right.max.x <= node.max.x);
+			continue;
+		}
+		for (uint32_t l = 0; l < node.count; l++) {
+			seen[tree.blocks[node.offset].triangle[l]]++;
+		}
+	}
+	for (int count : seen) {
+		ASSERT_CONDITION(count == 1);
+	}
+
+	std::vector<ray> rays = makeRays(1000);
+	std::vector<rayHit> hits(rays.size());
+	intersect(tree, rays.data(), rays.size(), hits.data());
+	for (size_t i = 0; i < rays.size(); i++) {
+		rayHit expected = bruteForce(vertices, rays[i]);
+		ASSERT_CONDITION(sameHit(intersect(tree, rays[i]), expected));
+		ASSERT_CONDITION(sameHit(hits[i], expected));
+	}
+
+	// Parallel build gives the same tree, also with an indexed mesh
+	std::vector<meshVertex> large = makeSoup(20000);
+	std::vector<uint32_t> indices(large.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices[i] = static_cast<uint32_t>(indices.size() - 1 - i);
+	}
+	threadPool pool(4);
+	bvh serial = buildLBVH(&large[0].pos, 20000, sizeof(meshVertex), indices.data());
+	bvh threaded = buildLBVH(&large[0].pos, 20000, sizeof(meshVertex), indices.data(), &pool);
+	ASSERT_CONDITION(serial.nodes.size() == threaded.nodes.size() && serial.blocks.size() == threaded.blocks.size());
+	ASSERT_CONDITION(std::memcmp(serial.nodes.data(), threaded.nodes.data(), serial.nodes.size() * sizeof(bvhNode)) == 0);
+	ASSERT_CONDITION(std::memcmp(serial.blocks.data(), threaded.blocks.data(), serial.blocks.size() * sizeof(triangleBlock)) == 0);
+	ASSERT_CONDITION(buildLBVH(&large[0].pos, 0).nodes.empty());
+
+	// Every triangle in one spot
+	std::vector<vec3> same(300, vec3{ 1, 2, 3 });
+	bvh degenerate = buildLBVH(same.data(), 100);
+	ASSERT_CONDITION(degenerate.nodes.size() > 1);
+	ASSERT_CONDITION(intersect(degenerate, ray{ { 1, 2, 0 }, { 0, 0, 1 } }).triangle == noHit);
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
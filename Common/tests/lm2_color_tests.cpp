@@ -0,0 +1,199 @@
+#include "lm2_color.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace lm2;
+
+static_assert(color::bytesPerPixel(color::format::bgra8Srgb) == 4 && color::bytesPerPixel(color::format::rgba16Float) == 8);
+
+static uint16_t toHalf(float f) {
+	float out[8];
+	simd::store(out, color::detail::floatToHalfLanes(simd::set1x8(f)));
+	return static_cast<uint16_t>(out[0]);
+}
+
+static float fromHalf(uint16_t h) {
+	float out[8];
+	simd::store(out, color::detail::halfToFloatLanes(simd::set1x8(h)));
+	return out[0];
+}
+
+TEST_CASE(TransferFunctions) {
+	ASSERT_CONDITION(color::srgbToLinear(0.0f) == 0.0f && std::abs(color::srgbToLinear(1.0f) - 1) < 1e-6f);
+	ASSERT_CONDITION(std::abs(color::srgbToLinear(0.5f) - 0.214041f) < 1e-6f);
+	ASSERT_CONDITION(std::abs(color::linearToSrgb(color::srgbToLinear(0.3f)) - 0.3f) < 1e-6f);
+
+	// The lane versions, HDR values and negative ones included
+	const size_t count = 100003;
+	std::vector<float> in(count), decoded(count), encoded(count);
+	for (size_t i = 0; i < count; i++) {
+		in[i] = -0.1f + 8.0f * i / count;
+	}
+	color::srgbToLinear(in.data(), decoded.data(), count);
+	color::linearToSrgb(in.data(), encoded.data(), count);
+	for (size_t i = 0; i < count; i++) {
+		float d = color::srgbToLinear(in[i]), e = color::linearToSrgb(in[i]);
+		ASSERT_CONDITION(std::abs(decoded[i] - d) <= 2e-6f * std::max(1.0f, std::abs(d)));
+		ASSERT_CONDITION(std::abs(encoded[i] - e) <= 2e-6f * std::max(1.0f, std::abs(e)));
+	}
+}
+
+TEST_CASE(Srgb8) {
+	const color::detail::tables& t = color::detail::lookup();
+	for (int i = 0; i < 256; i++) {
+		float reference = color::srgbToLinear(i / 255.0f);
+		ASSERT_CONDITION(std::abs(color::srgb8ToLinear(static_cast<uint8_t>(i)) - reference) <= 1e-6f * reference + 1e-9f);
+		ASSERT_CONDITION(color::linearToSrgb8(color::srgb8ToLinear(static_cast<uint8_t>(i))) == i);
+	}
+	// Both sides of every code boundary
+	for (int k = 1; k < 256; k++) {
+		float boundary = t.threshold[k];
+		ASSERT_CONDITION(color::linearToSrgb8(boundary) == k);
+		ASSERT_CONDITION(color::linearToSrgb8(std::nextafter(boundary, 0.0f)) == k - 1);
+	}
+	// Random floats in [0, 1] against rounding the double precision curve
+	random::generator g(1);
+	for (int i = 0; i < 200000; i++) {
+		float c = std::bit_cast<float>(static_cast<uint32_t>(random::uniform(g) * 0x3F800000u));
+		ASSERT_CONDITION(color::linearToSrgb8(c) == color::detail::encodeReference(c));
+	}
+	ASSERT_CONDITION(color::linearToSrgb8(-1.0f) == 0 && color::linearToSrgb8(NAN) == 0);
+	ASSERT_CONDITION(color::linearToSrgb8(1.0f) == 255 && color::linearToSrgb8(INFINITY) == 255);
+}
+
+TEST_CASE(Half) {
+	// Every half survives the trip through float
+	for (uint32_t h = 0; h < 0x10000; h++) {
+		float f = fromHalf(static_cast<uint16_t>(h));
+		if (std::isnan(f)) {
+			ASSERT_CONDITION((h & 0x7C00) == 0x7C00 && (h & 0x3FF) != 0 && std::isnan(fromHalf(toHalf(f))));
+			continue;
+		}
+		ASSERT_CONDITION(toHalf(f) == h);
+	}
+	ASSERT_CONDITION(fromHalf(0x3C00) == 1.0f && fromHalf(0xC000) == -2.0f && fromHalf(0x0001) == std::ldexp(1.0f, -24));
+	ASSERT_CONDITION(toHalf(65504.0f) == 0x7BFF && toHalf(65520.0f) == 0x7C00 && toHalf(-INFINITY) == 0xFC00);
+	// Ties round to even
+	ASSERT_CONDITION(toHalf(1.0f + std::ldexp(1.0f, -11)) == 0x3C00 && toHalf(1.0f + 3 * std::ldexp(1.0f, -11)) == 0x3C02);
+	ASSERT_CONDITION(toHalf(std::ldexp(1.0f, -25)) == 0 && toHalf(std::ldexp(3.0f, -25)) == 0x0002);
+}
+
+TEST_CASE(Convert) {
+	const size_t width = 37, height = 13, pitch = width * 4 + 12;
+	random::generator g(2);
+	std::vector<unsigned char> image(pitch * height);
+	for (unsigned char& c : image) {
+		c = static_cast<unsigned char>(random::uniform(g) * 256);
+	}
+	auto sameRows = [&](const std::vector<unsigned char>& a, size_t aPitch, const std::vector<unsigned char>& b, size_t bPitch) {
+		for (size_t y = 0; y < height; y++) {
+			if (std::memcmp(a.data() + y * aPitch, b.data() + y * bPitch, width * 4) != 0) {
+				return false;
+			}
+		}
+		return true;
+	};
+	using color::format;
+
+	// Swizzles and round trips through wider formats give back every byte
+	std::vector<unsigned char> bgra(width * height * 4), back(width * height * 4);
+	color::convert(image.data(), format::rgba8Srgb, pitch, bgra.data(), format::bgra8Srgb, 0, width, height);
+	ASSERT_CONDITION(bgra[0] == image[2] && bgra[2] == image[0] && bgra[3] == image[3]);
+	color::convert(bgra.data(), format::bgra8Srgb, 0, back.data(), format::rgba8Srgb, 0, width, height);
+	ASSERT_CONDITION(sameRows(image, pitch, back, width * 4));
+	for (format wide : { format::rgba32Float, format::rgba16Float }) {
+		std::vector<unsigned char> linear(width * height * color::bytesPerPixel(wide));
+		color::convert(image.data(), format::rgba8Srgb, pitch, linear.data(), wide, 0, width, height);
+		color::convert(linear.data(), wide, 0, back.data(), format::rgba8Srgb, 0, width, height);
+		ASSERT_CONDITION(sameRows(image, pitch, back, width * 4));
+	}
+	std::vector<float> floats(width * height * 4);
+	color::convert(image.data(), format::bgra8Srgb, pitch, floats.data(), format::rgba32Float, 0, width, height);
+	ASSERT_CONDITION(floats[0] == color::srgb8ToLinear(image[2]) && floats[3] == image[3] / 255.0f);
+
+	// The byte table path agrees with going through floats
+	std::vector<unsigned char> direct(width * height * 4), viaFloat(width * height * 4);
+	color::convert(image.data(), format::rgba8Unorm, pitch, direct.data(), format::bgra8Srgb, 0, width, height);
+	color::convert(image.data(), format::rgba8Unorm, pitch, floats.data(), format::rgba32Float, 0, width, height);
+	color::convert(floats.data(), format::rgba32Float, 0, viaFloat.data(), format::bgra8Srgb, 0, width, height);
+	ASSERT_CONDITION(direct == viaFloat);
+	color::convert(direct.data(), format::bgra8Srgb, 0, back.data(), format::rgba8Unorm, 0, width, height);
+	color::convert(direct.data(), format::bgra8Srgb, 0, floats.data(), format::rgba32Float, 0, width, height);
+	color::convert(floats.data(), format::rgba32Float, 0, viaFloat.data(), format::rgba8Unorm, 0, width, height);
+	ASSERT_CONDITION(back == viaFloat);
+
+	// Rows on a pool
+	threadPool pool(4);
+	std::vector<unsigned char> pooled(width * height * 8), serial(width * height * 8);
+	color::convert(image.data(), format::rgba8Srgb, pitch, serial.data(), format::rgba16Float, 0, width, height);
+	color::convert(image.data(), format::rgba8Srgb, pitch, pooled.data(), format::rgba16Float, 0, width, height, &pool);
+	ASSERT_CONDITION(serial == pooled);
+}
+
+TEST_CASE(Premultiply) {
+	unsigned char unorm[8] = { 200, 100, 50, 128, 255, 255, 255, 0 };
+	color::premultiply(unorm, color::format::rgba8Unorm, 0, 2, 1);
+	ASSERT_CONDITION(unorm[0] == 100 && unorm[1] == 50 && unorm[2] == 25 && unorm[3] == 128);
+	ASSERT_CONDITION(unorm[4] == 0 && unorm[5] == 0 && unorm[6] == 0 && unorm[7] == 0);
+
+	// sRGB pixels are scaled in linear space
+	unsigned char srgb[4] = { 255, 188, 0, 128 };
+	color::premultiply(srgb, color::format::bgra8Srgb, 0, 1, 1);
+	ASSERT_CONDITION(srgb[0] == color::linearToSrgb8(128 / 255.0f) && srgb[1] == color::linearToSrgb8(color::srgb8ToLinear(188) * 128 / 255.0f));
+
+	random::generator g(3);
+	const size_t width = 19, height = 7;
+	std::vector<float> pixels(width * height * 4);
+	for (size_t i = 0; i < pixels.size(); i++) {
+		pixels[i] = i % 4 == 3 ? random::uniform(g, 0.1f, 1.0f) : random::uniform(g, 0.0f, 4.0f);
+	}
+	pixels[3] = 0;
+	std::vector<float> copy = pixels;
+	threadPool pool(3);
+	color::premultiply(copy.data(), color::format::rgba32Float, 0, width, height, &pool);
+	ASSERT_CONDITION(std::abs(copy[4] - pixels[4] * pixels[7]) < 1e-6f);
+	color::unpremultiply(copy.data(), color::format::rgba32Float, 0, width, height, &pool);
+	ASSERT_CONDITION(copy[0] == 0 && copy[1] == 0 && copy[2] == 0);
+	for (size_t i = 4; i < pixels.size(); i++) {
+		ASSERT_CONDITION(std::abs(copy[i] - pixels[i]) < 1e-5f);
+	}
+}
+
+BENCHMARK_CASE(LinearToSrgbFloat) {
+	std::vector<float> in(4096), out(4096);
+	for (size_t i = 0; i < in.size(); i++) {
+		in[i] = i / 4096.0f;
+	}
+	bench.SetItems(4096);
+	bench.Measure([&] {
+		color::linearToSrgb(in.data(), out.data(), in.size());
+		DoNotOptimize(out.data());
+	});
+}
+
+BENCHMARK_CASE(ConvertHalfToSrgb8) {
+	const size_t width = 256, height = 256;
+	std::vector<float> pixels(width * height * 4);
+	for (size_t i = 0; i < pixels.size(); i++) {
+		pixels[i] = (i % 509) / 509.0f;
+	}
+	std::vector<unsigned char> half(width * height * 8), srgb(width * height * 4);
+	color::convert(pixels.data(), color::format::rgba32Float, 0, half.data(), color::format::rgba16Float, 0, width, height);
+	bench.SetBytes(double(half.size() + srgb.size()));
+	bench.Measure([&] {
+		color::convert(half.data(), color::format::rgba16Float, 0, srgb.data(), color::format::bgra8Srgb, 0, width, height);
+		DoNotOptimize(srgb.data());
+	});
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,104 @@
+#include "lm2.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <limits>
+
+using namespace lm2;
+
+// Everything below is evaluated by the compiler
+// Scalar math
+static_assert(lm2::sqrt(4.0f) == 2.0f);
+static_assert(lm2::sqrt(0.0) == 0.0);
+static_assert(lm2::abs(lm2::sqrt(2.0) - 1.4142135623730951) < 1e-15);
+static_assert(lm2::abs(lm2::sqrt(1e30) - 1e15) < 1.0);
+static_assert(lm2::sin(0.0) == 0.0);
+static_assert(lm2::abs(lm2::sin(detail::pi / 6) - 0.5L) < 1e-15L);
+static_assert(lm2::abs(lm2::cos(detail::pi / 3) - 0.5L) < 1e-15L);
+static_assert(lm2::abs(lm2::sin(100.0) - (-0.50636564110975879)) < 1e-14);
+static_assert(lm2::abs(lm2::tan(detail::pi / 4) - 1.0L) < 1e-15L);
+static_assert(lm2::abs(lm2::atan2(1.0, 1.0) - 0.78539816339744831) < 1e-15);
+static_assert(lm2::abs(lm2::atan2(-1.0, -1.0) + 2.3561944901923448) < 1e-15);
+static_assert(lm2::abs(lm2::asin(0.5) - 0.52359877559829887) < 1e-15);
+static_assert(lm2::abs(lm2::acos(0.5) - 1.0471975511965976) < 1e-15);
+static_assert(lm2::fmod(5.0f, 2.0f) == 1.0f);
+static_assert(lm2::abs(degrees2radians(180.0) - PI) < 1e-15);
+
+// Vectors
+static_assert(equal(vec3{ 1, 2, 3 } + vec3{ 1, 1, 1 }, vec3{ 2, 3, 4 }));
+static_assert(equal(vec4{ 1, 2, 3, 4 } * 2.0f, vec4{ 2, 4, 6, 8 }));
+static_assert(equal(vec4{ 1, 2, 3, 4 } / vec4{ 0, 2, 0, 4 }, vec4{ 0, 1, 0, 1 }));
+static_assert(equal(vec3{ 5, 5, 5 } % 2.0f, 1.0f));
+static_assert(equal(unchecked::divide(vec4{ 1, 2, 3, 4 }, vec4{ 2, 2, 2, 2 }), vec4{ 0.5f, 1, 1.5f, 2 }));
+static_assert(equal(unchecked::modulo(vec3{ 5, 5, 5 }, 2.0f), 1.0f));
+static_assert(dot(vec4{ 1, 2, 3, 4 }, vec4{ 1, 1, 1, 1 }) == 10);
+static_assert(equal(fma(vec4{ 1, 2, 3, 4 }, 2.0f, vec4{ 1, 1, 1, 1 }), vec4{ 3, 5, 7, 9 }));
+static_assert(equal(lerp(vec3{ 0, 2, 4 }, vec3{ 2, 4, 6 }, 0.5f), vec3{ 1, 3, 5 }));
+static_assert(equal(cross(vec3{ 1, 0, 0 }, vec3{ 0, 1, 0 }), vec3{ 0, 0, 1 }));
+static_assert(magnitude(vec3{ 3, 4, 0 }) == 5);
+static_assert(equal(normalize(vec4{ 0, 3, 0, 4 }), vec4{ 0, 0.6f, 0, 0.8f }));
+static_assert(equal(vec4(vec3{ 1, 2, 3 }), vec4{ 1, 2, 3, 0 }));
+
+// Matrices
+constexpr mat4 translated = position3d(vec3{ 1, 2, 3 }) * identity4x4<float>();
+static_assert(equal(translated * vec4{ 0, 0, 0, 1 }, vec4{ 1, 2, 3, 1 }));
+constexpr mat4 projection = perspective<float>(45.0f, 0.5f, 10.0f, 1);
+static_assert(projection.w.z == -1 && projection.w.w == 0);
+static_assert(projection.y.y == 1.0f / lm2::tan(degrees2radians(22.5f)));
+static_assert(equal(rotation3D(vec3{ 90.0f, 0, 0 }) * vec3{ 0, 1, 0 }, vec3{ 0, 0, -1 }, 0.001f));
+static_assert(equal(rotation2D(90.0f) * vec2{ 1, 0 }, vec2{ 0, -1 }, 0.001f));
+constexpr mat4 view = lookAt(vec3{ 0, 0, 5 }, vec3{ 0, 0, 0 }, vec3{ 0, 1, 0 });
+static_assert(equal(view * vec4{ 0, 0, 0, 1 }, vec4{ 0, 0, 5, 1 }));
+constexpr mat4 fromMat3 = mat4(identity3x3<float>());
+static_assert(equal(fromMat3.z, vec4{ 0, 0, 1, 0 }));
+static_assert(equal(inverse(translated) * vec4{ 1, 2, 3, 1 }, vec4{ 0, 0, 0, 1 }));
+static_assert(equal(inverseAffine(view) * vec4{ 0, 0, 5, 1 }, vec4{ 0, 0, 0, 1 }));
+static_assert(equal(inverseRigid(view), inverse(view)));
+static_assert(determinant(transpose(translated)) == 1);
+constexpr mat3x4 affine = mat3x4(translated);
+static_assert(equal(affine * affine, mat3x4(translated * translated)));
+static_assert(equal(transformPoint(inverse(affine), vec3{ 1, 2, 3 }), vec3{ 0, 0, 0 }));
+
+// Quaternions
+constexpr quaternion rotZ = quaternionAxisAngle(vec3{ 0, 0, 1 }, 90.0f);
+static_assert(equal(rotZ * vec3{ 1, 0, 0 }, vec3{ 0, 1, 0 }, 0.002f));
+static_assert(equal(slerp(identityQuaternion<float>(), rotZ, 1.0f), rotZ));
+static_assert(equal(quaternion2euler(quaternionEuler(vec3{ 10, 20, 30 })), vec3{ 10, 20, 30 }, 0.001f));
+
+
+// Runtime checks of the constant evaluated results against <cmath>
+TEST_CASE(ConstexprTrigMatchesCmath) {
+	constexpr float angles[] = { -7.5f, -3.0f, -1.0f, -0.1f, 0.0f, 0.3f, 1.0f, 1.5f, 2.9f, 6.0f, 42.0f };
+	constexpr float sines[] = {
+		lm2::sin(angles[0]), lm2::sin(angles[1]), lm2::sin(angles[2]), lm2::sin(angles[3]), lm2::sin(angles[4]), lm2::sin(angles[5]),
+		lm2::sin(angles[6]), lm2::sin(angles[7]), lm2::sin(angles[8]), lm2::sin(angles[9]), lm2::sin(angles[10]),
+	};
+	constexpr float cosines[] = {
+		lm2::cos(angles[0]), lm2::cos(angles[1]), lm2::cos(angles[2]), lm2::cos(angles[3]), lm2::cos(angles[4]), lm2::cos(angles[5]),
+		lm2::cos(angles[6]), lm2::cos(angles[7]), lm2::cos(angles[8]), lm2::cos(angles[9]), lm2::cos(angles[10]),
+	};
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(std::abs(sines[i] - std::sin(angles[i])) <= std::numeric_limits<float>::epsilon());
+		ASSERT_CONDITION(std::abs(cosines[i] - std::cos(angles[i])) <= std::numeric_limits<float>::epsilon());
+	}
+}
+
+TEST_CASE(ConstexprMatricesMatchRuntime) {
+	constexpr mat4 constProjection = perspective<float>(45.0f, 0.5f, 10.0f, 1);
+	volatile float fov = 45.0f;
+	mat4 runtimeProjection = perspective<float>(fov, 0.5f, 10.0f, 1);
+	ASSERT_CONDITION(equal(constProjection.x, runtimeProjection.x, 0.000001f));
+	ASSERT_CONDITION(equal(constProjection.y, runtimeProjection.y, 0.000001f));
+	ASSERT_CONDITION(equal(constProjection.z, runtimeProjection.z, 0.000001f));
+
+	constexpr mat3 constRotation = rotation3D(vec3{ 30, 60, 90 });
+	volatile float x = 30;
+	mat3 runtimeRotation = rotation3D(vec3{ x, 60, 90 });
+	ASSERT_CONDITION(equal(constRotation.x, runtimeRotation.x, 0.000001f));
+	ASSERT_CONDITION(equal(constRotation.y, runtimeRotation.y, 0.000001f));
+	ASSERT_CONDITION(equal(constRotation.z, runtimeRotation.z, 0.000001f));
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
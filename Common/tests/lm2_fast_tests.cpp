@@ -0,0 +1,98 @@
+#include "lm2.hpp"
+#include "lm2_fast.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+
+using namespace lm2;
+
+static_assert(lm2::abs(fast::rsqrt(4.0f) - 0.5f) < 1e-6f);
+static_assert(lm2::abs(fast::sin(0.5f) - 0.47942553860420301f) < 2e-7f);
+static_assert(lm2::abs(fast::cos(-2.0f) + 0.41614683654714241f) < 2e-7f);
+static_assert(equal(fast::normalize(vec3{ 0, 3, 4 }), vec3{ 0, 0.6f, 0.8f }));
+static_assert(equal(fast::normalize(vec3{ 0, 0, 0 }), 0.0f));
+
+TEST_CASE(FastScalarAccuracy) {
+	for (int i = -20000; i <= 20000; i++) {
+		float x = i * 0.4096f;
+		float s = 0, c = 0;
+		fast::sincos(x, s, c);
+		ASSERT_CONDITION(std::abs(s - std::sin(double(x))) < 1e-7);
+		ASSERT_CONDITION(std::abs(c - std::cos(double(x))) < 1e-7);
+
+		float small = i * 0.000075f;
+		ASSERT_CONDITION(std::abs((fast::tan(small) - std::tan(double(small))) / std::tan(double(small))) < 3e-7 || i == 0);
+		ASSERT_CONDITION(std::abs(fast::atan(x * 0.01f) - std::atan(double(x * 0.01f))) < 3e-7);
+
+		float y = std::sin(i * 0.01f) * 3, z = std::cos(i * 0.013f) * 2;
+		ASSERT_CONDITION(std::abs(fast::atan2(y, z) - std::atan2(double(y), double(z))) < 3e-7);
+
+		float r = 0.001f + std::abs(x);
+		ASSERT_CONDITION(std::abs(fast::rsqrt(r) * std::sqrt(double(r)) - 1) < 5e-5);
+	}
+	ASSERT_CONDITION(fast::atan2(0.0f, -1.0f) > 3.1415f && fast::atan2(-0.0f, -1.0f) < -3.1415f);
+	ASSERT_CONDITION(fast::atan2(0.0f, 0.0f) == 0);
+
+	// Past the polynomial range the results come from lm2::sin / lm2::cos
+	for (float x : { 1e6f, -3e9f, 1e30f }) {
+		ASSERT_CONDITION(fast::sin(x) == lm2::sin(x) && fast::cos(x) == lm2::cos(x));
+	}
+	ASSERT_CONDITION(std::isnan(fast::sin(std::nanf(""))));
+}
+
+TEST_CASE(FastRotations) {
+	vec3 angles{ 30, -70, 110 };
+	ASSERT_CONDITION(equal(fast::rotation3D(angles), rotation3D(angles), 0.00001f));
+	ASSERT_CONDITION(equal(fast::rotation2D(33.0f), rotation2D(33.0f), 0.00001f));
+	vec4 v{ 1, -2, 3, 0.5f };
+	ASSERT_CONDITION(equal(fast::normalize(v), normalize(v), 0.00001f));
+}
+
+TEST_CASE(FastStreams) {
+	soa::floatStream angles, y, x;
+	angles.resize(1001);
+	y.resize(1001);
+	x.resize(1001);
+	for (int i = 0; i < 1001; i++) {
+		angles.set(i, (i - 500) * 1.37f);
+		y.set(i, float(i % 13) - 6);
+		x.set(i, float(i % 7) - 3.5f);
+	}
+	soa::floatStream s, c, sinOnly, cosOnly, angle;
+	fast::sincos(angles, s, c);
+	fast::sin(angles, sinOnly);
+	fast::cos(angles, cosOnly);
+	fast::atan2(y, x, angle);
+	ASSERT_CONDITION(s.size() == 1001 && angle.size() == 1001);
+	for (int i = 0; i < 1001; i++) {
+		ASSERT_CONDITION(std::abs(s.get(i) - std::sin(double(angles.get(i)))) < 1e-7);
+		ASSERT_CONDITION(std::abs(c.get(i) - std::cos(double(angles.get(i)))) < 1e-7);
+		ASSERT_CONDITION(sinOnly.get(i) == s.get(i) && cosOnly.get(i) == c.get(i));
+		ASSERT_CONDITION(std::abs(angle.get(i) - std::atan2(double(y.get(i)), double(x.get(i)))) < 3e-7);
+	}
+
+	soa::vec3Stream vectors, normals;
+	vectors.resize(17);
+	for (int i = 0; i < 16; i++) {
+		vectors.set(i, { float(i), -2, float(i % 3) });
+	}
+	fast::normalize(vectors, normals);
+	for (int i = 0; i < 16; i++) {
+		ASSERT_CONDITION(equal(normals.get(i), normalize(vectors.get(i)), 0.00001f));
+	}
+	ASSERT_CONDITION(equal(normals.get(16), 0.0f));
+
+	// Far lanes in the middle of a block, and inputs of different sizes
+	angles.set(3, 1e6f);
+	angles.set(5, -3e9f);
+	fast::sincos(angles, s, c);
+	ASSERT_CONDITION(s.get(3) == lm2::sin(1e6f) && c.get(5) == lm2::cos(-3e9f));
+	ASSERT_CONDITION(std::abs(s.get(4) - std::sin(double(angles.get(4)))) < 1e-7);
+	x.resize(20);
+	fast::atan2(y, x, angle);
+	ASSERT_CONDITION(angle.size() == 20);
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
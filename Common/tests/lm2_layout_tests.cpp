@@ -0,0 +1,100 @@
+#include "lm2.hpp"
+#include "lm2_layout.hpp"
+#include "testlib.hpp"
+
+#include <cstddef>
+
+using namespace lm2;
+
+// Offsets from the std140 / std430 rules of the GLSL specification
+using std140Block = std140::layout<float, vec2, vec3, float, vec4, mat3, float, float[2]>;
+static_assert(std140Block::offset(0) == 0);
+static_assert(std140Block::offset(1) == 8);
+static_assert(std140Block::offset(2) == 16);
+static_assert(std140Block::offset(3) == 28);
+static_assert(std140Block::offset(4) == 32);
+static_assert(std140Block::offset(5) == 48);
+static_assert(std140Block::offset(6) == 96);
+static_assert(std140Block::offset(7) == 112);
+static_assert(std140Block::size == 144);
+
+using std430Block = std430::layout<float, vec2, vec3, float, vec4, mat3, float, float[2]>;
+static_assert(std430Block::offset(5) == 48);
+static_assert(std430Block::offset(7) == 100);
+static_assert(std430Block::size == 112);
+
+static_assert(std140::layout<mat4, mat4, mat4>::size == 192);
+static_assert(std140::layout<float, mat4>::offset(1) == 16);
+static_assert(std430::layout<vec2, float[3]>::size == 24);
+static_assert(std140::layout<vec2, float[3]>::size == 64);
+static_assert(std140::layout<double, vector3D<double>>::offset(1) == 32);
+
+// CPU side structs written with the aligned types and arrays
+struct testBlock {
+	float a;
+	alignedVec2 b;
+	vec3 c;
+	float d;
+	alignedVec4 e;
+	alignedMat3 f;
+	float g;
+	std140::array<float, 2> h;
+};
+static_assert(offsetof(testBlock, b) == std140Block::offset(1));
+static_assert(offsetof(testBlock, c) == std140Block::offset(2));
+static_assert(offsetof(testBlock, d) == std140Block::offset(3));
+static_assert(offsetof(testBlock, e) == std140Block::offset(4));
+static_assert(offsetof(testBlock, f) == std140Block::offset(5));
+static_assert(offsetof(testBlock, g) == std140Block::offset(6));
+static_assert(offsetof(testBlock, h) == std140Block::offset(7));
+static_assert(sizeof(testBlock) == std140Block::size);
+
+// A 16 byte alignedVec3 pushes the next scalar past the slot the GPU packs it into
+struct misalignedBlock {
+	alignedVec3 position;
+	float radius;
+};
+static_assert(offsetof(misalignedBlock, radius) != std140::layout<vec3, float>::offset(1));
+
+static_assert(sizeof(std140::array<vec3, 4>) == 64);
+static_assert(sizeof(std430::array<float, 4>) == 16);
+static_assert(sizeof(std430::array<alignedVec3, 4>) == 64);
+static_assert(sizeof(std140::array<alignedMat4, 2>) == 128);
+static_assert(sizeof(std430::array<mat3x4, 2>) == 96 && std430::layout<float, mat3x4>::offset(1) == 16);
+
+
+TEST_CASE(AlignedTypes) {
+	alignedVec3 a{ 1, 2, 3 };
+	alignedVec3 b = a + vec3{ 1, 1, 1 };
+	ASSERT_CONDITION(equal(b, vec3{ 2, 3, 4 }));
+	ASSERT_CONDITION(dot(a, b) == 20);
+
+	alignedMat4 m = position3d(vec3{ 1, 2, 3 });
+	ASSERT_CONDITION(equal(m * vec4{ 0, 0, 0, 1 }, vec4{ 1, 2, 3, 1 }));
+	m = m * m;
+	ASSERT_CONDITION(equal(m * vec4{ 0, 0, 0, 1 }, vec4{ 2, 4, 6, 1 }));
+
+	mat3 rotation = rotation3D(vec3{ 10, 20, 30 });
+	alignedMat3 padded = rotation;
+	const float* data = &padded.x.x;
+	ASSERT_CONDITION(data[4] == rotation.y.x && data[8] == rotation.z.x);
+	ASSERT_CONDITION(equal(mat3(padded), rotation));
+}
+
+TEST_CASE(LayoutArrays) {
+	std140::array<float, 4> scalars{};
+	for (size_t i = 0; i < scalars.size(); i++) {
+		scalars[i] = float(i);
+	}
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&scalars);
+	ASSERT_CONDITION(*reinterpret_cast<const float*>(bytes + 3 * 16) == 3.0f);
+
+	std430::array<vec3, 3> points{};
+	points[1] = { 4, 5, 6 };
+	bytes = reinterpret_cast<const unsigned char*>(&points);
+	ASSERT_CONDITION(equal(*reinterpret_cast<const vec3*>(bytes + 16), vec3{ 4, 5, 6 }));
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,264 @@
+#include "lm2.hpp"
+#include "lm2_mesh.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace lm2;
+
+struct testMesh {
+	std::vector<vec3> positions;
+	std::vector<vec2> uvs;
+	std::vector<uint32_t> indices;
+};
+
+// Unit cube at the origin, 8 shared corners and 12 triangles facing out
+static testMesh cubeMesh() {
+	testMesh mesh;
+	for (int corner = 0; corner < 8; corner++) {
+		mesh.positions.push_back({ corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f });
+	}
+	mesh.indices = { 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5 };
+	return mesh;
+}
+
+// UV sphere of radius 2, poles excluded so every vertex has a well defined neighbourhood
+static testMesh sphereMesh(size_t rings, size_t segments) {
+	testMesh mesh;
+	for (size_t r = 0; r <= rings; r++) {
+		float theta = 0.2f + 2.7f * r / rings;
+		for (size_t s = 0; s <= segments; s++) {
+			float phi = 6.2831853f * s / segments;
+			mesh.positions.push_back(vec3{ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) } * 2.0f);
+			mesh.uvs.push_back({ float(s) / segments, float(r) / rings });
+		}
+	}
+	for (size_t r = 0; r < rings; r++) {
+		for (size_t s = 0; s < segments; s++) {
+			uint32_t a = static_cast<uint32_t>(r * (segments + 1) + s);
+			uint32_t b = a + static_cast<uint32_t>(segments + 1);
+			mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+		}
+	}
+	return mesh;
+}
+
+// Grid in the xz plane with uv = (x, z), optionally mirrored in u
+static testMesh planeMesh(size_t size, bool mirrored) {
+	testMesh mesh;
+	for (size_t z = 0; z <= size; z++) {
+		for (size_t x = 0; x <= size; x++) {
+			mesh.positions.push_back({ float(x), 0, float(z) });
+			mesh.uvs.push_back({ mirrored ? -float(x) : float(x), float(z) });
+		}
+	}
+	for (size_t z = 0; z < size; z++) {
+		for (size_t x = 0; x < size; x++) {
+			uint32_t a = static_cast<uint32_t>(z * (size + 1) + x);
+			uint32_t b = a + static_cast<uint32_t>(size + 1);
+			mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	}
+	return mesh;
+}
+
+TEST_CASE(CubeNormals) {
+	testMesh mesh = cubeMesh();
+	std::vector<vec3> normals(8);
+	mesh::computeNormals(mesh.positions.data(), 8, mesh.indices.data(), 12, normals.data());
+	// Every corner sees three faces under a right angle each
+	for (size_t i = 0; i < 8; i++) {
+		ASSERT_CONDITION(equal(normals[i], normalize(mesh.positions[i]), 1e-5f));
+	}
+	// Area weights favour the faces with two triangles at the corner
+	mesh::computeNormals(mesh.positions.data(), 8, mesh.indices.data(), 12, normals.data(), mesh::normalWeight::area);
+	ASSERT_CONDITION(!equal(normals[1], normalize(mesh.positions[1]), 1e-3f));
+	ASSERT_CONDITION(std::abs(magnitude(normals[1]) - 1) < 1e-5f);
+}
+
+TEST_CASE(SphereNormals) {
+	testMesh mesh = sphereMesh(40, 64);
+	std::vector<vec3> normals(mesh.positions.size());
+	for (mesh::normalWeight weight : { mesh::normalWeight::area, mesh::normalWeight::angle, mesh::normalWeight::areaAngle }) {
+		mesh::computeNormals(mesh.positions.data(), mesh.positions.size(), mesh.indices.data(), mesh.indices.size() / 3, normals.data(), weight);
+		for (size_t i = 0; i < normals.size(); i++) {
+			// Seam and border vertices only see one side, skip them
+			size_t s = i % 65, r = i / 65;
+			if (s == 0 || s == 64 || r == 0 || r == 40) {
+				continue;
+			}
+			ASSERT_CONDITION(dot(normals[i], normalize(mesh.positions[i])) > 0.999f);
+		}
+	}
+}
+
+TEST_CASE(FlatNormals) {
+	// Without indices every triangle has its own vertices and gets its face normal
+	std::vector<vec3> positions = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 }, { 0, 0, 1 }, { 1, 0, 0 }, { 5, 5, 5 }, { 5, 5, 5 }, { 6, 5, 5 } };
+	std::vector<vec3> normals(9);
+	mesh::computeNormals(positions.data(), 9, nullptr, 3, normals.data());
+	ASSERT_CONDITION(equal(normals[0], vec3{ 0, 0, 1 }) && equal(normals[2], vec3{ 0, 0, 1 }));
+	ASSERT_CONDITION(equal(normals[4], vec3{ 0, 1, 0 }));
+	// Degenerate triangles give zero normals
+	ASSERT_CONDITION(equal(normals[7], vec3{ 0, 0, 0 }));
+}
+
+TEST_CASE(InterleavedNormals) {
+	struct vertex {
+		vec3 position;
+		vec2 uv;
+		vec3 normal;
+		vec4 tangent;
+	};
+	testMesh mesh = sphereMesh(10, 16);
+	std::vector<vertex> vertices(mesh.positions.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		vertices[i].position = mesh.positions[i];
+		vertices[i].uv = mesh.uvs[i];
+	}
+	size_t triangleCount = mesh.indices.size() / 3;
+	std::vector<vec3> normals(vertices.size());
+	std::vector<vec4> tangents(vertices.size());
+	mesh::computeNormals(mesh.positions.data(), vertices.size(), mesh.indices.data(), triangleCount, normals.data());
+	mesh::computeNormals(&vertices[0].position, vertices.size(), mesh.indices.data(), triangleCount, &vertices[0].normal,
+		mesh::normalWeight::angle, sizeof(vertex));
+	mesh::computeTangents(mesh.positions.data(), mesh.uvs.data(), normals.data(), vertices.size(), mesh.indices.data(), triangleCount, tangents.data());
+	mesh::computeTangents(&vertices[0].position, &vertices[0].uv, &vertices[0].normal, vertices.size(), mesh.indices.data(), triangleCount,
+		&vertices[0].tangent, sizeof(vertex));
+	for (size_t i = 0; i < vertices.size(); i++) {
+		ASSERT_CONDITION(std::memcmp(&vertices[i].normal, &normals[i], sizeof(vec3)) == 0);
+		ASSERT_CONDITION(std::memcmp(&vertices[i].tangent, &tangents[i], sizeof(vec4)) == 0);
+	}
+}
+
+TEST_CASE(PlaneTangents) {
+	for (bool mirrored : { false, true }) {
+		testMesh mesh = planeMesh(8, mirrored);
+		size_t vertexCount = mesh.positions.size();
+		std::vector<vec3> normals(vertexCount);
+		std::vector<vec4> tangents(vertexCount);
+		mesh::computeNormals(mesh.positions.data(), vertexCount, mesh.indices.data(), mesh.indices.size() / 3, normals.data());
+		mesh::computeTangents(mesh.positions.data(), mesh.uvs.data(), normals.data(), vertexCount, mesh.indices.data(),
+			mesh.indices.size() / 3, tangents.data());
+		// u along x and v along z over a +y normal is a left handed frame, mirroring u flips it
+		vec4 expected = mirrored ? vec4{ -1, 0, 0, 1 } : vec4{ 1, 0, 0, -1 };
+		for (size_t i = 0; i < vertexCount; i++) {
+			ASSERT_CONDITION(equal(normals[i], vec3{ 0, 1, 0 }, 1e-5f));
+			ASSERT_CONDITION(equal(tangents[i], expected, 1e-5f));
+			// The bitangent rebuilt from w points towards +v
+			vec3 bitangent = cross(normals[i], vec3{ tangents[i].x, tangents[i].y, tangents[i].z }) * tangents[i].w;
+			ASSERT_CONDITION(equal(bitangent, vec3{ 0, 0, 1 }, 1e-5f));
+		}
+	}
+}
+
+TEST_CASE(SphereTangents) {
+	testMesh mesh = sphereMesh(40, 64);
+	size_t vertexCount = mesh.positions.size();
+	std::vector<vec3> normals(vertexCount);
+	std::vector<vec4> tangents(vertexCount);
+	mesh::computeNormals(mesh.positions.data(), vertexCount, mesh.indices.data(), mesh.indices.size() / 3, normals.data());
+	mesh::computeTangents(mesh.positions.data(), mesh.uvs.data(), normals.data(), vertexCount, mesh.indices.data(), mesh.indices.size() / 3, tangents.data());
+	for (size_t i = 0; i < vertexCount; i++) {
+		vec3 t{ tangents[i].x, tangents[i].y, tangents[i].z };
+		ASSERT_CONDITION(std::abs(magnitude(t) - 1) < 1e-4f && std::abs(dot(t, normals[i])) < 1e-4f);
+		// u runs along phi, so the tangent follows the latitude circle
+		vec3 p = mesh.positions[i];
+		vec3 alongPhi = normalize(vec3{ -p.z, 0, p.x });
+		ASSERT_CONDITION(dot(t, alongPhi) > 0.99f);
+		ASSERT_CONDITION(tangents[i].w == 1 || tangents[i].w == -1);
+	}
+
+	// Without usable uvs the tangent is still a unit vector perpendicular to the normal
+	std::vector<vec2> flat(vertexCount, vec2{ 0.5f, 0.5f });
+	mesh::computeTangents(mesh.positions.data(), flat.data(), normals.data(), vertexCount, mesh.indices.data(), mesh.indices.size() / 3, tangents.data());
+	for (size_t i = 0; i < vertexCount; i++) {
+		vec3 t{ tangents[i].x, tangents[i].y, tangents[i].z };
+		ASSERT_CONDITION(std::abs(magnitude(t) - 1) < 1e-4f && std::abs(dot(t, normals[i])) < 1e-4f && tangents[i].w == 1);
+	}
+}
+
+TEST_CASE(Determinism) {
+	random::generator g(5);
+	testMesh mesh = sphereMesh(60, 90);
+	size_t vertexCount = mesh.positions.size();
+	for (vec3& p : mesh.positions) {
+		p = p + random::uniform(g, vec3{ -0.01f, -0.01f, -0.01f }, vec3{ 0.01f, 0.01f, 0.01f });
+	}
+	size_t triangleCount = mesh.indices.size() / 3;
+	auto run = [&](threadPool* pool, std::vector<vec3>& normals, std::vector<vec4>& tangents) {
+		normals.resize(vertexCount);
+		tangents.resize(vertexCount);
+		mesh::computeNormals(mesh.positions.data(), vertexCount, mesh.indices.data(), triangleCount, normals.data(),
+			mesh::normalWeight::areaAngle, 0, pool);
+		mesh::computeTangents(mesh.positions.data(), mesh.uvs.data(), normals.data(), vertexCount, mesh.indices.data(), triangleCount,
+			tangents.data(), 0, pool);
+	};
+	std::vector<vec3> serialNormals, pooledNormals;
+	std::vector<vec4> serialTangents, pooledTangents;
+	run(nullptr, serialNormals, serialTangents);
+	for (size_t threads : { 3, 4 }) {
+		threadPool pool(threads);
+		run(&pool, pooledNormals, pooledTangents);
+		ASSERT_CONDITION(std::memcmp(serialNormals.data(), pooledNormals.data(), vertexCount * sizeof(vec3)) == 0);
+		ASSERT_CONDITION(std::memcmp(serialTangents.data(), pooledTangents.data(), vertexCount * sizeof(vec4)) == 0);
+	}
+}
+
+TEST_CASE(Weld) {
+	// Two triangles of a quad as a soup, the shared edge welds
+	std::vector<vec3> positions = { { 0, 0, 0 }, { 1, 0, 0 }, { 0, 1, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 } };
+	std::vector<uint32_t> remap(positions.size());
+	ASSERT_CONDITION(mesh::weld(&positions[0].x, positions.size(), 3, 0, remap.data()) == 4);
+	ASSERT_CONDITION((remap == std::vector<uint32_t>{ 0, 1, 2, 1, 4, 2 }));
+	ASSERT_CONDITION(mesh::weld(nullptr, 0, 3, 0, remap.data()) == 0);
+
+	// Exporters write -0 for some copies of a shared vertex, the folded edge at x = 0 still welds so
+	// both of its vertices get the blend of the two face normals
+	std::vector<vec3> signedZeros = { { 0, 0, 0 }, { 0, 1, 0 }, { -1, 0, 0 }, { -0.0f, 1, 0 }, { -0.0f, 0, -0.0f }, { 1, 0, 1 } };
+	ASSERT_CONDITION(mesh::weld(&signedZeros[0].x, signedZeros.size(), 3, 0, remap.data()) == 4);
+	ASSERT_CONDITION((remap == std::vector<uint32_t>{ 0, 1, 2, 1, 0, 5 }));
+	std::vector<vec3> seamNormals(signedZeros.size());
+	mesh::computeNormals(signedZeros.data(), signedZeros.size(), remap.data(), 2, seamNormals.data());
+	ASSERT_CONDITION(seamNormals[0].x < -0.1f && seamNormals[1].x < -0.1f);
+
+	// A large soup of a few distinct values, pooled and serial agree and every remap is a first occurrence
+	random::generator g(8);
+	std::vector<float> keys(20000 * 2);
+	for (float& k : keys) {
+		k = float(random::uniform(g, 0.0f, 30.0f) > 15.0f);
+	}
+	std::vector<uint32_t> serial(20000), pooled(20000);
+	size_t unique = mesh::weld(keys.data(), 20000, 2, 0, serial.data());
+	threadPool pool(4);
+	ASSERT_CONDITION(mesh::weld(keys.data(), 20000, 2, 0, pooled.data(), &pool) == unique && unique == 4);
+	ASSERT_CONDITION(serial == pooled);
+	for (size_t i = 0; i < serial.size(); i++) {
+		uint32_t r = serial[i];
+		ASSERT_CONDITION(r <= i && serial[r] == r && keys[r * 2] == keys[i * 2] && keys[r * 2 + 1] == keys[i * 2 + 1]);
+	}
+
+	// Welded soup normals match the indexed mesh
+	testMesh indexed = sphereMesh(12, 20);
+	std::vector<vec3> soup;
+	for (uint32_t index : indexed.indices) {
+		soup.push_back(indexed.positions[index]);
+	}
+	std::vector<uint32_t> soupRemap(soup.size());
+	mesh::weld(&soup[0].x, soup.size(), 3, sizeof(vec3), soupRemap.data());
+	std::vector<vec3> soupNormals(soup.size()), normals(indexed.positions.size());
+	mesh::computeNormals(soup.data(), soup.size(), soupRemap.data(), soup.size() / 3, soupNormals.data());
+	mesh::computeNormals(indexed.positions.data(), indexed.positions.size(), indexed.indices.data(), indexed.indices.size() / 3, normals.data());
+	for (size_t i = 0; i < soup.size(); i++) {
+		ASSERT_CONDITION(equal(soupNormals[soupRemap[i]], normals[indexed.indices[i]], 1e-5f));
+	}
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,127 @@
+#include "lm2.hpp"
+#include "lm2_morton.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+using namespace lm2;
+
+static_assert(morton::encode(1, 0, 0) == 1 && morton::encode(0, 1, 0) == 2 && morton::encode(0, 0, 1) == 4);
+static_assert(morton::encode(1023, 1023, 1023) == 0x3FFFFFFFu);
+static_assert(morton::encode64(0x1FFFFF, 0x1FFFFF, 0x1FFFFF) == 0x7FFFFFFFFFFFFFFFull);
+static_assert(morton::code(vec3{ 1, 1, 1 }, aabb{ { 0, 0, 0 }, { 1, 1, 1 } }) == 0x3FFFFFFFu);
+static_assert(morton::code(vec3{ -5, 0, 0 }, aabb{ { 0, 0, 0 }, { 1, 1, 1 } }) == 0);
+
+TEST_CASE(MortonEncode) {
+	random::generator g(3);
+	for (int i = 0; i < 10000; i++) {
+		uint32_t x = g.next() & 1023, y = g.next() & 1023, z = g.next() & 1023;
+		uint32_t dx = 0, dy = 0, dz = 0;
+		morton::decode(morton::encode(x, y, z), dx, dy, dz);
+		ASSERT_CONDITION(dx == x && dy == y && dz == z);
+
+		x = g.next() & 0x1FFFFF;
+		y = g.next() & 0x1FFFFF;
+		z = g.next() & 0x1FFFFF;
+		morton::decode64(morton::encode64(x, y, z), dx, dy, dz);
+		ASSERT_CONDITION(dx == x && dy == y && dz == z);
+	}
+
+	// Array kernels match the scalar codes, with a stride and a tail shorter than 8
+	struct particle {
+		vec3 position;
+		float life;
+	};
+	std::vector<particle> particles(1003);
+	for (particle& p : particles) {
+		p = { random::uniform(g, vec3{ -2, -2, -2 }, vec3{ 2, 2, 2 }), 1 };
+	}
+	aabb bounds{ { -1, -1, -1 }, { 1, 1, 1 } };
+	std::vector<uint32_t> codes(particles.size());
+	std::vector<uint64_t> codes64(particles.size());
+	morton::codes(&particles[0].position, particles.size(), bounds, codes.data(), sizeof(particle));
+	morton::codes64(&particles[0].position, particles.size(), bounds, codes64.data(), sizeof(particle));
+	for (size_t i = 0; i < particles.size(); i++) {
+		ASSERT_CONDITION(codes[i] == morton::code(particles[i].position, bounds));
+		ASSERT_CONDITION(codes64[i] == morton::code64(particles[i].position, bounds));
+	}
+	// Flat bounds put every point in cell 0 of that axis
+	aabb flat{ { 0, 0, 0 }, { 1, 0, 1 } };
+	uint32_t x = 0, y = 0, z = 0;
+	morton::decode(morton::code(vec3{ 0.5f, 3, 0.5f }, flat), x, y, z);
+	ASSERT_CONDITION(x == 512 && y == 0 && z == 512);
+}
+
+template<typename Key>
+static void checkRadixSort(size_t count, Key keyMask, threadPool* pool) {
+	random::generator g(static_cast<uint64_t>(count));
+	std::vector<Key> keys(count);
+	for (Key& key : keys) {
+		key = static_cast<Key>((static_cast<uint64_t>(g.next()) << 32 | g.next()) & keyMask);
+	}
+	std::vector<uint32_t> values(count);
+	std::iota(values.begin(), values.end(), 0u);
+	std::vector<uint32_t> expected = values;
+	std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+	std::vector<Key> sorted = keys;
+	radixSort(sorted.data(), values.data(), count, pool);
+	ASSERT_CONDITION(values == expected);
+	for (size_t i = 0; i < count; i++) {
+		ASSERT_CONDITION(sorted[i] == keys[values[i]]);
+	}
+}
+
+TEST_CASE(RadixSort) {
+	threadPool pool(4);
+	for (size_t count : { 0, 1, 2, 7, 1000, 50000 }) {
+		checkRadixSort<uint32_t>(count, 0x3FFFFFFF, nullptr);
+		checkRadixSort<uint32_t>(count, 0x3FFFFFFF, &pool);
+		// Few distinct keys, stability matters
+		checkRadixSort<uint32_t>(count, 0x7, &pool);
+		checkRadixSort<uint64_t>(count, 0x7FFFFFFFFFFFFFFFull, nullptr);
+		checkRadixSort<uint64_t>(count, 0x7FFFFFFFFFFFFFFFull, &pool);
+	}
+}
+
+TEST_CASE(MortonOrder) {
+	random::generator g(5);
+	std::vector<vec3> points(20000);
+	for (vec3& p : points) {
+		p = random::uniform(g, vec3{ -100, -100, -100 }, vec3{ 100, 100, 100 });
+	}
+	std::vector<uint32_t> order(points.size());
+	morton::order(points.data(), points.size(), order.data());
+	threadPool pool(4);
+	std::vector<uint32_t> pooled(points.size());
+	morton::order(points.data(), points.size(), pooled.data(), sizeof(vec3), &pool);
+	ASSERT_CONDITION(order == pooled);
+
+	// A permutation in ascending code order
+	aabb bounds = computeAABB(points.data(), points.size());
+	std::vector<int> seen(points.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		seen[order[i]]++;
+		if (i > 0) {
+			ASSERT_CONDITION(morton::code64(points[order[i - 1]], bounds) <= morton::code64(points[order[i]], bounds));
+		}
+	}
+	ASSERT_CONDITION(std::count(seen.begin(), seen.end(), 1) == static_cast<long>(points.size()));
+
+	// Neighbours along the curve are much closer than random pairs
+	std::vector<vec3> sorted(points.size());
+	morton::reorder(points.data(), order.data(), points.size(), sorted.data());
+	float curveDistance = 0, randomDistance = 0;
+	for (size_t i = 1; i < points.size(); i++) {
+		curveDistance += magnitude(sorted[i] - sorted[i - 1]);
+		randomDistance += magnitude(points[i] - points[i - 1]);
+	}
+	ASSERT_CONDITION(curveDistance * 5 < randomDistance);
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
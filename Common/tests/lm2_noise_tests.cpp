@@ -0,0 +1,138 @@
+#include "lm2.hpp"
+#include "lm2_noise.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace lm2;
+
+static_assert(noise::detail::floorCell(-0.5f) == -1 && noise::detail::floorCell(-1.0f) == -1 && noise::detail::floorCell(1.5f) == 1);
+static_assert(noise::detail::fade(0.0f) == 0.0f && noise::detail::fade(1.0f) == 1.0f && noise::detail::fade(0.5f) == 0.5f);
+static_assert(noise::detail::mix(1) != noise::detail::mix(2));
+
+TEST_CASE(NoiseScalar) {
+	// Gradient noise is zero on the lattice
+	ASSERT_CONDITION(noise::perlin(vec2{ 3, -7 }) == 0.0f);
+	ASSERT_CONDITION(noise::perlin(vec3{ 3, -7, 2 }) == 0.0f);
+	ASSERT_CONDITION(noise::perlin(vec4{ 3, -7, 2, 5 }) == 0.0f);
+
+	random::generator g(11);
+	double sums[9] = {};
+	bool inRange = true, seeded = false;
+	const int count = 20000;
+	for (int i = 0; i < count; i++) {
+		vec4 p = random::uniform(g, vec4{ -50, -50, -50, -50 }, vec4{ 50, 50, 50, 50 });
+		vec2 p2{ p.x, p.y };
+		vec3 p3{ p.x, p.y, p.z };
+		float values[9] = {
+			noise::perlin(p2), noise::perlin(p3), noise::perlin(p),
+			noise::simplex(p2), noise::simplex(p3), noise::simplex(p),
+			noise::value(p2), noise::value(p3), noise::value(p),
+		};
+		for (int k = 0; k < 9; k++) {
+			inRange = inRange && std::fabs(values[k]) <= 1.0f;
+			sums[k] += values[k];
+		}
+		// Same seed, same field, other seeds give other fields
+		ASSERT_CONDITION(noise::simplex(p3, 7) == noise::simplex(p3, 7));
+		seeded = seeded || noise::simplex(p3, 7) != noise::simplex(p3, 8);
+	}
+	ASSERT_CONDITION(inRange && seeded);
+	for (int k = 0; k < 9; k++) {
+		ASSERT_CONDITION(std::fabs(sums[k] / count) < 0.05);
+	}
+
+	// Continuous: a tiny step moves the value a tiny amount
+	vec3 p{ 1.3f, 2.7f, -0.4f };
+	ASSERT_CONDITION(std::fabs(noise::perlin(p) - noise::perlin(p + vec3{ 1e-4f, 0, 0 })) < 1e-3f);
+	ASSERT_CONDITION(std::fabs(noise::simplex(p) - noise::simplex(p + vec3{ 0, 1e-4f, 0 })) < 1e-3f);
+	ASSERT_CONDITION(std::fabs(noise::value(p) - noise::value(p + vec3{ 0, 0, 1e-4f })) < 1e-3f);
+}
+
+TEST_CASE(NoiseFractal) {
+	noise::settings s;
+	s.mode = noise::fractal::none;
+	s.frequency = 2.0f;
+	s.seed = 3;
+	vec2 p{ 0.37f, -1.21f };
+	ASSERT_CONDITION(noise::sample(s, p) == noise::simplex(p * 2.0f, 3));
+
+	random::generator g(5);
+	for (int type = 0; type < 3; type++) {
+		s.type = static_cast<noise::basis>(type);
+		for (int i = 0; i < 500; i++) {
+			vec3 q = random::uniform(g, vec3{ -20, -20, -20 }, vec3{ 20, 20, 20 });
+			s.mode = noise::fractal::fbm;
+			float fbm = noise::sample(s, q);
+			s.mode = noise::fractal::ridged;
+			float ridged = noise::sample(s, q);
+			ASSERT_CONDITION(std::fabs(fbm) <= 1.0f);
+			ASSERT_CONDITION(ridged >= 0.0f && ridged <= 1.0f);
+		}
+	}
+}
+
+TEST_CASE(NoiseStreams) {
+	random::generator g(17);
+	const size_t count = 37;
+	soa::vec2Stream in2;
+	soa::vec3Stream in3;
+	soa::vec4Stream in4;
+	in2.resize(count);
+	in3.resize(count);
+	in4.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		vec4 p = random::uniform(g, vec4{ -30, -30, -30, -30 }, vec4{ 30, 30, 30, 30 });
+		in2.set(i, vec2{ p.x, p.y });
+		in3.set(i, vec3{ p.x, p.y, p.z });
+		in4.set(i, p);
+	}
+	noise::settings s;
+	soa::floatStream out;
+	for (int type = 0; type < 3; type++) {
+		for (int mode = 0; mode < 3; mode++) {
+			s.type = static_cast<noise::basis>(type);
+			s.mode = static_cast<noise::fractal>(mode);
+			// 8 lanes run the same code as one, so the results only differ by rounding
+			noise::sample(s, in2, out);
+			ASSERT_CONDITION(out.size() == count);
+			for (size_t i = 0; i < count; i++) {
+				ASSERT_CONDITION(std::fabs(out.get(i) - noise::sample(s, in2.get(i))) < 1e-5f);
+			}
+			noise::sample(s, in3, out);
+			for (size_t i = 0; i < count; i++) {
+				ASSERT_CONDITION(std::fabs(out.get(i) - noise::sample(s, in3.get(i))) < 1e-5f);
+			}
+			noise::sample(s, in4, out);
+			for (size_t i = 0; i < count; i++) {
+				ASSERT_CONDITION(std::fabs(out.get(i) - noise::sample(s, in4.get(i))) < 1e-5f);
+			}
+		}
+	}
+}
+
+TEST_CASE(NoiseFillGrid) {
+	noise::settings s;
+	s.type = noise::basis::perlin;
+	s.octaves = 4;
+	const size_t width = 67, height = 45;
+	vec2 origin{ -3, 2 }, spacing{ 0.05f, 0.07f };
+	std::vector<float> serial(width * height), pooled(width * height, -5.0f);
+	noise::fillGrid(s, origin, spacing, width, height, serial.data());
+	threadPool pool(3);
+	noise::fillGrid(s, origin, spacing, width, height, pooled.data(), &pool);
+	ASSERT_CONDITION(serial == pooled);
+	for (size_t y = 0; y < height; y += 11) {
+		for (size_t x = 0; x < width; x += 7) {
+			vec2 p = origin + vec2{ spacing.x * x, spacing.y * y };
+			ASSERT_CONDITION(std::fabs(serial[y * width + x] - noise::sample(s, p)) < 1e-5f);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,178 @@
+#include "lm2.hpp"
+#include "lm2_bounds.hpp"
+#include "lm2_obb.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace lm2;
+
+constexpr vec3 diagonalValues() {
+	vec3 values;
+	mat3 vectors;
+	eigenSymmetric(mat3{ { 2, 0, 0 }, { 0, 5, 0 }, { 0, 0, -1 } }, values, vectors);
+	return values;
+}
+static_assert(equal(diagonalValues(), vec3{ 5, 2, -1 }));
+static_assert(volume(obb{ {}, { 1, 2, 3 }, identity3x3<float>() }) == 48.0f);
+
+static mat3 randomRotation(random::generator& g) {
+	vec3 axis = normalize(random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 }) + vec3{ 0, 0, 0.01f });
+	return quaternion2matrix3x3(quaternionAxisAngle(axis, random::uniform(g, 0.0f, 360.0f)));
+}
+
+// Points filling a box with the given axes and half sizes, corners included
+static std::vector<vec3> boxPoints(random::generator& g, vec3 center, vec3 halfSize, const mat3& axes, size_t count) {
+	std::vector<vec3> points;
+	for (int corner = 0; corner < 8; corner++) {
+		vec3 local{ corner & 1 ? halfSize.x : -halfSize.x, corner & 2 ? halfSize.y : -halfSize.y, corner & 4 ? halfSize.z : -halfSize.z };
+		points.push_back(center + axes * local);
+	}
+	for (size_t i = 8; i < count; i++) {
+		points.push_back(center + axes * random::uniform(g, -halfSize, halfSize));
+	}
+	return points;
+}
+
+static bool containsAll(const obb& box, const vec3* points, size_t count) {
+	for (size_t i = 0; i < count; i++) {
+		vec3 local = toBoxSpace(box, points[i]);
+		if (std::abs(local.x) > box.extents.x + 1e-3f || std::abs(local.y) > box.extents.y + 1e-3f || std::abs(local.z) > box.extents.z + 1e-3f) {
+			return false;
+		}
+	}
+	return true;
+}
+
+TEST_CASE(EigenSymmetric) {
+	random::generator g(3);
+	for (int i = 0; i < 200; i++) {
+		// m = R * diag * R^T with known eigenvalues
+		mat3 r = randomRotation(g);
+		vec3 d{ random::uniform(g, -5.0f, 5.0f), random::uniform(g, -5.0f, 5.0f), random::uniform(g, -5.0f, 5.0f) };
+		mat3 m = r * mat3{ { d.x, 0, 0 }, { 0, d.y, 0 }, { 0, 0, d.z } } * transpose(r);
+		vec3 values;
+		mat3 vectors;
+		eigenSymmetric(m, values, vectors);
+		ASSERT_CONDITION(values.x >= values.y && values.y >= values.z);
+		ASSERT_CONDITION(std::abs(determinant(vectors) - 1) < 1e-4f);
+		ASSERT_CONDITION(equal(vectors * transpose(vectors), identity3x3<float>(), 1e-4f));
+		mat3 rebuilt = vectors * mat3{ { values.x, 0, 0 }, { 0, values.y, 0 }, { 0, 0, values.z } } * transpose(vectors);
+		ASSERT_CONDITION(equal(rebuilt, m, 1e-4f));
+		ASSERT_CONDITION(std::abs(values.x + values.y + values.z - (d.x + d.y + d.z)) < 1e-4f);
+	}
+	// Repeated eigenvalues still give an orthonormal basis
+	vec3 values;
+	mat3 vectors;
+	eigenSymmetric(mat3{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } }, values, vectors);
+	ASSERT_CONDITION(equal(values, vec3{ 1, 1, 1 }) && equal(vectors, identity3x3<float>()));
+}
+
+TEST_CASE(Covariance) {
+	std::vector<vec3> points = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 2, 0 }, { 0, -2, 0 } };
+	vec3 mean;
+	mat3 cov;
+	computeCovariance(points.data(), points.size(), mean, cov);
+	ASSERT_CONDITION(equal(mean, vec3{ 0, 0, 0 }));
+	ASSERT_CONDITION(equal(cov, mat3{ { 0.5f, 0, 0 }, { 0, 2, 0 }, { 0, 0, 0 } }));
+
+	// Far from the origin the result stays the same
+	for (vec3& p : points) {
+		p = p + vec3{ 10000, -20000, 5000 };
+	}
+	computeCovariance(points.data(), points.size(), mean, cov);
+	ASSERT_CONDITION(equal(mean, vec3{ 10000, -20000, 5000 }, 1e-2f));
+	ASSERT_CONDITION(equal(cov, mat3{ { 0.5f, 0, 0 }, { 0, 2, 0 }, { 0, 0, 0 } }, 1e-3f));
+}
+
+TEST_CASE(OBBFit) {
+	random::generator g(9);
+	for (int i = 0; i < 50; i++) {
+		mat3 axes = randomRotation(g);
+		vec3 halfSize{ random::uniform(g, 2.0f, 6.0f), random::uniform(g, 0.5f, 1.5f), random::uniform(g, 0.1f, 0.3f) };
+		vec3 center = random::uniform(g, vec3{ -50, -50, -50 }, vec3{ 50, 50, 50 });
+		std::vector<vec3> points = boxPoints(g, center, halfSize, axes, 500);
+		obb box = computeOBB(points.data(), points.size());
+		aabb bounds = computeAABB(points.data(), points.size());
+		float trueVolume = 8 * halfSize.x * halfSize.y * halfSize.z;
+		ASSERT_CONDITION(containsAll(box, points.data(), points.size()));
+		ASSERT_CONDITION(volume(box) <= volume(aabb2obb(bounds)));
+		ASSERT_CONDITION(volume(box) < trueVolume * 1.05f);
+		ASSERT_CONDITION(std::abs(determinant(box.axes) - 1) < 1e-4f);
+	}
+
+	// A few points, a flat set and no points
+	std::vector<vec3> line = { { 0, 0, 0 }, { 1, 1, 1 }, { 2, 2, 2 } };
+	obb lineBox = computeOBB(line.data(), line.size());
+	ASSERT_CONDITION(containsAll(lineBox, line.data(), line.size()) && volume(lineBox) < 1e-4f);
+	ASSERT_CONDITION(std::abs(lineBox.extents.x - std::sqrt(3.0f)) < 1e-4f);
+	obb empty = computeOBB<float>(nullptr, 0);
+	ASSERT_CONDITION(volume(empty) == 0 && equal(empty.axes, identity3x3<float>()));
+
+	// An axis aligned cloud keeps its AABB
+	std::vector<vec3> aligned = boxPoints(g, { 1, 2, 3 }, { 4, 2, 1 }, identity3x3<float>(), 100);
+	obb alignedBox = computeOBB(aligned.data(), aligned.size());
+	aabb enclosing = obb2aabb(alignedBox);
+	ASSERT_CONDITION(equal(enclosing.min, vec3{ -3, 0, 2 }, 1e-3f) && equal(enclosing.max, vec3{ 5, 4, 4 }, 1e-3f));
+}
+
+TEST_CASE(OBBBatch) {
+	random::generator g(12);
+	const size_t boxCount = 300;
+	std::vector<vec3> points;
+	std::vector<uint32_t> offsets = { 0 };
+	for (size_t i = 0; i < boxCount; i++) {
+		size_t count = i % 7 == 0 ? 0 : 8 + i % 60;
+		std::vector<vec3> set = boxPoints(g, random::uniform(g, vec3{ -100, -100, -100 }, vec3{ 100, 100, 100 }),
+			{ 3, 1, 0.5f }, randomRotation(g), count);
+		points.insert(points.end(), set.begin(), set.begin() + count);
+		offsets.push_back(static_cast<uint32_t>(points.size()));
+	}
+	std::vector<obb> serial(boxCount), pooled(boxCount);
+	computeOBBs(points.data(), offsets.data(), boxCount, serial.data());
+	threadPool pool(4);
+	computeOBBs(points.data(), offsets.data(), boxCount, pooled.data(), sizeof(vec3), nullptr, &pool);
+	ASSERT_CONDITION(std::memcmp(serial.data(), pooled.data(), boxCount * sizeof(obb)) == 0);
+	for (size_t i = 0; i < boxCount; i++) {
+		obb single = computeOBB(points.data() + offsets[i], offsets[i + 1] - offsets[i]);
+		ASSERT_CONDITION(std::memcmp(&single, &serial[i], sizeof(obb)) == 0);
+	}
+
+	// The same sets through an index list over reversed points
+	std::vector<vec3> reversed(points.rbegin(), points.rend());
+	std::vector<uint32_t> indices(points.size());
+	for (size_t i = 0; i < indices.size(); i++) {
+		indices[i] = static_cast<uint32_t>(points.size() - 1 - i);
+	}
+	std::vector<obb> indexed(boxCount);
+	computeOBBs(reversed.data(), offsets.data(), boxCount, indexed.data(), sizeof(vec3), indices.data(), &pool);
+	ASSERT_CONDITION(std::memcmp(serial.data(), indexed.data(), boxCount * sizeof(obb)) == 0);
+}
+
+TEST_CASE(OBBFrustum) {
+	// Camera at the origin looking down -z, near 0.5 and far 10
+	frustum f = matrix2frustum(perspective<float>(90.0f, 0.5f, 10.0f, 1));
+	mat3 tilt = quaternion2matrix3x3(quaternionAxisAngle(vec3{ 0, 1, 0 }, 45.0f));
+	ASSERT_CONDITION(intersects(f, obb{ { 0, 0, -5 }, { 1, 1, 1 }, tilt }));
+	ASSERT_CONDITION(!intersects(f, obb{ { 0, 0, 5 }, { 1, 1, 1 }, tilt }));
+	// A thin box just outside the right plane and parallel to it, its AABB reaches inside
+	float h = std::sqrt(0.5f);
+	mat3 alongPlane{ { h, 0, -h }, { 0, 1, 0 }, { h, 0, h } };
+	obb sliver{ { 5.3f, 0, -5 }, { 0.05f, 1, 3 }, alongPlane };
+	ASSERT_CONDITION(!intersects(f, sliver));
+	ASSERT_CONDITION(intersects(f, obb2aabb(sliver)));
+	// Axis aligned boxes agree with the AABB test
+	aabb boxes[] = { { { -1, -1, -6 }, { 1, 1, -4 } }, { { 20, -1, -6 }, { 22, 1, -4 } }, { { -1, -1, -12 }, { 1, 1, -11 } } };
+	for (const aabb& box : boxes) {
+		ASSERT_CONDITION(intersects(f, aabb2obb(box)) == intersects(f, box));
+	}
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,133 @@
+#include "lm2.hpp"
+#include "lm2_parallel.hpp"
+#include "testlib.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+using namespace lm2;
+
+TEST_CASE(ThreadPoolRunsEveryTask) {
+	threadPool pool(4);
+	ASSERT_CONDITION(pool.getThreadCount() == 4);
+
+	std::vector<std::atomic<int>> calls(1000);
+	for (int repeat = 0; repeat < 50; repeat++) {
+		pool.run(calls.size(), [&](size_t i) {
+			calls[i]++;
+		});
+	}
+	for (auto& count : calls) {
+		ASSERT_CONDITION(count == 50);
+	}
+
+	// Ranges cover everything exactly once
+	std::vector<int> covered(10007);
+	parallelFor(pool, covered.size(), 100, [&](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			covered[i]++;
+		}
+	});
+	for (int count : covered) {
+		ASSERT_CONDITION(count == 1);
+	}
+	// Nothing to do is no call, a zero chunk size is one element per chunk
+	std::atomic<int> emptyCalls = 0;
+	parallelFor(pool, 0, 0, [&](size_t, size_t) { emptyCalls++; });
+	ASSERT_CONDITION(emptyCalls == 0);
+	std::atomic<int> unitChunks = 0;
+	parallelFor(pool, 3, 0, [&](size_t begin, size_t end) {
+		unitChunks += end == begin + 1;
+	});
+	ASSERT_CONDITION(unitChunks == 3);
+
+	threadPool single(1);
+	int sum = 0;
+	single.run(10, [&](size_t i) { sum += int(i); });
+	ASSERT_CONDITION(sum == 45);
+}
+
+TEST_CASE(ParallelMatrixArrays) {
+	threadPool pool(3);
+	const size_t count = 5000;
+	std::vector<mat4> models(count);
+	std::vector<mat3x4> locals(count);
+	for (size_t i = 0; i < count; i++) {
+		float f = float(i);
+		models[i] = compose(vec3{ f, -f, 1 }, quaternionEuler(vec3{ f * 0.1f, f * 0.2f, 0 }), vec3{ 1, 2, 1 });
+		locals[i] = mat3x4(models[i]);
+	}
+	mat4 viewProjection = perspective<float>(60.0f, 0.1f, 100.0f, 1) * lookAt(vec3{ 0, 0, 10 }, vec3{ 0, 0, 0 }, vec3{ 0, 1, 0 });
+
+	std::vector<mat4> serial(count), threaded(count);
+	soa::multiply(viewProjection, models.data(), count, serial.data());
+	parallel::multiply(pool, viewProjection, models.data(), count, threaded.data());
+	for (size_t i = 0; i < count; i++) {
+		ASSERT_CONDITION(equal(serial[i], viewProjection * models[i]));
+		// Same kernel on every chunk, so the results match bit for bit
+		ASSERT_CONDITION(std::memcmp(&threaded[i], &serial[i], sizeof(mat4)) == 0);
+	}
+
+	parallel::multiply(pool, models.data(), viewProjection, count, threaded.data());
+	ASSERT_CONDITION(equal(threaded[4321], models[4321] * viewProjection));
+	parallel::multiply(pool, models.data(), models.data(), count, threaded.data());
+	ASSERT_CONDITION(equal(threaded[17], models[17] * models[17]));
+
+	std::vector<mat3x4> affine(count);
+	parallel::multiply(pool, locals[3], locals.data(), count, affine.data());
+	ASSERT_CONDITION(equal(affine[4999], locals[3] * locals[4999]));
+	parallel::inverse(pool, locals.data(), count, affine.data());
+	// The translation of model 2500 is about 3500 long, a few float ULP of it are well above the
+	// default absolute epsilon of equal
+	float tolerance = 1e-6f * magnitude(vec3{ 2500, -2500, 1 });
+	ASSERT_CONDITION(equal(affine[2500] * locals[2500], identity3x4<float>(), tolerance));
+	parallel::inverseAffine(pool, models.data(), count, threaded.data());
+	ASSERT_CONDITION(equal(threaded[100], inverseAffine(models[100])));
+}
+
+TEST_CASE(ComposeHierarchy) {
+	// 0 <- 1 <- 2, 0 <- 3, 4 is a second root
+	const int32_t parents[] = { -1, 0, 1, 0, -1 };
+	mat4 local[5];
+	for (int i = 0; i < 5; i++) {
+		local[i] = compose(vec3{ float(i), 1, 0 }, quaternionAxisAngle(vec3{ 0, 0, 1 }, 10.0f * i), vec3{ 1, 1, 1 });
+	}
+	mat4 world[5];
+	soa::composeHierarchy(local, parents, 5, world);
+	ASSERT_CONDITION(equal(world[0], local[0]));
+	ASSERT_CONDITION(equal(world[2], local[0] * local[1] * local[2]));
+	ASSERT_CONDITION(equal(world[3], local[0] * local[3]));
+	ASSERT_CONDITION(equal(world[4], local[4]));
+
+	mat3x4 local3x4[5];
+	mat3x4 world3x4[5];
+	for (int i = 0; i < 5; i++) {
+		local3x4[i] = mat3x4(local[i]);
+	}
+	soa::composeHierarchy(local3x4, parents, 5, world3x4);
+	ASSERT_CONDITION(equal(mat4(world3x4[2]), world[2]));
+
+	// A forest of deep and wide trees, levels split over the pool give the same bits as the serial pass
+	const size_t count = 6000;
+	std::vector<int32_t> forest(count);
+	std::vector<mat3x4> locals(count), serial(count), threaded(count);
+	for (size_t i = 0; i < count; i++) {
+		forest[i] = i % 1000 == 0 ? -1 : int32_t(i % 7 == 0 ? i - 1 : i - 1 - (i * 7919) % std::min<size_t>(i % 1000, 40));
+		float f = float(i % 97);
+		locals[i] = mat3x4(compose(vec3{ f * 0.01f, 0.1f, 0 }, quaternionEuler(vec3{ f, f * 0.5f, 0 }), vec3{ 1, 1, 1 }));
+	}
+	soa::composeHierarchy(locals.data(), forest.data(), count, serial.data());
+	threadPool pool(4);
+	parallel::composeHierarchy(pool, locals.data(), forest.data(), count, threaded.data());
+	ASSERT_CONDITION(std::memcmp(serial.data(), threaded.data(), count * sizeof(mat3x4)) == 0);
+	for (size_t i = 0; i < count; i++) {
+		mat3x4 expected = forest[i] < 0 ? locals[i] : serial[forest[i]] * locals[i];
+		ASSERT_CONDITION(equal(serial[i], expected));
+	}
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
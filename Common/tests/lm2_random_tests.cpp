@@ -0,0 +1,118 @@
+#include "lm2.hpp"
+#include "lm2_random.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace lm2;
+
+constexpr float firstDraw(uint64_t seed, uint64_t stream) {
+	random::generator g(seed, stream);
+	return random::uniform(g);
+}
+static_assert(firstDraw(1, 0) == firstDraw(1, 0));
+static_assert(firstDraw(1, 0) != firstDraw(1, 1));
+static_assert(firstDraw(1, 0) >= 0.0f && firstDraw(1, 0) < 1.0f);
+
+TEST_CASE(RandomSeeding) {
+	random::generator a(42), b(42), c(42, 1), d(43);
+	int sameStream = 0, otherStream = 0, otherSeed = 0;
+	for (int i = 0; i < 1000; i++) {
+		uint32_t va = a.next();
+		sameStream += va == b.next();
+		otherStream += va == c.next();
+		otherSeed += va == d.next();
+	}
+	ASSERT_CONDITION(sameStream == 1000);
+	ASSERT_CONDITION(otherStream == 0);
+	ASSERT_CONDITION(otherSeed == 0);
+
+	// Lane l of stream s is scalar stream s * 8 + l
+	random::generator8 lanes(7, 3);
+	std::vector<random::generator> scalar;
+	for (size_t l = 0; l < random::laneCount; l++) {
+		scalar.emplace_back(7, 3 * random::laneCount + l);
+	}
+	for (int i = 0; i < 100; i++) {
+		uint32_t bits[random::laneCount];
+		lanes.next(bits);
+		for (size_t l = 0; l < random::laneCount; l++) {
+			ASSERT_CONDITION(bits[l] == scalar[l].next());
+		}
+	}
+}
+
+TEST_CASE(RandomUniform) {
+	random::generator g(1);
+	double sum = 0;
+	const int count = 100000;
+	for (int i = 0; i < count; i++) {
+		float u = random::uniform(g);
+		ASSERT_CONDITION(u >= 0.0f && u < 1.0f);
+		sum += u;
+
+		vec3 v = random::uniform(g, vec3{ -1, 2, 10 }, vec3{ 1, 3, 20 });
+		ASSERT_CONDITION(v.x >= -1 && v.x < 1 && v.y >= 2 && v.y < 3 && v.z >= 10 && v.z < 20);
+	}
+	ASSERT_CONDITION(std::abs(sum / count - 0.5) < 0.01);
+
+	// Arrays, including a tail shorter than 8
+	random::generator8 g8(1);
+	std::vector<float> values(count + 5, -1.0f);
+	random::uniform(g8, values.data(), count + 3, 2.0f, 4.0f);
+	sum = 0;
+	for (int i = 0; i < count + 3; i++) {
+		ASSERT_CONDITION(values[i] >= 2.0f && values[i] < 4.0f);
+		sum += values[i];
+	}
+	ASSERT_CONDITION(std::abs(sum / (count + 3) - 3.0) < 0.02);
+	ASSERT_CONDITION(values[count + 3] == -1.0f && values[count + 4] == -1.0f);
+
+	std::vector<vec4> vectors(13);
+	random::uniform(g8, vectors.data(), vectors.size(), vec4{ 0, 0, 0, 0 }, vec4{ 1, 2, 3, 4 });
+	for (vec4 v : vectors) {
+		ASSERT_CONDITION(v.x >= 0 && v.x < 1 && v.y < 2 && v.z < 3 && v.w < 4);
+	}
+}
+
+TEST_CASE(RandomShapes) {
+	random::generator g(5);
+	random::generator8 g8(5);
+	const size_t count = 20000;
+	std::vector<vec3> sphere(count), ball(count), hemisphere(count);
+	std::vector<vec2> disk(count);
+	random::onUnitSphere(g8, sphere.data(), count);
+	random::inUnitSphere(g8, ball.data(), count);
+	random::onHemisphere(g8, vec3{ 0, 1, 0 }, hemisphere.data(), count);
+	random::inUnitDisk(g8, disk.data(), count);
+
+	vec3 sphereMean{}, scalarMean{};
+	int innerBall = 0, innerDisk = 0;
+	for (size_t i = 0; i < count; i++) {
+		ASSERT_CONDITION(std::abs(magnitude(sphere[i]) - 1) < 1e-5f);
+		ASSERT_CONDITION(magnitude(ball[i]) <= 1.00001f);
+		ASSERT_CONDITION(std::abs(magnitude(hemisphere[i]) - 1) < 1e-5f && hemisphere[i].y >= 0);
+		ASSERT_CONDITION(magnitude(disk[i]) <= 1.00001f);
+		sphereMean += sphere[i];
+		innerBall += magnitude(ball[i]) < 0.5f;
+		innerDisk += magnitude(disk[i]) < 0.5f;
+
+		vec3 s = random::onUnitSphere(g);
+		ASSERT_CONDITION(std::abs(magnitude(s) - 1) < 1e-5f);
+		ASSERT_CONDITION(magnitude(random::inUnitSphere(g)) <= 1.00001f);
+		ASSERT_CONDITION(random::onHemisphere(g, vec3{ 1, 0, 0 }).x >= 0);
+		ASSERT_CONDITION(magnitude(random::inUnitDisk(g)) <= 1.00001f);
+		ASSERT_CONDITION(std::abs(magnitude(random::onUnitCircle(g)) - 1) < 1e-5f);
+		scalarMean += s;
+	}
+	// Centered, and uniform over the area / volume: 1/4 of the disk and 1/8 of the ball within radius 0.5
+	ASSERT_CONDITION(magnitude(sphereMean / float(count)) < 0.02f);
+	ASSERT_CONDITION(magnitude(scalarMean / float(count)) < 0.02f);
+	ASSERT_CONDITION(std::abs(innerDisk / float(count) - 0.25f) < 0.01f);
+	ASSERT_CONDITION(std::abs(innerBall / float(count) - 0.125f) < 0.01f);
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
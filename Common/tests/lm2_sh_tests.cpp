@@ -0,0 +1,170 @@
+#include "lm2.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_random.hpp"
+#include "lm2_sh.hpp"
+#include "lm2_soa.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace lm2;
+
+constexpr float pi = 3.14159265f;
+
+static_assert(sizeof(sh::l2) == 9 * sizeof(vec3));
+
+// Cubemap with every texel set from its direction
+template<typename F>
+static std::vector<vec3> cubemap(size_t size, F f) {
+	std::vector<vec3> texels(size * size * 6);
+	for (size_t face = 0; face < 6; face++) {
+		for (size_t j = 0; j < size; j++) {
+			for (size_t i = 0; i < size; i++) {
+				float u = -1 + 2 * (i + 0.5f) / size, v = -1 + 2 * (j + 0.5f) / size;
+				vec3 d = face == 0 ? vec3{ 1, -v, -u } : face == 1 ? vec3{ -1, -v, u } : face == 2 ? vec3{ u, 1, v }
+					: face == 3 ? vec3{ u, -1, -v } : face == 4 ? vec3{ u, -v, 1 } : vec3{ -u, -v, -1 };
+				texels[(face * size + j) * size + i] = f(normalize(d));
+			}
+		}
+	}
+	return texels;
+}
+
+static sh::l2 randomSH(random::generator& g) {
+	sh::l2 s;
+	for (vec3& c : s.coefficients) {
+		c = random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 });
+	}
+	return s;
+}
+
+TEST_CASE(Orthonormal) {
+	// Projecting a basis function gives back that coefficient alone
+	for (size_t k = 0; k < 9; k++) {
+		std::vector<vec3> texels = cubemap(48, [&](vec3 d) {
+			float y[9];
+			sh::basis<3>(d, y);
+			return vec3{ y[k], 2 * y[k], -y[k] };
+		});
+		sh::l2 s = sh::projectCubemap(texels.data(), 48);
+		for (size_t i = 0; i < 9; i++) {
+			float expected = i == k ? 1.0f : 0.0f;
+			ASSERT_CONDITION(equal(s.coefficients[i], vec3{ expected, 2 * expected, -expected }, 2e-3f));
+		}
+	}
+}
+
+TEST_CASE(Irradiance) {
+	// A constant sky of radiance 1 gives irradiance pi everywhere
+	std::vector<vec3> sky = cubemap(16, [](vec3) { return vec3{ 1, 1, 1 }; });
+	sh::l1 ambient1 = sh::projectCubemap<2>(sky.data(), 16);
+	sh::l2 ambient2 = sh::projectCubemap(sky.data(), 16);
+	ASSERT_CONDITION(std::abs(ambient2.coefficients[0].x - 4 * pi * 0.282094792f) < 1e-4f);
+	random::generator g(1);
+	for (int i = 0; i < 20; i++) {
+		vec3 n = random::onUnitSphere(g);
+		ASSERT_CONDITION(equal(sh::irradiance(ambient1, n), vec3{ pi, pi, pi }, 1e-4f));
+		ASSERT_CONDITION(equal(sh::irradiance(ambient2, n), vec3{ pi, pi, pi }, 1e-4f));
+	}
+
+	// A delta light, band l adds (2l + 1) / 4 pi * A_l * P_l(cos)
+	vec3 light = normalize(vec3{ 1, 2, 3 });
+	sh::l2 s;
+	sh::addSample(s, light, vec3{ 1, 1, 1 }, 1.0f);
+	ASSERT_CONDITION(equal(sh::irradiance(s, light), vec3{ 1.0625f, 1.0625f, 1.0625f }, 1e-4f));
+	ASSERT_CONDITION(equal(sh::irradiance(s, -light), vec3{ 0.0625f, 0.0625f, 0.0625f }, 1e-4f));
+	vec3 side = normalize(cross(light, vec3{ 0, 0, 1 }));
+	ASSERT_CONDITION(equal(sh::irradiance(s, side), vec3{ 0.25f - 0.15625f, 0.25f - 0.15625f, 0.25f - 0.15625f }, 1e-4f));
+}
+
+TEST_CASE(Rotation) {
+	random::generator g(2);
+	for (int i = 0; i < 50; i++) {
+		sh::l2 s = randomSH(g);
+		vec3 axis = normalize(random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 }) + vec3{ 0, 0, 0.01f });
+		quaternion q = quaternionAxisAngle(axis, random::uniform(g, 0.0f, 360.0f));
+		mat3 r = quaternion2matrix3x3(q);
+		sh::l2 rotated = sh::rotate(s, r);
+		sh::l2 byQuaternion = sh::rotate(s, q);
+		sh::l1 low{ { s.coefficients[0], s.coefficients[1], s.coefficients[2], s.coefficients[3] } };
+		sh::l1 lowRotated = sh::rotate(low, r);
+		for (int j = 0; j < 10; j++) {
+			vec3 d = random::onUnitSphere(g);
+			vec3 expected = sh::evaluate(s, transpose(r) * d);
+			ASSERT_CONDITION(equal(sh::evaluate(rotated, d), expected, 1e-4f));
+			ASSERT_CONDITION(equal(sh::evaluate(byQuaternion, d), expected, 1e-4f));
+			ASSERT_CONDITION(equal(sh::evaluate(lowRotated, d), sh::evaluate(low, transpose(r) * d), 1e-4f));
+		}
+	}
+	// The identity keeps every coefficient
+	sh::l2 s = randomSH(g);
+	sh::l2 same = sh::rotate(s, identity3x3<float>());
+	for (size_t i = 0; i < 9; i++) {
+		ASSERT_CONDITION(equal(same.coefficients[i], s.coefficients[i], 1e-5f));
+	}
+}
+
+TEST_CASE(Packed) {
+	random::generator g(3);
+	sh::l2 s = randomSH(g);
+	sh::l1 low{ { s.coefficients[0], s.coefficients[1], s.coefficients[2], s.coefficients[3] } };
+	sh::packedIrradiance packed = sh::packIrradiance(s);
+	sh::packedIrradiance packedLow = sh::packIrradiance(low);
+	ASSERT_CONDITION(equal(packedLow.c, vec4{ 0, 0, 0, 0 }) && equal(packedLow.b[1], vec4{ 0, 0, 0, 0 }));
+
+	const size_t count = 1001;
+	soa::vec3Stream normals, out;
+	normals.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		normals.set(i, random::onUnitSphere(g));
+	}
+	sh::irradiance(packed, normals, out);
+	for (size_t i = 0; i < count; i++) {
+		vec3 n = normals.get(i);
+		vec3 expected = sh::irradiance(s, n);
+		ASSERT_CONDITION(equal(sh::irradiance(packed, n), expected, 1e-4f));
+		ASSERT_CONDITION(equal(out.get(i), expected, 1e-4f));
+		ASSERT_CONDITION(equal(sh::irradiance(packedLow, n), sh::irradiance(low, n), 1e-4f));
+	}
+	threadPool pool(4);
+	soa::vec3Stream pooled;
+	sh::irradiance(packed, normals, pooled, &pool);
+	ASSERT_CONDITION(std::memcmp(out.blocks.data(), pooled.blocks.data(), out.blocks.size() * sizeof(out.blocks[0])) == 0);
+}
+
+TEST_CASE(Projection) {
+	// Samples and the cubemap agree on a smooth sky
+	auto skyColor = [](vec3 d) {
+		return vec3{ 1 + d.y, 0.5f + 0.5f * d.x * d.z, std::max(d.z, 0.0f) };
+	};
+	std::vector<vec3> texels = cubemap(32, skyColor);
+	random::generator g(4);
+	const size_t count = 200000;
+	std::vector<vec3> directions(count), colors(count);
+	for (size_t i = 0; i < count; i++) {
+		directions[i] = random::onUnitSphere(g);
+		colors[i] = skyColor(directions[i]);
+	}
+	sh::l2 fromCube = sh::projectCubemap(texels.data(), 32);
+	sh::l2 fromSamples = sh::projectSamples(directions.data(), colors.data(), count);
+	for (size_t i = 0; i < 9; i++) {
+		ASSERT_CONDITION(equal(fromCube.coefficients[i], fromSamples.coefficients[i], 3e-2f));
+	}
+
+	// The same sums with a pool
+	for (size_t threads : { 3, 4 }) {
+		threadPool pool(threads);
+		sh::l2 cubePooled = sh::projectCubemap(texels.data(), 32, &pool);
+		sh::l2 samplesPooled = sh::projectSamples(directions.data(), colors.data(), count, &pool);
+		ASSERT_CONDITION(std::memcmp(&cubePooled, &fromCube, sizeof(sh::l2)) == 0);
+		ASSERT_CONDITION(std::memcmp(&samplesPooled, &fromSamples, sizeof(sh::l2)) == 0);
+	}
+	sh::l2 none = sh::projectSamples(directions.data(), colors.data(), 0);
+	ASSERT_CONDITION(equal(none.coefficients[0], vec3{ 0, 0, 0 }));
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,281 @@
+#include "lm2.hpp"
+#include "lm2_soa.hpp"
+#include "testlib.hpp"
+
+using namespace lm2;
+
+TEST_CASE(StreamResizeGetSet) {
+	soa::vec3Stream s;
+	s.resize(10);
+	ASSERT_CONDITION(s.size() == 10);
+	ASSERT_CONDITION(s.blockCount() == 2);
+	ASSERT_CONDITION(equal(s.get(9), 0.0f));
+
+	s.set(9, { 1, 2, 3 });
+	ASSERT_CONDITION(equal(s.get(9), vec3{ 1, 2, 3 }));
+	ASSERT_CONDITION(s.blocks[1].y[1] == 2);
+
+	// Shrinking inside the last block clears the dropped lanes, growing back reads zeros
+	s.resize(9);
+	ASSERT_CONDITION(s.blockCount() == 2 && s.blocks[1].x[1] == 0 && s.blocks[1].z[1] == 0);
+	s.resize(10);
+	ASSERT_CONDITION(equal(s.get(9), 0.0f));
+	soa::quaternionStream<double> q;
+	q.resize(3);
+	q.set(2, { 1, 2, 3, 4 });
+	q.resize(2);
+	ASSERT_CONDITION(q.blocks[0].w[2] == 0 && q.blocks[0].z[2] == 0);
+}
+
+TEST_CASE(StreamAoSConversion) {
+	vec3 points[11];
+	for (int i = 0; i < 11; i++) {
+		points[i] = { float(i), float(i * 2), float(-i) };
+	}
+	soa::vec3Stream s;
+	soa::fromAoS(points, 11, s);
+	ASSERT_CONDITION(equal(s.get(7), points[7]));
+
+	vec3 back[11];
+	soa::toAoS(s, back);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(back[i], points[i]));
+	}
+
+	// Strided, as used for vertex attributes
+	struct testVertex {
+		vec3 pos;
+		vec2 uv;
+	};
+	testVertex vertices[3] = { { { 1, 2, 3 }, { 4, 5 } }, { { 6, 7, 8 }, { 9, 10 } }, { { 11, 12, 13 }, { 14, 15 } } };
+	soa::vec3Stream pos;
+	soa::vec2Stream uv;
+	soa::fromAoS(&vertices[0].pos, 3, pos, sizeof(testVertex));
+	soa::fromAoS(&vertices[0].uv, 3, uv, sizeof(testVertex));
+	ASSERT_CONDITION(equal(pos.get(2), vec3{ 11, 12, 13 }));
+	ASSERT_CONDITION(equal(uv.get(1), vec2{ 9, 10 }));
+
+	pos.set(1, { 0, 0, 0 });
+	soa::toAoS(pos, &vertices[0].pos, sizeof(testVertex));
+	ASSERT_CONDITION(equal(vertices[1].pos, 0.0f));
+	ASSERT_CONDITION(equal(vertices[1].uv, vec2{ 9, 10 }));
+}
+
+TEST_CASE(StreamTransform) {
+	mat4 rotation{
+		{ 0, 1, 0, 0 },
+		{ -1, 0, 0, 0 },
+		{ 0, 0, 2, 0 },
+		{ 0, 0, 0, 1 },
+	};
+	mat4 mat = position3d(vec3{ 1, 2, 3 }) * rotation;
+
+	soa::vec3Stream points;
+	points.resize(20);
+	for (int i = 0; i < 20; i++) {
+		points.set(i, { float(i), float(i % 3), 1.0f });
+	}
+
+	soa::vec3Stream transformed;
+	soa::transformPoints(mat, points, transformed);
+	soa::vec4Stream homogeneous;
+	soa::transformPoints(mat, points, homogeneous);
+	soa::vec3Stream directions;
+	soa::transformDirections(mat, points, directions);
+
+	ASSERT_CONDITION(transformed.size() == 20);
+	for (int i = 0; i < 20; i++) {
+		vec3 p = points.get(i);
+		vec4 expected = mat * vec4{ p.x, p.y, p.z, 1 };
+		ASSERT_CONDITION(equal(transformed.get(i), vec3{ expected.x, expected.y, expected.z }));
+		ASSERT_CONDITION(equal(homogeneous.get(i), expected));
+
+		vec4 expectedDir = mat * vec4{ p.x, p.y, p.z, 0 };
+		ASSERT_CONDITION(equal(directions.get(i), vec3{ expectedDir.x, expectedDir.y, expectedDir.z }));
+	}
+}
+
+TEST_CASE(StreamDotCrossNormalize) {
+	soa::vec3Stream a;
+	soa::vec3Stream b;
+	a.resize(9);
+	b.resize(9);
+	for (int i = 0; i < 9; i++) {
+		a.set(i, { float(i), 1, 0 });
+		b.set(i, { 0, float(i), 2 });
+	}
+	a.set(8, { 0, 0, 0 });
+
+	soa::floatStream dots;
+	soa::dot(a, b, dots);
+	soa::vec3Stream crosses;
+	soa::cross(a, b, crosses);
+	soa::vec3Stream normals;
+	soa::normalize(a, normals);
+	soa::floatStream lengths;
+	soa::magnitude(a, lengths);
+
+	for (int i = 0; i < 9; i++) {
+		ASSERT_CONDITION(dots.get(i) == dot(a.get(i), b.get(i)));
+		ASSERT_CONDITION(equal(crosses.get(i), cross(a.get(i), b.get(i))));
+		ASSERT_CONDITION(equal(normals.get(i), normalize(a.get(i))));
+		ASSERT_CONDITION(std::abs(lengths.get(i) - magnitude(a.get(i))) < 0.0001f);
+	}
+	ASSERT_CONDITION(equal(normals.get(8), 0.0f));
+}
+
+TEST_CASE(StreamFmaLerp) {
+	soa::vec3Stream a, b, out;
+	soa::floatStream t;
+	a.resize(11);
+	b.resize(11);
+	t.resize(11);
+	for (int i = 0; i < 11; i++) {
+		a.set(i, { float(i), 1, -float(i) });
+		b.set(i, { 2, float(i), 4 });
+		t.set(i, i / 10.0f);
+	}
+
+	soa::fma(a, 0.5f, b, out);
+	ASSERT_CONDITION(out.size() == 11);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(out.get(i), fma(a.get(i), 0.5f, b.get(i))));
+	}
+	soa::lerp(a, b, t, out);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(out.get(i), lerp(a.get(i), b.get(i), t.get(i))));
+	}
+	ASSERT_CONDITION(equal(out.get(0), a.get(0)));
+	ASSERT_CONDITION(equal(out.get(10), b.get(10)));
+}
+
+TEST_CASE(StreamQuaternionInterpolation) {
+	soa::quaternionStreamF a;
+	soa::quaternionStreamF b;
+	soa::floatStream t;
+	a.resize(13);
+	b.resize(13);
+	t.resize(13);
+	for (int i = 0; i < 13; i++) {
+		a.set(i, quaternionAxisAngle(vec3{ 0, 1, 0 }, float(i * 10)));
+		b.set(i, quaternionAxisAngle(normalize(vec3{ 1, 1, float(i) }), float(i * -12)));
+		t.set(i, float(i) / 12.0f);
+	}
+	b.set(3, -b.get(3));
+
+	soa::quaternionStreamF slerped;
+	soa::slerp(a, b, t, slerped);
+	soa::quaternionStreamF nlerped;
+	soa::nlerp(a, b, t, nlerped);
+	for (int i = 0; i < 13; i++) {
+		ASSERT_CONDITION(equal(slerped.get(i), slerp(a.get(i), b.get(i), t.get(i)), 0.0001f));
+		ASSERT_CONDITION(equal(nlerped.get(i), nlerp(a.get(i), b.get(i), t.get(i))));
+	}
+}
+
+TEST_CASE(StreamQuaternionMatrices) {
+	quaternion source[10];
+	for (int i = 0; i < 10; i++) {
+		source[i] = quaternionEuler(vec3{ float(i * 7), float(i * -11), float(i * 5) });
+	}
+	soa::quaternionStreamF q;
+	soa::fromAoS(source, 10, q);
+
+	mat3 m3[10];
+	mat4 m4[10];
+	soa::quaternion2matrix3x3(q, m3);
+	soa::quaternion2matrix4x4(q, m4);
+	for (int i = 0; i < 10; i++) {
+		mat3 expected = quaternion2matrix3x3(source[i]);
+		ASSERT_CONDITION(equal(m3[i].x, expected.x) && equal(m3[i].y, expected.y) && equal(m3[i].z, expected.z));
+		ASSERT_CONDITION(equal(m4[i].x, vec4{ expected.x.x, expected.x.y, expected.x.z, 0 }));
+		ASSERT_CONDITION(equal(m4[i].w, vec4{ 0, 0, 0, 1 }));
+	}
+}
+
+TEST_CASE(MatrixArrayInverse) {
+	mat4 rigid[11];
+	mat4 affine[11];
+	mat4 general[11];
+	for (int i = 0; i < 11; i++) {
+		rigid[i] = position3d(vec3{ float(i), float(-i * 2), 3 }) * mat4(rotation3D(vec3{ float(i * 13), float(i * -7), float(i * 29) }));
+		affine[i] = rigid[i] * mat4{ { 1.0f + i, 0.25f, 0, 0 }, { 0, 2, 0, 0 }, { 0, 0, 0.5f, 0 }, { 0, 0, 0, 1 } };
+		general[i] = affine[i];
+		general[i].w = vec4{ 0.1f * i, 0, 0.2f, 1 };
+	}
+	general[4] = mat4{};
+
+	mat4 rigidInv[11];
+	mat4 affineInv[11];
+	mat4 generalInv[11];
+	soa::inverseRigid(rigid, 11, rigidInv);
+	soa::inverseAffine(affine, 11, affineInv);
+	soa::inverse(general, 11, generalInv);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(rigidInv[i], inverseRigid(rigid[i])));
+		ASSERT_CONDITION(equal(affineInv[i], inverseAffine(affine[i])));
+		ASSERT_CONDITION(equal(generalInv[i], inverse(general[i])));
+	}
+	ASSERT_CONDITION(equal(generalInv[4], mat4{}));
+
+	// In place
+	soa::inverseAffine(affine, 11, affine);
+	ASSERT_CONDITION(equal(affine[10], affineInv[10]));
+}
+
+TEST_CASE(AffineMatrixArrays) {
+	mat3x4 world[11];
+	mat3x4 bind[11];
+	for (int i = 0; i < 11; i++) {
+		world[i] = mat3x4(position3d(vec3{ float(i), 2, float(-i) }) * mat4(rotation3D(vec3{ float(i * 11), float(i * 5), float(i * -17) })));
+		bind[i] = mat3x4(compose(vec3{ 1, float(i), 0 }, quaternionEuler(vec3{ 0, float(i * 9), 0 }), vec3{ 1, 2, 0.5f }));
+	}
+
+	mat3x4 skin[11];
+	soa::multiply(world, bind, 11, skin);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(skin[i], world[i] * bind[i]));
+		ASSERT_CONDITION(equal(mat4(skin[i]), mat4(world[i]) * mat4(bind[i])));
+	}
+	mat3x4 parent = mat3x4(position3d(vec3{ 0, 0, 5 }));
+	soa::multiply(parent, world, 11, skin);
+	ASSERT_CONDITION(equal(skin[7], parent * world[7]));
+
+	mat3x4 inv[11];
+	soa::inverse(bind, 11, inv);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(inv[i], inverse(bind[i])));
+		ASSERT_CONDITION(equal(inv[i] * bind[i], identity3x4<float>()));
+	}
+	soa::inverseRigid(world, 11, inv);
+	for (int i = 0; i < 11; i++) {
+		ASSERT_CONDITION(equal(inv[i], inverseRigid(world[i])));
+	}
+
+	soa::vec3Stream points, out;
+	points.resize(3);
+	points.set(2, { 1, 2, 3 });
+	soa::transformPoints(world[3], points, out);
+	ASSERT_CONDITION(equal(out.get(2), transformPoint(world[3], vec3{ 1, 2, 3 })));
+	soa::transformDirections(world[3], points, out);
+	ASSERT_CONDITION(equal(out.get(2), transformDirection(world[3], vec3{ 1, 2, 3 })));
+}
+
+BENCHMARK_CASE(StreamTransformPoints) {
+	mat4 mat = position3d(vec3{ 1, 2, 3 });
+	soa::vec3Stream points;
+	points.resize(4096);
+	for (int i = 0; i < 4096; i++) {
+		points.set(i, { float(i), float(i % 7), 1.0f });
+	}
+	soa::vec3Stream transformed;
+	bench.SetItems(4096);
+	bench.Measure([&] {
+		soa::transformPoints(mat, points, transformed);
+		DoNotOptimize(transformed);
+	});
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
@@ -0,0 +1,167 @@
+#include "lm2.hpp"
+#include "lm2_random.hpp"
+#include "lm2_spline.hpp"
+#include "testlib.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace lm2;
+
+static_assert(equal(evaluate(bezier(vec2{ 0, 0 }, vec2{ 1, 2 }, vec2{ 3, 2 }, vec2{ 4, 0 }), 0.0f), vec2{ 0, 0 }));
+static_assert(equal(evaluate(bezier(vec2{ 0, 0 }, vec2{ 1, 2 }, vec2{ 3, 2 }, vec2{ 4, 0 }), 1.0f), vec2{ 4, 0 }));
+static_assert(equal(evaluate(bezier(vec2{ 0, 0 }, vec2{ 1, 2 }, vec2{ 3, 2 }, vec2{ 4, 0 }), 0.5f), vec2{ 2, 1.5f }));
+static_assert(equal(derivative(hermite(vec2{ 0, 0 }, vec2{ 1, 0 }, vec2{ 2, 2 }, vec2{ 0, 3 }), 1.0f), vec2{ 0, 3 }));
+
+TEST_CASE(SplineSegments) {
+	vec3 p0{ 0, 0, 0 }, p1{ 1, 2, 0 }, p2{ 3, 2, 1 }, p3{ 4, 0, 2 };
+	cubicCurve<vec3> curve = bezier(p0, p1, p2, p3);
+	// Tangents at the ends point at the inner control points
+	ASSERT_CONDITION(equal(derivative(curve, 0.0f), (p1 - p0) * 3.0f));
+	ASSERT_CONDITION(equal(derivative(curve, 1.0f), (p3 - p2) * 3.0f));
+	// de Casteljau at t = 0.3
+	float t = 0.3f;
+	vec3 a = lerp(p0, p1, t), b = lerp(p1, p2, t), c = lerp(p2, p3, t);
+	ASSERT_CONDITION(equal(evaluate(curve, t), lerp(lerp(a, b, t), lerp(b, c, t), t)));
+	ASSERT_CONDITION(equal(secondDerivative(curve, t), evaluate(derivative(derivative(curve)), t)));
+
+	cubicCurve<vec3> rom = catmullRom(p0, p1, p2, p3);
+	ASSERT_CONDITION(equal(evaluate(rom, 0.0f), p1) && equal(evaluate(rom, 1.0f), p2));
+	ASSERT_CONDITION(equal(derivative(rom, 0.0f), (p2 - p0) * 0.5f));
+}
+
+TEST_CASE(SplineCurves) {
+	std::vector<vec3> points = { { 0, 0, 0 }, { 1, 2, 0 }, { 3, 2, 1 }, { 4, 0, 2 }, { 6, 1, 2 } };
+	spline<vec3> open = catmullRomSpline(points.data(), points.size());
+	ASSERT_CONDITION(open.getSegmentCount() == 4);
+	for (size_t i = 0; i < points.size(); i++) {
+		ASSERT_CONDITION(equal(open.evaluate(static_cast<float>(i)), points[i]));
+	}
+	// C1 at the joints
+	ASSERT_CONDITION(equal(open.derivative(2.0f), (points[3] - points[1]) * 0.5f));
+	ASSERT_CONDITION(equal(open.evaluate(-3.0f), points[0]) && equal(open.evaluate(10.0f), points[4]));
+
+	spline<vec3> closed = catmullRomSpline(points.data(), points.size(), true);
+	ASSERT_CONDITION(closed.getSegmentCount() == 5);
+	ASSERT_CONDITION(equal(closed.evaluate(5.0f), points[0]));
+	ASSERT_CONDITION(equal(closed.derivative(0.0f), (points[1] - points[4]) * 0.5f));
+
+	spline<vec3> beziers = bezierSpline(points.data(), 4);
+	ASSERT_CONDITION(beziers.getSegmentCount() == 1 && equal(beziers.evaluate(1.0f), points[3]));
+	std::vector<vec3> tangents(points.size(), vec3{ 1, 0, 0 });
+	spline<vec3> hermites = hermiteSpline(points.data(), tangents.data(), points.size());
+	ASSERT_CONDITION(equal(hermites.derivative(3.0f), vec3{ 1, 0, 0 }) && equal(hermites.evaluate(3.0f), points[3]));
+
+	ASSERT_CONDITION(equal(catmullRomSpline(points.data(), 1).evaluate(0.5f), points[0]));
+	ASSERT_CONDITION(equal(spline<vec3>().evaluate(1.0f), vec3{}));
+
+	// Quaternion keys, one given on the far hemisphere
+	std::vector<quaternion> keys = {
+		quaternionAxisAngle(vec3{ 0, 1, 0 }, 0.0f),
+		-quaternionAxisAngle(vec3{ 0, 1, 0 }, 60.0f),
+		quaternionAxisAngle(vec3{ 0, 1, 0 }, 120.0f),
+	};
+	spline<quaternion> rotations = catmullRomSpline(keys.data(), keys.size());
+	ASSERT_CONDITION(equal(rotations.evaluate(1.0f), -keys[1]));
+	for (float u = 0; u <= 2; u += 0.125f) {
+		quaternion q = rotations.evaluate(u);
+		ASSERT_CONDITION(std::abs(magnitude(q) - 1) < 1e-5f);
+		// Stays on the arc about y, the angle grows with u
+		vec3 axis;
+		float degrees = 0;
+		quaternion2axisAngle(q, axis, degrees);
+		ASSERT_CONDITION(u == 0 || (std::abs(axis.y) > 0.999f && std::abs(degrees - 60 * u) < 2));
+	}
+}
+
+TEST_CASE(SplineArcLength) {
+	// A straight line with control points bunched at the start, the speed varies a lot
+	std::vector<vec2> points = { { 0, 0 }, { 0.1f, 0 }, { 0.2f, 0 }, { 10, 0 } };
+	spline<vec2> line = bezierSpline(points.data(), points.size());
+	arcLengthTable<vec2> table(line, 32);
+	ASSERT_CONDITION(std::abs(table.getLength() - 10) < 1e-4f);
+	for (float distance = 0; distance <= 10; distance += 0.5f) {
+		ASSERT_CONDITION(std::abs(line.evaluate(table.parameter(distance)).x - distance) < 0.02f);
+	}
+	ASSERT_CONDITION(table.parameter(-1) == 0 && table.parameter(20) == 1);
+
+	// Unit circle from 8 points, length close to 2 pi
+	std::vector<vec2> circle;
+	for (int i = 0; i < 8; i++) {
+		float angle = i * 6.28318530718f / 8;
+		circle.push_back({ std::cos(angle), std::sin(angle) });
+	}
+	spline<vec2> loop = catmullRomSpline(circle.data(), circle.size(), true);
+	arcLengthTable<vec2> loopTable(loop);
+	ASSERT_CONDITION(std::abs(loopTable.getLength() - 6.28318530718f) < 0.05f);
+
+	soa::vec2Stream evenly;
+	sampleByDistance(line, table, 101, evenly);
+	ASSERT_CONDITION(evenly.size() == 101);
+	for (size_t i = 0; i < evenly.size(); i++) {
+		ASSERT_CONDITION(std::abs(evenly.get(i).x - 0.1f * i) < 0.02f);
+	}
+}
+
+template<typename V, typename Stream>
+static void checkBulk(const spline<V>& curve, float maxU) {
+	random::generator g(9);
+	soa::floatStream u;
+	u.resize(203);
+	for (size_t i = 0; i < u.size(); i++) {
+		// The first blocks share a segment, the rest are scattered
+		u.set(i, i < 64 ? 1.25f + i * 0.001f : random::uniform(g, -0.5f, maxU + 0.5f));
+	}
+	Stream values, tangents, samples;
+	evaluate(curve, u, values);
+	derivative(curve, u, tangents);
+	sample(curve, 77, samples);
+	ASSERT_CONDITION(values.size() == 203 && samples.size() == 77);
+	for (size_t i = 0; i < u.size(); i++) {
+		ASSERT_CONDITION(equal(values.get(i), curve.evaluate(u.get(i))));
+		ASSERT_CONDITION(equal(tangents.get(i), curve.derivative(u.get(i))));
+	}
+	for (size_t i = 0; i < samples.size(); i++) {
+		ASSERT_CONDITION(equal(samples.get(i), curve.evaluate(i * maxU / 76)));
+	}
+}
+
+TEST_CASE(SplineBulk) {
+	random::generator g(4);
+	std::vector<vec2> points2;
+	std::vector<vec3> points3;
+	std::vector<vec4> points4;
+	std::vector<quaternion> rotations;
+	for (int i = 0; i < 6; i++) {
+		points2.push_back(random::uniform(g, vec2{ -1, -1 }, vec2{ 1, 1 }));
+		points3.push_back(random::uniform(g, vec3{ -1, -1, -1 }, vec3{ 1, 1, 1 }));
+		points4.push_back(random::uniform(g, vec4{ -1, -1, -1, -1 }, vec4{ 1, 1, 1, 1 }));
+		rotations.push_back(quaternionEuler(random::uniform(g, vec3{ -90, -90, -90 }, vec3{ 90, 90, 90 })));
+	}
+	checkBulk<vec2, soa::vec2Stream>(catmullRomSpline(points2.data(), 6), 5);
+	checkBulk<vec3, soa::vec3Stream>(catmullRomSpline(points3.data(), 6), 5);
+	checkBulk<vec4, soa::vec4Stream>(bezierSpline(points4.data(), 4), 1);
+	checkBulk<quaternion, soa::quaternionStreamF>(catmullRomSpline(rotations.data(), 6), 5);
+
+	// A single segment
+	cubicCurve<vec3> curve = bezier(points3[0], points3[1], points3[2], points3[3]);
+	soa::floatStream t;
+	t.resize(20);
+	for (size_t i = 0; i < t.size(); i++) {
+		t.set(i, i / 19.0f);
+	}
+	soa::vec3Stream out;
+	evaluate(curve, t, out);
+	for (size_t i = 0; i < t.size(); i++) {
+		ASSERT_CONDITION(equal(out.get(i), evaluate(curve, t.get(i))));
+	}
+
+	// Empty spline gives zeros
+	soa::vec3Stream empty;
+	sample(spline<vec3>(), 5, empty);
+	ASSERT_CONDITION(empty.size() == 5 && equal(empty.get(4), vec3{}));
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
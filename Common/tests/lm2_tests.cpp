@@ -101,6 +101,51 @@ TEST_CASE(VectorModulo) {
 	ASSERT_CONDITION(equal(v4 % vec4{ 0, 0, 0, 0 }, 0.0f));
 }
 
+TEST_CASE(UncheckedDivision) {
+	// Same results as the checked operators for non zero divisors
+	ASSERT_CONDITION(equal(unchecked::divide(vec2{ 1, 3 }, vec2{ 2, 4 }), vec2{ 1, 3 } / vec2{ 2, 4 }));
+	ASSERT_CONDITION(equal(unchecked::divide(vec3{ 1, 2, 3 }, 4.0f), vec3{ 1, 2, 3 } / 4.0f));
+	ASSERT_CONDITION(equal(unchecked::divide(vec4{ 1, 2, 3, 4 }, vec4{ 2, 4, 8, 16 }), vec4{ 1, 2, 3, 4 } / vec4{ 2, 4, 8, 16 }));
+	ASSERT_CONDITION(equal(unchecked::divide(vec4{ 1, 2, 3, 4 }, 2.0f), vec4{ 1, 2, 3, 4 } / 2.0f));
+	ASSERT_CONDITION(equal(unchecked::modulo(vec3{ 5, 7, 9 }, vec3{ 2, 4, 5 }), vec3{ 5, 7, 9 } % vec3{ 2, 4, 5 }));
+	ASSERT_CONDITION(equal(unchecked::modulo(vec4{ 5, 5, 5, 5 }, 2.0f), 1.0f));
+
+	vec4 v4{ 4, 4, 4, 4 };
+	unchecked::divideAssign(v4, 2.0f);
+	ASSERT_CONDITION(equal(v4, 2.0f));
+	unchecked::moduloAssign(v4, vec4{ 3, 3, 3, 3 });
+	ASSERT_CONDITION(equal(v4, 2.0f));
+
+	// Zero divisors follow IEEE 754 instead of returning 0
+	vec4 inf = unchecked::divide(vec4{ 1, -1, 1, 1 }, vec4{ 0, 0, 1, 1 });
+	ASSERT_CONDITION(std::isinf(inf.x) && inf.x > 0 && std::isinf(inf.y) && inf.y < 0 && inf.z == 1);
+	ASSERT_CONDITION(std::isnan(unchecked::divide(vec2{ 0, 0 }, 0.0f).x));
+	ASSERT_CONDITION(std::isnan(unchecked::modulo(vec3{ 1, 1, 1 }, 0.0f).z));
+}
+
+TEST_CASE(FusedMultiplyAdd) {
+	ASSERT_CONDITION(lm2::fma(2.0f, 3.0f, 1.0f) == 7.0f);
+	ASSERT_CONDITION(equal(fma(vec2{ 1, 2 }, vec2{ 3, 4 }, vec2{ 1, 1 }), vec2{ 4, 9 }));
+	ASSERT_CONDITION(equal(fma(vec3{ 1, 2, 3 }, 2.0f, vec3{ 1, 1, 1 }), vec3{ 3, 5, 7 }));
+	ASSERT_CONDITION(equal(fma(vec4{ 1, 2, 3, 4 }, vec4{ 2, 2, 2, 2 }, vec4{ 0, 1, 0, 1 }), vec4{ 2, 5, 6, 9 }));
+	ASSERT_CONDITION(equal(fma(vec4{ 1, 2, 3, 4 }, 0.5f, vec4{ 1, 1, 1, 1 }), vec4{ 1, 2, 3, 4 } * 0.5f + vec4{ 1, 1, 1, 1 }));
+
+	ASSERT_CONDITION(lerp(2.0f, 4.0f, 0.5f) == 3.0f);
+	ASSERT_CONDITION(equal(lerp(vec2{ 0, 0 }, vec2{ 2, 4 }, 0.25f), vec2{ 0.5f, 1 }));
+	ASSERT_CONDITION(equal(lerp(vec3{ 1, 2, 3 }, vec3{ 3, 2, 1 }, 0.5f), 2.0f));
+	vec4 a{ 1, -2, 3, -4 };
+	vec4 b{ -5, 6, -7, 8 };
+	ASSERT_CONDITION(equal(lerp(a, b, 0.0f), a));
+	ASSERT_CONDITION(equal(lerp(a, b, 1.0f), b));
+	ASSERT_CONDITION(equal(lerp(a, b, 0.75f), a + (b - a) * 0.75f));
+
+	// Fused where the target has FMA, one rounding instead of two
+	float x = 1.0f + std::numeric_limits<float>::epsilon();
+	float fused = lm2::fma(x, x, -1.0f);
+	float exact = 2 * std::numeric_limits<float>::epsilon() + std::numeric_limits<float>::epsilon() * std::numeric_limits<float>::epsilon();
+	ASSERT_CONDITION(!detail::fastFma<float> || fused == exact);
+}
+
 TEST_CASE(VectorUnaryOperations) {
 	vec2 v2{ 5, 5 };
 
@@ -192,6 +237,33 @@ TEST_CASE(MatrixMatrixMultiplication) {
 	ASSERT_CONDITION(equal(posMat2 * vec4 { 1, 0, 1, 1 }, vec4{ 2, 2, 3, 1 }));
 }
 
+TEST_CASE(MatrixGeneralMultiplication) {
+	mat4 a{
+		{ 1, 2, 3, 4 },
+		{ 5, 6, 7, 8 },
+		{ 9, 10, 11, 12 },
+		{ 13, 14, 15, 16 },
+	};
+	mat4 b{
+		{ 2, 0, 1, 0 },
+		{ 0, 1, 0, 3 },
+		{ 1, 0, 2, 0 },
+		{ 0, 4, 0, 1 },
+	};
+	mat4 ab = a * b;
+	ASSERT_CONDITION(equal(ab.x, vec4{ 5, 18, 7, 10 }));
+	ASSERT_CONDITION(equal(ab.y, vec4{ 17, 38, 19, 26 }));
+	ASSERT_CONDITION(equal(ab.z, vec4{ 29, 58, 31, 42 }));
+	ASSERT_CONDITION(equal(ab.w, vec4{ 41, 78, 43, 58 }));
+
+	mat4 ai = a * identity4x4<float>();
+	ASSERT_CONDITION(equal(ai.x, a.x) && equal(ai.y, a.y) && equal(ai.z, a.z) && equal(ai.w, a.w));
+
+	ASSERT_CONDITION(equal(a * vec4{ 1, -1, 2, 0 }, vec4{ 5, 13, 21, 29 }));
+	ASSERT_CONDITION(equal(normalize(vec4{ 2, 0, 0, 0 }), vec4{ 1, 0, 0, 0 }));
+	ASSERT_CONDITION(equal(normalize(vec4{ 0, 0, 0, 0 }), 0.0f));
+}
+
 TEST_CASE(RotationMatrix) {
 	mat2 rot2D = rotation2D(90.0f);
 	ASSERT_CONDITION(equal(rot2D * vec2{ 1, 0 }, vec2{ 0, -1 }, 0.001f));
@@ -199,8 +271,115 @@ TEST_CASE(RotationMatrix) {
 	ASSERT_CONDITION(equal(rot3D * vec3{ 0, 1, 0 }, vec3{ 0, 0, -1 }, 0.001f));
 }
 
-int main() {
-	RUN_TESTS();
+TEST_CASE(MatrixInverse) {
+	mat4 general{
+		{ 2, 0, 1, 3 },
+		{ 1, 3, 0, -1 },
+		{ 0, 1, 4, 2 },
+		{ 1, 0, 2, 5 },
+	};
+	ASSERT_CONDITION(equal(transpose(transpose(general)), general));
+	ASSERT_CONDITION(transpose(general).x.y == general.y.x);
+	ASSERT_CONDITION(std::abs(determinant(general) - determinant(transpose(general))) < 0.0001f);
+	ASSERT_CONDITION(std::abs(determinant(position3d(vec3{ 1, 2, 3 })) - 1) < 0.0001f);
+	ASSERT_CONDITION(equal(general * inverse(general), identity4x4<float>()));
+	ASSERT_CONDITION(equal(inverse(general) * general, identity4x4<float>()));
+	ASSERT_CONDITION(equal(inverse(mat4{}), mat4{}));
+
+	mat3 general3{ { 2, 1, 0 }, { 0, 1, 3 }, { 1, 0, 1 } };
+	ASSERT_CONDITION(std::abs(determinant(general3) - 5) < 0.0001f);
+	ASSERT_CONDITION(equal(general3 * inverse(general3), identity3x3<float>()));
+	mat2 general2{ { 4, 7 }, { 2, 6 } };
+	ASSERT_CONDITION(equal(general2 * inverse(general2), mat2{ { 1, 0 }, { 0, 1 } }));
+
+	// Rotation and translation
+	mat4 rigid = position3d(vec3{ 1, -2, 3 }) * mat4(rotation3D(vec3{ 30, 45, -60 }));
+	ASSERT_CONDITION(equal(inverseRigid(rigid), inverse(rigid)));
+	ASSERT_CONDITION(equal(rigid * inverseRigid(rigid), identity4x4<float>()));
+
+	// Non uniform scale and shear
+	mat4 affine = rigid * mat4{ { 2, 0.5f, 0, 0 }, { 0, 3, 0, 0 }, { 0, 0, 0.5f, 0 }, { 0, 0, 0, 1 } };
+	ASSERT_CONDITION(equal(inverseAffine(affine), inverse(affine)));
+	ASSERT_CONDITION(equal(affine * inverseAffine(affine), identity4x4<float>()));
+
+	mat3 rigid2D = position2d(vec2{ 3, 4 }) * mat3(rotation2D(30.0f));
+	ASSERT_CONDITION(equal(inverseRigid(rigid2D), inverse(rigid2D)));
+	mat3 affine2D = rigid2D * mat3{ { 2, 1, 0 }, { 0, 0.5f, 0 }, { 0, 0, 1 } };
+	ASSERT_CONDITION(equal(inverseAffine(affine2D), inverse(affine2D)));
+}
+
+TEST_CASE(AffineMatrix) {
+	mat4 a4 = position3d(vec3{ 1, 2, 3 }) * mat4(rotation3D(vec3{ 30, -45, 60 }));
+	mat4 b4 = compose(vec3{ -4, 0, 2 }, quaternionEuler(vec3{ 10, 20, 30 }), vec3{ 2, 1, 0.5f });
+	mat3x4 a = mat3x4(a4);
+	mat3x4 b = mat3x4(b4);
+	ASSERT_CONDITION(equal(mat4(a), a4));
+	ASSERT_CONDITION(equal(mat4(a * b), a4 * b4));
+	ASSERT_CONDITION(equal(a * identity3x4<float>(), a));
+
+	vec3 p{ 1, -2, 0.5f };
+	vec4 p4 = a4 * vec4{ p.x, p.y, p.z, 1 };
+	ASSERT_CONDITION(equal(transformPoint(a, p), vec3{ p4.x, p4.y, p4.z }));
+	ASSERT_CONDITION(equal(a * vec4{ p.x, p.y, p.z, 1 }, vec3{ p4.x, p4.y, p4.z }));
+	vec4 d4 = a4 * vec4{ p.x, p.y, p.z, 0 };
+	ASSERT_CONDITION(equal(transformDirection(a, p), vec3{ d4.x, d4.y, d4.z }));
+
+	ASSERT_CONDITION(equal(mat4(inverse(b)), inverseAffine(b4)));
+	ASSERT_CONDITION(equal(inverse(b) * b, identity3x4<float>()));
+	ASSERT_CONDITION(equal(mat4(inverseRigid(a)), inverseRigid(a4)));
+	ASSERT_CONDITION(equal(inverse(mat3x4{}), mat3x4{}));
+	ASSERT_CONDITION(sizeof(mat3x4) == 48);
+}
+
+TEST_CASE(QuaternionBasics) {
+	quaternion q = quaternionAxisAngle(vec3{ 0, 0, 1 }, 90.0f);
+	ASSERT_CONDITION(std::abs(magnitude(q) - 1) < 0.0001f);
+	ASSERT_CONDITION(equal(q * vec3{ 1, 0, 0 }, vec3{ 0, 1, 0 }, 0.002f));
+	ASSERT_CONDITION(equal(conjugate(q) * (q * vec3{ 1, 2, 3 }), vec3{ 1, 2, 3 }));
+	ASSERT_CONDITION(equal(q * inverse(q), identityQuaternion<float>()));
+	ASSERT_CONDITION(equal(normalize(quaternion{ 0, 0, 0, 0 }), identityQuaternion<float>()));
+
+	// Composition applies the right hand side first
+	quaternion q2 = quaternionAxisAngle(vec3{ 1, 0, 0 }, 90.0f);
+	vec3 v{ 0, 1, 0 };
+	ASSERT_CONDITION(equal((q * q2) * v, q * (q2 * v)));
+
+	vec3 axis;
+	float degrees;
+	quaternion2axisAngle(quaternionAxisAngle(vec3{ 0, 1, 0 }, 30.0f), axis, degrees);
+	ASSERT_CONDITION(equal(axis, vec3{ 0, 1, 0 }));
+	ASSERT_CONDITION(std::abs(degrees - 30.0f) < 0.001f);
+}
+
+TEST_CASE(QuaternionMatrixEuler) {
+	vec3 angles{ 30.0f, -45.0f, 60.0f };
+	mat3 rot = rotation3D(angles);
+	quaternion q = quaternionEuler(angles);
+	mat3 fromQ = quaternion2matrix3x3(q);
+	ASSERT_CONDITION(equal(rot.x, fromQ.x) && equal(rot.y, fromQ.y) && equal(rot.z, fromQ.z));
+	ASSERT_CONDITION(equal(quaternion2euler(q), angles, 0.001f));
+	ASSERT_CONDITION(equal(rot * vec3{ 1, 2, 3 }, q * vec3{ 1, 2, 3 }));
+
+	quaternion back = matrix2quaternion(rot);
+	ASSERT_CONDITION(equal(back, q) || equal(-back, q));
+
+	mat4 rot4 = quaternion2matrix4x4(q);
+	ASSERT_CONDITION(equal(rot4 * vec4{ 1, 2, 3, 1 }, vec4{ fromQ.x.x + 2 * fromQ.x.y + 3 * fromQ.x.z, fromQ.y.x + 2 * fromQ.y.y + 3 * fromQ.y.z, fromQ.z.x + 2 * fromQ.z.y + 3 * fromQ.z.z, 1 }));
+}
+
+TEST_CASE(QuaternionInterpolation) {
+	quaternion a = identityQuaternion<float>();
+	quaternion b = quaternionAxisAngle(vec3{ 0, 1, 0 }, 90.0f);
+	ASSERT_CONDITION(equal(slerp(a, b, 0.0f), a));
+	ASSERT_CONDITION(equal(slerp(a, b, 1.0f), b));
+	ASSERT_CONDITION(equal(slerp(a, b, 0.5f), quaternionAxisAngle(vec3{ 0, 1, 0 }, 45.0f)));
+	ASSERT_CONDITION(equal(nlerp(a, b, 0.5f), quaternionAxisAngle(vec3{ 0, 1, 0 }, 45.0f)));
+
+	// Shortest path with a negated target
+	ASSERT_CONDITION(equal(slerp(a, -b, 0.5f), quaternionAxisAngle(vec3{ 0, 1, 0 }, 45.0f)));
+	ASSERT_CONDITION(equal(slerp(a, a, 0.3f), a));
+}
 
-	return 0;
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
 }
@@ -0,0 +1,68 @@
+#include "lm2.hpp"
+#include "lm2_transform.hpp"
+#include "testlib.hpp"
+
+using namespace lm2;
+
+TEST_CASE(ComposeDecompose) {
+	vec3 position{ 1, -2, 3 };
+	quaternion rotation = quaternionEuler(vec3{ 20, -35, 70 });
+	vec3 scale{ 2, 0.5f, 3 };
+	mat4 m = compose(position, rotation, scale);
+	ASSERT_CONDITION(equal(m, position3d(position) * quaternion2matrix4x4(rotation) * mat4(mat3{ { 2, 0, 0 }, { 0, 0.5f, 0 }, { 0, 0, 3 } })));
+
+	vec3 outPosition, outScale;
+	quaternion outRotation;
+	decompose(m, outPosition, outRotation, outScale);
+	ASSERT_CONDITION(equal(outPosition, position));
+	ASSERT_CONDITION(equal(outScale, scale));
+	ASSERT_CONDITION(equal(outRotation, rotation) || equal(-outRotation, rotation));
+
+	// Reflection
+	decompose(compose(position, rotation, vec3{ -1, 1, 1 }), outPosition, outRotation, outScale);
+	ASSERT_CONDITION(equal(outScale, vec3{ -1, 1, 1 }));
+	ASSERT_CONDITION(equal(outRotation, rotation) || equal(-outRotation, rotation));
+}
+
+TEST_CASE(TransformCachesMatrices) {
+	transform t(vec3{ 1, 2, 3 }, quaternionAxisAngle(vec3{ 0, 1, 0 }, 90.0f), vec3{ 2, 2, 2 });
+	ASSERT_CONDITION(t.isDirty());
+	const mat4& local = t.getLocalMatrix();
+	ASSERT_CONDITION(equal(local, compose(t.getPosition(), t.getRotation(), t.getScale())));
+	ASSERT_CONDITION(equal(t.getWorldMatrix(), local));
+	ASSERT_CONDITION(!t.isDirty());
+
+	t.translate(vec3{ 1, 0, 0 });
+	ASSERT_CONDITION(t.isDirty());
+	ASSERT_CONDITION(equal(t.getWorldPosition(), vec3{ 2, 2, 3 }));
+	ASSERT_CONDITION(!t.isDirty());
+
+	transform fromMatrix(t.getLocalMatrix());
+	ASSERT_CONDITION(equal(fromMatrix.getLocalMatrix(), t.getLocalMatrix()));
+}
+
+TEST_CASE(TransformHierarchy) {
+	transform root(vec3{ 10, 0, 0 });
+	transform child(vec3{ 0, 1, 0 }, quaternionAxisAngle(vec3{ 0, 0, 1 }, 90.0f));
+	transform grandChild(vec3{ 1, 0, 0 });
+	child.setParent(&root);
+	grandChild.setParent(&child);
+
+	ASSERT_CONDITION(equal(grandChild.getWorldMatrix(), root.getLocalMatrix() * child.getLocalMatrix() * grandChild.getLocalMatrix()));
+	ASSERT_CONDITION(equal(grandChild.getWorldPosition(), vec3{ 10, 2, 0 }, 0.01f));
+	ASSERT_CONDITION(!grandChild.isDirty());
+
+	// Moving the root is seen by every descendant
+	root.setPosition(vec3{ 0, 0, 5 });
+	ASSERT_CONDITION(grandChild.isDirty());
+	ASSERT_CONDITION(equal(grandChild.getWorldPosition(), vec3{ 0, 2, 5 }, 0.01f));
+	ASSERT_CONDITION(!child.isDirty());
+	ASSERT_CONDITION(equal(child.getWorldPosition(), vec3{ 0, 1, 5 }));
+
+	grandChild.setParent(nullptr);
+	ASSERT_CONDITION(equal(grandChild.getWorldMatrix(), grandChild.getLocalMatrix()));
+}
+
+int main(int argc, char** argv) {
+	return RUN_TESTS(argc, argv);
+}
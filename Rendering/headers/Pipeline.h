@@ -1,6 +1,7 @@
 #pragma once
 
 #include "lm2.hpp"
+#include "lm2_layout.hpp"
 
 #define VULKAN_HPP_NO_STRUCT_CONSTRUCTORS
 #include <vulkan/vulkan.hpp>
@@ -42,10 +43,16 @@ private:
 	std::vector<char> ReadFile(const char* filepath);
 };
 
+// Written straight into the mapped uniform buffer, must match MainMeshUB in forward.slang
 struct MainMeshUB {
-	lm2::mat4 model;
-	lm2::mat4 view;
-	lm2::mat4 proj;
+	lm2::alignedMat4 model;
+	lm2::alignedMat4 view;
+	lm2::alignedMat4 proj;
 };
+using MainMeshLayout = lm2::std140::layout<lm2::mat4, lm2::mat4, lm2::mat4>;
+static_assert(offsetof(MainMeshUB, model) == MainMeshLayout::offset(0));
+static_assert(offsetof(MainMeshUB, view) == MainMeshLayout::offset(1));
+static_assert(offsetof(MainMeshUB, proj) == MainMeshLayout::offset(2));
+static_assert(sizeof(MainMeshUB) == MainMeshLayout::size);
 
 } // namespace renderer
@@ -2,6 +2,22 @@
 
 #include "lm2.hpp"
 
+#include <cstddef>
+
+// Declared only, vertex.cpp includes the lm2 headers that define them
+namespace lm2 {
+	template<typename T> struct aabbT;
+	using aabb = aabbT<float>;
+	struct bvh;
+	class threadPool;
+	namespace soa {
+		template<typename T> struct vector2Stream;
+		template<typename T> struct vector3Stream;
+		using vec2Stream = vector2Stream<float>;
+		using vec3Stream = vector3Stream<float>;
+	} // namespace soa
+} // namespace lm2
+
 
 namespace renderer {
 
@@ -10,4 +26,22 @@ namespace renderer {
 		lm2::vec2 uv;
 	};
 
+	// Conversion between vertex arrays and lm2::soa streams for batch processing
+	void verticesToSoA(const vertex* vertices, size_t count, lm2::soa::vec3Stream& outPositions, lm2::soa::vec2Stream& outUVs);
+	void soaToVertices(const lm2::soa::vec3Stream& positions, const lm2::soa::vec2Stream& uvs, vertex* outVertices);
+
+	// Local space bounds of a mesh, used for frustum culling
+	lm2::aabb computeBounds(const vertex* vertices, size_t count);
+
+	// BVH over the triangle list of a mesh, for picking and line of sight queries
+	lm2::bvh buildBVH(const vertex* vertices, size_t count, lm2::threadPool* pool = nullptr);
+
+	// Smooth normals of a triangle list, corners at the same position share their normal
+	// Kept outside of vertex until the shaders light anything, so the vertex buffer does not grow
+	void generateNormals(const vertex* vertices, size_t count, lm2::vec3* outNormals, lm2::threadPool* pool = nullptr);
+	// MikkTSpace style tangents from pos, uv and normal, corners share a tangent only where all three
+	// match and the uvs are not mirrored between their triangles
+	// xyz points towards +u, bitangent = tangent.w * cross(normal, tangent.xyz)
+	void generateTangents(const vertex* vertices, const lm2::vec3* normals, size_t count, lm2::vec4* outTangents, lm2::threadPool* pool = nullptr);
+
 } // namespace renderer
\ No newline at end of file
@@ -168,7 +168,7 @@ void Pipeline::ApplyBasePass(vk::raii::CommandBuffer& commandBuffer, vk::raii::I
 		.pColorAttachments = &attachmentInfo
 	};
 
-	MainMeshUB ubo{
+	static constexpr MainMeshUB ubo{
 		lm2::position3d<float>({ 0.1f, 0, -5 }),
 		lm2::identity4x4<float>(),
 		//lm2::ortho<float>(1, 1, 0.5f, 15.0f),
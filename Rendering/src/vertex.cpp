@@ -0,0 +1,74 @@
+#include "vertex.h"
+
+#include "lm2_bounds.hpp"
+#include "lm2_bvh.hpp"
+#include "lm2_mesh.hpp"
+#include "lm2_parallel.hpp"
+#include "lm2_soa.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+using namespace renderer;
+
+void renderer::verticesToSoA(const vertex* vertices, size_t count, lm2::soa::vec3Stream& outPositions, lm2::soa::vec2Stream& outUVs) {
+	lm2::soa::fromAoS(&vertices->pos, count, outPositions, sizeof(vertex));
+	lm2::soa::fromAoS(&vertices->uv, count, outUVs, sizeof(vertex));
+}
+
+void renderer::soaToVertices(const lm2::soa::vec3Stream& positions, const lm2::soa::vec2Stream& uvs, vertex* outVertices) {
+	lm2::soa::toAoS(positions, &outVertices->pos, sizeof(vertex));
+	lm2::soa::toAoS(uvs, &outVertices->uv, sizeof(vertex));
+}
+
+
+lm2::aabb renderer::computeBounds(const vertex* vertices, size_t count) {
+	return lm2::computeAABB(&vertices->pos, count, sizeof(vertex));
+}
+
+lm2::bvh renderer::buildBVH(const vertex* vertices, size_t count, lm2::threadPool* pool) {
+	return lm2::buildBVH(&vertices->pos, count / 3, sizeof(vertex), nullptr, pool);
+}
+
+void renderer::generateNormals(const vertex* vertices, size_t count, lm2::vec3* outNormals, lm2::threadPool* pool) {
+	std::vector<lm2::vec3> positions(count);
+	for (size_t i = 0; i < count; i++) {
+		positions[i] = vertices[i].pos;
+	}
+	std::vector<uint32_t> remap(count);
+	lm2::mesh::weld(&positions.data()->x, count, 3, 0, remap.data(), pool);
+	lm2::mesh::computeNormals(positions.data(), count, remap.data(), count / 3, outNormals, lm2::mesh::normalWeight::angle, 0, pool);
+	// Only the first corner of a welded vertex got a normal, remap[i] <= i
+	for (size_t i = 0; i < count; i++) {
+		outNormals[i] = outNormals[remap[i]];
+	}
+}
+
+void renderer::generateTangents(const vertex* vertices, const lm2::vec3* normals, size_t count, lm2::vec4* outTangents, lm2::threadPool* pool) {
+	std::vector<lm2::vec3> positions(count);
+	std::vector<lm2::vec2> uvs(count);
+	// Weld key: pos, uv, normal and the winding of the triangle in uv space
+	constexpr size_t keySize = 9;
+	std::vector<float> keys(count * keySize);
+	for (size_t i = 0; i < count; i++) {
+		const vertex* triangle = vertices + i / 3 * 3;
+		lm2::vec2 e1 = triangle[1].uv - triangle[0].uv;
+		lm2::vec2 e2 = triangle[2].uv - triangle[0].uv;
+		float* key = keys.data() + i * keySize;
+		const vertex& v = vertices[i];
+		const lm2::vec3& n = normals[i];
+		float values[keySize] = { v.pos.x, v.pos.y, v.pos.z, v.uv.x, v.uv.y, n.x, n.y, n.z,
+			e1.x * e2.y - e2.x * e1.y < 0.0f ? -1.0f : 1.0f };
+		std::copy(values, values + keySize, key);
+		positions[i] = v.pos;
+		uvs[i] = v.uv;
+	}
+	std::vector<uint32_t> remap(count);
+	lm2::mesh::weld(keys.data(), count, keySize, 0, remap.data(), pool);
+	lm2::mesh::computeTangents(positions.data(), uvs.data(), normals, count, remap.data(), count / 3, outTangents, 0, pool);
+	for (size_t i = 0; i < count; i++) {
+		outTangents[i] = outTangents[remap[i]];
+	}
+}